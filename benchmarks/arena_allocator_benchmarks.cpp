@@ -0,0 +1,99 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_arena_allocator.h>
+#include <tsl/hopscotch_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+/*
+ * Build and teardown of a short-lived map, as done once per request by a
+ * server, with std::allocator, with tsl::hh::arena_allocator on a buffer and
+ * with tsl::pmr::hopscotch_map on a std::pmr::monotonic_buffer_resource using
+ * the same buffer. The argument is the number of elements inserted.
+ */
+namespace {
+
+using value_type = std::pair<std::uint64_t, std::uint64_t>;
+
+unsigned char buffer[1 << 20];
+
+template <class Map>
+void fill_map(Map& map, std::uint64_t nb_elements) {
+  for (std::uint64_t i = 0; i < nb_elements; i++) {
+    map.insert({i * 0x9E3779B97F4A7C15, i});
+  }
+
+  benchmark::DoNotOptimize(map.size());
+}
+
+void bm_request_map_std_allocator(benchmark::State& state) {
+  for (auto _ : state) {
+    tsl::hopscotch_map<std::uint64_t, std::uint64_t> map;
+    fill_map(map, std::uint64_t(state.range(0)));
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+void bm_request_map_arena_allocator(benchmark::State& state) {
+  using allocator_type = tsl::hh::arena_allocator<value_type>;
+
+  std::size_t heap_size = 0;
+  for (auto _ : state) {
+    tsl::hh::arena arena(buffer, sizeof(buffer));
+    {
+      tsl::hopscotch_map<std::uint64_t, std::uint64_t,
+                         std::hash<std::uint64_t>,
+                         std::equal_to<std::uint64_t>, allocator_type>
+          map{allocator_type(arena)};
+      fill_map(map, std::uint64_t(state.range(0)));
+    }
+    heap_size = arena.heap_size();
+  }
+
+  state.counters["heap_size"] = double(heap_size);
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+void bm_request_map_pmr(benchmark::State& state) {
+  for (auto _ : state) {
+    std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer));
+    tsl::pmr::hopscotch_map<std::uint64_t, std::uint64_t> map(&resource);
+    fill_map(map, std::uint64_t(state.range(0)));
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(bm_request_map_std_allocator)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK(bm_request_map_arena_allocator)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK(bm_request_map_pmr)->RangeMultiplier(8)->Range(8, 4096);
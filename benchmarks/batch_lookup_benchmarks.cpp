@@ -0,0 +1,123 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_map.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/*
+ * Compare a loop of find calls with find_batch, which hashes and prefetches
+ * the home buckets of a group of keys before looking them up. The largest
+ * maps don't fit in the last level cache, every lookup is a cache miss.
+ */
+namespace {
+
+using map_type = tsl::hopscotch_map<std::uint64_t, std::uint64_t>;
+
+struct batch_lookup_fixture {
+  explicit batch_lookup_fixture(std::size_t nb_keys) {
+    std::mt19937_64 generator(1);
+    keys.resize(nb_keys);
+    std::generate(keys.begin(), keys.end(), generator);
+
+    map.reserve(nb_keys);
+    for (std::size_t i = 0; i < keys.size(); i++) {
+      map.insert({keys[i], i});
+    }
+
+    // Half hits, half misses, in random order.
+    lookups = keys;
+    for (std::size_t i = 0; i < lookups.size(); i += 2) {
+      lookups[i] = generator();
+    }
+    std::shuffle(lookups.begin(), lookups.end(), generator);
+  }
+
+  std::vector<std::uint64_t> keys;
+  std::vector<std::uint64_t> lookups;
+  map_type map;
+};
+
+void bm_find_loop(benchmark::State& state) {
+  const batch_lookup_fixture fixture(std::size_t(state.range(0)));
+  const std::size_t batch_size = std::size_t(state.range(1));
+  std::vector<map_type::const_iterator> results(batch_size);
+
+  std::size_t offset = 0;
+  for (auto _ : state) {
+    for (std::size_t i = 0; i < batch_size; i++) {
+      results[i] = fixture.map.find(fixture.lookups[offset + i]);
+    }
+    benchmark::DoNotOptimize(results.data());
+    benchmark::ClobberMemory();
+
+    offset += batch_size;
+    if (offset + batch_size > fixture.lookups.size()) {
+      offset = 0;
+    }
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()) *
+                          std::int64_t(batch_size));
+}
+
+void bm_find_batch(benchmark::State& state) {
+  const batch_lookup_fixture fixture(std::size_t(state.range(0)));
+  const std::size_t batch_size = std::size_t(state.range(1));
+  std::vector<map_type::const_iterator> results(batch_size);
+
+  std::size_t offset = 0;
+  for (auto _ : state) {
+    const auto first = fixture.lookups.begin() + std::ptrdiff_t(offset);
+    fixture.map.find_batch(first, first + std::ptrdiff_t(batch_size),
+                           results.begin());
+    benchmark::DoNotOptimize(results.data());
+    benchmark::ClobberMemory();
+
+    offset += batch_size;
+    if (offset + batch_size > fixture.lookups.size()) {
+      offset = 0;
+    }
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()) *
+                          std::int64_t(batch_size));
+}
+
+void batch_lookup_arguments(benchmark::internal::Benchmark* benchmark) {
+  for (std::int64_t nb_keys : {1 << 16, 1 << 22, 1 << 24}) {
+    for (std::int64_t batch_size : {16, 256}) {
+      benchmark->Args({nb_keys, batch_size});
+    }
+  }
+}
+
+}  // namespace
+
+BENCHMARK(bm_find_loop)->Apply(batch_lookup_arguments);
+BENCHMARK(bm_find_batch)->Apply(batch_lookup_arguments);
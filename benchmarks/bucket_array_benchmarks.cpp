@@ -0,0 +1,85 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_map.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Cost of the bucket storage itself: reserve on an empty map, which allocates
+ * and initializes the buckets, and clear of a map with a few elements in a
+ * large bucket array which has already been filled once. The argument is the
+ * number of buckets.
+ */
+namespace {
+
+using map_type = tsl::hopscotch_map<std::uint64_t, std::uint64_t>;
+
+void bm_reserve(benchmark::State& state) {
+  for (auto _ : state) {
+    map_type map;
+    map.reserve(std::size_t(state.range(0)));
+    benchmark::DoNotOptimize(map.bucket_count());
+
+    state.PauseTiming();
+    map = map_type();
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+void bm_clear(benchmark::State& state) {
+  map_type map;
+  map.rehash(std::size_t(state.range(0)));
+  for (std::uint64_t i = 0; i < map.bucket_count() / 2; i++) {
+    map.insert({i, i});
+  }
+  map.clear();
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (std::uint64_t i = 0; i < 1000; i++) {
+      map.insert({i, i});
+    }
+    state.ResumeTiming();
+
+    map.clear();
+    benchmark::DoNotOptimize(map.bucket_count());
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(bm_reserve)
+    ->RangeMultiplier(16)
+    ->Range(1 << 16, 1 << 24)
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(bm_clear)
+    ->RangeMultiplier(16)
+    ->Range(1 << 16, 1 << 24)
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,105 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_map.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+/*
+ * Build a map from a range of random key-values with insert(first, last),
+ * bulk_build and bulk_build with tsl::hh::unique_keys. The argument is the
+ * number of elements.
+ */
+namespace {
+
+using map_type = tsl::hopscotch_map<std::uint64_t, std::uint64_t>;
+
+std::vector<std::pair<std::uint64_t, std::uint64_t>> make_values(
+    std::size_t nb_values) {
+  std::mt19937_64 generator(1);
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> values(nb_values);
+  for (std::size_t i = 0; i < nb_values; i++) {
+    values[i] = {generator(), i};
+  }
+
+  return values;
+}
+
+template <class BuildFunction>
+void bm_build(benchmark::State& state, BuildFunction build) {
+  const auto values = make_values(std::size_t(state.range(0)));
+
+  // Reuse the buckets array, the first touch of freshly allocated memory is
+  // expensive and the same for all the build methods.
+  map_type map;
+  map.reserve(values.size());
+  for (auto _ : state) {
+    build(map, values);
+    benchmark::DoNotOptimize(map.size());
+
+    state.PauseTiming();
+    map.clear();
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+void bm_range_insert(benchmark::State& state) {
+  bm_build(state, [](map_type& map, const auto& values) {
+    map.insert(values.begin(), values.end());
+  });
+}
+
+void bm_bulk_build(benchmark::State& state) {
+  bm_build(state, [](map_type& map, const auto& values) {
+    map.bulk_build(values.begin(), values.end());
+  });
+}
+
+void bm_bulk_build_unique_keys(benchmark::State& state) {
+  bm_build(state, [](map_type& map, const auto& values) {
+    map.bulk_build(tsl::hh::unique_keys, values.begin(), values.end());
+  });
+}
+
+}  // namespace
+
+BENCHMARK(bm_range_insert)
+    ->RangeMultiplier(8)
+    ->Range(1 << 14, 1 << 23)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_bulk_build)
+    ->RangeMultiplier(8)
+    ->Range(1 << 14, 1 << 23)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_bulk_build_unique_keys)
+    ->RangeMultiplier(8)
+    ->Range(1 << 14, 1 << 23)
+    ->Unit(benchmark::kMillisecond);
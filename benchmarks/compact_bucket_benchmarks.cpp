@@ -0,0 +1,103 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_hash_functions.h>
+#include <tsl/hopscotch_set.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Default neighborhood of 62 against compact_neighborhood_size: lookups in a
+ * set of std::uint32_t, whose buckets go from 16 to 8 bytes, the argument is
+ * the number of keys; and lookups of absent keys in a set of std::string with
+ * the 8-bit hash fragment of the compact neighborhood.
+ */
+namespace {
+
+template <class Key, unsigned int NeighborhoodSize>
+using set_type =
+    tsl::hopscotch_set<Key, tsl::hh::hash<Key>, std::equal_to<Key>,
+                       std::allocator<Key>, NeighborhoodSize>;
+
+template <unsigned int NeighborhoodSize>
+void bm_compact_find_uint32(benchmark::State& state) {
+  const std::uint32_t nb_keys = std::uint32_t(state.range(0));
+  set_type<std::uint32_t, NeighborhoodSize> set;
+  for (std::uint32_t i = 0; i < nb_keys; i++) {
+    set.insert(i);
+  }
+
+  std::uint32_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(set.find(i));
+    i = (i + 7919) % nb_keys;
+  }
+
+  state.counters["bytes"] = double(
+      set.bucket_count() *
+      sizeof(tsl::detail_hopscotch_hash::hopscotch_bucket<
+             std::uint32_t, NeighborhoodSize, false>));
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+template <unsigned int NeighborhoodSize>
+void bm_compact_find_miss_string(benchmark::State& state) {
+  const std::size_t nb_keys = 100000;
+  std::vector<std::string> absent_keys;
+  set_type<std::string, NeighborhoodSize> set;
+  for (std::size_t i = 0; i < nb_keys; i++) {
+    set.insert("tsl::hopscotch_set key " + std::to_string(i));
+    absent_keys.push_back("tsl::hopscotch_set key " +
+                          std::to_string(i + nb_keys));
+  }
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(set.find(absent_keys[i]));
+    i = (i + 7919) % nb_keys;
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+const unsigned int COMPACT_UINT32 =
+    tsl::hh::compact_neighborhood_size<std::uint32_t>::value;
+const unsigned int COMPACT_STRING =
+    tsl::hh::compact_neighborhood_size<std::string>::value;
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(bm_compact_find_uint32, 62)
+    ->RangeMultiplier(16)
+    ->Range(1 << 16, 1 << 24);
+BENCHMARK_TEMPLATE(bm_compact_find_uint32, COMPACT_UINT32)
+    ->RangeMultiplier(16)
+    ->Range(1 << 16, 1 << 24);
+BENCHMARK_TEMPLATE(bm_compact_find_miss_string, 62);
+BENCHMARK_TEMPLATE(bm_compact_find_miss_string, COMPACT_STRING);
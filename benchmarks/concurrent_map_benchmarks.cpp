@@ -0,0 +1,143 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/concurrent_hopscotch_map.h>
+#include <tsl/hopscotch_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+/*
+ * Throughput of concurrent_hopscotch_map against a tsl::hopscotch_map behind
+ * a std::shared_mutex, with several threads doing a mix of lookups and
+ * modifications (half insert_or_assign, half erase) on random keys. The
+ * arguments are the percentage of lookups and the number of keys in the map.
+ */
+namespace {
+
+using concurrent_map_type =
+    tsl::concurrent_hopscotch_map<std::uint64_t, std::uint64_t>;
+
+class locked_map_type {
+ public:
+  void reserve(std::size_t count) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_map.reserve(count);
+  }
+
+  bool insert_or_assign(std::uint64_t key, std::uint64_t value) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    return m_map.insert_or_assign(key, value).second;
+  }
+
+  std::size_t erase(std::uint64_t key) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    return m_map.erase(key);
+  }
+
+  bool find(std::uint64_t key, std::uint64_t& value) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_map.find(key);
+    if (it == m_map.end()) {
+      return false;
+    }
+
+    value = it->second;
+    return true;
+  }
+
+ private:
+  mutable std::shared_mutex m_mutex;
+  tsl::hopscotch_map<std::uint64_t, std::uint64_t> m_map;
+};
+
+/*
+ * Keys of the form mix(i) with i in [0, 2 * nb_keys), half of them are in the
+ * map at the start.
+ */
+std::uint64_t mix(std::uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  return x;
+}
+
+template <class Map>
+std::unique_ptr<Map> shared_map;
+
+template <class Map>
+void bm_mixed_read_write(benchmark::State& state) {
+  const std::uint64_t read_percent = std::uint64_t(state.range(0));
+  const std::uint64_t nb_keys = std::uint64_t(state.range(1));
+
+  // The threads wait for each other before and after the loop.
+  if (state.thread_index() == 0) {
+    shared_map<Map> = std::make_unique<Map>();
+    shared_map<Map>->reserve(2 * nb_keys);
+    for (std::uint64_t i = 0; i < nb_keys; i++) {
+      shared_map<Map>->insert_or_assign(mix(2 * i), i);
+    }
+  }
+
+  std::uint64_t random_state = std::uint64_t(state.thread_index()) + 1;
+  std::uint64_t value = 0;
+  for (auto _ : state) {
+    // xorshift64
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+
+    const std::uint64_t key = mix(random_state % (2 * nb_keys));
+    const std::uint64_t op = (random_state >> 32) % 200;
+    if (op < 2 * read_percent) {
+      benchmark::DoNotOptimize(shared_map<Map>->find(key, value));
+    } else if (op % 2 == 0) {
+      benchmark::DoNotOptimize(shared_map<Map>->insert_or_assign(key, op));
+    } else {
+      benchmark::DoNotOptimize(shared_map<Map>->erase(key));
+    }
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+  if (state.thread_index() == 0) {
+    shared_map<Map>.reset();
+  }
+}
+
+void mixed_args(benchmark::internal::Benchmark* benchmark) {
+  for (int read_percent : {50, 90, 99}) {
+    for (int nb_keys : {1 << 12, 1 << 20}) {
+      benchmark->Args({read_percent, nb_keys});
+    }
+  }
+  benchmark->ThreadRange(1, 8)->UseRealTime();
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(bm_mixed_read_write, concurrent_map_type)->Apply(mixed_args);
+BENCHMARK_TEMPLATE(bm_mixed_read_write, locked_map_type)->Apply(mixed_args);
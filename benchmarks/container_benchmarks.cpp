@@ -0,0 +1,352 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/bhopscotch_map.h>
+#include <tsl/hopscotch_hash_functions.h>
+#include <tsl/hopscotch_map.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <ratio>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Matrix of the containers (tsl::hopscotch_map, tsl::bhopscotch_map and their
+ * pg aliases), of the growth policies, of StoreHash (with a neighborhood of
+ * 30, its maximum) and of a few NeighborhoodSize, with std::int64_t,
+ * std::string and 64-byte struct keys. For each: insert, find of present and
+ * absent keys, erase, iteration and rehash, the argument is the number of
+ * elements. The "bytes" counter is the memory allocated by the container once
+ * filled, through its allocator (the characters of a long std::string key are
+ * not counted).
+ *
+ * Run with --benchmark_out=results.json --benchmark_out_format=json (or build
+ * the tsl_hopscotch_map_benchmarks_json target) to keep the results, e.g. to
+ * compare two versions with compare.py of Google Benchmark.
+ */
+namespace {
+
+/**
+ * Key of 64 bytes, expensive to compare and to move.
+ */
+struct large_key {
+  std::array<std::uint64_t, 8> data;
+
+  friend bool operator==(const large_key& lhs, const large_key& rhs) {
+    return lhs.data == rhs.data;
+  }
+
+  friend bool operator<(const large_key& lhs, const large_key& rhs) {
+    return lhs.data < rhs.data;
+  }
+};
+
+}  // namespace
+
+namespace std {
+template <>
+struct hash<large_key> {
+  std::size_t operator()(const large_key& key) const {
+    return std::size_t(tsl::hh::hash_bytes(key.data.data(), sizeof(key.data)));
+  }
+};
+}  // namespace std
+
+namespace {
+
+std::size_t allocated_bytes = 0;
+
+/**
+ * malloc/calloc allocator counting the bytes currently allocated in
+ * allocated_bytes. It provides allocate_zeroed as the buckets array would use
+ * calloc with std::allocator.
+ */
+template <class T>
+class counting_allocator {
+ public:
+  using value_type = T;
+
+  counting_allocator() = default;
+
+  template <class U>
+  counting_allocator(const counting_allocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n) { return checked(std::malloc(n * sizeof(T)), n); }
+
+  T* allocate_zeroed(std::size_t n) {
+    return checked(std::calloc(n, sizeof(T)), n);
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept {
+    allocated_bytes -= n * sizeof(T);
+    std::free(p);
+  }
+
+  friend bool operator==(const counting_allocator&,
+                         const counting_allocator&) noexcept {
+    return true;
+  }
+
+  friend bool operator!=(const counting_allocator&,
+                         const counting_allocator&) noexcept {
+    return false;
+  }
+
+ private:
+  static T* checked(void* p, std::size_t n) {
+    if (p == nullptr) {
+      throw std::bad_alloc();
+    }
+
+    allocated_bytes += n * sizeof(T);
+    return static_cast<T*>(p);
+  }
+};
+
+std::uint64_t random_value(std::uint64_t i) {
+  // splitmix64
+  std::uint64_t z = i + 0x9E3779B97F4A7C15ull;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+template <class Key>
+Key make_key(std::uint64_t i);
+
+template <>
+std::int64_t make_key<std::int64_t>(std::uint64_t i) {
+  return std::int64_t(random_value(i));
+}
+
+template <>
+std::string make_key<std::string>(std::uint64_t i) {
+  return "tsl::hopscotch_map key " + std::to_string(random_value(i));
+}
+
+template <>
+large_key make_key<large_key>(std::uint64_t i) {
+  large_key key;
+  for (std::size_t j = 0; j < key.data.size(); j++) {
+    key.data[j] = random_value(i * key.data.size() + j);
+  }
+
+  return key;
+}
+
+template <class Key>
+using allocator_t = counting_allocator<std::pair<Key, std::uint64_t>>;
+
+template <class Key>
+struct maps {
+  using hopscotch = tsl::hopscotch_map<Key, std::uint64_t, std::hash<Key>,
+                                       std::equal_to<Key>, allocator_t<Key>>;
+  using store_hash =
+      tsl::hopscotch_map<Key, std::uint64_t, std::hash<Key>,
+                         std::equal_to<Key>, allocator_t<Key>, 30, true>;
+  using neighborhood_10 =
+      tsl::hopscotch_map<Key, std::uint64_t, std::hash<Key>,
+                         std::equal_to<Key>, allocator_t<Key>, 10>;
+  using neighborhood_30 =
+      tsl::hopscotch_map<Key, std::uint64_t, std::hash<Key>,
+                         std::equal_to<Key>, allocator_t<Key>, 30>;
+  using pg = tsl::hopscotch_pg_map<Key, std::uint64_t, std::hash<Key>,
+                                   std::equal_to<Key>, allocator_t<Key>>;
+  using mod = tsl::hopscotch_map<Key, std::uint64_t, std::hash<Key>,
+                                 std::equal_to<Key>, allocator_t<Key>, 62,
+                                 false, tsl::hh::mod_growth_policy<>>;
+  using fastrange =
+      tsl::hopscotch_map<Key, std::uint64_t, std::hash<Key>,
+                         std::equal_to<Key>, allocator_t<Key>, 62, false,
+                         tsl::hh::fastrange_growth_policy<>>;
+  using b = tsl::bhopscotch_map<Key, std::uint64_t, std::hash<Key>,
+                                std::equal_to<Key>, std::less<Key>,
+                                allocator_t<Key>>;
+  using bpg = tsl::bhopscotch_pg_map<Key, std::uint64_t, std::hash<Key>,
+                                     std::equal_to<Key>, std::less<Key>,
+                                     allocator_t<Key>>;
+};
+
+template <class Map>
+std::vector<typename Map::key_type> make_keys(std::size_t nb_keys,
+                                              std::uint64_t first) {
+  std::vector<typename Map::key_type> keys;
+  keys.reserve(nb_keys);
+  for (std::size_t i = 0; i < nb_keys; i++) {
+    keys.push_back(make_key<typename Map::key_type>(first + i));
+  }
+
+  return keys;
+}
+
+template <class Map>
+Map make_map(const std::vector<typename Map::key_type>& keys) {
+  Map map;
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    map.insert({keys[i], i});
+  }
+
+  return map;
+}
+
+template <class Map>
+void set_memory_counters(benchmark::State& state, const Map& map) {
+  state.counters["bytes"] = double(allocated_bytes);
+  state.counters["bytes_per_element"] =
+      double(allocated_bytes) / double(map.size());
+}
+
+template <class Map>
+void bm_insert(benchmark::State& state) {
+  const auto keys = make_keys<Map>(std::size_t(state.range(0)), 0);
+
+  for (auto _ : state) {
+    Map map;
+    for (std::size_t i = 0; i < keys.size(); i++) {
+      map.insert({keys[i], i});
+    }
+    benchmark::DoNotOptimize(map);
+
+    state.PauseTiming();
+    set_memory_counters(state, map);
+    map = Map();
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+template <class Map>
+void bm_find_hit(benchmark::State& state) {
+  const std::size_t nb_keys = std::size_t(state.range(0));
+  const auto keys = make_keys<Map>(nb_keys, 0);
+  const Map map = make_map<Map>(keys);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(keys[i]));
+    i = (i + 7919) % nb_keys;
+  }
+
+  set_memory_counters(state, map);
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+template <class Map>
+void bm_find_miss(benchmark::State& state) {
+  const std::size_t nb_keys = std::size_t(state.range(0));
+  const Map map = make_map<Map>(make_keys<Map>(nb_keys, 0));
+  const auto absent_keys = make_keys<Map>(nb_keys, nb_keys);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(absent_keys[i]));
+    i = (i + 7919) % nb_keys;
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+template <class Map>
+void bm_erase(benchmark::State& state) {
+  const auto keys = make_keys<Map>(std::size_t(state.range(0)), 0);
+  const Map full_map = make_map<Map>(keys);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    Map map = full_map;
+    state.ResumeTiming();
+
+    for (const auto& key : keys) {
+      map.erase(key);
+    }
+    benchmark::DoNotOptimize(map);
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+template <class Map>
+void bm_iterate(benchmark::State& state) {
+  const Map map =
+      make_map<Map>(make_keys<Map>(std::size_t(state.range(0)), 0));
+
+  for (auto _ : state) {
+    std::uint64_t sum = 0;
+    for (const auto& key_value : map) {
+      sum += key_value.second;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+template <class Map>
+void bm_rehash(benchmark::State& state) {
+  const Map full_map =
+      make_map<Map>(make_keys<Map>(std::size_t(state.range(0)), 0));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    Map map = full_map;
+    state.ResumeTiming();
+
+    map.rehash(map.bucket_count() * 2);
+    benchmark::DoNotOptimize(map);
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+}  // namespace
+
+#define TSL_HH_CONTAINER_BENCHMARKS(MAP)                            \
+  BENCHMARK_TEMPLATE(bm_insert, MAP)->Arg(1 << 10)->Arg(1 << 18);    \
+  BENCHMARK_TEMPLATE(bm_find_hit, MAP)->Arg(1 << 10)->Arg(1 << 18);  \
+  BENCHMARK_TEMPLATE(bm_find_miss, MAP)->Arg(1 << 10)->Arg(1 << 18); \
+  BENCHMARK_TEMPLATE(bm_erase, MAP)->Arg(1 << 10)->Arg(1 << 18);     \
+  BENCHMARK_TEMPLATE(bm_iterate, MAP)->Arg(1 << 10)->Arg(1 << 18);   \
+  BENCHMARK_TEMPLATE(bm_rehash, MAP)->Arg(1 << 10)->Arg(1 << 18)
+
+#define TSL_HH_CONTAINER_BENCHMARKS_FOR_KEY(KEY)            \
+  TSL_HH_CONTAINER_BENCHMARKS(maps<KEY>::hopscotch);        \
+  TSL_HH_CONTAINER_BENCHMARKS(maps<KEY>::store_hash);       \
+  TSL_HH_CONTAINER_BENCHMARKS(maps<KEY>::neighborhood_10);  \
+  TSL_HH_CONTAINER_BENCHMARKS(maps<KEY>::neighborhood_30);  \
+  TSL_HH_CONTAINER_BENCHMARKS(maps<KEY>::pg);               \
+  TSL_HH_CONTAINER_BENCHMARKS(maps<KEY>::mod);              \
+  TSL_HH_CONTAINER_BENCHMARKS(maps<KEY>::fastrange);        \
+  TSL_HH_CONTAINER_BENCHMARKS(maps<KEY>::b);                \
+  TSL_HH_CONTAINER_BENCHMARKS(maps<KEY>::bpg)
+
+TSL_HH_CONTAINER_BENCHMARKS_FOR_KEY(std::int64_t);
+TSL_HH_CONTAINER_BENCHMARKS_FOR_KEY(std::string);
+TSL_HH_CONTAINER_BENCHMARKS_FOR_KEY(large_key);
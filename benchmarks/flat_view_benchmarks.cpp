@@ -0,0 +1,131 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_map.h>
+#include <tsl/hopscotch_map_view.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+
+/*
+ * Compare building a map from its elements with opening a
+ * tsl::hopscotch_map_view on a file written by flat_serialize, and the lookups
+ * in both. The argument is the number of elements.
+ */
+namespace {
+
+using map_type = tsl::hopscotch_map<std::uint64_t, std::uint64_t>;
+using map_view_type = tsl::hopscotch_map_view<std::uint64_t, std::uint64_t>;
+
+const char* const flat_file_path = "tsl_hopscotch_flat_benchmark.bin";
+
+std::vector<std::uint64_t> make_keys(std::size_t nb_elements) {
+  std::mt19937_64 generator(1);
+  std::vector<std::uint64_t> keys(nb_elements);
+  for (auto& key : keys) {
+    key = generator();
+  }
+
+  return keys;
+}
+
+map_type make_map(const std::vector<std::uint64_t>& keys) {
+  map_type map;
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    map.insert({keys[i], i});
+  }
+
+  return map;
+}
+
+void write_flat_file(const map_type& map) {
+  std::ofstream file(flat_file_path, std::ios::binary | std::ios::trunc);
+  auto writer = [&](const void* data, std::size_t size) {
+    file.write(static_cast<const char*>(data),
+               static_cast<std::streamsize>(size));
+  };
+  map.flat_serialize(writer);
+}
+
+void bm_build_map(benchmark::State& state) {
+  const auto keys = make_keys(std::size_t(state.range(0)));
+  for (auto _ : state) {
+    const map_type map = make_map(keys);
+    benchmark::DoNotOptimize(map.size());
+  }
+}
+
+void bm_open_view(benchmark::State& state) {
+  const auto keys = make_keys(std::size_t(state.range(0)));
+  write_flat_file(make_map(keys));
+
+  for (auto _ : state) {
+    const map_view_type view(flat_file_path);
+    benchmark::DoNotOptimize(view.find(keys.front()));
+  }
+
+  std::remove(flat_file_path);
+}
+
+template <class Map>
+void find_all(benchmark::State& state, const Map& map,
+              const std::vector<std::uint64_t>& keys) {
+  for (auto _ : state) {
+    for (const std::uint64_t key : keys) {
+      benchmark::DoNotOptimize(map.find(key));
+    }
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()) *
+                          std::int64_t(keys.size()));
+}
+
+void bm_find_map(benchmark::State& state) {
+  const auto keys = make_keys(std::size_t(state.range(0)));
+  const map_type map = make_map(keys);
+  find_all(state, map, keys);
+}
+
+void bm_find_view(benchmark::State& state) {
+  const auto keys = make_keys(std::size_t(state.range(0)));
+  write_flat_file(make_map(keys));
+
+  {
+    const map_view_type view(flat_file_path);
+    find_all(state, view, keys);
+  }
+
+  std::remove(flat_file_path);
+}
+
+}  // namespace
+
+BENCHMARK(bm_build_map)->Arg(1 << 22)->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_open_view)->Arg(1 << 22)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bm_find_map)->Arg(1 << 22)->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_find_view)->Arg(1 << 22)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,130 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_hash_functions.h>
+#include <tsl/hopscotch_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+/*
+ * Lookups of random integer keys with each growth policy. The argument is the
+ * number of keys; the map is not reserved, its load factor is the one left by
+ * the growth of the policy. The hash is either std::hash (the identity with
+ * libstdc++, mixed by the map with power_of_two_growth_policy and
+ * fastrange_growth_policy) or tsl::hh::hash.
+ */
+namespace {
+
+template <class Hash, class GrowthPolicy>
+using map_type =
+    tsl::hopscotch_map<std::uint64_t, std::uint64_t, Hash,
+                       std::equal_to<std::uint64_t>,
+                       std::allocator<std::pair<std::uint64_t, std::uint64_t>>,
+                       62, false, GrowthPolicy>;
+
+template <class Hash, class GrowthPolicy>
+void bm_policy_find(benchmark::State& state) {
+  const std::size_t nb_keys = std::size_t(state.range(0));
+
+  std::mt19937_64 generator(42);
+  std::vector<std::uint64_t> keys;
+  map_type<Hash, GrowthPolicy> map;
+  for (std::size_t i = 0; i < nb_keys; i++) {
+    keys.push_back(generator());
+    map.insert({keys.back(), i});
+  }
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(keys[i]));
+    i = (i + 7919) % nb_keys;
+  }
+
+  state.counters["buckets"] = double(map.bucket_count());
+  state.counters["load_factor"] = double(map.load_factor());
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+template <class Hash, class GrowthPolicy>
+void bm_policy_find_miss(benchmark::State& state) {
+  const std::size_t nb_keys = std::size_t(state.range(0));
+
+  std::mt19937_64 generator(42);
+  map_type<Hash, GrowthPolicy> map;
+  for (std::size_t i = 0; i < nb_keys; i++) {
+    map.insert({generator(), i});
+  }
+
+  std::vector<std::uint64_t> missing_keys;
+  for (std::size_t i = 0; i < nb_keys; i++) {
+    missing_keys.push_back(generator());
+  }
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(missing_keys[i]));
+    i = (i + 7919) % nb_keys;
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+using power_of_two = tsl::hh::power_of_two_growth_policy<2>;
+using prime = tsl::hh::prime_growth_policy;
+using mod = tsl::hh::mod_growth_policy<>;
+using fastrange = tsl::hh::fastrange_growth_policy<>;
+
+using std_hash = std::hash<std::uint64_t>;
+using tsl_hash = tsl::hh::hash<std::uint64_t>;
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(bm_policy_find, std_hash, power_of_two)
+    ->Arg(1000)
+    ->Arg(1000000);
+BENCHMARK_TEMPLATE(bm_policy_find, std_hash, prime)->Arg(1000)->Arg(1000000);
+BENCHMARK_TEMPLATE(bm_policy_find, std_hash, mod)->Arg(1000)->Arg(1000000);
+BENCHMARK_TEMPLATE(bm_policy_find, std_hash, fastrange)
+    ->Arg(1000)
+    ->Arg(1000000);
+BENCHMARK_TEMPLATE(bm_policy_find, tsl_hash, power_of_two)
+    ->Arg(1000)
+    ->Arg(1000000);
+BENCHMARK_TEMPLATE(bm_policy_find, tsl_hash, prime)->Arg(1000)->Arg(1000000);
+BENCHMARK_TEMPLATE(bm_policy_find, tsl_hash, mod)->Arg(1000)->Arg(1000000);
+BENCHMARK_TEMPLATE(bm_policy_find, tsl_hash, fastrange)
+    ->Arg(1000)
+    ->Arg(1000000);
+
+BENCHMARK_TEMPLATE(bm_policy_find_miss, tsl_hash, power_of_two)
+    ->Arg(1000000);
+BENCHMARK_TEMPLATE(bm_policy_find_miss, tsl_hash, prime)->Arg(1000000);
+BENCHMARK_TEMPLATE(bm_policy_find_miss, tsl_hash, mod)->Arg(1000000);
+BENCHMARK_TEMPLATE(bm_policy_find_miss, tsl_hash, fastrange)->Arg(1000000);
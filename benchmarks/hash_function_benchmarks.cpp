@@ -0,0 +1,125 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_hash_functions.h>
+#include <tsl/hopscotch_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * tsl::hh::hash against std::hash: hashing throughput of strings of the length
+ * given in argument, then lookups in maps with each growth policy. The integer
+ * keys are multiples of KEY_STRIDE, which std::hash (the identity with
+ * libstdc++) maps to a few buckets with power_of_two_growth_policy. The string
+ * keys are the decimal representation of an integer with a common prefix.
+ */
+namespace {
+
+const std::uint64_t KEY_STRIDE = 32;
+const std::size_t NB_KEYS = 100000;
+
+template <class Hash>
+void bm_hash_string(benchmark::State& state) {
+  const std::string str(std::size_t(state.range(0)), 'a');
+  const Hash hash;
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(hash(std::string_view(str)));
+  }
+
+  state.SetBytesProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+template <class Key>
+Key make_key(std::uint64_t i) {
+  if constexpr (std::is_same<Key, std::string>::value) {
+    return "tsl::hopscotch_map key " + std::to_string(i);
+  } else {
+    return Key(i * KEY_STRIDE);
+  }
+}
+
+template <class Key, class Hash, class GrowthPolicy>
+void bm_hash_find(benchmark::State& state) {
+  using map_type =
+      tsl::hopscotch_map<Key, std::uint64_t, Hash, std::equal_to<Key>,
+                         std::allocator<std::pair<Key, std::uint64_t>>, 62,
+                         false, GrowthPolicy>;
+
+  std::vector<Key> keys;
+  map_type map;
+  for (std::uint64_t i = 0; i < NB_KEYS; i++) {
+    keys.push_back(make_key<Key>(i));
+    map.insert({keys.back(), i});
+  }
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(keys[i]));
+    i = (i + 7919) % NB_KEYS;
+  }
+
+  state.counters["buckets"] = double(map.bucket_count());
+  state.counters["overflow"] = double(map.overflow_size());
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+using power_of_two = tsl::hh::power_of_two_growth_policy<2>;
+using prime = tsl::hh::prime_growth_policy;
+using mod = tsl::hh::mod_growth_policy<>;
+
+using std_int_hash = std::hash<std::uint64_t>;
+using tsl_int_hash = tsl::hh::hash<std::uint64_t>;
+using std_string_hash = std::hash<std::string>;
+using tsl_string_hash = tsl::hh::hash<std::string>;
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(bm_hash_string, std::hash<std::string_view>)
+    ->RangeMultiplier(4)
+    ->Range(8, 4096);
+BENCHMARK_TEMPLATE(bm_hash_string, tsl::hh::hash<std::string_view>)
+    ->RangeMultiplier(4)
+    ->Range(8, 4096);
+
+BENCHMARK_TEMPLATE(bm_hash_find, std::uint64_t, std_int_hash, power_of_two);
+BENCHMARK_TEMPLATE(bm_hash_find, std::uint64_t, tsl_int_hash, power_of_two);
+BENCHMARK_TEMPLATE(bm_hash_find, std::uint64_t, std_int_hash, prime);
+BENCHMARK_TEMPLATE(bm_hash_find, std::uint64_t, tsl_int_hash, prime);
+BENCHMARK_TEMPLATE(bm_hash_find, std::uint64_t, std_int_hash, mod);
+BENCHMARK_TEMPLATE(bm_hash_find, std::uint64_t, tsl_int_hash, mod);
+BENCHMARK_TEMPLATE(bm_hash_find, std::string, std_string_hash, power_of_two);
+BENCHMARK_TEMPLATE(bm_hash_find, std::string, tsl_string_hash, power_of_two);
+BENCHMARK_TEMPLATE(bm_hash_find, std::string, std_string_hash, prime);
+BENCHMARK_TEMPLATE(bm_hash_find, std::string, tsl_string_hash, prime);
+BENCHMARK_TEMPLATE(bm_hash_find, std::string, std_string_hash, mod);
+BENCHMARK_TEMPLATE(bm_hash_find, std::string, tsl_string_hash, mod);
@@ -0,0 +1,108 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/*
+ * Insertion and lookups of integer keys i << shift with std::hash, the
+ * identity with libstdc++, and power_of_two_growth_policy. std::hash is mixed
+ * by the map, identity_hash is the same hash declared as avalanching and is
+ * used as is. The arguments are the number of keys and the shift.
+ */
+namespace {
+
+struct identity_hash {
+  using is_avalanching = void;
+
+  std::size_t operator()(std::uint64_t key) const noexcept {
+    return std::size_t(key);
+  }
+};
+
+template <class Hash>
+using map_type = tsl::hopscotch_map<std::uint64_t, std::uint64_t, Hash>;
+
+template <class Hash>
+void bm_mixing_insert(benchmark::State& state) {
+  const std::uint64_t nb_keys = std::uint64_t(state.range(0));
+  const std::uint64_t shift = std::uint64_t(state.range(1));
+
+  std::size_t bucket_count = 0;
+  std::size_t overflow_size = 0;
+  for (auto _ : state) {
+    map_type<Hash> map;
+    for (std::uint64_t i = 0; i < nb_keys; i++) {
+      map.insert({i << shift, i});
+    }
+
+    bucket_count = map.bucket_count();
+    overflow_size = map.overflow_size();
+
+    state.PauseTiming();
+    map = map_type<Hash>();
+    state.ResumeTiming();
+  }
+
+  state.counters["buckets"] = double(bucket_count);
+  state.counters["overflow"] = double(overflow_size);
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+template <class Hash>
+void bm_mixing_find(benchmark::State& state) {
+  const std::uint64_t nb_keys = std::uint64_t(state.range(0));
+  const std::uint64_t shift = std::uint64_t(state.range(1));
+
+  map_type<Hash> map;
+  for (std::uint64_t i = 0; i < nb_keys; i++) {
+    map.insert({i << shift, i});
+  }
+
+  std::uint64_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(i << shift));
+    i = (i + 7919) % nb_keys;
+  }
+
+  state.counters["buckets"] = double(map.bucket_count());
+  state.counters["overflow"] = double(map.overflow_size());
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(bm_mixing_insert, std::hash<std::uint64_t>)
+    ->ArgsProduct({{10000}, {0, 6, 12}})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(bm_mixing_insert, identity_hash)
+    ->ArgsProduct({{10000}, {0, 6, 12}})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(bm_mixing_find, std::hash<std::uint64_t>)
+    ->ArgsProduct({{10000}, {0, 6, 12}});
+BENCHMARK_TEMPLATE(bm_mixing_find, identity_hash)
+    ->ArgsProduct({{10000}, {0, 6, 12}});
@@ -0,0 +1,102 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_hash_functions.h>
+#include <tsl/hopscotch_huge_page_allocator.h>
+#include <tsl/hopscotch_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+/*
+ * Random lookups in a map whose bucket array is far larger than what the TLB
+ * covers with 4 KiB pages (a few MiB), with std::allocator and with
+ * tsl::hh::huge_page_allocator. The argument is the number of keys, the
+ * bucket array has between 1.1 and 2.2 buckets of 24 bytes per key.
+ */
+namespace {
+
+using value_type = std::pair<std::uint64_t, std::uint64_t>;
+
+template <class Allocator>
+using map_type = tsl::hopscotch_map<std::uint64_t, std::uint64_t,
+                                    tsl::hh::hash<std::uint64_t>,
+                                    std::equal_to<std::uint64_t>, Allocator>;
+
+template <class Allocator>
+void bm_huge_page_find(benchmark::State& state) {
+  const std::size_t nb_keys = std::size_t(state.range(0));
+
+  std::mt19937_64 generator(42);
+  std::vector<std::uint64_t> keys;
+  map_type<Allocator> map;
+  map.reserve(nb_keys);
+  for (std::size_t i = 0; i < nb_keys; i++) {
+    keys.push_back(generator());
+    map.insert({keys.back(), i});
+  }
+
+  // Random order of the lookups, each one touches a new page.
+  std::vector<std::uint32_t> lookup_order(nb_keys);
+  for (std::size_t i = 0; i < nb_keys; i++) {
+    lookup_order[i] = std::uint32_t(generator() % nb_keys);
+  }
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(keys[lookup_order[i]]));
+    if (++i == nb_keys) {
+      i = 0;
+    }
+  }
+
+  state.counters["buckets"] = double(map.bucket_count());
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+using std_allocator = std::allocator<value_type>;
+using huge_page_allocator = tsl::hh::huge_page_allocator<value_type>;
+using huge_page_interleave_allocator =
+    tsl::hh::huge_page_allocator<value_type, std::size_t(2) << 20,
+                                 tsl::hh::numa_policy::interleave>;
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(bm_huge_page_find, std_allocator)
+    ->Arg(1 << 16)
+    ->Arg(1 << 22)
+    ->Arg(1 << 24);
+BENCHMARK_TEMPLATE(bm_huge_page_find, huge_page_allocator)
+    ->Arg(1 << 16)
+    ->Arg(1 << 22)
+    ->Arg(1 << 24);
+BENCHMARK_TEMPLATE(bm_huge_page_find, huge_page_interleave_allocator)
+    ->Arg(1 << 16)
+    ->Arg(1 << 22)
+    ->Arg(1 << 24);
@@ -0,0 +1,105 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_map.h>
+#include <tsl/incremental_hopscotch_map.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/*
+ * Insert random keys one by one in an empty map and time each insertion.
+ * Report the mean, the 99th and 99.99th percentiles and the maximum of the
+ * insertion latencies, in nanoseconds, as counters. The argument is the number
+ * of keys.
+ */
+namespace {
+
+template <class Map>
+void bm_insert_latency(benchmark::State& state) {
+  using clock = std::chrono::steady_clock;
+
+  const std::size_t nb_elements = std::size_t(state.range(0));
+  std::mt19937_64 generator(1);
+  std::vector<std::uint64_t> keys(nb_elements);
+  for (auto& key : keys) {
+    key = generator();
+  }
+
+  std::vector<double> latencies(nb_elements);
+  std::vector<double> all_latencies;
+  for (auto _ : state) {
+    Map map;
+    for (std::size_t i = 0; i < nb_elements; i++) {
+      const auto start = clock::now();
+      map.insert({keys[i], i});
+      const auto end = clock::now();
+
+      latencies[i] = std::chrono::duration<double, std::nano>(end - start)
+                         .count();
+    }
+    benchmark::DoNotOptimize(map.size());
+
+    state.PauseTiming();
+    all_latencies.insert(all_latencies.end(), latencies.begin(),
+                         latencies.end());
+    map = Map();
+    state.ResumeTiming();
+  }
+
+  std::sort(all_latencies.begin(), all_latencies.end());
+  const auto percentile = [&](double p) {
+    return all_latencies[std::size_t(p * double(all_latencies.size() - 1))];
+  };
+
+  double sum = 0;
+  for (const double latency : all_latencies) {
+    sum += latency;
+  }
+
+  state.counters["mean_ns"] = sum / double(all_latencies.size());
+  state.counters["p99_ns"] = percentile(0.99);
+  state.counters["p99.99_ns"] = percentile(0.9999);
+  state.counters["max_ns"] = all_latencies.back();
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+using map_type = tsl::hopscotch_map<std::uint64_t, std::uint64_t>;
+using incremental_map_type =
+    tsl::incremental_hopscotch_map<std::uint64_t, std::uint64_t>;
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(bm_insert_latency, map_type)
+    ->Arg(1 << 22)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(bm_insert_latency, incremental_map_type)
+    ->Arg(1 << 22)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
@@ -0,0 +1,145 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_map.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Lookup benchmarks stressing hopscotch_hash::find_in_buckets, the neighborhood
+ * probe, with NeighborhoodSize 30 (StoreHash true, the stored hashes are used
+ * to filter the candidates) and 62 (StoreHash false).
+ */
+namespace {
+
+template <class Key>
+Key make_key(std::uint64_t value);
+
+template <>
+std::uint64_t make_key<std::uint64_t>(std::uint64_t value) {
+  return value;
+}
+
+template <>
+std::string make_key<std::string>(std::uint64_t value) {
+  // Long common prefix so that each key comparison is costly.
+  return "neighborhood_probe_benchmark_key_" + std::to_string(value);
+}
+
+template <class Key>
+std::vector<Key> make_keys(std::size_t nb_keys, std::uint64_t seed) {
+  std::mt19937_64 generator(seed);
+
+  std::vector<Key> keys;
+  keys.reserve(nb_keys);
+  for (std::size_t i = 0; i < nb_keys; i++) {
+    keys.push_back(make_key<Key>(generator()));
+  }
+
+  return keys;
+}
+
+template <class Key, unsigned int NeighborhoodSize, bool StoreHash>
+using probe_map =
+    tsl::hopscotch_map<Key, std::uint64_t, std::hash<Key>, std::equal_to<Key>,
+                       std::allocator<std::pair<Key, std::uint64_t>>,
+                       NeighborhoodSize, StoreHash>;
+
+template <class Map>
+void bm_find_hit(benchmark::State& state) {
+  using key_type = typename Map::key_type;
+  const std::size_t nb_keys = std::size_t(state.range(0));
+
+  std::vector<key_type> keys = make_keys<key_type>(nb_keys, 1);
+  Map map;
+  // Fill the map up to its max_load_factor to get crowded neighborhoods.
+  map.max_load_factor(0.95f);
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    map.insert({keys[i], i});
+  }
+
+  std::shuffle(keys.begin(), keys.end(), std::mt19937_64(2));
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(keys[i]));
+    if (++i == keys.size()) {
+      i = 0;
+    }
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+template <class Map>
+void bm_find_miss(benchmark::State& state) {
+  using key_type = typename Map::key_type;
+  const std::size_t nb_keys = std::size_t(state.range(0));
+
+  const std::vector<key_type> keys = make_keys<key_type>(nb_keys, 1);
+  const std::vector<key_type> missing_keys = make_keys<key_type>(nb_keys, 3);
+  Map map;
+  map.max_load_factor(0.95f);
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    map.insert({keys[i], i});
+  }
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(missing_keys[i]));
+    if (++i == missing_keys.size()) {
+      i = 0;
+    }
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(bm_find_hit, probe_map<std::uint64_t, 30, true>)
+    ->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(bm_find_hit, probe_map<std::uint64_t, 62, false>)
+    ->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(bm_find_hit, probe_map<std::string, 30, true>)
+    ->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(bm_find_hit, probe_map<std::string, 62, false>)
+    ->Range(1 << 12, 1 << 20);
+
+BENCHMARK_TEMPLATE(bm_find_miss, probe_map<std::uint64_t, 30, true>)
+    ->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(bm_find_miss, probe_map<std::uint64_t, 62, false>)
+    ->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(bm_find_miss, probe_map<std::string, 30, true>)
+    ->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(bm_find_miss, probe_map<std::string, 62, false>)
+    ->Range(1 << 12, 1 << 20);
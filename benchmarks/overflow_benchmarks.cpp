@@ -0,0 +1,183 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/bhopscotch_map.h>
+#include <tsl/hopscotch_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/*
+ * Lookups and erase/insert cycles on maps with a lot of elements in the
+ * overflow container. The keys come in groups of GROUP_SIZE keys with the same
+ * hash, more than what fits in a neighborhood of 6, spreading thousands of
+ * overflow elements over many home buckets. A hopscotch_map indexes its
+ * overflow elements by home bucket while a bhopscotch_map keeps them in a
+ * std::map. The argument is the number of elements.
+ */
+namespace {
+
+const std::uint64_t GROUP_SIZE = 16;
+
+struct overflow_hash {
+  std::size_t operator()(std::uint64_t key) const noexcept {
+    return std::size_t(key / GROUP_SIZE);
+  }
+};
+
+using map_type =
+    tsl::hopscotch_map<std::uint64_t, std::uint64_t, overflow_hash,
+                       std::equal_to<std::uint64_t>,
+                       std::allocator<std::pair<std::uint64_t, std::uint64_t>>,
+                       6>;
+using bmap_type = tsl::bhopscotch_map<
+    std::uint64_t, std::uint64_t, overflow_hash, std::equal_to<std::uint64_t>,
+    std::less<std::uint64_t>,
+    std::allocator<std::pair<const std::uint64_t, std::uint64_t>>, 6>;
+
+template <class Map>
+Map make_map(std::size_t nb_elements) {
+  Map map;
+  for (std::size_t i = 0; i < nb_elements; i++) {
+    map.insert({i, i});
+  }
+
+  return map;
+}
+
+template <class Map>
+void bm_overflow_find(benchmark::State& state) {
+  const std::size_t nb_elements = std::size_t(state.range(0));
+  const Map map = make_map<Map>(nb_elements);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(i));
+    i = (i + 7) % nb_elements;
+  }
+
+  state.counters["overflow"] = double(map.overflow_size());
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+template <class Map>
+void bm_overflow_erase_insert(benchmark::State& state) {
+  const std::size_t nb_elements = std::size_t(state.range(0));
+  Map map = make_map<Map>(nb_elements);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.erase(i));
+    map.insert({i, i});
+    i = (i + 7) % nb_elements;
+  }
+
+  state.counters["overflow"] = double(map.overflow_size());
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+/*
+ * Sliding window of keys: each iteration inserts a new key and erases the
+ * oldest one, the number of overflow elements stays roughly constant while
+ * the home buckets of the overflow elements keep changing.
+ */
+template <class Map>
+void bm_overflow_churn(benchmark::State& state) {
+  const std::size_t nb_elements = std::size_t(state.range(0));
+  Map map = make_map<Map>(nb_elements);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    map.insert({i + nb_elements, i});
+    benchmark::DoNotOptimize(map.erase(i));
+    i++;
+  }
+
+  state.counters["overflow"] = double(map.overflow_size());
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+/*
+ * Rehash of a map with long string keys, where hashing a key is expensive.
+ * The keys share their hash by groups of GROUP_SIZE, only the last two
+ * characters are not hashed.
+ */
+struct overflow_string_hash {
+  std::size_t operator()(const std::string& key) const noexcept {
+    return std::hash<std::string_view>()(
+        std::string_view(key.data(), key.size() - 2));
+  }
+};
+
+using string_map_type =
+    tsl::hopscotch_map<std::string, std::uint64_t, overflow_string_hash,
+                       std::equal_to<std::string>,
+                       std::allocator<std::pair<std::string, std::uint64_t>>,
+                       6>;
+
+void bm_overflow_rehash_strings(benchmark::State& state) {
+  const std::size_t nb_elements = std::size_t(state.range(0));
+
+  string_map_type original_map;
+  for (std::size_t i = 0; i < nb_elements; i++) {
+    std::string key(256, 'a');
+    key.replace(0, 20, std::to_string(i / GROUP_SIZE));
+    key.replace(key.size() - 2, 2, std::to_string(i % GROUP_SIZE + 10));
+
+    original_map.insert({key, i});
+  }
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    string_map_type map = original_map;
+    state.ResumeTiming();
+
+    map.rehash(map.bucket_count() * 2);
+    benchmark::DoNotOptimize(map.bucket_count());
+
+    state.PauseTiming();
+    map = string_map_type();
+    state.ResumeTiming();
+  }
+
+  state.counters["overflow"] = double(original_map.overflow_size());
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(bm_overflow_find, map_type)->Arg(1000)->Arg(10000);
+BENCHMARK_TEMPLATE(bm_overflow_find, bmap_type)->Arg(1000)->Arg(10000);
+BENCHMARK_TEMPLATE(bm_overflow_erase_insert, map_type)->Arg(1000)->Arg(10000);
+BENCHMARK_TEMPLATE(bm_overflow_erase_insert, bmap_type)->Arg(1000)->Arg(10000);
+BENCHMARK_TEMPLATE(bm_overflow_churn, map_type)->Arg(1000)->Arg(10000);
+BENCHMARK_TEMPLATE(bm_overflow_churn, bmap_type)->Arg(1000)->Arg(10000);
+BENCHMARK(bm_overflow_rehash_strings)
+    ->Arg(10000)
+    ->Unit(benchmark::kMicrosecond);
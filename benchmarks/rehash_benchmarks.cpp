@@ -0,0 +1,95 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_map.h>
+#include <tsl/hopscotch_thread_executor.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+/*
+ * Double the bucket count of a map with rehash and with parallel_rehash on a
+ * tsl::hh::thread_executor. The arguments are the number of elements and the
+ * number of threads of the executor.
+ */
+namespace {
+
+using map_type = tsl::hopscotch_map<std::uint64_t, std::uint64_t>;
+
+map_type make_map(std::size_t nb_elements) {
+  std::mt19937_64 generator(1);
+  map_type map;
+  map.reserve(nb_elements);
+  for (std::size_t i = 0; i < nb_elements; i++) {
+    map.insert({generator(), i});
+  }
+
+  return map;
+}
+
+template <class RehashFunction>
+void bm_rehash(benchmark::State& state, RehashFunction rehash) {
+  const map_type original_map = make_map(std::size_t(state.range(0)));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    map_type map = original_map;
+    state.ResumeTiming();
+
+    rehash(map, map.bucket_count() * 2);
+    benchmark::DoNotOptimize(map.bucket_count());
+
+    state.PauseTiming();
+    map = map_type();
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+void bm_rehash_sequential(benchmark::State& state) {
+  bm_rehash(state, [](map_type& map, std::size_t bucket_count) {
+    map.rehash(bucket_count);
+  });
+}
+
+void bm_rehash_parallel(benchmark::State& state) {
+  const tsl::hh::thread_executor executor(std::size_t(state.range(1)));
+  bm_rehash(state, [&](map_type& map, std::size_t bucket_count) {
+    map.parallel_rehash(bucket_count, executor);
+  });
+}
+
+}  // namespace
+
+BENCHMARK(bm_rehash_sequential)
+    ->Args({1 << 20, 1})
+    ->Args({1 << 23, 1})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(bm_rehash_parallel)
+    ->ArgsProduct({{1 << 20, 1 << 23}, {1, 2, 4, 8}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
@@ -0,0 +1,148 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Deserialize a map with std::string keys with and without hash_compatible.
+ * The argument is the number of elements.
+ */
+namespace {
+
+using map_type = tsl::hopscotch_map<std::string, std::uint64_t>;
+
+class buffer_serializer {
+ public:
+  template <class T>
+  void operator()(const T& value) {
+    serialize_impl(value);
+  }
+
+  std::vector<char> buffer;
+
+ private:
+  template <typename T, typename std::enable_if<
+                            std::is_arithmetic<T>::value>::type* = nullptr>
+  void serialize_impl(const T& value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+  }
+
+  void serialize_impl(const std::string& value) {
+    serialize_impl(std::uint64_t(value.size()));
+    buffer.insert(buffer.end(), value.begin(), value.end());
+  }
+
+  void serialize_impl(const std::pair<std::string, std::uint64_t>& value) {
+    serialize_impl(value.first);
+    serialize_impl(value.second);
+  }
+};
+
+class buffer_deserializer {
+ public:
+  explicit buffer_deserializer(const std::vector<char>& buffer)
+      : m_buffer(buffer), m_position(0) {}
+
+  template <class T>
+  T operator()() {
+    return deserialize_impl(type_tag<T>());
+  }
+
+ private:
+  template <class T>
+  struct type_tag {};
+
+  template <typename T, typename std::enable_if<
+                            std::is_arithmetic<T>::value>::type* = nullptr>
+  T deserialize_impl(type_tag<T>) {
+    T value;
+    std::memcpy(&value, m_buffer.data() + m_position, sizeof(T));
+    m_position += sizeof(T);
+
+    return value;
+  }
+
+  std::string deserialize_impl(type_tag<std::string>) {
+    const std::size_t size =
+        std::size_t(deserialize_impl(type_tag<std::uint64_t>()));
+    std::string value(m_buffer.data() + m_position, size);
+    m_position += size;
+
+    return value;
+  }
+
+  std::pair<std::string, std::uint64_t> deserialize_impl(
+      type_tag<std::pair<std::string, std::uint64_t>>) {
+    std::string key = deserialize_impl(type_tag<std::string>());
+    return {std::move(key), deserialize_impl(type_tag<std::uint64_t>())};
+  }
+
+  const std::vector<char>& m_buffer;
+  std::size_t m_position;
+};
+
+void bm_deserialize(benchmark::State& state, bool hash_compatible) {
+  const std::size_t nb_elements = std::size_t(state.range(0));
+
+  buffer_serializer serializer;
+  {
+    map_type map;
+    for (std::size_t i = 0; i < nb_elements; i++) {
+      map.insert({"key_for_element_" + std::to_string(i), i});
+    }
+    map.serialize(serializer);
+  }
+
+  for (auto _ : state) {
+    buffer_deserializer deserializer(serializer.buffer);
+    const map_type map = map_type::deserialize(deserializer, hash_compatible);
+    benchmark::DoNotOptimize(map.size());
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()) * state.range(0));
+}
+
+void bm_deserialize_rehash(benchmark::State& state) {
+  bm_deserialize(state, false);
+}
+
+void bm_deserialize_hash_compatible(benchmark::State& state) {
+  bm_deserialize(state, true);
+}
+
+}  // namespace
+
+BENCHMARK(bm_deserialize_rehash)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(bm_deserialize_hash_compatible)
+    ->Arg(1 << 20)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,91 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_map.h>
+#include <tsl/small_hopscotch_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Many tiny maps: build NB_MAPS maps of the number of elements given in
+ * argument, then lookups in them, with tsl::hopscotch_map and with
+ * tsl::small_hopscotch_map storing up to 8 elements inline.
+ */
+namespace {
+
+const std::size_t NB_MAPS = 10000;
+
+using map_type = tsl::hopscotch_map<std::uint64_t, std::uint64_t>;
+using small_map_type = tsl::small_hopscotch_map<std::uint64_t, std::uint64_t>;
+
+template <class Map>
+std::vector<Map> make_maps(std::uint64_t nb_elements) {
+  std::vector<Map> maps(NB_MAPS);
+  for (std::size_t imap = 0; imap < maps.size(); imap++) {
+    for (std::uint64_t i = 0; i < nb_elements; i++) {
+      maps[imap].insert({imap * 31 + i, i});
+    }
+  }
+
+  return maps;
+}
+
+template <class Map>
+void bm_tiny_maps_build(benchmark::State& state) {
+  for (auto _ : state) {
+    std::vector<Map> maps = make_maps<Map>(std::uint64_t(state.range(0)));
+    benchmark::DoNotOptimize(maps.data());
+
+    state.PauseTiming();
+    maps = std::vector<Map>();
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations() * NB_MAPS));
+}
+
+template <class Map>
+void bm_tiny_maps_find(benchmark::State& state) {
+  const std::uint64_t nb_elements = std::uint64_t(state.range(0));
+  const std::vector<Map> maps = make_maps<Map>(nb_elements);
+
+  std::size_t imap = 0;
+  std::uint64_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(maps[imap].find(imap * 31 + i));
+    imap = (imap + 7919) % NB_MAPS;
+    i = (i + 1) % nb_elements;
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(bm_tiny_maps_build, map_type)->Arg(1)->Arg(4)->Arg(8);
+BENCHMARK_TEMPLATE(bm_tiny_maps_build, small_map_type)->Arg(1)->Arg(4)->Arg(8);
+BENCHMARK_TEMPLATE(bm_tiny_maps_find, map_type)->Arg(1)->Arg(4)->Arg(8);
+BENCHMARK_TEMPLATE(bm_tiny_maps_find, small_map_type)->Arg(1)->Arg(4)->Arg(8);
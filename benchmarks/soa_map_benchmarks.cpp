@@ -0,0 +1,141 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <benchmark/benchmark.h>
+#include <tsl/hopscotch_map.h>
+#include <tsl/hopscotch_soa_map.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+/*
+ * Lookup benchmarks comparing tsl::hopscotch_map, where the values are stored
+ * next to the neighborhood bitmaps, with tsl::hopscotch_soa_map, where a
+ * lookup only reads the bitmap and the hash fragments of the neighborhood
+ * before comparing a key. Large values make the difference visible.
+ */
+namespace {
+
+struct large_value {
+  explicit large_value(std::uint64_t value = 0) { data.fill(value); }
+
+  std::array<std::uint64_t, 25> data;
+};
+static_assert(sizeof(large_value) == 200, "");
+
+template <class Value>
+using aos_map =
+    tsl::hopscotch_map<std::uint64_t, Value, std::hash<std::uint64_t>,
+                       std::equal_to<std::uint64_t>,
+                       std::allocator<std::pair<std::uint64_t, Value>>, 62>;
+
+template <class Value>
+using soa_map =
+    tsl::hopscotch_soa_map<std::uint64_t, Value, std::hash<std::uint64_t>,
+                           std::equal_to<std::uint64_t>,
+                           std::allocator<std::pair<std::uint64_t, Value>>, 62>;
+
+std::vector<std::uint64_t> make_keys(std::size_t nb_keys, std::uint64_t seed) {
+  std::mt19937_64 generator(seed);
+
+  std::vector<std::uint64_t> keys(nb_keys);
+  std::generate(keys.begin(), keys.end(), generator);
+
+  return keys;
+}
+
+template <class Map>
+Map make_map(const std::vector<std::uint64_t>& keys) {
+  using mapped_type = typename Map::mapped_type;
+
+  Map map;
+  map.max_load_factor(0.95f);
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    map.insert({keys[i], mapped_type(i)});
+  }
+
+  return map;
+}
+
+template <class Map>
+void bm_find_hit(benchmark::State& state) {
+  std::vector<std::uint64_t> keys =
+      make_keys(std::size_t(state.range(0)), 1);
+  const Map map = make_map<Map>(keys);
+
+  std::shuffle(keys.begin(), keys.end(), std::mt19937_64(2));
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(keys[i]));
+    if (++i == keys.size()) {
+      i = 0;
+    }
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+template <class Map>
+void bm_find_miss(benchmark::State& state) {
+  const std::vector<std::uint64_t> keys =
+      make_keys(std::size_t(state.range(0)), 1);
+  const std::vector<std::uint64_t> missing_keys =
+      make_keys(std::size_t(state.range(0)), 3);
+  const Map map = make_map<Map>(keys);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(missing_keys[i]));
+    if (++i == missing_keys.size()) {
+      i = 0;
+    }
+  }
+
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(bm_find_hit, aos_map<std::uint64_t>)
+    ->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(bm_find_hit, soa_map<std::uint64_t>)
+    ->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(bm_find_hit, aos_map<large_value>)->Range(1 << 12, 1 << 18);
+BENCHMARK_TEMPLATE(bm_find_hit, soa_map<large_value>)->Range(1 << 12, 1 << 18);
+
+BENCHMARK_TEMPLATE(bm_find_miss, aos_map<std::uint64_t>)
+    ->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(bm_find_miss, soa_map<std::uint64_t>)
+    ->Range(1 << 12, 1 << 20);
+BENCHMARK_TEMPLATE(bm_find_miss, aos_map<large_value>)
+    ->Range(1 << 12, 1 << 18);
+BENCHMARK_TEMPLATE(bm_find_miss, soa_map<large_value>)
+    ->Range(1 << 12, 1 << 18);
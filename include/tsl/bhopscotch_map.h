@@ -30,6 +30,9 @@
 #include <initializer_list>
 #include <map>
 #include <memory>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
 #include <type_traits>
 #include <utility>
 
@@ -249,6 +252,25 @@ class bhopscotch_map {
     m_ht.insert(ilist.begin(), ilist.end());
   }
 
+  /**
+   * Same as insert(first, last) but optimized for large ranges. The elements
+   * are inserted in small groups, the buckets of a whole group are prefetched
+   * before its insertion to overlap the cache misses.
+   */
+  template <class ForwardIt>
+  void bulk_build(ForwardIt first, ForwardIt last) {
+    m_ht.template bulk_build<false>(first, last);
+  }
+
+  /**
+   * Same as bulk_build(first, last), but the keys of [first, last) must be
+   * distinct and not already in the map, the check for duplicates is skipped.
+   */
+  template <class ForwardIt>
+  void bulk_build(tsl::hh::unique_keys_t, ForwardIt first, ForwardIt last) {
+    m_ht.template bulk_build<true>(first, last);
+  }
+
   template <class M>
   std::pair<iterator, bool> insert_or_assign(const key_type& k, M&& obj) {
     return m_ht.insert_or_assign(k, std::forward<M>(obj));
@@ -371,6 +393,120 @@ class bhopscotch_map {
                             std::forward<Args>(args)...);
   }
 
+  /**
+   * Same as insert(value), but use the hash value 'precalculated_hash'
+   * instead of hashing the key. The hash value must be the same as
+   * hash_function()(value.first), which is checked in debug mode. Useful if
+   * the hash was already computed, e.g. to find the shard of a sharded map.
+   *
+   * The other modifiers accept a precalculated hash too:
+   * insert_or_assign(k, obj, precalculated_hash),
+   * try_emplace_with_hash(k, precalculated_hash, args...),
+   * emplace_with_hash(precalculated_hash, args...),
+   * emplace_hint_with_hash(hint, precalculated_hash, args...) and
+   * subscript_with_hash(key, precalculated_hash) in place of operator[].
+   */
+  std::pair<iterator, bool> insert(const value_type& value,
+                                   std::size_t precalculated_hash) {
+    return m_ht.insert_with_hash(value, precalculated_hash);
+  }
+
+  template <class P, typename std::enable_if<std::is_constructible<
+                         value_type, P&&>::value>::type* = nullptr>
+  std::pair<iterator, bool> insert(P&& value, std::size_t precalculated_hash) {
+    return m_ht.insert_with_hash(std::forward<P>(value), precalculated_hash);
+  }
+
+  std::pair<iterator, bool> insert(value_type&& value,
+                                   std::size_t precalculated_hash) {
+    return m_ht.insert_with_hash(std::move(value), precalculated_hash);
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(const key_type& k, M&& obj,
+                                             std::size_t precalculated_hash) {
+    return m_ht.insert_or_assign_with_hash(k, std::forward<M>(obj),
+                                           precalculated_hash);
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(key_type&& k, M&& obj,
+                                             std::size_t precalculated_hash) {
+    return m_ht.insert_or_assign_with_hash(std::move(k), std::forward<M>(obj),
+                                           precalculated_hash);
+  }
+
+  /**
+   * This overload only participates in the overload resolution if the typedef
+   * KeyEqual::is_transparent and Compare::is_transparent exist. If so, K must
+   * be hashable and comparable to Key.
+   */
+  template <
+      class K, class M, class KE = KeyEqual, class CP = Compare,
+      typename std::enable_if<
+          has_is_transparent<KE>::value && has_is_transparent<CP>::value &&
+          !std::is_convertible<K&&, iterator>::value &&
+          !std::is_convertible<K&&, const_iterator>::value>::type* = nullptr>
+  std::pair<iterator, bool> insert_or_assign(K&& k, M&& obj,
+                                             std::size_t precalculated_hash) {
+    return m_ht.insert_or_assign_with_hash(
+        std::forward<K>(k), std::forward<M>(obj), precalculated_hash);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace_with_hash(
+      const key_type& k, std::size_t precalculated_hash, Args&&... args) {
+    return m_ht.try_emplace_with_hash(k, precalculated_hash,
+                                      std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace_with_hash(
+      key_type&& k, std::size_t precalculated_hash, Args&&... args) {
+    return m_ht.try_emplace_with_hash(std::move(k), precalculated_hash,
+                                      std::forward<Args>(args)...);
+  }
+
+  /**
+   * This overload only participates in the overload resolution if the typedef
+   * KeyEqual::is_transparent and Compare::is_transparent exist. If so, K must
+   * be hashable and comparable to Key.
+   */
+  template <
+      class K, class... Args, class KE = KeyEqual, class CP = Compare,
+      typename std::enable_if<
+          has_is_transparent<KE>::value && has_is_transparent<CP>::value &&
+          !std::is_convertible<K&&, iterator>::value &&
+          !std::is_convertible<K&&, const_iterator>::value>::type* = nullptr>
+  std::pair<iterator, bool> try_emplace_with_hash(
+      K&& k, std::size_t precalculated_hash, Args&&... args) {
+    return m_ht.try_emplace_with_hash(std::forward<K>(k), precalculated_hash,
+                                      std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace_with_hash(std::size_t precalculated_hash,
+                                              Args&&... args) {
+    return m_ht.emplace_with_hash(precalculated_hash,
+                                  std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  iterator emplace_hint_with_hash(const_iterator hint,
+                                  std::size_t precalculated_hash,
+                                  Args&&... args) {
+    return m_ht.emplace_hint_with_hash(hint, precalculated_hash,
+                                       std::forward<Args>(args)...);
+  }
+
+  T& subscript_with_hash(const Key& key, std::size_t precalculated_hash) {
+    return m_ht.subscript_with_hash(key, precalculated_hash);
+  }
+
+  T& subscript_with_hash(Key&& key, std::size_t precalculated_hash) {
+    return m_ht.subscript_with_hash(std::move(key), precalculated_hash);
+  }
+
   iterator erase(iterator pos) { return m_ht.erase(pos); }
   iterator erase(const_iterator pos) { return m_ht.erase(pos); }
   iterator erase(const_iterator first, const_iterator last) {
@@ -654,6 +790,41 @@ class bhopscotch_map {
     return m_ht.contains(key, precalculated_hash);
   }
 
+  /**
+   * Look up each key of [first, last) and write the resulting iterators, end()
+   * if the key is absent, to out. Return the output iterator past the last
+   * written element.
+   *
+   * Equivalent to calling find on each key, but the keys are hashed and their
+   * buckets prefetched in small groups before being looked up, which hides
+   * most of the cache misses when the map doesn't fit in the cache.
+   *
+   * The keys must be of type Key, or of a type K hashable and comparable to Key
+   * if the typedef KeyEqual::is_transparent exists.
+   */
+  template <class ForwardIt, class OutputIt>
+  OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) {
+    return m_ht.find_batch(first, last, out);
+  }
+
+  /**
+   * @copydoc find_batch(ForwardIt first, ForwardIt last, OutputIt out)
+   */
+  template <class ForwardIt, class OutputIt>
+  OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+    return m_ht.find_batch(first, last, out);
+  }
+
+  /**
+   * Same as find_batch but write a bool telling if the key is in the map for
+   * each key of [first, last).
+   */
+  template <class ForwardIt, class OutputIt>
+  OutputIt contains_batch(ForwardIt first, ForwardIt last,
+                          OutputIt out) const {
+    return m_ht.contains_batch(first, last, out);
+  }
+
   std::pair<iterator, iterator> equal_range(const Key& key) {
     return m_ht.equal_range(key);
   }
@@ -748,6 +919,31 @@ class bhopscotch_map {
   void rehash(size_type count_) { m_ht.rehash(count_); }
   void reserve(size_type count_) { m_ht.reserve(count_); }
 
+  /**
+   * Same as rehash(count_), but the elements are moved to the new buckets by
+   * several tasks run through the executor, e.g. a tsl::hh::thread_executor.
+   * The result is the same as a sequential rehash.
+   *
+   * executor(nb_tasks, task) must call task(itask) once for each itask in
+   * [0, nb_tasks), possibly concurrently, and return once all the tasks
+   * returned. The hash function is called concurrently and must not throw.
+   *
+   * Small maps and value types which are not nothrow move constructible are
+   * rehashed sequentially.
+   */
+  template <class Executor>
+  void parallel_rehash(size_type count_, Executor&& executor) {
+    m_ht.parallel_rehash(count_, executor);
+  }
+
+  /**
+   * Same as reserve(count_) with a parallel rehash, see parallel_rehash.
+   */
+  template <class Executor>
+  void parallel_reserve(size_type count_, Executor&& executor) {
+    m_ht.parallel_reserve(count_, executor);
+  }
+
   /*
    * Observers
    */
@@ -768,6 +964,83 @@ class bhopscotch_map {
 
   size_type overflow_size() const noexcept { return m_ht.overflow_size(); }
 
+  /**
+   * Describe the current layout of the elements of the map: occupancy of the
+   * neighborhoods, distances of the elements to their home bucket, runs of
+   * non-empty buckets, overflow and expected cache lines read per lookup, see
+   * tsl::hh::hopscotch_analysis. Walks all the buckets.
+   */
+  tsl::hh::hopscotch_analysis analyze() const { return m_ht.analyze(); }
+
+#ifdef TSL_HH_ENABLE_STATS
+  /**
+   * Counters of the operations done on the map since its construction or the
+   * last call to reset_stats() and histogram of the current occupancy of the
+   * neighborhoods, see tsl::hh::hopscotch_stats. Only available when
+   * TSL_HH_ENABLE_STATS is defined.
+   */
+  tsl::hh::hopscotch_stats stats() const { return m_ht.stats(); }
+
+  void reset_stats() noexcept { m_ht.reset_stats(); }
+#endif
+
+  /**
+   * Serialize the map through the serializer parameter.
+   *
+   * The serializer parameter must be a function object that supports the
+   * following call:
+   *  - `template<typename U> void operator()(const U& value);` where the types
+   * `std::uint64_t`, `std::uint32_t`, `float` and `std::pair<const Key, T>`
+   * must be supported for U.
+   *
+   * The implementation leaves binary compatibility (endianness, IEEE 754 for
+   * floats, ...) of the types it serializes in the hands of the serializer
+   * function object if compatibility is required.
+   */
+  template <class Serializer>
+  void serialize(Serializer& serializer) const {
+    m_ht.serialize(serializer);
+  }
+
+  /**
+   * Deserialize a previously serialized map through the deserializer
+   * parameter.
+   *
+   * The deserializer parameter must be a function object that supports the
+   * following call:
+   *  - `template<typename U> U operator()();` where the types `std::uint64_t`,
+   * `std::uint32_t`, `float` and `std::pair<const Key, T>` must be supported
+   * for U.
+   *
+   * If the deserialized hash map type is hash compatible with the
+   * serialized map, the deserialization process can be sped up by setting
+   * `hash_compatible` to true. To be hash compatible, the Hash, KeyEqual and
+   * GrowthPolicy must behave the same way than the ones used on the serialized
+   * map. The std::size_t must also be of the same size as the one on the
+   * platform used to serialize the map. If these criteria are not met,
+   * the behaviour is undefined with `hash_compatible` sets to true.
+   *
+   * The buckets are then copied in place with their neighborhood bitmaps and
+   * stored hashes, without hashing any key. If NeighborhoodSize or StoreHash
+   * differ from the serialized map, the values are inserted one by one as
+   * if `hash_compatible` was false.
+   *
+   * The behaviour is undefined if the type `std::pair<const Key, T>` of the
+   * `bhopscotch_map` is not the same as the type used during serialization.
+   *
+   * The implementation leaves binary compatibility (endianness, IEEE 754 for
+   * floats, size of int, ...) of the types it deserializes in the hands of the
+   * deserializer function object if compatibility is required.
+   */
+  template <class Deserializer>
+  static bhopscotch_map deserialize(Deserializer& deserializer,
+                                    bool hash_compatible = false) {
+    bhopscotch_map map(0);
+    map.m_ht.deserialize(deserializer, hash_compatible);
+
+    return map;
+  }
+
   friend bool operator==(const bhopscotch_map& lhs, const bhopscotch_map& rhs) {
     if (lhs.size() != rhs.size()) {
       return false;
@@ -809,6 +1082,33 @@ using bhopscotch_pg_map =
     bhopscotch_map<Key, T, Hash, KeyEqual, Compare, Allocator, NeighborhoodSize,
                    StoreHash, tsl::hh::prime_growth_policy>;
 
+#if __has_include(<memory_resource>)
+namespace pmr {
+
+/**
+ * Aliases of `tsl::bhopscotch_map` and of its prime growth policy variant
+ * using a `std::pmr::polymorphic_allocator`, like the `std::pmr` containers.
+ */
+template <class Key, class T, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>, class Compare = std::less<Key>,
+          unsigned int NeighborhoodSize = 62, bool StoreHash = false,
+          class GrowthPolicy = tsl::hh::power_of_two_growth_policy<2>>
+using bhopscotch_map = tsl::bhopscotch_map<
+    Key, T, Hash, KeyEqual, Compare,
+    std::pmr::polymorphic_allocator<std::pair<const Key, T>>, NeighborhoodSize,
+    StoreHash, GrowthPolicy>;
+
+template <class Key, class T, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>, class Compare = std::less<Key>,
+          unsigned int NeighborhoodSize = 62, bool StoreHash = false>
+using bhopscotch_pg_map = tsl::bhopscotch_pg_map<
+    Key, T, Hash, KeyEqual, Compare,
+    std::pmr::polymorphic_allocator<std::pair<const Key, T>>, NeighborhoodSize,
+    StoreHash>;
+
+}  // end namespace pmr
+#endif
+
 }  // end namespace tsl
 
 #endif
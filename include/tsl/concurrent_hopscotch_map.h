@@ -0,0 +1,1121 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_CONCURRENT_HOPSCOTCH_MAP_H
+#define TSL_CONCURRENT_HOPSCOTCH_MAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "hopscotch_hash.h"
+#include "hopscotch_overflow_table.h"
+
+namespace tsl {
+
+namespace detail_concurrent_hopscotch {
+
+constexpr std::size_t round_up_to_power_of_two(std::size_t value) {
+  std::size_t power = 1;
+  while (power < value) {
+    power *= 2;
+  }
+
+  return power;
+}
+
+}  // namespace detail_concurrent_hopscotch
+
+/**
+ * Implementation of a concurrent hash map using the hopscotch hashing
+ * algorithm.
+ *
+ * The buckets are grouped in segments of consecutive buckets, each segment
+ * having a mutex and a version counter. A writer locks the (at most two)
+ * segments covering the buckets it may touch, which are the
+ * MAX_PROBES_FOR_EMPTY_BUCKET buckets following the home bucket of the key,
+ * and makes their versions odd while it modifies them. The displacement of the
+ * values is the same as tsl::hopscotch_map.
+ *
+ * A lookup never takes a lock while searching the buckets. It reads the
+ * version of the segment of the home bucket, reads the neighborhood and
+ * re-reads the version, retrying if a writer modified the segment in the
+ * meantime (seqlock).
+ *
+ * The overflow elements are kept by segment, in a
+ * detail_hopscotch_hash::hopscotch_overflow_table indexed by home bucket and
+ * protected by the mutex of the segment of their home bucket, which the
+ * writers of the bucket already hold. Only a lookup of a key whose home bucket
+ * has an overflow takes this mutex, which should be rare with a good hash, and
+ * then only contends with the writers of the same segment.
+ *
+ * For the optimistic reads to be well-defined, the keys and values are stored
+ * as arrays of std::atomic<std::uint64_t> words and are copied out on lookup.
+ * Key and T must thus be trivially copyable and default constructible, and
+ * KeyEqual must not have side effects as it may be called on a key copied
+ * while being modified (the result is then discarded).
+ *
+ * On rehash, the old table is first retired: a flag is raised and each
+ * segment is locked and unlocked in turn to wait for the writers in progress.
+ * The writers coming after see the flag and wait for the new table. The old
+ * table is then never modified again, the lookups can keep reading it while
+ * the new table is built and published.
+ *
+ * Each operation announces itself in a reader counter of the current epoch
+ * before loading the table. Once the new table is published, the rehash
+ * advances the epoch twice and waits for the counters of each previous epoch
+ * to drop to zero before freeing the old table (epoch-based reclamation). At
+ * most one table besides the current one is thus alive, even with repeated
+ * calls to clear. The counters are spread on several cache lines indexed by
+ * thread so that the lookups of different threads don't contend on them.
+ *
+ * There are no iterators, the values are returned by copy.
+ *
+ * NeighborhoodSize and GrowthPolicy are the same as tsl::hopscotch_map.
+ */
+template <class Key, class T, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>,
+          unsigned int NeighborhoodSize = 62,
+          class GrowthPolicy = tsl::hh::power_of_two_growth_policy<2>>
+class concurrent_hopscotch_map : private Hash, private KeyEqual {
+ private:
+  static_assert(NeighborhoodSize >= 4, "NeighborhoodSize should be >= 4.");
+  static_assert(NeighborhoodSize <= 62, "NeighborhoodSize should be <= 62.");
+
+  static_assert(std::is_trivially_copyable<Key>::value &&
+                    std::is_default_constructible<Key>::value,
+                "Key must be trivially copyable and default constructible.");
+  static_assert(std::is_trivially_copyable<T>::value &&
+                    std::is_default_constructible<T>::value,
+                "T must be trivially copyable and default constructible.");
+
+ public:
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<Key, T>;
+  using size_type = std::size_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+
+ private:
+  static const std::size_t NB_KEY_WORDS =
+      (sizeof(Key) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+  static const std::size_t NB_VALUE_WORDS =
+      (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+  /*
+   * Same layout as the neighborhood bitmap of hopscotch_bucket. Bit 0 tells if
+   * the bucket is occupied, bit 1 if the bucket has an overflow and bit 'i + 2'
+   * if the bucket 'ibucket + i' contains a value belonging to ibucket.
+   */
+  static const std::uint64_t OCCUPIED_BIT = 1;
+  static const std::uint64_t OVERFLOW_BIT = 2;
+  static const std::size_t NB_RESERVED_BITS_IN_NEIGHBORHOOD = 2;
+
+  struct bucket {
+    std::atomic<std::uint64_t> m_neighborhood_infos;
+    std::atomic<std::uint64_t> m_key[NB_KEY_WORDS];
+    std::atomic<std::uint64_t> m_value[NB_VALUE_WORDS];
+  };
+
+  using overflow_container_type =
+      tsl::detail_hopscotch_hash::hopscotch_overflow_table<
+          value_type, std::allocator<value_type>>;
+
+  struct alignas(64) segment {
+    std::mutex m_mutex;
+    std::atomic<std::uint64_t> m_version{0};
+
+    /**
+     * Overflow elements whose home bucket is in the segment, with their hash.
+     * Protected by m_mutex.
+     */
+    overflow_container_type m_overflow_elements;
+  };
+
+  class table : private GrowthPolicy {
+   public:
+    table(size_type bucket_count, float max_load_factor,
+          std::uint64_t generation)
+        : GrowthPolicy(bucket_count),
+          m_bucket_count(bucket_count),
+          m_nb_buckets(bucket_count + NeighborhoodSize - 1),
+          m_buckets(new bucket[m_nb_buckets]()),
+          m_nb_segments((m_nb_buckets + SEGMENT_SIZE - 1) / SEGMENT_SIZE),
+          m_segments(new segment[m_nb_segments]()),
+          m_min_load_threshold_rehash(
+              size_type(float(bucket_count) * MIN_LOAD_FACTOR_FOR_REHASH)),
+          m_max_load_threshold_rehash(
+              size_type(float(bucket_count) * max_load_factor)),
+          m_overflow_size(0),
+          m_generation(generation),
+          m_retired(false) {
+      tsl_hh_assert(bucket_count > 0);
+    }
+
+    size_type bucket_for_hash(std::size_t hash) const noexcept {
+      const size_type ibucket = GrowthPolicy::bucket_for_hash(hash);
+      tsl_hh_assert(ibucket < m_nb_buckets);
+
+      return ibucket;
+    }
+
+    size_type next_bucket_count() const {
+      return GrowthPolicy::next_bucket_count();
+    }
+
+    bucket& bucket_at(size_type ibucket) noexcept {
+      return m_buckets[ibucket];
+    }
+
+    const bucket& bucket_at(size_type ibucket) const noexcept {
+      return m_buckets[ibucket];
+    }
+
+    segment& segment_for_bucket(size_type ibucket) const noexcept {
+      return m_segments[ibucket / SEGMENT_SIZE];
+    }
+
+    size_type m_bucket_count;
+    size_type m_nb_buckets;
+    std::unique_ptr<bucket[]> m_buckets;
+
+    size_type m_nb_segments;
+    std::unique_ptr<segment[]> m_segments;
+
+    size_type m_min_load_threshold_rehash;
+    size_type m_max_load_threshold_rehash;
+
+    std::atomic<size_type> m_overflow_size;
+
+    /**
+     * Number of tables created before this one by the map. Identify the table
+     * without dereferencing a pointer which may have been freed and reused.
+     */
+    std::uint64_t m_generation;
+
+    /**
+     * Set before the table is replaced. A writer must check it once it holds
+     * its segments locks and must not modify the table if it is set.
+     */
+    std::atomic<bool> m_retired;
+  };
+
+  /**
+   * Lock the segments covering the buckets [ifirst_bucket, ilast_bucket) of a
+   * table, in increasing order so that two writers can't deadlock.
+   *
+   * Between begin_write and end_write, the versions of the segments are odd and
+   * the concurrent lookups in these segments will retry.
+   */
+  class segments_lock {
+   public:
+    segments_lock(table& t, size_type ifirst_bucket, size_type ilast_bucket)
+        : m_table(t),
+          m_ifirst_segment(ifirst_bucket / SEGMENT_SIZE),
+          m_ilast_segment((ilast_bucket - 1) / SEGMENT_SIZE),
+          m_locked(true),
+          m_writing(false) {
+      tsl_hh_assert(ifirst_bucket < ilast_bucket);
+      for (size_type i = m_ifirst_segment; i <= m_ilast_segment; i++) {
+        m_table.m_segments[i].m_mutex.lock();
+      }
+    }
+
+    segments_lock(const segments_lock&) = delete;
+    segments_lock& operator=(const segments_lock&) = delete;
+
+    ~segments_lock() { unlock(); }
+
+    void begin_write() noexcept {
+      tsl_hh_assert(m_locked && !m_writing);
+      for (size_type i = m_ifirst_segment; i <= m_ilast_segment; i++) {
+        std::atomic<std::uint64_t>& version = m_table.m_segments[i].m_version;
+        version.store(version.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+      }
+
+      // Order the odd versions before the following modifications of the
+      // buckets.
+      std::atomic_thread_fence(std::memory_order_release);
+      m_writing = true;
+    }
+
+    void end_write() noexcept {
+      tsl_hh_assert(m_writing);
+      for (size_type i = m_ifirst_segment; i <= m_ilast_segment; i++) {
+        m_table.m_segments[i].m_version.fetch_add(1, std::memory_order_release);
+      }
+      m_writing = false;
+    }
+
+    void unlock() noexcept {
+      if (m_writing) {
+        end_write();
+      }
+
+      if (m_locked) {
+        for (size_type i = m_ilast_segment + 1; i-- > m_ifirst_segment;) {
+          m_table.m_segments[i].m_mutex.unlock();
+        }
+        m_locked = false;
+      }
+    }
+
+   private:
+    table& m_table;
+    size_type m_ifirst_segment;
+    size_type m_ilast_segment;
+    bool m_locked;
+    bool m_writing;
+  };
+
+  struct alignas(64) reader_counters {
+    std::atomic<size_type> m_nb_readers[2];
+  };
+
+  /**
+   * Count the calling thread as a reader of the current epoch until release or
+   * destruction. A table loaded from m_table while the guard is held is not
+   * freed before the guard is released.
+   */
+  class operation_guard {
+   public:
+    explicit operation_guard(const concurrent_hopscotch_map& map) noexcept {
+      reader_counters& counters =
+          map.m_reader_counters[reader_counters_for_thread()];
+      const std::uint64_t epoch = map.m_epoch.load(std::memory_order_seq_cst);
+
+      // Safe even if the epoch advanced in the meantime, see wait_for_readers.
+      m_nb_readers = &counters.m_nb_readers[epoch & 1];
+      m_nb_readers->fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    operation_guard(const operation_guard&) = delete;
+    operation_guard& operator=(const operation_guard&) = delete;
+
+    ~operation_guard() { release(); }
+
+    void release() noexcept {
+      if (m_nb_readers != nullptr) {
+        m_nb_readers->fetch_sub(1, std::memory_order_release);
+        m_nb_readers = nullptr;
+      }
+    }
+
+   private:
+    static size_type reader_counters_for_thread() noexcept {
+      static thread_local const size_type ireader_counters =
+          std::hash<std::thread::id>()(std::this_thread::get_id()) %
+          NB_READER_COUNTERS;
+      return ireader_counters;
+    }
+
+    std::atomic<size_type>* m_nb_readers;
+  };
+
+ public:
+  concurrent_hopscotch_map()
+      : concurrent_hopscotch_map(DEFAULT_INIT_BUCKETS_SIZE) {}
+
+  explicit concurrent_hopscotch_map(size_type bucket_count,
+                                    const Hash& hash = Hash(),
+                                    const KeyEqual& equal = KeyEqual())
+      : Hash(hash),
+        KeyEqual(equal),
+        m_max_load_factor(DEFAULT_MAX_LOAD_FACTOR),
+        m_current_table(std::make_unique<table>(
+            std::max(bucket_count, size_type(1)), m_max_load_factor, 0)),
+        m_epoch(0),
+        m_nb_elements(0) {
+    for (reader_counters& counters : m_reader_counters) {
+      counters.m_nb_readers[0].store(0, std::memory_order_relaxed);
+      counters.m_nb_readers[1].store(0, std::memory_order_relaxed);
+    }
+
+    m_table.store(m_current_table.get(), std::memory_order_release);
+  }
+
+  concurrent_hopscotch_map(const concurrent_hopscotch_map& other) = delete;
+  concurrent_hopscotch_map& operator=(const concurrent_hopscotch_map& other) =
+      delete;
+
+  /*
+   * Capacity
+   */
+  bool empty() const noexcept { return size() == 0; }
+
+  size_type size() const noexcept {
+    return m_nb_elements.load(std::memory_order_relaxed);
+  }
+
+  /*
+   * Modifiers
+   */
+
+  /**
+   * Insert the key-value if the key is not already in the map. Return true if
+   * the key-value was inserted.
+   */
+  bool insert(const Key& key, const T& value) {
+    return insert_impl(key, value, false);
+  }
+
+  /**
+   * Insert the key-value or assign value to the existing key. Return true if
+   * the key-value was inserted, false if it was assigned.
+   */
+  bool insert_or_assign(const Key& key, const T& value) {
+    return insert_impl(key, value, true);
+  }
+
+  size_type erase(const Key& key) {
+    const std::size_t hash = hash_key(key);
+    operation_guard guard(*this);
+
+    while (true) {
+      table* t = m_table.load(std::memory_order_acquire);
+      const size_type ibucket_for_hash = t->bucket_for_hash(hash);
+
+      // An erase only modifies the neighborhood of ibucket_for_hash.
+      segments_lock lock(*t, ibucket_for_hash, ibucket_for_hash + 1);
+      if (t->m_retired.load(std::memory_order_acquire)) {
+        lock.unlock();
+        wait_for_replacement(t);
+        continue;
+      }
+
+      const size_type ibucket_found = find_in_buckets(
+          *t, key, ibucket_for_hash,
+          t->bucket_at(ibucket_for_hash)
+              .m_neighborhood_infos.load(std::memory_order_relaxed));
+      if (ibucket_found != t->m_nb_buckets) {
+        lock.begin_write();
+        erase_from_bucket(*t, ibucket_found, ibucket_for_hash);
+        m_nb_elements.fetch_sub(1, std::memory_order_relaxed);
+
+        return 1;
+      }
+
+      if (!has_overflow(*t, ibucket_for_hash)) {
+        return 0;
+      }
+
+      overflow_container_type& overflow_elements =
+          t->segment_for_bucket(ibucket_for_hash).m_overflow_elements;
+      auto it = find_in_overflow(overflow_elements, key, hash, ibucket_for_hash);
+      if (it == overflow_elements.end()) {
+        return 0;
+      }
+
+      overflow_elements.erase(it);
+      t->m_overflow_size.fetch_sub(1, std::memory_order_relaxed);
+      m_nb_elements.fetch_sub(1, std::memory_order_relaxed);
+
+      // Check if we can remove the overflow flag
+      if (overflow_elements.has_bucket(ibucket_for_hash)) {
+        return 1;
+      }
+
+      lock.begin_write();
+      t->bucket_at(ibucket_for_hash)
+          .m_neighborhood_infos.fetch_and(~OVERFLOW_BIT,
+                                          std::memory_order_acq_rel);
+
+      return 1;
+    }
+  }
+
+  /**
+   * Remove all the elements. Safe to call concurrently with the other methods.
+   */
+  void clear() {
+    std::lock_guard<std::mutex> rehash_lock(m_rehash_mutex);
+
+    auto new_table = std::make_unique<table>(
+        m_current_table->m_bucket_count, m_max_load_factor,
+        m_current_table->m_generation + 1);
+
+    retire_table(*m_current_table);
+    m_nb_elements.store(0, std::memory_order_relaxed);
+    replace_table(std::move(new_table));
+  }
+
+  /*
+   * Lookup
+   */
+
+  /**
+   * If the key is in the map, copy its value in value and return true.
+   * Otherwise return false and leave value untouched.
+   */
+  bool find(const Key& key, T& value) const { return find_impl(key, &value); }
+
+  bool contains(const Key& key) const { return find_impl(key, nullptr); }
+
+  size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+
+  /*
+   * Bucket interface
+   */
+  size_type bucket_count() const {
+    operation_guard guard(*this);
+    return m_table.load(std::memory_order_acquire)->m_bucket_count;
+  }
+
+  /*
+   *  Hash policy
+   */
+  float load_factor() const {
+    return float(size()) / float(bucket_count());
+  }
+
+  float max_load_factor() const { return m_max_load_factor; }
+
+  void reserve(size_type count_) {
+    const size_type bucket_count_for_count =
+        size_type(std::ceil(float(count_) / max_load_factor()));
+
+    operation_guard guard(*this);
+    const table* t = m_table.load(std::memory_order_acquire);
+    if (bucket_count_for_count > t->m_bucket_count) {
+      const std::uint64_t generation = t->m_generation;
+      guard.release();
+
+      rehash_impl(generation, bucket_count_for_count);
+    }
+  }
+
+  /*
+   * Observers
+   */
+  hasher hash_function() const { return static_cast<const Hash&>(*this); }
+  key_equal key_eq() const { return static_cast<const KeyEqual&>(*this); }
+
+  /*
+   * Other
+   */
+  size_type overflow_size() const noexcept {
+    operation_guard guard(*this);
+    return m_table.load(std::memory_order_acquire)
+        ->m_overflow_size.load(std::memory_order_relaxed);
+  }
+
+ private:
+  /**
+   * Hash of key as used in the table, mixed like in tsl::hopscotch_map (see
+   * needs_hash_mixing).
+   */
+  template <class K>
+  std::size_t hash_key(const K& key) const {
+    const std::size_t hash = Hash::operator()(key);
+    if constexpr (tsl::detail_hopscotch_hash::needs_hash_mixing<
+                      Hash, GrowthPolicy>::value) {
+      return tsl::detail_hopscotch_hash::mix_hash_bits(hash);
+    } else {
+      return hash;
+    }
+  }
+
+  template <class K1, class K2>
+  bool compare_keys(const K1& key1, const K2& key2) const {
+    return KeyEqual::operator()(key1, key2);
+  }
+
+  static Key load_key(const bucket& b) noexcept {
+    std::uint64_t words[NB_KEY_WORDS];
+    for (std::size_t i = 0; i < NB_KEY_WORDS; i++) {
+      words[i] = b.m_key[i].load(std::memory_order_relaxed);
+    }
+
+    Key key;
+    std::memcpy(static_cast<void*>(&key), words, sizeof(Key));
+    return key;
+  }
+
+  static T load_value(const bucket& b) noexcept {
+    std::uint64_t words[NB_VALUE_WORDS];
+    for (std::size_t i = 0; i < NB_VALUE_WORDS; i++) {
+      words[i] = b.m_value[i].load(std::memory_order_relaxed);
+    }
+
+    T value;
+    std::memcpy(static_cast<void*>(&value), words, sizeof(T));
+    return value;
+  }
+
+  static void store_key(bucket& b, const Key& key) noexcept {
+    std::uint64_t words[NB_KEY_WORDS] = {};
+    std::memcpy(words, static_cast<const void*>(&key), sizeof(Key));
+    for (std::size_t i = 0; i < NB_KEY_WORDS; i++) {
+      b.m_key[i].store(words[i], std::memory_order_release);
+    }
+  }
+
+  static void store_value(bucket& b, const T& value) noexcept {
+    std::uint64_t words[NB_VALUE_WORDS] = {};
+    std::memcpy(words, static_cast<const void*>(&value), sizeof(T));
+    for (std::size_t i = 0; i < NB_VALUE_WORDS; i++) {
+      b.m_value[i].store(words[i], std::memory_order_release);
+    }
+  }
+
+  static bool bucket_empty(const table& t, size_type ibucket) noexcept {
+    return (t.bucket_at(ibucket).m_neighborhood_infos.load(
+                std::memory_order_acquire) &
+            OCCUPIED_BIT) == 0;
+  }
+
+  static bool has_overflow(const table& t, size_type ibucket) noexcept {
+    return (t.bucket_at(ibucket).m_neighborhood_infos.load(
+                std::memory_order_relaxed) &
+            OVERFLOW_BIT) != 0;
+  }
+
+  static std::uint64_t neighbor_bit(size_type ineighbor) noexcept {
+    tsl_hh_assert(ineighbor < NeighborhoodSize);
+    return std::uint64_t(1) << (ineighbor + NB_RESERVED_BITS_IN_NEIGHBORHOOD);
+  }
+
+  /**
+   * Return the index of the bucket of the neighborhood of ibucket_for_hash,
+   * described by neighborhood_infos, containing key. Return t.m_nb_buckets if
+   * none.
+   */
+  size_type find_in_buckets(const table& t, const Key& key,
+                            size_type ibucket_for_hash,
+                            std::uint64_t neighborhood_infos) const {
+    std::uint64_t neighborhood =
+        neighborhood_infos >> NB_RESERVED_BITS_IN_NEIGHBORHOOD;
+    while (neighborhood != 0) {
+      const size_type ibucket =
+          ibucket_for_hash +
+          tsl::detail_hopscotch_hash::count_trailing_zeros(neighborhood);
+      if (compare_keys(load_key(t.bucket_at(ibucket)), key)) {
+        return ibucket;
+      }
+
+      // Clear the least significant bit set to 1.
+      neighborhood &= neighborhood - 1;
+    }
+
+    return t.m_nb_buckets;
+  }
+
+  /**
+   * Find key in the overflow elements of the segment of ibucket_for_hash. The
+   * mutex of the segment must be held.
+   */
+  template <class OverflowContainer>
+  auto find_in_overflow(OverflowContainer& overflow_elements, const Key& key,
+                        std::size_t hash, size_type ibucket_for_hash) const {
+    return overflow_elements.find(
+        ibucket_for_hash,
+        [&](std::size_t value_hash, const value_type& value) {
+          return value_hash == hash && compare_keys(key, value.first);
+        });
+  }
+
+  bool find_impl(const Key& key, T* value) const {
+    const std::size_t hash = hash_key(key);
+    operation_guard guard(*this);
+
+    while (true) {
+      table* t = m_table.load(std::memory_order_acquire);
+      const size_type ibucket_for_hash = t->bucket_for_hash(hash);
+      const segment& seg = t->segment_for_bucket(ibucket_for_hash);
+
+      const std::uint64_t version =
+          seg.m_version.load(std::memory_order_acquire);
+      if ((version & 1) != 0) {
+        std::this_thread::yield();
+        continue;
+      }
+
+      const std::uint64_t neighborhood_infos =
+          t->bucket_at(ibucket_for_hash)
+              .m_neighborhood_infos.load(std::memory_order_relaxed);
+      const size_type ibucket_found =
+          find_in_buckets(*t, key, ibucket_for_hash, neighborhood_infos);
+      const bool found = ibucket_found != t->m_nb_buckets;
+      const T found_value =
+          (found && value != nullptr) ? load_value(t->bucket_at(ibucket_found))
+                                      : T();
+
+      // Order the reads of the buckets before the check of the version.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seg.m_version.load(std::memory_order_relaxed) != version) {
+        continue;
+      }
+
+      if (found) {
+        if (value != nullptr) {
+          *value = found_value;
+        }
+        return true;
+      }
+
+      if ((neighborhood_infos & OVERFLOW_BIT) == 0) {
+        return false;
+      }
+
+      // A retired table is not modified anymore, its overflow elements can
+      // still be read.
+      segment& home_segment = t->segment_for_bucket(ibucket_for_hash);
+      std::lock_guard<std::mutex> overflow_lock(home_segment.m_mutex);
+
+      const overflow_container_type& overflow_elements =
+          home_segment.m_overflow_elements;
+      const auto it =
+          find_in_overflow(overflow_elements, key, hash, ibucket_for_hash);
+      if (it == overflow_elements.cend()) {
+        return false;
+      }
+
+      if (value != nullptr) {
+        *value = it->second;
+      }
+      return true;
+    }
+  }
+
+  bool insert_impl(const Key& key, const T& value, bool assign) {
+    const std::size_t hash = hash_key(key);
+
+    while (true) {
+      // The guard must be released before a rehash, which waits for all the
+      // operations in progress.
+      operation_guard guard(*this);
+      table* t = m_table.load(std::memory_order_acquire);
+      const size_type ibucket_for_hash = t->bucket_for_hash(hash);
+
+      const size_type ibucket_probes_end = std::min(
+          ibucket_for_hash + MAX_PROBES_FOR_EMPTY_BUCKET, t->m_nb_buckets);
+
+      segments_lock lock(*t, ibucket_for_hash, ibucket_probes_end);
+      if (t->m_retired.load(std::memory_order_acquire)) {
+        lock.unlock();
+        wait_for_replacement(t);
+        continue;
+      }
+
+      const size_type ibucket_found = find_in_buckets(
+          *t, key, ibucket_for_hash,
+          t->bucket_at(ibucket_for_hash)
+              .m_neighborhood_infos.load(std::memory_order_relaxed));
+      if (ibucket_found != t->m_nb_buckets) {
+        if (assign) {
+          lock.begin_write();
+          store_value(t->bucket_at(ibucket_found), value);
+        }
+
+        return false;
+      }
+
+      if (has_overflow(*t, ibucket_for_hash)) {
+        overflow_container_type& overflow_elements =
+            t->segment_for_bucket(ibucket_for_hash).m_overflow_elements;
+        auto it =
+            find_in_overflow(overflow_elements, key, hash, ibucket_for_hash);
+        if (it != overflow_elements.end()) {
+          if (assign) {
+            it->second = value;
+          }
+
+          return false;
+        }
+      }
+
+      if (size() - t->m_overflow_size.load(std::memory_order_relaxed) >=
+          t->m_max_load_threshold_rehash) {
+        const std::uint64_t generation = t->m_generation;
+        const size_type bucket_count = t->next_bucket_count();
+        lock.unlock();
+        guard.release();
+
+        rehash_impl(generation, bucket_count);
+        continue;
+      }
+
+      lock.begin_write();
+      if (!insert_in_buckets(*t, ibucket_for_hash, key, value)) {
+        // Load factor is too low or a rehash will not change the neighborhood,
+        // put the value in overflow list. Otherwise rehash and retry.
+        if (size() >= t->m_min_load_threshold_rehash &&
+            will_neighborhood_change_on_rehash(*t, ibucket_for_hash)) {
+          const std::uint64_t generation = t->m_generation;
+          const size_type bucket_count = t->next_bucket_count();
+          lock.unlock();
+          guard.release();
+
+          rehash_impl(generation, bucket_count);
+          continue;
+        }
+
+        insert_in_overflow(*t, ibucket_for_hash, hash, key, value);
+      }
+
+      m_nb_elements.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+
+  /**
+   * Insert the key-value in a bucket of the neighborhood of ibucket_for_hash,
+   * displacing other values if needed. Return false if no bucket could be
+   * freed in the neighborhood.
+   *
+   * The segments covering [ibucket_for_hash, ibucket_for_hash +
+   * MAX_PROBES_FOR_EMPTY_BUCKET) must be locked and in write mode.
+   */
+  bool insert_in_buckets(table& t, size_type ibucket_for_hash, const Key& key,
+                         const T& value) {
+    size_type ibucket_empty = find_empty_bucket(t, ibucket_for_hash);
+    if (ibucket_empty < t.m_nb_buckets) {
+      do {
+        tsl_hh_assert(ibucket_empty >= ibucket_for_hash);
+
+        // Empty bucket is in range of NeighborhoodSize, use it
+        if (ibucket_empty - ibucket_for_hash < NeighborhoodSize) {
+          insert_in_bucket(t, ibucket_empty, ibucket_for_hash, key, value);
+          return true;
+        }
+      }
+      // else, try to swap values to get a closer empty bucket
+      while (swap_empty_bucket_closer(t, ibucket_empty));
+    }
+
+    return false;
+  }
+
+  /**
+   * The segment of ibucket_for_hash must be locked and in write mode, unless
+   * the table is not shared yet.
+   */
+  void insert_in_overflow(table& t, size_type ibucket_for_hash,
+                          std::size_t hash, const Key& key, const T& value) {
+    t.segment_for_bucket(ibucket_for_hash)
+        .m_overflow_elements.emplace(ibucket_for_hash, hash, key, value);
+    t.m_overflow_size.fetch_add(1, std::memory_order_relaxed);
+
+    t.bucket_at(ibucket_for_hash)
+        .m_neighborhood_infos.fetch_or(OVERFLOW_BIT, std::memory_order_acq_rel);
+  }
+
+  /*
+   * Return true if a rehash will change the position of a key-value in the
+   * neighborhood of ibucket_neighborhood_check. In this case a rehash is needed
+   * instead of puting the value in overflow list.
+   */
+  bool will_neighborhood_change_on_rehash(
+      const table& t, size_type ibucket_neighborhood_check) const {
+    std::size_t expand_bucket_count = t.next_bucket_count();
+    GrowthPolicy expand_growth_policy(expand_bucket_count);
+
+    for (size_type ibucket = ibucket_neighborhood_check;
+         ibucket < t.m_nb_buckets &&
+         (ibucket - ibucket_neighborhood_check) < NeighborhoodSize;
+         ++ibucket) {
+      tsl_hh_assert(!bucket_empty(t, ibucket));
+
+      const std::size_t hash = hash_key(load_key(t.bucket_at(ibucket)));
+      if (t.bucket_for_hash(hash) !=
+          expand_growth_policy.bucket_for_hash(hash)) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /*
+   * Return the index of an empty bucket in [ibucket_start, ibucket_start +
+   * MAX_PROBES_FOR_EMPTY_BUCKET). If none, the returned index equals
+   * t.m_nb_buckets.
+   */
+  size_type find_empty_bucket(const table& t, size_type ibucket_start) const {
+    const size_type limit =
+        std::min(ibucket_start + MAX_PROBES_FOR_EMPTY_BUCKET, t.m_nb_buckets);
+    for (; ibucket_start < limit; ibucket_start++) {
+      if (bucket_empty(t, ibucket_start)) {
+        return ibucket_start;
+      }
+    }
+
+    return t.m_nb_buckets;
+  }
+
+  void insert_in_bucket(table& t, size_type ibucket_empty,
+                        size_type ibucket_for_hash, const Key& key,
+                        const T& value) {
+    tsl_hh_assert(ibucket_empty >= ibucket_for_hash);
+    tsl_hh_assert(bucket_empty(t, ibucket_empty));
+
+    bucket& b = t.bucket_at(ibucket_empty);
+    store_key(b, key);
+    store_value(b, value);
+    b.m_neighborhood_infos.fetch_or(OCCUPIED_BIT, std::memory_order_acq_rel);
+
+    t.bucket_at(ibucket_for_hash)
+        .m_neighborhood_infos.fetch_xor(
+            neighbor_bit(ibucket_empty - ibucket_for_hash),
+            std::memory_order_acq_rel);
+  }
+
+  /*
+   * Try to swap the bucket ibucket_empty_in_out with a bucket preceding it
+   * while keeping the neighborhood conditions correct.
+   *
+   * If a swap was possible, the position of ibucket_empty_in_out will be closer
+   * to 0 and true will re returned.
+   */
+  bool swap_empty_bucket_closer(table& t, size_type& ibucket_empty_in_out) {
+    tsl_hh_assert(ibucket_empty_in_out >= NeighborhoodSize);
+    const size_type neighborhood_start =
+        ibucket_empty_in_out - NeighborhoodSize + 1;
+
+    for (size_type to_check = neighborhood_start;
+         to_check < ibucket_empty_in_out; to_check++) {
+      std::uint64_t neighborhood_infos =
+          t.bucket_at(to_check).m_neighborhood_infos.load(
+              std::memory_order_relaxed) >>
+          NB_RESERVED_BITS_IN_NEIGHBORHOOD;
+      size_type to_swap = to_check;
+
+      while (neighborhood_infos != 0 && to_swap < ibucket_empty_in_out) {
+        if ((neighborhood_infos & 1) == 1) {
+          tsl_hh_assert(bucket_empty(t, ibucket_empty_in_out));
+          tsl_hh_assert(!bucket_empty(t, to_swap));
+
+          bucket& empty_bucket = t.bucket_at(ibucket_empty_in_out);
+          store_key(empty_bucket, load_key(t.bucket_at(to_swap)));
+          store_value(empty_bucket, load_value(t.bucket_at(to_swap)));
+          empty_bucket.m_neighborhood_infos.fetch_or(OCCUPIED_BIT,
+                                                     std::memory_order_acq_rel);
+
+          t.bucket_at(to_check).m_neighborhood_infos.fetch_xor(
+              neighbor_bit(ibucket_empty_in_out - to_check) |
+                  neighbor_bit(to_swap - to_check),
+              std::memory_order_acq_rel);
+          t.bucket_at(to_swap).m_neighborhood_infos.fetch_and(
+              ~OCCUPIED_BIT, std::memory_order_acq_rel);
+
+          ibucket_empty_in_out = to_swap;
+
+          return true;
+        }
+
+        to_swap++;
+        neighborhood_infos >>= 1;
+      }
+    }
+
+    return false;
+  }
+
+  void erase_from_bucket(table& t, size_type ibucket_for_value,
+                         size_type ibucket_for_hash) noexcept {
+    tsl_hh_assert(ibucket_for_value >= ibucket_for_hash);
+
+    t.bucket_at(ibucket_for_hash)
+        .m_neighborhood_infos.fetch_xor(
+            neighbor_bit(ibucket_for_value - ibucket_for_hash),
+            std::memory_order_acq_rel);
+    t.bucket_at(ibucket_for_value)
+        .m_neighborhood_infos.fetch_and(~OCCUPIED_BIT,
+                                        std::memory_order_acq_rel);
+  }
+
+  /**
+   * Replace the table of the given generation by a new table of bucket_count
+   * buckets, unless it has already been replaced by a concurrent rehash.
+   *
+   * The calling thread must not hold an operation_guard.
+   */
+  void rehash_impl(std::uint64_t generation, size_type bucket_count) {
+    std::lock_guard<std::mutex> rehash_lock(m_rehash_mutex);
+    table* t = m_current_table.get();
+    if (t->m_generation != generation) {
+      return;
+    }
+
+    bucket_count = std::max(
+        bucket_count, size_type(std::ceil(float(size()) / max_load_factor())));
+    auto new_table = std::make_unique<table>(bucket_count, m_max_load_factor,
+                                             generation + 1);
+
+    retire_table(*t);
+
+    // The old table is not modified anymore and the new table is not shared
+    // yet, no need to lock their segments.
+#ifndef TSL_HH_NO_EXCEPTIONS
+    try {
+#endif
+      for (size_type ibucket = 0; ibucket < t->m_nb_buckets; ibucket++) {
+        if (!bucket_empty(*t, ibucket)) {
+          const bucket& b = t->bucket_at(ibucket);
+          insert_in_new_table(*new_table, load_key(b), load_value(b));
+        }
+      }
+
+      for (size_type isegment = 0; isegment < t->m_nb_segments; isegment++) {
+        for (const value_type& value :
+             t->m_segments[isegment].m_overflow_elements) {
+          insert_in_new_table(*new_table, value.first, value.second);
+        }
+      }
+#ifndef TSL_HH_NO_EXCEPTIONS
+    }
+    /*
+     * The allocation of an overflow element may throw. The old table is
+     * untouched, let the waiting writers use it again.
+     */
+    catch (...) {
+      t->m_retired.store(false, std::memory_order_release);
+      throw;
+    }
+#endif
+
+    replace_table(std::move(new_table));
+  }
+
+  /**
+   * Publish new_table in place of the retired current table and free the
+   * retired table once no operation can still read it. m_rehash_mutex must be
+   * held.
+   */
+  void replace_table(std::unique_ptr<table> new_table) {
+    std::unique_ptr<table> old_table = std::move(m_current_table);
+    m_current_table = std::move(new_table);
+    m_table.store(m_current_table.get(), std::memory_order_seq_cst);
+
+    wait_for_readers();
+  }
+
+  /**
+   * Wait until all the operations which started before the call are finished.
+   *
+   * The epoch is advanced twice. Each advance stops new operations from using
+   * the counters of the previous epoch, which can then only drop to zero.
+   * An operation which read the epoch before an advance but incremented its
+   * counter after the wait loads the table after, it can only see the new
+   * table.
+   */
+  void wait_for_readers() {
+    for (int i = 0; i < 2; i++) {
+      const std::uint64_t previous_epoch =
+          m_epoch.fetch_add(1, std::memory_order_seq_cst);
+      for (const reader_counters& counters : m_reader_counters) {
+        while (counters.m_nb_readers[previous_epoch & 1].load(
+                   std::memory_order_seq_cst) != 0) {
+          std::this_thread::yield();
+        }
+      }
+    }
+  }
+
+  /**
+   * Stop the modifications of t. Once the method returns, no writer is
+   * modifying t and the following ones will wait for its replacement.
+   *
+   * The segments are locked one at a time, a writer only checks the flag once
+   * it holds its segments locks.
+   */
+  static void retire_table(table& t) {
+    t.m_retired.store(true, std::memory_order_release);
+    for (size_type i = 0; i < t.m_nb_segments; i++) {
+      std::lock_guard<std::mutex> lock(t.m_segments[i].m_mutex);
+    }
+  }
+
+  /**
+   * Wait until the retired table t is replaced, or un-retired if the rehash
+   * failed.
+   */
+  void wait_for_replacement(const table* t) const {
+    while (m_table.load(std::memory_order_acquire) == t &&
+           t->m_retired.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+
+  void insert_in_new_table(table& t, const Key& key, const T& value) {
+    const std::size_t hash = hash_key(key);
+    const size_type ibucket_for_hash = t.bucket_for_hash(hash);
+    if (!insert_in_buckets(t, ibucket_for_hash, key, value)) {
+      insert_in_overflow(t, ibucket_for_hash, hash, key, value);
+    }
+  }
+
+ public:
+  static const size_type DEFAULT_INIT_BUCKETS_SIZE = 16;
+  static constexpr float DEFAULT_MAX_LOAD_FACTOR =
+      (NeighborhoodSize <= 30) ? 0.8f : 0.9f;
+
+ private:
+  static const std::size_t MAX_PROBES_FOR_EMPTY_BUCKET = 12 * NeighborhoodSize;
+  static constexpr float MIN_LOAD_FACTOR_FOR_REHASH = 0.1f;
+
+  /**
+   * Number of buckets per segment. At least MAX_PROBES_FOR_EMPTY_BUCKET so
+   * that an insertion locks at most two segments.
+   */
+  static const std::size_t SEGMENT_SIZE =
+      tsl::detail_concurrent_hopscotch::round_up_to_power_of_two(
+          MAX_PROBES_FOR_EMPTY_BUCKET);
+
+  static const std::size_t NB_READER_COUNTERS = 16;
+
+ private:
+  const float m_max_load_factor;
+
+  /**
+   * Owner of the current table. Protected by m_rehash_mutex.
+   */
+  std::unique_ptr<table> m_current_table;
+  std::mutex m_rehash_mutex;
+
+  /**
+   * Current table, read without lock by the operations while they hold an
+   * operation_guard.
+   */
+  std::atomic<table*> m_table;
+
+  std::atomic<std::uint64_t> m_epoch;
+  mutable reader_counters m_reader_counters[NB_READER_COUNTERS];
+
+  std::atomic<size_type> m_nb_elements;
+};
+
+}  // end namespace tsl
+
+#endif
@@ -0,0 +1,324 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_HOPSCOTCH_ARENA_ALLOCATOR_H
+#define TSL_HOPSCOTCH_ARENA_ALLOCATOR_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+#include "hopscotch_growth_policy.h"
+
+namespace tsl {
+namespace hh {
+
+/**
+ * Memory arena for short-lived hash tables: the allocations are carved
+ * sequentially out of a buffer given by the caller, e.g. on the stack, then
+ * out of chunks taken from the heap, each one twice as large as the previous
+ * one, when the buffer is full. Everything is freed at once by release() or
+ * by the destructor, which must only be called once all the containers using
+ * the arena are destroyed.
+ *
+ * A deallocation only gives the memory back to the arena if it is the last
+ * allocation, or if it is a small block of at most MAX_POOLED_SIZE bytes. The
+ * small blocks, e.g. the nodes of a node-based overflow container, are kept
+ * in free lists by size class and reused by the next allocations of the same
+ * class. The other blocks, e.g. the previous bucket arrays after a rehash,
+ * stay allocated until the release, reserving the table up front avoids them.
+ *
+ * The arena is not thread-safe, use it through tsl::hh::arena_allocator.
+ */
+class arena {
+ public:
+  /**
+   * Size in bytes of the first heap chunk if the arena is created without a
+   * buffer or with a smaller one.
+   */
+  static constexpr std::size_t MIN_CHUNK_SIZE = 4096;
+
+  /**
+   * The blocks of at most MAX_POOLED_SIZE bytes are rounded up to a multiple
+   * of POOL_GRANULARITY bytes and reused once deallocated.
+   */
+  static constexpr std::size_t MAX_POOLED_SIZE = 256;
+  static constexpr std::size_t POOL_GRANULARITY = alignof(std::max_align_t);
+
+  arena() noexcept : arena(nullptr, 0) {}
+
+  /**
+   * Arena starting with the buffer of size bytes, which must outlive the
+   * arena. The buffer doesn't need any particular alignment.
+   */
+  arena(void* buffer, std::size_t size) noexcept
+      : m_buffer(static_cast<unsigned char*>(buffer)),
+        m_buffer_size(size),
+        m_current(m_buffer),
+        m_end(m_buffer + size),
+        m_chunks(nullptr),
+        m_next_chunk_size(std::max(size, MIN_CHUNK_SIZE)),
+        m_heap_size(0),
+        m_free_lists() {}
+
+  arena(const arena&) = delete;
+  arena& operator=(const arena&) = delete;
+
+  ~arena() { release(); }
+
+  /**
+   * Allocate size bytes aligned on alignment, which must be a power of two.
+   */
+  void* allocate(std::size_t size, std::size_t alignment) {
+    tsl_hh_assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    if (is_pooled(size, alignment)) {
+      size = pooled_size(size);
+
+      free_block*& free_list = m_free_lists[size_class(size)];
+      if (free_list != nullptr) {
+        free_block* block = free_list;
+        free_list = block->m_next;
+
+        return block;
+      }
+
+      return allocate_bytes(size, POOL_GRANULARITY);
+    }
+
+    return allocate_bytes(std::max<std::size_t>(size, 1), alignment);
+  }
+
+  /**
+   * Give back a block allocated by allocate with the same size and alignment.
+   */
+  void deallocate(void* p, std::size_t size, std::size_t alignment) noexcept {
+    const bool pooled = is_pooled(size, alignment);
+    if (pooled) {
+      size = pooled_size(size);
+    }
+
+    unsigned char* block = static_cast<unsigned char*>(p);
+    if (block + std::max<std::size_t>(size, 1) == m_current) {
+      m_current = block;
+    } else if (pooled) {
+      free_block*& free_list = m_free_lists[size_class(size)];
+      free_list = ::new (p) free_block{free_list};
+    }
+  }
+
+  /**
+   * Free all the heap chunks and start again from the beginning of the
+   * buffer. All the allocations of the arena are invalidated.
+   */
+  void release() noexcept {
+    while (m_chunks != nullptr) {
+      chunk* previous = m_chunks->m_previous;
+      ::operator delete(static_cast<void*>(m_chunks));
+      m_chunks = previous;
+    }
+
+    m_current = m_buffer;
+    m_end = m_buffer + m_buffer_size;
+    m_next_chunk_size = std::max(m_buffer_size, MIN_CHUNK_SIZE);
+    m_heap_size = 0;
+    std::fill(std::begin(m_free_lists), std::end(m_free_lists), nullptr);
+  }
+
+  /**
+   * Number of bytes taken from the heap, zero as long as the allocations fit
+   * in the buffer.
+   */
+  std::size_t heap_size() const noexcept { return m_heap_size; }
+
+ private:
+  struct chunk {
+    chunk* m_previous;
+  };
+
+  struct free_block {
+    free_block* m_next;
+  };
+
+  static constexpr std::size_t CHUNK_HEADER_SIZE =
+      (sizeof(chunk) + POOL_GRANULARITY - 1) / POOL_GRANULARITY *
+      POOL_GRANULARITY;
+  static constexpr std::size_t NB_SIZE_CLASSES =
+      MAX_POOLED_SIZE / POOL_GRANULARITY;
+
+  static_assert(sizeof(free_block) <= POOL_GRANULARITY, "");
+
+  static bool is_pooled(std::size_t size, std::size_t alignment) noexcept {
+    return size <= MAX_POOLED_SIZE && alignment <= POOL_GRANULARITY;
+  }
+
+  static std::size_t size_class(std::size_t pooled_size) noexcept {
+    return pooled_size / POOL_GRANULARITY - 1;
+  }
+
+  static std::size_t pooled_size(std::size_t size) noexcept {
+    return (std::max<std::size_t>(size, 1) + POOL_GRANULARITY - 1) /
+           POOL_GRANULARITY * POOL_GRANULARITY;
+  }
+
+  void* allocate_bytes(std::size_t size, std::size_t alignment) {
+    void* p = allocate_in_current(size, alignment);
+    if (p != nullptr) {
+      return p;
+    }
+
+    if (size > std::numeric_limits<std::size_t>::max() / 2 - alignment -
+                   CHUNK_HEADER_SIZE) {
+      throw_bad_alloc();
+    }
+
+    const std::size_t chunk_size = std::max(
+        m_next_chunk_size, CHUNK_HEADER_SIZE + alignment - 1 + size);
+    unsigned char* data =
+        static_cast<unsigned char*>(::operator new(chunk_size));
+    m_chunks = ::new (static_cast<void*>(data)) chunk{m_chunks};
+
+    m_current = data + CHUNK_HEADER_SIZE;
+    m_end = data + chunk_size;
+    m_next_chunk_size = chunk_size * 2;
+    m_heap_size += chunk_size;
+
+    p = allocate_in_current(size, alignment);
+    tsl_hh_assert(p != nullptr);
+
+    return p;
+  }
+
+  void* allocate_in_current(std::size_t size, std::size_t alignment) noexcept {
+    if (m_current == nullptr) {
+      return nullptr;
+    }
+
+    const std::uintptr_t current = reinterpret_cast<std::uintptr_t>(m_current);
+    const std::size_t padding =
+        std::size_t((alignment - current % alignment) % alignment);
+    const std::size_t available = std::size_t(m_end - m_current);
+    if (padding > available || size > available - padding) {
+      return nullptr;
+    }
+
+    unsigned char* p = m_current + padding;
+    m_current = p + size;
+
+    return p;
+  }
+
+  [[noreturn]] static void throw_bad_alloc() {
+#ifdef TSL_HH_NO_EXCEPTIONS
+    std::terminate();
+#else
+    throw std::bad_alloc();
+#endif
+  }
+
+  unsigned char* m_buffer;
+  std::size_t m_buffer_size;
+  unsigned char* m_current;
+  unsigned char* m_end;
+  chunk* m_chunks;
+  std::size_t m_next_chunk_size;
+  std::size_t m_heap_size;
+  free_block* m_free_lists[NB_SIZE_CLASSES];
+};
+
+/**
+ * Allocator allocating from a tsl::hh::arena, which must outlive all the
+ * containers using it, e.g. for a map built and destroyed within a request:
+ *
+ * unsigned char buffer[16384];
+ * tsl::hh::arena arena(buffer, sizeof(buffer));
+ * tsl::hopscotch_map<Key, T, Hash, KeyEqual,
+ *                    tsl::hh::arena_allocator<std::pair<Key, T>>>
+ *     map(tsl::hh::arena_allocator<std::pair<Key, T>>(arena));
+ *
+ * Two allocators are equal if they use the same arena. The arena follows the
+ * containers on move assignment and swap but not on copy assignment.
+ */
+template <class T>
+class arena_allocator {
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  explicit arena_allocator(arena& memory_arena) noexcept
+      : m_arena(&memory_arena) {}
+
+  template <class U>
+  arena_allocator(const arena_allocator<U>& other) noexcept
+      : m_arena(&other.get_arena()) {}
+
+  T* allocate(size_type n) {
+    if (n > max_size()) {
+#ifdef TSL_HH_NO_EXCEPTIONS
+      std::terminate();
+#else
+      throw std::bad_alloc();
+#endif
+    }
+
+    return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, size_type n) noexcept {
+    m_arena->deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  size_type max_size() const noexcept {
+    return std::numeric_limits<size_type>::max() / 2 / sizeof(T);
+  }
+
+  arena& get_arena() const noexcept { return *m_arena; }
+
+ private:
+  arena* m_arena;
+};
+
+template <class T, class U>
+bool operator==(const arena_allocator<T>& lhs, const arena_allocator<U>& rhs) {
+  return &lhs.get_arena() == &rhs.get_arena();
+}
+
+template <class T, class U>
+bool operator!=(const arena_allocator<T>& lhs, const arena_allocator<U>& rhs) {
+  return !(lhs == rhs);
+}
+
+}  // namespace hh
+}  // namespace tsl
+
+#endif
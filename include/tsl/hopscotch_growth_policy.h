@@ -35,6 +35,10 @@
 #include <ratio>
 #include <stdexcept>
 
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
 /**
  * Only activate tsl_hh_assert if TSL_DEBUG is defined.
  * This way we avoid the performance hit when NDEBUG is not defined with assert
@@ -398,6 +402,109 @@ class prime_growth_policy {
                 "The type of m_iprime is not big enough.");
 };
 
+namespace detail {
+
+/**
+ * Return the high half of the product of hash and bucket_count, a value in
+ * [0, bucket_count) (see https://arxiv.org/abs/1805.10941).
+ */
+inline std::size_t multiply_high(std::size_t hash,
+                                 std::size_t bucket_count) noexcept {
+#if SIZE_MAX > UINT32_MAX
+#if defined(__SIZEOF_INT128__)
+  __extension__ typedef unsigned __int128 uint128;
+
+  return static_cast<std::size_t>(
+      (static_cast<uint128>(hash) * bucket_count) >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  return static_cast<std::size_t>(__umulh(hash, bucket_count));
+#else
+  const std::uint64_t hash_lo = hash & 0xffffffff;
+  const std::uint64_t hash_hi = std::uint64_t(hash) >> 32;
+  const std::uint64_t count_lo = bucket_count & 0xffffffff;
+  const std::uint64_t count_hi = std::uint64_t(bucket_count) >> 32;
+
+  const std::uint64_t lo_lo = hash_lo * count_lo;
+  const std::uint64_t hi_lo = hash_hi * count_lo;
+  const std::uint64_t middle =
+      (lo_lo >> 32) + (hi_lo & 0xffffffff) + hash_lo * count_hi;
+
+  return static_cast<std::size_t>(hash_hi * count_hi + (hi_lo >> 32) +
+                                  (middle >> 32));
+#endif
+#else
+  return static_cast<std::size_t>(
+      (std::uint64_t(hash) * std::uint64_t(bucket_count)) >> 32);
+#endif
+}
+
+}  // namespace detail
+
+/**
+ * Grow the hash table by GrowthFactor::num / GrowthFactor::den like
+ * tsl::hh::mod_growth_policy, but map a hash to a bucket with the high half of
+ * hash * bucket_count instead of a modulo. The bucket count can be any number
+ * and the cost is close to the one of a mask.
+ *
+ * The bucket only depends on the high bits of the hash, the hash function must
+ * have good high bits. With a hash which doesn't declare an 'is_avalanching'
+ * member type (see tsl::hh::is_avalanching), the hash table mixes the hashes
+ * first as for tsl::hh::power_of_two_growth_policy.
+ */
+template <class GrowthFactor = std::ratio<3, 2>>
+class fastrange_growth_policy {
+ public:
+  explicit fastrange_growth_policy(std::size_t& min_bucket_count_in_out) {
+    if (min_bucket_count_in_out > max_bucket_count()) {
+      TSL_HH_THROW_OR_TERMINATE(std::length_error,
+                                "The hash table exceeds its maximum size.");
+    }
+
+    m_bucket_count = min_bucket_count_in_out;
+  }
+
+  std::size_t bucket_for_hash(std::size_t hash) const noexcept {
+    return detail::multiply_high(hash, m_bucket_count);
+  }
+
+  std::size_t next_bucket_count() const {
+    if (m_bucket_count == max_bucket_count()) {
+      TSL_HH_THROW_OR_TERMINATE(std::length_error,
+                                "The hash table exceeds its maximum size.");
+    }
+
+    const double next_bucket_count = std::ceil(
+        double(std::max<std::size_t>(m_bucket_count, 1)) *
+        REHASH_SIZE_MULTIPLICATION_FACTOR);
+    if (!std::isnormal(next_bucket_count)) {
+      TSL_HH_THROW_OR_TERMINATE(std::length_error,
+                                "The hash table exceeds its maximum size.");
+    }
+
+    if (next_bucket_count > double(max_bucket_count())) {
+      return max_bucket_count();
+    } else {
+      return std::size_t(next_bucket_count);
+    }
+  }
+
+  std::size_t max_bucket_count() const { return MAX_BUCKET_COUNT; }
+
+  void clear() noexcept { m_bucket_count = 0; }
+
+ private:
+  static constexpr double REHASH_SIZE_MULTIPLICATION_FACTOR =
+      1.0 * GrowthFactor::num / GrowthFactor::den;
+  static const std::size_t MAX_BUCKET_COUNT =
+      std::size_t(double(std::numeric_limits<std::size_t>::max() /
+                         REHASH_SIZE_MULTIPLICATION_FACTOR));
+
+  static_assert(REHASH_SIZE_MULTIPLICATION_FACTOR >= 1.1,
+                "Growth factor should be >= 1.1.");
+
+  std::size_t m_bucket_count;
+};
+
 /**
  * SFINAE helper to detect growth policies which can be noexcept-initialized
  * with a zero min bucket count.
@@ -412,6 +519,9 @@ struct is_noexcept_on_zero_init<mod_growth_policy<GrowthFactor>>
     : std::true_type {};
 template <>
 struct is_noexcept_on_zero_init<prime_growth_policy> : std::true_type {};
+template <class GrowthFactor>
+struct is_noexcept_on_zero_init<fastrange_growth_policy<GrowthFactor>>
+    : std::true_type {};
 
 }  // namespace hh
 }  // namespace tsl
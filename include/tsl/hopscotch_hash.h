@@ -29,6 +29,8 @@
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <initializer_list>
 #include <iterator>
@@ -42,8 +44,177 @@
 #include <vector>
 
 #include "hopscotch_growth_policy.h"
+#include "hopscotch_hash_functions.h"
+#include "hopscotch_overflow_table.h"
+
+#ifdef TSL_HH_ENABLE_STATS
+#include <atomic>
+#include <chrono>
+#endif
+
+/**
+ * If TSL_HH_SIMD_GATHER is defined and the compiler targets AVX2 (e.g. "-mavx2"
+ * or "-march=native"), the hashes stored in a neighborhood are compared all at
+ * once with AVX2 gathers when StoreHash is true. Scalar code is used otherwise.
+ *
+ * As the stored hashes are interleaved with the values in the buckets, they
+ * have to be gathered one by one. On CPUs with a slow gather instruction (e.g.
+ * recent Intel CPUs with the GDS mitigation) it is slower than the scalar loop,
+ * the option is thus off by default. Measure with the neighborhood probe
+ * benchmark before enabling it.
+ */
+#if defined(TSL_HH_SIMD_GATHER) && defined(__AVX2__)
+#define TSL_HH_AVX2_GATHER
+#include <immintrin.h>
+#endif
+
+/**
+ * SSE2 or AVX2 are used to compare the contiguous hash fragments of a
+ * neighborhood all at once (see tsl::hopscotch_soa_map) when the compiler
+ * targets them. Define TSL_HH_NO_SIMD to always use the scalar code.
+ */
+#if !defined(TSL_HH_NO_SIMD) && defined(__AVX2__)
+#define TSL_HH_AVX2
+#include <immintrin.h>
+#elif !defined(TSL_HH_NO_SIMD) &&             \
+    (defined(__SSE2__) || defined(_M_X64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define TSL_HH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
 
 namespace tsl {
+namespace hh {
+
+/**
+ * Tag telling bulk_build that the keys of the range are distinct and not
+ * already in the container, skipping the check for duplicates.
+ */
+struct unique_keys_t {
+  explicit unique_keys_t() = default;
+};
+
+inline constexpr unique_keys_t unique_keys{};
+
+/**
+ * Layout of the elements of a hash table at the time of a call to its
+ * analyze() method, to choose its NeighborhoodSize, max_load_factor and
+ * growth policy from real data.
+ */
+struct hopscotch_analysis {
+  std::size_t nb_elements = 0;
+  std::size_t bucket_count = 0;
+  float load_factor = 0;
+
+  /**
+   * neighborhood_occupancy[n] is the number of buckets which are the home
+   * bucket of n elements stored in their neighborhood, for n in
+   * [0, NeighborhoodSize].
+   */
+  std::vector<std::size_t> neighborhood_occupancy;
+
+  /**
+   * displacement_distribution[d] is the number of elements stored d buckets
+   * after their home bucket, for d in [0, NeighborhoodSize). The elements of
+   * the overflow list are not counted here.
+   */
+  std::vector<std::size_t> displacement_distribution;
+  double average_displacement = 0;
+  std::size_t max_displacement = 0;
+
+  /**
+   * Runs of consecutive non-empty buckets: number of runs and average and
+   * max length.
+   */
+  std::size_t nb_full_bucket_runs = 0;
+  double average_full_bucket_run = 0;
+  std::size_t max_full_bucket_run = 0;
+
+  /**
+   * Number of home buckets with elements in the overflow list, and number of
+   * these elements.
+   */
+  std::size_t nb_overflow_home_buckets = 0;
+  std::size_t overflow_size = 0;
+
+  /**
+   * Average number of cache lines of the buckets array read by a lookup,
+   * from the home bucket to the bucket of the element, of a key in the
+   * buckets (average over these elements) or of a key not in the table
+   * (average over the home buckets). A search of the overflow list counts as
+   * one more line.
+   */
+  double cache_lines_per_successful_lookup = 0;
+  double cache_lines_per_unsuccessful_lookup = 0;
+};
+
+#ifdef TSL_HH_ENABLE_STATS
+/**
+ * Snapshot of the counters kept by a hash table when TSL_HH_ENABLE_STATS is
+ * defined, see the stats() method of the containers.
+ *
+ * The counters cover the operations done on the container object since its
+ * construction or the last reset_stats(). They are not copied, moved or
+ * swapped along with the elements.
+ */
+struct hopscotch_stats {
+  /**
+   * Number of rehashes, automatic or through rehash/reserve, and their total
+   * duration.
+   */
+  std::uint64_t nb_rehashes = 0;
+  std::chrono::nanoseconds rehash_duration{0};
+
+  /**
+   * Number of elements inserted in a bucket of their neighborhood.
+   */
+  std::uint64_t nb_bucket_inserts = 0;
+
+  /**
+   * Number of values moved to bring an empty bucket closer to the
+   * neighborhood of an inserted element, and the longest chain of moves
+   * needed by one insertion.
+   */
+  std::uint64_t nb_displacements = 0;
+  std::uint64_t max_displacements = 0;
+
+  /**
+   * Searches of an empty bucket on insertion: number of searches which found
+   * one, sum and max of the distances between the home bucket and the empty
+   * bucket, and number of searches which found none in the probe limit.
+   */
+  std::uint64_t nb_empty_bucket_searches = 0;
+  std::uint64_t empty_bucket_distance_sum = 0;
+  std::uint64_t max_empty_bucket_distance = 0;
+  std::uint64_t nb_empty_bucket_not_found = 0;
+
+  /**
+   * Number of elements inserted in the overflow list because their
+   * neighborhood was full, and number of searches in the overflow list.
+   */
+  std::uint64_t nb_overflow_inserts = 0;
+  std::uint64_t nb_overflow_lookups = 0;
+
+  /**
+   * Number of elements currently in the overflow list.
+   */
+  std::size_t overflow_size = 0;
+
+  /**
+   * neighborhood_occupancy[n] is the number of buckets which currently are
+   * the home bucket of n elements stored in their neighborhood, for n in
+   * [0, NeighborhoodSize].
+   */
+  std::vector<std::size_t> neighborhood_occupancy;
+};
+#endif
+
+}  // namespace hh
+
 namespace detail_hopscotch_hash {
 
 template <typename T>
@@ -66,6 +237,14 @@ template <typename T>
 struct has_key_compare<T, typename make_void<typename T::key_compare>::type>
     : std::true_type {};
 
+template <typename T, typename = void>
+struct has_allocate_zeroed : std::false_type {};
+
+template <typename T>
+struct has_allocate_zeroed<
+    T, typename make_void<decltype(std::declval<T&>().allocate_zeroed(
+           std::size_t(0)))>::type> : std::true_type {};
+
 template <typename U>
 struct is_power_of_two_policy : std::false_type {};
 
@@ -73,6 +252,43 @@ template <std::size_t GrowthFactor>
 struct is_power_of_two_policy<tsl::hh::power_of_two_growth_policy<GrowthFactor>>
     : std::true_type {};
 
+template <typename U>
+struct is_fastrange_policy : std::false_type {};
+
+template <class GrowthFactor>
+struct is_fastrange_policy<tsl::hh::fastrange_growth_policy<GrowthFactor>>
+    : std::true_type {};
+
+/**
+ * power_of_two_growth_policy only looks at the low bits of a hash and
+ * fastrange_growth_policy mostly at the high bits. Unless Hash is declared as
+ * avalanching (see tsl::hh::is_avalanching), the hashes are thus mixed with
+ * mix_hash_bits before being used with these policies, so that keys differing
+ * only in some of their bits (e.g. the multiples of a power of two or small
+ * integers with an identity hash) are still spread over all the buckets.
+ */
+template <class Hash, class GrowthPolicy>
+struct needs_hash_mixing
+    : std::integral_constant<bool,
+                             (is_power_of_two_policy<GrowthPolicy>::value ||
+                              is_fastrange_policy<GrowthPolicy>::value) &&
+                                 !tsl::hh::is_avalanching<Hash>::value> {};
+
+/**
+ * Multiply hash by an odd constant and fold the high half of the product into
+ * the low half, each low bit of the result depends on all the bits of hash.
+ */
+inline std::size_t mix_hash_bits(std::size_t hash) noexcept {
+  if constexpr (sizeof(std::size_t) >= sizeof(std::uint64_t)) {
+    return static_cast<std::size_t>(tsl::detail_hash_functions::mix(
+        hash, tsl::detail_hash_functions::GOLDEN_RATIO));
+  } else {
+    const std::uint64_t product =
+        std::uint64_t(hash) * tsl::detail_hash_functions::PRIME32;
+    return static_cast<std::size_t>(product ^ (product >> 32));
+  }
+}
+
 template <typename T, typename U>
 static T numeric_cast(U value,
                       const char* error_message = "numeric_cast() failed.") {
@@ -192,7 +408,7 @@ class hopscotch_bucket_hash<true> {
 
 template <typename ValueType, unsigned int NeighborhoodSize, bool StoreHash>
 class hopscotch_bucket : public hopscotch_bucket_hash<StoreHash> {
- private:
+ public:
   static const std::size_t MIN_NEIGHBORHOOD_SIZE = 4;
   static const std::size_t MAX_NEIGHBORHOOD_SIZE =
       SMALLEST_TYPE_MAX_BITS_SUPPORTED - NB_RESERVED_BITS_IN_NEIGHBORHOOD;
@@ -210,6 +426,7 @@ class hopscotch_bucket : public hopscotch_bucket_hash<StoreHash> {
   // We can't put a variable in the message, ensure coherence
   static_assert(MAX_NEIGHBORHOOD_SIZE - 32 == 30, "");
 
+ private:
   using bucket_hash = hopscotch_bucket_hash<StoreHash>;
 
  public:
@@ -217,6 +434,40 @@ class hopscotch_bucket : public hopscotch_bucket_hash<StoreHash> {
   using neighborhood_bitmap = typename smallest_type_for_min_bits<
       NeighborhoodSize + NB_RESERVED_BITS_IN_NEIGHBORHOOD>::type;
 
+ private:
+  static constexpr std::size_t NB_BITMAP_BITS =
+      std::numeric_limits<neighborhood_bitmap>::digits;
+
+ public:
+  /**
+   * If StoreHash is false, the most significant bits of the bitmap which
+   * aren't used by the neighborhood, up to 8, keep the most significant bits
+   * of the truncated hash of the value. Most of the keys with a different
+   * hash are then skipped without comparing them. E.g. a NeighborhoodSize of
+   * 22 for a 32-bit bitmap leaves an 8-bit fragment.
+   */
+  static constexpr std::size_t NB_HASH_FRAGMENT_BITS =
+      StoreHash ? 0
+                : std::min<std::size_t>(
+                      8, NB_BITMAP_BITS - NeighborhoodSize -
+                             NB_RESERVED_BITS_IN_NEIGHBORHOOD);
+
+  /**
+   * True if bucket_hash_equal can tell that a value has a different hash.
+   */
+  static constexpr bool HAS_HASH_FILTER =
+      StoreHash || NB_HASH_FRAGMENT_BITS > 0;
+
+ private:
+  static constexpr std::size_t HASH_FRAGMENT_SHIFT =
+      NB_BITMAP_BITS - NB_HASH_FRAGMENT_BITS;
+  static constexpr std::uint64_t HASH_FRAGMENT_MASK =
+      (NB_HASH_FRAGMENT_BITS == 0)
+          ? 0
+          : ((std::uint64_t(1) << NB_HASH_FRAGMENT_BITS) - 1)
+                << HASH_FRAGMENT_SHIFT;
+
+ public:
   hopscotch_bucket() noexcept : bucket_hash(), m_neighborhood_infos(0) {
     tsl_hh_assert(empty());
   }
@@ -269,10 +520,19 @@ class hopscotch_bucket : public hopscotch_bucket_hash<StoreHash> {
   }
 
   neighborhood_bitmap neighborhood_infos() const noexcept {
-    return neighborhood_bitmap(m_neighborhood_infos >>
+    return neighborhood_bitmap((m_neighborhood_infos & ~HASH_FRAGMENT_MASK) >>
                                NB_RESERVED_BITS_IN_NEIGHBORHOOD);
   }
 
+  bool bucket_hash_equal(std::size_t hash) const noexcept {
+    if constexpr (NB_HASH_FRAGMENT_BITS > 0) {
+      return (m_neighborhood_infos & HASH_FRAGMENT_MASK) ==
+             hash_fragment_bits(truncate_hash(hash));
+    } else {
+      return bucket_hash::bucket_hash_equal(hash);
+    }
+  }
+
   void set_overflow(bool has_overflow) noexcept {
     if (has_overflow) {
       m_neighborhood_infos = neighborhood_bitmap(m_neighborhood_infos | 2);
@@ -324,6 +584,7 @@ class hopscotch_bucket : public hopscotch_bucket_hash<StoreHash> {
         value_type(std::forward<Args>(value_type_args)...);
     set_empty(false);
     this->set_hash(hash);
+    set_hash_fragment_bits(hash_fragment_bits(hash));
   }
 
   void swap_value_into_empty_bucket(hopscotch_bucket& empty_bucket) {
@@ -332,6 +593,8 @@ class hopscotch_bucket : public hopscotch_bucket_hash<StoreHash> {
       ::new (static_cast<void*>(std::addressof(empty_bucket.m_value)))
           value_type(std::move(value()));
       empty_bucket.copy_hash(*this);
+      empty_bucket.set_hash_fragment_bits(m_neighborhood_infos &
+                                          HASH_FRAGMENT_MASK);
       empty_bucket.set_empty(false);
 
       destroy_value();
@@ -355,6 +618,29 @@ class hopscotch_bucket : public hopscotch_bucket_hash<StoreHash> {
     tsl_hh_assert(empty());
   }
 
+  /**
+   * Set the whole bitmap, the bit telling if the bucket has a value must stay
+   * the same. Used by deserialization.
+   */
+  void set_neighborhood_infos(neighborhood_bitmap neighborhood_infos) noexcept {
+    tsl_hh_assert(((neighborhood_infos & 1) == 0) == empty());
+    m_neighborhood_infos = neighborhood_infos;
+  }
+
+  std::uint64_t raw_neighborhood_infos() const noexcept {
+    return m_neighborhood_infos;
+  }
+
+  /**
+   * Unset all the neighbor bits, keep the empty and overflow bits and the
+   * hash fragment.
+   */
+  void clear_neighbors() noexcept {
+    m_neighborhood_infos = neighborhood_bitmap(
+        m_neighborhood_infos &
+        (((1u << NB_RESERVED_BITS_IN_NEIGHBORHOOD) - 1) | HASH_FRAGMENT_MASK));
+  }
+
   static truncated_hash_type truncate_hash(std::size_t hash) noexcept {
     return truncated_hash_type(hash);
   }
@@ -373,150 +659,710 @@ class hopscotch_bucket : public hopscotch_bucket_hash<StoreHash> {
     value().~value_type();
   }
 
+  static std::uint64_t hash_fragment_bits(truncated_hash_type hash) noexcept {
+    if constexpr (NB_HASH_FRAGMENT_BITS > 0) {
+      return (std::uint64_t(hash) >>
+              (std::numeric_limits<truncated_hash_type>::digits -
+               NB_HASH_FRAGMENT_BITS))
+             << HASH_FRAGMENT_SHIFT;
+    } else {
+      (void)hash;
+      return 0;
+    }
+  }
+
+  void set_hash_fragment_bits(std::uint64_t fragment_bits) noexcept {
+    if constexpr (NB_HASH_FRAGMENT_BITS > 0) {
+      m_neighborhood_infos = neighborhood_bitmap(
+          (m_neighborhood_infos & ~HASH_FRAGMENT_MASK) | fragment_bits);
+    } else {
+      (void)fragment_bits;
+    }
+  }
+
  private:
   neighborhood_bitmap m_neighborhood_infos;
   alignas(value_type) unsigned char m_value[sizeof(value_type)];
 };
 
 /**
- * Internal common class used by (b)hopscotch_map and (b)hopscotch_set.
- *
- * ValueType is what will be stored by hopscotch_hash (usually std::pair<Key, T>
- * for a map and Key for a set).
- *
- * KeySelect should be a FunctionObject which takes a ValueType in parameter and
- * returns a reference to the key.
+ * Array of buckets used by hopscotch_hash, a pointer and a size.
  *
- * ValueSelect should be a FunctionObject which takes a ValueType in parameter
- * and returns a reference to the value. ValueSelect should be void if there is
- * no value (in a set for example).
+ * A bucket with all its bytes to zero is an empty bucket, the buckets are
+ * thus not constructed one by one but allocated zeroed:
+ * - with std::calloc if Allocator is std::allocator, which gets the pages of a
+ *   large array already zeroed (and only faulted on first use) from the
+ *   system;
+ * - with Allocator::allocate_zeroed(n) if the allocator has it (e.g.
+ *   tsl::hh::huge_page_allocator), the memory is then deallocated with
+ *   Allocator::deallocate;
+ * - with Allocator::allocate and a memset otherwise.
+ * The values are only destroyed one by one if they aren't trivially
+ * destructible.
  *
- * OverflowContainer will be used as containers for overflown elements. Usually
- * it should be a list<ValueType> or a set<Key>/map<Key, T>.
+ * An empty array points to a static empty bucket, so that a lookup in an empty
+ * table doesn't have to check the size first.
  */
-template <class ValueType, class KeySelect, class ValueSelect, class Hash,
-          class KeyEqual, class Allocator, unsigned int NeighborhoodSize,
-          bool StoreHash, class GrowthPolicy, class OverflowContainer>
-class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
+template <class Bucket, class Allocator>
+class hopscotch_bucket_array : private Allocator {
  private:
-  template <typename U>
-  using has_mapped_type =
-      typename std::integral_constant<bool, !std::is_same<U, void>::value>;
+  using value_type = typename Bucket::value_type;
+  using allocator_traits = std::allocator_traits<Allocator>;
 
-  static_assert(
-      noexcept(std::declval<GrowthPolicy>().bucket_for_hash(std::size_t(0))),
-      "GrowthPolicy::bucket_for_hash must be noexcept.");
-  static_assert(noexcept(std::declval<GrowthPolicy>().clear()),
-                "GrowthPolicy::clear must be noexcept.");
+  static constexpr bool USE_CALLOC =
+      std::is_same<Allocator, std::allocator<Bucket>>::value &&
+      alignof(Bucket) <= alignof(std::max_align_t);
 
  public:
-  template <bool IsConst>
-  class hopscotch_iterator;
-
-  using key_type = typename KeySelect::key_type;
-  using value_type = ValueType;
-  using size_type = std::size_t;
-  using difference_type = std::ptrdiff_t;
-  using hasher = Hash;
-  using key_equal = KeyEqual;
   using allocator_type = Allocator;
-  using reference = value_type&;
-  using const_reference = const value_type&;
-  using pointer = value_type*;
-  using const_pointer = const value_type*;
-  using iterator = hopscotch_iterator<false>;
-  using const_iterator = hopscotch_iterator<true>;
+  using size_type = std::size_t;
+  using iterator = Bucket*;
+  using const_iterator = const Bucket*;
 
- private:
-  using hopscotch_bucket =
-      tsl::detail_hopscotch_hash::hopscotch_bucket<ValueType, NeighborhoodSize,
-                                                   StoreHash>;
-  using neighborhood_bitmap = typename hopscotch_bucket::neighborhood_bitmap;
+  explicit hopscotch_bucket_array(const Allocator& alloc) noexcept
+      : Allocator(alloc),
+        m_buckets(static_empty_bucket_ptr()),
+        m_nb_buckets(0) {}
 
-  using buckets_allocator = typename std::allocator_traits<
-      allocator_type>::template rebind_alloc<hopscotch_bucket>;
-  using buckets_container_type =
-      std::vector<hopscotch_bucket, buckets_allocator>;
+  hopscotch_bucket_array(const hopscotch_bucket_array& other,
+                         const Allocator& alloc)
+      : hopscotch_bucket_array(alloc) {
+    if (other.m_nb_buckets == 0) {
+      return;
+    }
 
-  using overflow_container_type = OverflowContainer;
+    Bucket* buckets = allocate_buckets(other.m_nb_buckets, false);
+    if constexpr (std::is_trivially_copyable<value_type>::value) {
+      std::memcpy(static_cast<void*>(buckets),
+                  static_cast<const void*>(other.m_buckets),
+                  other.m_nb_buckets * sizeof(Bucket));
+    } else {
+      size_type ibucket = 0;
+#ifndef TSL_HH_NO_EXCEPTIONS
+      try {
+#endif
+        for (; ibucket < other.m_nb_buckets; ibucket++) {
+          ::new (static_cast<void*>(buckets + ibucket))
+              Bucket(other.m_buckets[ibucket]);
+        }
+#ifndef TSL_HH_NO_EXCEPTIONS
+      } catch (...) {
+        destroy_values(buckets, ibucket);
+        deallocate_buckets(buckets, other.m_nb_buckets);
+        throw;
+      }
+#endif
+    }
 
-  static_assert(std::is_same<typename overflow_container_type::value_type,
-                             ValueType>::value,
-                "OverflowContainer should have ValueType as type.");
+    m_buckets = buckets;
+    m_nb_buckets = other.m_nb_buckets;
+  }
 
-  static_assert(std::is_same<typename overflow_container_type::allocator_type,
-                             Allocator>::value,
-                "Invalid allocator, not the same type as the value_type.");
+  hopscotch_bucket_array(hopscotch_bucket_array&& other) noexcept
+      : Allocator(std::move(static_cast<Allocator&>(other))),
+        m_buckets(other.m_buckets),
+        m_nb_buckets(other.m_nb_buckets) {
+    other.m_buckets = static_empty_bucket_ptr();
+    other.m_nb_buckets = 0;
+  }
+
+  hopscotch_bucket_array& operator=(const hopscotch_bucket_array& other) {
+    if (this != &other) {
+      if constexpr (allocator_traits::propagate_on_container_copy_assignment::
+                        value) {
+        hopscotch_bucket_array tmp(other, other.get_allocator());
+        swap_with_allocators(tmp);
+      } else {
+        hopscotch_bucket_array tmp(other, get_allocator());
+        swap_buckets(tmp);
+      }
+    }
 
-  using iterator_buckets = typename buckets_container_type::iterator;
-  using const_iterator_buckets =
-      typename buckets_container_type::const_iterator;
+    return *this;
+  }
 
-  using iterator_overflow = typename overflow_container_type::iterator;
-  using const_iterator_overflow =
-      typename overflow_container_type::const_iterator;
+  hopscotch_bucket_array& operator=(hopscotch_bucket_array&&) = delete;
 
- public:
-  /**
-   * The `operator*()` and `operator->()` methods return a const reference and
-   * const pointer respectively to the stored value type.
-   *
-   * In case of a map, to get a modifiable reference to the value associated to
-   * a key (the `.second` in the stored pair), you have to call `value()`.
-   */
-  template <bool IsConst>
-  class hopscotch_iterator {
-    friend class hopscotch_hash;
+  ~hopscotch_bucket_array() { release(); }
 
-   private:
-    using iterator_bucket = typename std::conditional<
-        IsConst, typename hopscotch_hash::const_iterator_buckets,
-        typename hopscotch_hash::iterator_buckets>::type;
-    using iterator_overflow = typename std::conditional<
-        IsConst, typename hopscotch_hash::const_iterator_overflow,
-        typename hopscotch_hash::iterator_overflow>::type;
+  allocator_type get_allocator() const {
+    return static_cast<const Allocator&>(*this);
+  }
 
-    hopscotch_iterator(iterator_bucket buckets_iterator,
-                       iterator_bucket buckets_end_iterator,
-                       iterator_overflow overflow_iterator) noexcept
-        : m_buckets_iterator(buckets_iterator),
-          m_buckets_end_iterator(buckets_end_iterator),
-          m_overflow_iterator(overflow_iterator) {}
+  iterator begin() noexcept { return m_buckets; }
+  const_iterator begin() const noexcept { return m_buckets; }
+  const_iterator cbegin() const noexcept { return m_buckets; }
 
-   public:
-    using iterator_category = std::forward_iterator_tag;
-    using value_type = const typename hopscotch_hash::value_type;
-    using difference_type = std::ptrdiff_t;
-    using reference = value_type&;
-    using pointer = value_type*;
+  iterator end() noexcept { return m_buckets + m_nb_buckets; }
+  const_iterator end() const noexcept { return m_buckets + m_nb_buckets; }
+  const_iterator cend() const noexcept { return m_buckets + m_nb_buckets; }
 
-    hopscotch_iterator() noexcept {}
+  Bucket* data() noexcept { return m_buckets; }
+  const Bucket* data() const noexcept { return m_buckets; }
 
-    // Copy constructor from iterator to const_iterator.
-    template <bool TIsConst = IsConst,
-              typename std::enable_if<TIsConst>::type* = nullptr>
-    hopscotch_iterator(const hopscotch_iterator<!TIsConst>& other) noexcept
-        : m_buckets_iterator(other.m_buckets_iterator),
-          m_buckets_end_iterator(other.m_buckets_end_iterator),
-          m_overflow_iterator(other.m_overflow_iterator) {}
+  Bucket& operator[](size_type ibucket) noexcept {
+    tsl_hh_assert(ibucket < m_nb_buckets);
+    return m_buckets[ibucket];
+  }
 
-    hopscotch_iterator(const hopscotch_iterator& other) = default;
-    hopscotch_iterator(hopscotch_iterator&& other) = default;
-    hopscotch_iterator& operator=(const hopscotch_iterator& other) = default;
-    hopscotch_iterator& operator=(hopscotch_iterator&& other) = default;
+  const Bucket& operator[](size_type ibucket) const noexcept {
+    tsl_hh_assert(ibucket < m_nb_buckets);
+    return m_buckets[ibucket];
+  }
 
-    const typename hopscotch_hash::key_type& key() const {
-      if (m_buckets_iterator != m_buckets_end_iterator) {
-        return KeySelect()(m_buckets_iterator->value());
-      }
+  bool empty() const noexcept { return m_nb_buckets == 0; }
 
-      return KeySelect()(*m_overflow_iterator);
+  size_type size() const noexcept { return m_nb_buckets; }
+
+  size_type max_size() const noexcept {
+    return std::min<size_type>(
+        allocator_traits::max_size(static_cast<const Allocator&>(*this)),
+        size_type(std::numeric_limits<std::ptrdiff_t>::max()) /
+            sizeof(Bucket));
+  }
+
+  /**
+   * Replace the buckets by nb_buckets empty buckets.
+   */
+  void reset(size_type nb_buckets) {
+    release();
+    if (nb_buckets > 0) {
+      m_buckets = allocate_buckets(nb_buckets, true);
+      m_nb_buckets = nb_buckets;
     }
+  }
 
-    template <
-        class U = ValueSelect,
-        typename std::enable_if<has_mapped_type<U>::value>::type* = nullptr>
-    typename std::conditional<IsConst, const typename U::value_type&,
+  /**
+   * Destroy the values and make all the buckets empty, the array is kept.
+   */
+  void clear_values() noexcept {
+    destroy_values(m_buckets, m_nb_buckets);
+    std::memset(static_cast<void*>(m_buckets), 0,
+                m_nb_buckets * sizeof(Bucket));
+  }
+
+  void swap(hopscotch_bucket_array& other) noexcept {
+    // Some allocators, like std::pmr::polymorphic_allocator, can't be assigned
+    // and don't propagate.
+    if constexpr (allocator_traits::propagate_on_container_swap::value) {
+      swap_with_allocators(other);
+    } else {
+      swap_buckets(other);
+    }
+  }
+
+  friend void swap(hopscotch_bucket_array& lhs,
+                   hopscotch_bucket_array& rhs) noexcept {
+    lhs.swap(rhs);
+  }
+
+ private:
+  static Bucket* static_empty_bucket_ptr() noexcept {
+    static Bucket empty_bucket;
+    return &empty_bucket;
+  }
+
+  void swap_with_allocators(hopscotch_bucket_array& other) noexcept {
+    using std::swap;
+    swap(static_cast<Allocator&>(*this), static_cast<Allocator&>(other));
+    swap_buckets(other);
+  }
+
+  void swap_buckets(hopscotch_bucket_array& other) noexcept {
+    std::swap(m_buckets, other.m_buckets);
+    std::swap(m_nb_buckets, other.m_nb_buckets);
+  }
+
+  void release() noexcept {
+    if (m_nb_buckets > 0) {
+      destroy_values(m_buckets, m_nb_buckets);
+      deallocate_buckets(m_buckets, m_nb_buckets);
+      m_buckets = static_empty_bucket_ptr();
+      m_nb_buckets = 0;
+    }
+  }
+
+  static void destroy_values(Bucket* buckets, size_type nb_buckets) noexcept {
+    if constexpr (!std::is_trivially_destructible<value_type>::value) {
+      for (size_type ibucket = 0; ibucket < nb_buckets; ibucket++) {
+        buckets[ibucket].remove_value();
+      }
+    }
+  }
+
+  Bucket* allocate_buckets(size_type nb_buckets, bool zeroed) {
+    if (nb_buckets > max_size()) {
+      TSL_HH_THROW_OR_TERMINATE(std::length_error,
+                                "The map exceeds its maximum size.");
+    }
+
+    if constexpr (USE_CALLOC) {
+      void* data = zeroed ? std::calloc(nb_buckets, sizeof(Bucket))
+                          : std::malloc(nb_buckets * sizeof(Bucket));
+      if (data == nullptr) {
+#ifdef TSL_HH_NO_EXCEPTIONS
+        std::terminate();
+#else
+        throw std::bad_alloc();
+#endif
+      }
+
+      return static_cast<Bucket*>(data);
+    } else {
+      if constexpr (has_allocate_zeroed<Allocator>::value) {
+        if (zeroed) {
+          return std::addressof(*Allocator::allocate_zeroed(nb_buckets));
+        }
+      }
+
+      Bucket* buckets = std::addressof(*allocator_traits::allocate(
+          static_cast<Allocator&>(*this), nb_buckets));
+      if (zeroed) {
+        std::memset(static_cast<void*>(buckets), 0,
+                    nb_buckets * sizeof(Bucket));
+      }
+
+      return buckets;
+    }
+  }
+
+  void deallocate_buckets(Bucket* buckets, size_type nb_buckets) noexcept {
+    if constexpr (USE_CALLOC) {
+      (void)nb_buckets;
+      std::free(buckets);
+    } else {
+      allocator_traits::deallocate(
+          static_cast<Allocator&>(*this),
+          std::pointer_traits<typename allocator_traits::pointer>::pointer_to(
+              *buckets),
+          nb_buckets);
+    }
+  }
+
+ private:
+  Bucket* m_buckets;
+  size_type m_nb_buckets;
+};
+
+/**
+ * Return the index of the least significant bit set to 1 in value. The value
+ * must not be 0.
+ */
+inline unsigned int count_trailing_zeros(std::uint64_t value) noexcept {
+  tsl_hh_assert(value != 0);
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned int>(__builtin_ctzll(value));
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanForward64(&index, value);
+  return static_cast<unsigned int>(index);
+#else
+  unsigned int index = 0;
+  while ((value & 1) == 0) {
+    value >>= 1;
+    index++;
+  }
+
+  return index;
+#endif
+}
+
+/**
+ * Hint the processor to bring the cache line containing address into the
+ * cache. No-op if the compiler doesn't provide a prefetch intrinsic.
+ */
+inline void prefetch(const void* address) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+  (void)address;
+#endif
+}
+
+/**
+ * Compare the nb_fragments one-byte hash fragments starting at fragments with
+ * fragment. Return a bitmap where the bit 'i' is set to 1 if fragments[i] is
+ * equal to fragment.
+ *
+ * With SSE2 or AVX2 the fragments are loaded 16 or 32 at a time, the caller
+ * must guarantee that the bytes up to fragments + 64 are readable.
+ */
+inline std::uint64_t fragments_equal_mask(const std::uint8_t* fragments,
+                                          std::uint8_t fragment,
+                                          std::size_t nb_fragments) noexcept {
+  tsl_hh_assert(nb_fragments <= 64);
+
+  std::uint64_t mask = 0;
+#if defined(TSL_HH_AVX2)
+  const __m256i needle = _mm256_set1_epi8(static_cast<char>(fragment));
+  for (std::size_t i = 0; i < nb_fragments; i += 32) {
+    const __m256i loaded = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(fragments + i));
+    mask |= std::uint64_t(static_cast<std::uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(loaded, needle))))
+            << i;
+  }
+#elif defined(TSL_HH_SSE2)
+  const __m128i needle = _mm_set1_epi8(static_cast<char>(fragment));
+  for (std::size_t i = 0; i < nb_fragments; i += 16) {
+    const __m128i loaded =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(fragments + i));
+    mask |= std::uint64_t(static_cast<std::uint32_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(loaded, needle))))
+            << i;
+  }
+#else
+  for (std::size_t i = 0; i < nb_fragments; i++) {
+    if (fragments[i] == fragment) {
+      mask |= std::uint64_t(1) << i;
+    }
+  }
+#endif
+
+  if (nb_fragments < 64) {
+    mask &= (std::uint64_t(1) << nb_fragments) - 1;
+  }
+
+  return mask;
+}
+
+#ifdef TSL_HH_AVX2_GATHER
+/**
+ * For each bit 'i' set to 1 in neighborhood_infos, compare the truncated hash
+ * stored in first_bucket[i] with hash. Return neighborhood_infos where the bits
+ * of the buckets storing a different hash have been cleared.
+ *
+ * The buckets are stored contiguously, the stored hashes are loaded eight at a
+ * time with a gather using a stride of sizeof(Bucket). Only the buckets with
+ * their bit set are read.
+ */
+template <class Bucket>
+std::uint64_t stored_hashes_equal_mask(const Bucket* first_bucket,
+                                       std::uint64_t neighborhood_infos,
+                                       truncated_hash_type hash) noexcept {
+  static_assert(sizeof(truncated_hash_type) == sizeof(std::int32_t), "");
+  static_assert(sizeof(Bucket) * 8 <=
+                    std::size_t(std::numeric_limits<std::int32_t>::max()),
+                "The offsets of the gather must fit in 32-bit integers.");
+
+  // The bucket hash is the only member of hopscotch_bucket_hash<true>, a
+  // pointer to the base class is also a pointer to the stored hash.
+  const char* hashes = reinterpret_cast<const char*>(
+      static_cast<const hopscotch_bucket_hash<true>*>(first_bucket));
+
+  const __m256i lanes_bit =
+      _mm256_setr_epi32(1 << 0, 1 << 1, 1 << 2, 1 << 3, 1 << 4, 1 << 5, 1 << 6,
+                        1 << 7);
+  const __m256i offsets = _mm256_mullo_epi32(
+      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+      _mm256_set1_epi32(static_cast<int>(sizeof(Bucket))));
+  const __m256i needle = _mm256_set1_epi32(static_cast<int>(hash));
+
+  std::uint64_t mask = 0;
+  for (unsigned int i = 0; i < 64 && (neighborhood_infos >> i) != 0; i += 8) {
+    const __m256i lanes_infos =
+        _mm256_set1_epi32(static_cast<int>((neighborhood_infos >> i) & 0xFF));
+    const __m256i lanes_to_check = _mm256_cmpeq_epi32(
+        _mm256_and_si256(lanes_infos, lanes_bit), lanes_bit);
+    const __m256i stored_hashes = _mm256_mask_i32gather_epi32(
+        _mm256_setzero_si256(),
+        reinterpret_cast<const int*>(hashes + i * sizeof(Bucket)), offsets,
+        lanes_to_check, 1);
+    const __m256i equal = _mm256_and_si256(
+        _mm256_cmpeq_epi32(stored_hashes, needle), lanes_to_check);
+
+    mask |= std::uint64_t(static_cast<unsigned int>(
+                _mm256_movemask_ps(_mm256_castsi256_ps(equal))))
+            << i;
+  }
+
+  return mask;
+}
+#endif
+
+/**
+ * Search the neighborhood of bucket_for_hash for a value for which
+ * key_match(value) returns true. Return a pointer to its bucket, nullptr
+ * otherwise.
+ *
+ * Shared by hopscotch_hash and hopscotch_hash_view.
+ */
+template <bool StoreHash, class Bucket, class KeyMatch>
+const Bucket* find_in_neighborhood(const Bucket* bucket_for_hash,
+                                   std::size_t hash, KeyMatch key_match) {
+  (void)hash;  // Avoid warning of unused variable when StoreHash is false;
+
+  std::uint64_t neighborhood_infos = bucket_for_hash->neighborhood_infos();
+  if (neighborhood_infos == 0) {
+    return nullptr;
+  }
+
+  // Only the bits set to 1 in the neighborhood are visited. With
+  // TSL_HH_SIMD_GATHER, the stored hashes of the neighborhood are compared
+  // all at once beforehand and the bits of the buckets with a different hash
+  // are cleared, key_match is then only called on a hash match.
+#ifdef TSL_HH_AVX2_GATHER
+  constexpr bool simd_hash_filter = StoreHash;
+  if constexpr (simd_hash_filter) {
+    neighborhood_infos =
+        stored_hashes_equal_mask(bucket_for_hash, neighborhood_infos,
+                                 Bucket::truncate_hash(hash));
+  }
+#else
+  constexpr bool simd_hash_filter = false;
+#endif
+
+  while (neighborhood_infos != 0) {
+    const Bucket* bucket =
+        bucket_for_hash + count_trailing_zeros(neighborhood_infos);
+
+    // Check HAS_HASH_FILTER before calling bucket_hash_equal. Functionally it
+    // doesn't change anythin. If the bucket has neither a stored hash nor a
+    // hash fragment, bucket_hash_equal is a no-op. Avoiding the call is there
+    // to help GCC optimizes `hash` parameter away, it seems to not be able to
+    // do without this hint.
+    if ((!Bucket::HAS_HASH_FILTER || simd_hash_filter ||
+         bucket->bucket_hash_equal(hash)) &&
+        key_match(bucket->value())) {
+      return bucket;
+    }
+
+    // Clear the least significant bit set to 1.
+    neighborhood_infos &= neighborhood_infos - 1;
+  }
+
+  return nullptr;
+}
+
+/**
+ * Header of the flat format written by hopscotch_hash::flat_serialize and read
+ * in place by hopscotch_hash_view.
+ *
+ * The header is followed, at buckets_offset, by the nb_buckets buckets as they
+ * are in memory and, at overflow_offset, by the nb_overflow_elements values of
+ * the overflow list grouped by home bucket. At overflow_index_offset, a
+ * flat_overflow_entry for each of these values, in the same order, gives its
+ * home bucket and its hash, a lookup finds the values of a home bucket with a
+ * binary search. The offsets are relative to the beginning of the header and
+ * are multiples of FLAT_ALIGNMENT, the format doesn't contain any pointer.
+ * The layout fields must match the reader's types, the magic number also
+ * checks the byte order.
+ */
+struct flat_header {
+  std::uint64_t magic;
+  std::uint64_t version;
+
+  std::uint64_t bucket_size;
+  std::uint64_t bucket_alignment;
+  std::uint64_t key_size;
+  std::uint64_t value_size;
+  std::uint64_t neighborhood_size;
+  std::uint64_t store_hash;
+
+  std::uint64_t bucket_count;
+  std::uint64_t nb_buckets;
+  std::uint64_t nb_elements;
+  std::uint64_t nb_overflow_elements;
+
+  std::uint64_t buckets_offset;
+  std::uint64_t overflow_offset;
+  std::uint64_t overflow_index_offset;
+  std::uint64_t size;
+};
+
+/**
+ * Home bucket and hash, as given to bucket_for_hash, of an overflow value in
+ * the flat format. The entries are sorted by home bucket.
+ */
+struct flat_overflow_entry {
+  std::uint64_t ibucket;
+  std::uint64_t hash;
+};
+
+// "TSLHHFLT" when written in little-endian
+static constexpr std::uint64_t FLAT_MAGIC = 0x544C4648484C5354;
+static constexpr std::uint64_t FLAT_VERSION = 4;
+static constexpr std::uint64_t FLAT_ALIGNMENT = 64;
+
+inline std::uint64_t flat_align(std::uint64_t offset,
+                                std::uint64_t alignment) noexcept {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * Number of overflow elements of each home bucket, only needed when the
+ * OverflowContainer doesn't index its elements by home bucket. hopscotch_hash
+ * inherits from it so that the empty hopscotch_no_bucket_index takes no space
+ * (empty base optimization).
+ */
+template <class OverflowContainer, class Allocator>
+using hopscotch_overflow_counters = typename std::conditional<
+    has_key_compare<OverflowContainer>::value,
+    hopscotch_bucket_index<Allocator>, hopscotch_no_bucket_index>::type;
+
+/**
+ * Internal common class used by (b)hopscotch_map and (b)hopscotch_set.
+ *
+ * ValueType is what will be stored by hopscotch_hash (usually std::pair<Key, T>
+ * for a map and Key for a set).
+ *
+ * KeySelect should be a FunctionObject which takes a ValueType in parameter and
+ * returns a reference to the key.
+ *
+ * ValueSelect should be a FunctionObject which takes a ValueType in parameter
+ * and returns a reference to the value. ValueSelect should be void if there is
+ * no value (in a set for example).
+ *
+ * OverflowContainer will be used as containers for overflown elements. Usually
+ * it should be a hopscotch_overflow_table<ValueType, Allocator>, which indexes
+ * the elements by home bucket, or a set<Key>/map<Key, T>.
+ */
+template <class ValueType, class KeySelect, class ValueSelect, class Hash,
+          class KeyEqual, class Allocator, unsigned int NeighborhoodSize,
+          bool StoreHash, class GrowthPolicy, class OverflowContainer>
+class hopscotch_hash
+    : private Hash,
+      private KeyEqual,
+      private GrowthPolicy,
+      private hopscotch_overflow_counters<OverflowContainer, Allocator> {
+ private:
+  template <typename U>
+  using has_mapped_type =
+      typename std::integral_constant<bool, !std::is_same<U, void>::value>;
+
+  static_assert(
+      noexcept(std::declval<GrowthPolicy>().bucket_for_hash(std::size_t(0))),
+      "GrowthPolicy::bucket_for_hash must be noexcept.");
+  static_assert(noexcept(std::declval<GrowthPolicy>().clear()),
+                "GrowthPolicy::clear must be noexcept.");
+
+ public:
+  template <bool IsConst>
+  class hopscotch_iterator;
+
+  using key_type = typename KeySelect::key_type;
+  using value_type = ValueType;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using allocator_type = Allocator;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using iterator = hopscotch_iterator<false>;
+  using const_iterator = hopscotch_iterator<true>;
+
+ private:
+  using hopscotch_bucket =
+      tsl::detail_hopscotch_hash::hopscotch_bucket<ValueType, NeighborhoodSize,
+                                                   StoreHash>;
+  using neighborhood_bitmap = typename hopscotch_bucket::neighborhood_bitmap;
+
+  using buckets_allocator = typename std::allocator_traits<
+      allocator_type>::template rebind_alloc<hopscotch_bucket>;
+  using buckets_container_type =
+      hopscotch_bucket_array<hopscotch_bucket, buckets_allocator>;
+
+  /**
+   * True if a move assignment can always just swap the allocations of the two
+   * tables.
+   */
+  static constexpr bool MOVE_ASSIGNMENT_SWAPS_ALLOCATIONS =
+      std::allocator_traits<allocator_type>::is_always_equal::value ||
+      (std::allocator_traits<
+           allocator_type>::propagate_on_container_move_assignment::value &&
+       std::allocator_traits<allocator_type>::propagate_on_container_swap::
+           value);
+
+  using overflow_container_type = OverflowContainer;
+
+  static_assert(std::is_same<typename overflow_container_type::value_type,
+                             ValueType>::value,
+                "OverflowContainer should have ValueType as type.");
+
+  static_assert(std::is_same<typename overflow_container_type::allocator_type,
+                             Allocator>::value,
+                "Invalid allocator, not the same type as the value_type.");
+
+  using iterator_buckets = typename buckets_container_type::iterator;
+  using const_iterator_buckets =
+      typename buckets_container_type::const_iterator;
+
+  using iterator_overflow = typename overflow_container_type::iterator;
+  using const_iterator_overflow =
+      typename overflow_container_type::const_iterator;
+
+  using overflow_counters_type =
+      hopscotch_overflow_counters<OverflowContainer, Allocator>;
+
+ public:
+  /**
+   * The `operator*()` and `operator->()` methods return a const reference and
+   * const pointer respectively to the stored value type.
+   *
+   * In case of a map, to get a modifiable reference to the value associated to
+   * a key (the `.second` in the stored pair), you have to call `value()`.
+   */
+  template <bool IsConst>
+  class hopscotch_iterator {
+    friend class hopscotch_hash;
+
+   private:
+    using iterator_bucket = typename std::conditional<
+        IsConst, typename hopscotch_hash::const_iterator_buckets,
+        typename hopscotch_hash::iterator_buckets>::type;
+    using iterator_overflow = typename std::conditional<
+        IsConst, typename hopscotch_hash::const_iterator_overflow,
+        typename hopscotch_hash::iterator_overflow>::type;
+
+    hopscotch_iterator(iterator_bucket buckets_iterator,
+                       iterator_bucket buckets_end_iterator,
+                       iterator_overflow overflow_iterator) noexcept
+        : m_buckets_iterator(buckets_iterator),
+          m_buckets_end_iterator(buckets_end_iterator),
+          m_overflow_iterator(overflow_iterator) {}
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = const typename hopscotch_hash::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type&;
+    using pointer = value_type*;
+
+    hopscotch_iterator() noexcept
+        : m_buckets_iterator(),
+          m_buckets_end_iterator(),
+          m_overflow_iterator() {}
+
+    // Copy constructor from iterator to const_iterator.
+    template <bool TIsConst = IsConst,
+              typename std::enable_if<TIsConst>::type* = nullptr>
+    hopscotch_iterator(const hopscotch_iterator<!TIsConst>& other) noexcept
+        : m_buckets_iterator(other.m_buckets_iterator),
+          m_buckets_end_iterator(other.m_buckets_end_iterator),
+          m_overflow_iterator(other.m_overflow_iterator) {}
+
+    hopscotch_iterator(const hopscotch_iterator& other) = default;
+    hopscotch_iterator(hopscotch_iterator&& other) = default;
+    hopscotch_iterator& operator=(const hopscotch_iterator& other) = default;
+    hopscotch_iterator& operator=(hopscotch_iterator&& other) = default;
+
+    const typename hopscotch_hash::key_type& key() const {
+      if (m_buckets_iterator != m_buckets_end_iterator) {
+        return KeySelect()(m_buckets_iterator->value());
+      }
+
+      return KeySelect()(*m_overflow_iterator);
+    }
+
+    template <
+        class U = ValueSelect,
+        typename std::enable_if<has_mapped_type<U>::value>::type* = nullptr>
+    typename std::conditional<IsConst, const typename U::value_type&,
                               typename U::value_type&>::type
     value() const {
       if (m_buckets_iterator != m_buckets_end_iterator) {
@@ -603,9 +1449,9 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
       : Hash(hash),
         KeyEqual(equal),
         GrowthPolicy(bucket_count),
+        overflow_counters_type(alloc),
         m_buckets_data(alloc),
         m_overflow_elements(alloc),
-        m_buckets(static_empty_bucket_ptr()),
         m_nb_elements(0) {
     if (bucket_count > max_bucket_count()) {
       TSL_HH_THROW_OR_TERMINATE(std::length_error,
@@ -614,11 +1460,7 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
 
     if (bucket_count > 0) {
       static_assert(NeighborhoodSize - 1 > 0, "");
-
-      // Can't directly construct with the appropriate size in the initializer
-      // as m_buckets_data(bucket_count, alloc) is not supported by GCC 4.8
-      m_buckets_data.resize(bucket_count + NeighborhoodSize - 1);
-      m_buckets = m_buckets_data.data();
+      m_buckets_data.reset(bucket_count + NeighborhoodSize - 1);
     }
 
     this->max_load_factor(max_load_factor);
@@ -654,9 +1496,9 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
       : Hash(hash),
         KeyEqual(equal),
         GrowthPolicy(bucket_count),
+        overflow_counters_type(alloc),
         m_buckets_data(alloc),
         m_overflow_elements(comp, alloc),
-        m_buckets(static_empty_bucket_ptr()),
         m_nb_elements(0) {
     if (bucket_count > max_bucket_count()) {
       TSL_HH_THROW_OR_TERMINATE(std::length_error,
@@ -665,11 +1507,7 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
 
     if (bucket_count > 0) {
       static_assert(NeighborhoodSize - 1 > 0, "");
-
-      // Can't directly construct with the appropriate size in the initializer
-      // as m_buckets_data(bucket_count, alloc) is not supported by GCC 4.8
-      m_buckets_data.resize(bucket_count + NeighborhoodSize - 1);
-      m_buckets = m_buckets_data.data();
+      m_buckets_data.reset(bucket_count + NeighborhoodSize - 1);
     }
 
     this->max_load_factor(max_load_factor);
@@ -689,10 +1527,9 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
       : Hash(other),
         KeyEqual(other),
         GrowthPolicy(other),
+        overflow_counters_type(other.overflow_counters()),
         m_buckets_data(other.m_buckets_data, alloc),
         m_overflow_elements(other.m_overflow_elements),
-        m_buckets(m_buckets_data.empty() ? static_empty_bucket_ptr()
-                                         : m_buckets_data.data()),
         m_nb_elements(other.m_nb_elements),
         m_min_load_threshold_rehash(other.m_min_load_threshold_rehash),
         m_max_load_threshold_rehash(other.m_max_load_threshold_rehash),
@@ -708,18 +1545,16 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
       : Hash(std::move(static_cast<Hash&>(other))),
         KeyEqual(std::move(static_cast<KeyEqual&>(other))),
         GrowthPolicy(std::move(static_cast<GrowthPolicy&>(other))),
+        overflow_counters_type(std::move(other.overflow_counters())),
         m_buckets_data(std::move(other.m_buckets_data)),
         m_overflow_elements(std::move(other.m_overflow_elements)),
-        m_buckets(m_buckets_data.empty() ? static_empty_bucket_ptr()
-                                         : m_buckets_data.data()),
         m_nb_elements(other.m_nb_elements),
         m_min_load_threshold_rehash(other.m_min_load_threshold_rehash),
         m_max_load_threshold_rehash(other.m_max_load_threshold_rehash),
         m_max_load_factor(other.m_max_load_factor) {
     other.GrowthPolicy::clear();
-    other.m_buckets_data.clear();
     other.m_overflow_elements.clear();
-    other.m_buckets = static_empty_bucket_ptr();
+    other.overflow_counters().clear();
     other.m_nb_elements = 0;
     other.m_min_load_threshold_rehash = 0;
     other.m_max_load_threshold_rehash = 0;
@@ -733,8 +1568,7 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
 
       m_buckets_data = other.m_buckets_data;
       m_overflow_elements = other.m_overflow_elements;
-      m_buckets = m_buckets_data.empty() ? static_empty_bucket_ptr()
-                                         : m_buckets_data.data();
+      overflow_counters() = other.overflow_counters();
       m_nb_elements = other.m_nb_elements;
 
       m_min_load_threshold_rehash = other.m_min_load_threshold_rehash;
@@ -746,11 +1580,35 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
   }
 
   hopscotch_hash& operator=(hopscotch_hash&& other) noexcept(
-      noexcept(other.swap(*this))) {
-    other.swap(*this);
-    other.clear();
+      noexcept(other.swap(*this)) && MOVE_ASSIGNMENT_SWAPS_ALLOCATIONS) {
+    if constexpr (!MOVE_ASSIGNMENT_SWAPS_ALLOCATIONS) {
+      // The memory of other can't be freed with our allocator, e.g. with two
+      // std::pmr::polymorphic_allocator on different resources. Move the
+      // elements one by one in a table using our allocator, they are copied
+      // only if value_type is not nothrow move constructible. If an exception
+      // is thrown, *this is unchanged and other keeps the elements not moved
+      // yet.
+      if (get_allocator() != other.get_allocator()) {
+        hopscotch_hash new_map =
+            other.new_hopscotch_hash(other.bucket_count(), get_allocator());
+
+        std::size_t ibucket_cursor = 0;
+        other.migrate_buckets_to(
+            new_map, ibucket_cursor,
+            other.m_buckets_data.size() + other.m_overflow_elements.size());
+        tsl_hh_assert(other.empty());
+
+        new_map.swap(*this);
+        other.clear();
 
-    return *this;
+        return *this;
+      }
+    }
+
+    other.swap(*this);
+    other.clear();
+
+    return *this;
   }
 
   allocator_type get_allocator() const {
@@ -806,26 +1664,28 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
    * Modifiers
    */
   void clear() noexcept {
-    for (auto& bucket : m_buckets_data) {
-      bucket.clear();
+    // Once all the elements have been erased, the buckets are already empty.
+    if (m_nb_elements > 0) {
+      m_buckets_data.clear_values();
     }
 
     m_overflow_elements.clear();
+    overflow_counters().clear();
     m_nb_elements = 0;
   }
 
   std::pair<iterator, bool> insert(const value_type& value) {
-    return insert_impl(value);
+    return insert_impl(hash_key(KeySelect()(value)), value);
   }
 
   template <class P, typename std::enable_if<std::is_constructible<
                          value_type, P&&>::value>::type* = nullptr>
   std::pair<iterator, bool> insert(P&& value) {
-    return insert_impl(std::forward<P>(value));
+    return insert_impl(hash_key(KeySelect()(value)), std::forward<P>(value));
   }
 
   std::pair<iterator, bool> insert(value_type&& value) {
-    return insert_impl(std::move(value));
+    return insert_impl(hash_key(KeySelect()(value)), std::move(value));
   }
 
   iterator insert(const_iterator hint, const value_type& value) {
@@ -862,18 +1722,7 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     if (std::is_base_of<
             std::forward_iterator_tag,
             typename std::iterator_traits<InputIt>::iterator_category>::value) {
-      const auto nb_elements_insert = std::distance(first, last);
-      const std::size_t nb_elements_in_buckets =
-          m_nb_elements - m_overflow_elements.size();
-      const std::size_t nb_free_buckets =
-          m_max_load_threshold_rehash - nb_elements_in_buckets;
-      tsl_hh_assert(m_nb_elements >= m_overflow_elements.size());
-      tsl_hh_assert(m_max_load_threshold_rehash >= nb_elements_in_buckets);
-
-      if (nb_elements_insert > 0 &&
-          nb_free_buckets < std::size_t(nb_elements_insert)) {
-        reserve(nb_elements_in_buckets + std::size_t(nb_elements_insert));
-      }
+      reserve_for_insert(std::size_t(std::distance(first, last)));
     }
 
     for (; first != last; ++first) {
@@ -881,19 +1730,50 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     }
   }
 
+  /**
+   * Insert the elements of [first, last) like insert(first, last), but in
+   * groups of LOOKUP_BATCH_SIZE elements. The keys of a group are all hashed
+   * and their home buckets prefetched before the group is inserted, so that
+   * the cache misses of a large table overlap.
+   *
+   * If UniqueKeys is true, the keys of the range must be distinct and absent
+   * from the map, the check for an existing key is skipped.
+   */
+  template <bool UniqueKeys, class ForwardIt>
+  void bulk_build(ForwardIt first, ForwardIt last) {
+    reserve_for_insert(std::size_t(std::distance(first, last)));
+
+    while (first != last) {
+      std::size_t hashes[LOOKUP_BATCH_SIZE];
+      ForwardIt group_first = first;
+      std::size_t nb_elements_group = 0;
+      for (; nb_elements_group < LOOKUP_BATCH_SIZE && first != last;
+           ++nb_elements_group, ++first) {
+        hashes[nb_elements_group] = hash_key(KeySelect()(*first));
+        prefetch(buckets() + bucket_for_hash(hashes[nb_elements_group]));
+      }
+
+      for (std::size_t i = 0; i < nb_elements_group; i++, ++group_first) {
+        bulk_insert_value<UniqueKeys>(hashes[i], *group_first);
+      }
+    }
+  }
+
   template <class M>
   std::pair<iterator, bool> insert_or_assign(const key_type& k, M&& obj) {
-    return insert_or_assign_impl(k, std::forward<M>(obj));
+    return insert_or_assign_impl(hash_key(k), k, std::forward<M>(obj));
   }
 
   template <class M>
   std::pair<iterator, bool> insert_or_assign(key_type&& k, M&& obj) {
-    return insert_or_assign_impl(std::move(k), std::forward<M>(obj));
+    return insert_or_assign_impl(hash_key(k), std::move(k),
+                                 std::forward<M>(obj));
   }
 
   template <class K, class M>
   std::pair<iterator, bool> insert_or_assign(K&& k, M&& obj) {
-    return insert_or_assign_impl(std::forward<K>(k), std::forward<M>(obj));
+    return insert_or_assign_impl(hash_key(k), std::forward<K>(k),
+                                 std::forward<M>(obj));
   }
 
   template <class M>
@@ -944,17 +1824,19 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
 
   template <class... Args>
   std::pair<iterator, bool> try_emplace(const key_type& k, Args&&... args) {
-    return try_emplace_impl(k, std::forward<Args>(args)...);
+    return try_emplace_impl(hash_key(k), k, std::forward<Args>(args)...);
   }
 
   template <class... Args>
   std::pair<iterator, bool> try_emplace(key_type&& k, Args&&... args) {
-    return try_emplace_impl(std::move(k), std::forward<Args>(args)...);
+    return try_emplace_impl(hash_key(k), std::move(k),
+                            std::forward<Args>(args)...);
   }
 
   template <class K, class... Args>
   std::pair<iterator, bool> try_emplace(K&& k, Args&&... args) {
-    return try_emplace_impl(std::forward<K>(k), std::forward<Args>(args)...);
+    return try_emplace_impl(hash_key(k), std::forward<K>(k),
+                            std::forward<Args>(args)...);
   }
 
   template <class... Args>
@@ -984,6 +1866,59 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     return try_emplace(std::forward<K>(k), std::forward<Args>(args)...).first;
   }
 
+  /*
+   * Same as the methods above without the _with_hash suffix, but with the
+   * hash of the key given by the caller, as Hash would compute it (it is
+   * mixed here if needed, see needs_hash_mixing). A wrong hash would put the
+   * element where the lookups don't find it, it is checked in debug mode.
+   */
+  template <class P>
+  std::pair<iterator, bool> insert_with_hash(P&& value, std::size_t hash) {
+    check_precalculated_hash(KeySelect()(value), hash);
+    return insert_impl(mix_hash(hash), std::forward<P>(value));
+  }
+
+  template <class K, class M>
+  std::pair<iterator, bool> insert_or_assign_with_hash(K&& k, M&& obj,
+                                                       std::size_t hash) {
+    check_precalculated_hash(k, hash);
+    return insert_or_assign_impl(mix_hash(hash), std::forward<K>(k),
+                                 std::forward<M>(obj));
+  }
+
+  template <class K, class... Args>
+  std::pair<iterator, bool> try_emplace_with_hash(K&& k, std::size_t hash,
+                                                  Args&&... args) {
+    check_precalculated_hash(k, hash);
+    return try_emplace_impl(mix_hash(hash), std::forward<K>(k),
+                            std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> emplace_with_hash(std::size_t hash,
+                                              Args&&... args) {
+    return insert_with_hash(value_type(std::forward<Args>(args)...), hash);
+  }
+
+  template <class... Args>
+  iterator emplace_hint_with_hash(const_iterator hint, std::size_t hash,
+                                  Args&&... args) {
+    value_type value(std::forward<Args>(args)...);
+    if (hint != cend() &&
+        compare_keys(KeySelect()(*hint), KeySelect()(value))) {
+      return mutable_iterator(hint);
+    }
+
+    return insert_with_hash(std::move(value), hash).first;
+  }
+
+  template <class K, class U = ValueSelect,
+            typename std::enable_if<has_mapped_type<U>::value>::type* = nullptr>
+  typename U::value_type& subscript_with_hash(K&& key, std::size_t hash) {
+    check_precalculated_hash(key, hash);
+    return subscript_impl(mix_hash(hash), std::forward<K>(key));
+  }
+
   /**
    * Here to avoid `template<class K> size_type erase(const K& key)` being used
    * when we use an iterator instead of a const_iterator.
@@ -991,9 +1926,9 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
   iterator erase(iterator pos) { return erase(const_iterator(pos)); }
 
   iterator erase(const_iterator pos) {
-    const std::size_t ibucket_for_hash = bucket_for_hash(hash_key(pos.key()));
-
     if (pos.m_buckets_iterator != pos.m_buckets_end_iterator) {
+      const std::size_t ibucket_for_hash =
+          bucket_for_hash(hash_key(pos.key()));
       auto it_bucket =
           m_buckets_data.begin() +
           std::distance(m_buckets_data.cbegin(), pos.m_buckets_iterator);
@@ -1002,6 +1937,8 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
       return ++iterator(it_bucket, m_buckets_data.end(),
                         m_overflow_elements.begin());
     } else {
+      const std::size_t ibucket_for_hash = bucket_for_hash(
+          overflow_hash(pos.m_overflow_iterator, bucket_count()));
       auto it_next_overflow =
           erase_from_overflow(pos.m_overflow_iterator, ibucket_for_hash);
       return iterator(m_buckets_data.end(), m_buckets_data.end(),
@@ -1024,23 +1961,28 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
 
   template <class K>
   size_type erase(const K& key) {
-    return erase(key, hash_key(key));
+    return erase(key, Hash::operator()(key));
   }
 
+  /**
+   * The hash is the one of hash_function(), like for the other methods taking
+   * a hash. It is mixed here if needed (see needs_hash_mixing).
+   */
   template <class K>
   size_type erase(const K& key, std::size_t hash) {
+    hash = mix_hash(hash);
     const std::size_t ibucket_for_hash = bucket_for_hash(hash);
 
     hopscotch_bucket* bucket_found =
-        find_in_buckets(key, hash, m_buckets + ibucket_for_hash);
+        find_in_buckets(key, hash, buckets() + ibucket_for_hash);
     if (bucket_found != nullptr) {
       erase_from_bucket(*bucket_found, ibucket_for_hash);
 
       return 1;
     }
 
-    if (m_buckets[ibucket_for_hash].has_overflow()) {
-      auto it_overflow = find_in_overflow(key);
+    if (buckets()[ibucket_for_hash].has_overflow()) {
+      auto it_overflow = find_in_overflow(key, hash, ibucket_for_hash);
       if (it_overflow != m_overflow_elements.end()) {
         erase_from_overflow(it_overflow, ibucket_for_hash);
 
@@ -1063,7 +2005,7 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     swap(static_cast<GrowthPolicy&>(*this), static_cast<GrowthPolicy&>(other));
     swap(m_buckets_data, other.m_buckets_data);
     swap(m_overflow_elements, other.m_overflow_elements);
-    swap(m_buckets, other.m_buckets);
+    overflow_counters().swap(other.overflow_counters());
     swap(m_nb_elements, other.m_nb_elements);
     swap(m_min_load_threshold_rehash, other.m_min_load_threshold_rehash);
     swap(m_max_load_threshold_rehash, other.m_max_load_threshold_rehash);
@@ -1076,7 +2018,7 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
   template <class K, class U = ValueSelect,
             typename std::enable_if<has_mapped_type<U>::value>::type* = nullptr>
   typename U::value_type& at(const K& key) {
-    return at(key, hash_key(key));
+    return at(key, Hash::operator()(key));
   }
 
   template <class K, class U = ValueSelect,
@@ -1089,7 +2031,7 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
   template <class K, class U = ValueSelect,
             typename std::enable_if<has_mapped_type<U>::value>::type* = nullptr>
   const typename U::value_type& at(const K& key) const {
-    return at(key, hash_key(key));
+    return at(key, Hash::operator()(key));
   }
 
   template <class K, class U = ValueSelect,
@@ -1097,8 +2039,9 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
   const typename U::value_type& at(const K& key, std::size_t hash) const {
     using T = typename U::value_type;
 
+    hash = mix_hash(hash);
     const T* value =
-        find_value_impl(key, hash, m_buckets + bucket_for_hash(hash));
+        find_value_impl(key, hash, buckets() + bucket_for_hash(hash));
     if (value == nullptr) {
       TSL_HH_THROW_OR_TERMINATE(std::out_of_range, "Couldn't find key.");
     } else {
@@ -1109,55 +2052,46 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
   template <class K, class U = ValueSelect,
             typename std::enable_if<has_mapped_type<U>::value>::type* = nullptr>
   typename U::value_type& operator[](K&& key) {
-    using T = typename U::value_type;
-
     const std::size_t hash = hash_key(key);
-    const std::size_t ibucket_for_hash = bucket_for_hash(hash);
-
-    T* value = find_value_impl(key, hash, m_buckets + ibucket_for_hash);
-    if (value != nullptr) {
-      return *value;
-    } else {
-      return insert_value(ibucket_for_hash, hash, std::piecewise_construct,
-                          std::forward_as_tuple(std::forward<K>(key)),
-                          std::forward_as_tuple())
-          .first.value();
-    }
+    return subscript_impl(hash, std::forward<K>(key));
   }
 
   template <class K>
   size_type count(const K& key) const {
-    return count(key, hash_key(key));
+    return count(key, Hash::operator()(key));
   }
 
   template <class K>
   size_type count(const K& key, std::size_t hash) const {
-    return count_impl(key, hash, m_buckets + bucket_for_hash(hash));
+    hash = mix_hash(hash);
+    return count_impl(key, hash, buckets() + bucket_for_hash(hash));
   }
 
   template <class K>
   iterator find(const K& key) {
-    return find(key, hash_key(key));
+    return find(key, Hash::operator()(key));
   }
 
   template <class K>
   iterator find(const K& key, std::size_t hash) {
-    return find_impl(key, hash, m_buckets + bucket_for_hash(hash));
+    hash = mix_hash(hash);
+    return find_impl(key, hash, buckets() + bucket_for_hash(hash));
   }
 
   template <class K>
   const_iterator find(const K& key) const {
-    return find(key, hash_key(key));
+    return find(key, Hash::operator()(key));
   }
 
   template <class K>
   const_iterator find(const K& key, std::size_t hash) const {
-    return find_impl(key, hash, m_buckets + bucket_for_hash(hash));
+    hash = mix_hash(hash);
+    return find_impl(key, hash, buckets() + bucket_for_hash(hash));
   }
 
   template <class K>
   bool contains(const K& key) const {
-    return contains(key, hash_key(key));
+    return contains(key, Hash::operator()(key));
   }
 
   template <class K>
@@ -1165,9 +2099,68 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     return count(key, hash) != 0;
   }
 
+  /**
+   * Look up each key of [first, last) and write the resulting iterators, end()
+   * if the key is absent, to out.
+   *
+   * The keys are processed in groups of LOOKUP_BATCH_SIZE. All the keys of a
+   * group are hashed and their home buckets prefetched before any of them is
+   * looked up, the cache misses of the group overlap instead of being paid one
+   * after the other.
+   */
+  template <class ForwardIt, class OutputIt>
+  OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) {
+    std::size_t hashes[LOOKUP_BATCH_SIZE];
+    std::size_t ibuckets[LOOKUP_BATCH_SIZE];
+
+    while (first != last) {
+      const std::size_t nb_keys = prefetch_batch(first, last, hashes, ibuckets);
+      for (std::size_t i = 0; i < nb_keys; ++i, ++first) {
+        *out++ = find_impl(*first, hashes[i], buckets() + ibuckets[i]);
+      }
+    }
+
+    return out;
+  }
+
+  template <class ForwardIt, class OutputIt>
+  OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+    std::size_t hashes[LOOKUP_BATCH_SIZE];
+    std::size_t ibuckets[LOOKUP_BATCH_SIZE];
+
+    while (first != last) {
+      const std::size_t nb_keys = prefetch_batch(first, last, hashes, ibuckets);
+      for (std::size_t i = 0; i < nb_keys; ++i, ++first) {
+        *out++ = find_impl(*first, hashes[i], buckets() + ibuckets[i]);
+      }
+    }
+
+    return out;
+  }
+
+  /**
+   * Same as find_batch but write a bool telling if the key is present for each
+   * key of [first, last).
+   */
+  template <class ForwardIt, class OutputIt>
+  OutputIt contains_batch(ForwardIt first, ForwardIt last,
+                          OutputIt out) const {
+    std::size_t hashes[LOOKUP_BATCH_SIZE];
+    std::size_t ibuckets[LOOKUP_BATCH_SIZE];
+
+    while (first != last) {
+      const std::size_t nb_keys = prefetch_batch(first, last, hashes, ibuckets);
+      for (std::size_t i = 0; i < nb_keys; ++i, ++first) {
+        *out++ = count_impl(*first, hashes[i], buckets() + ibuckets[i]) != 0;
+      }
+    }
+
+    return out;
+  }
+
   template <class K>
   std::pair<iterator, iterator> equal_range(const K& key) {
-    return equal_range(key, hash_key(key));
+    return equal_range(key, Hash::operator()(key));
   }
 
   template <class K>
@@ -1178,7 +2171,7 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
 
   template <class K>
   std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
-    return equal_range(key, hash_key(key));
+    return equal_range(key, Hash::operator()(key));
   }
 
   template <class K>
@@ -1235,13 +2228,30 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
   void rehash(size_type count_) {
     count_ = std::max(count_,
                       size_type(std::ceil(float(size()) / max_load_factor())));
-    rehash_impl(count_);
+    record_rehash([&] { rehash_impl(count_); });
   }
 
   void reserve(size_type count_) {
     rehash(size_type(std::ceil(float(count_) / max_load_factor())));
   }
 
+  /**
+   * Same as rehash(count_), but the elements are moved to the new buckets by
+   * tasks run through the executor, see parallel_rehash_impl.
+   */
+  template <class Executor>
+  void parallel_rehash(size_type count_, Executor&& executor) {
+    count_ = std::max(count_,
+                      size_type(std::ceil(float(size()) / max_load_factor())));
+    record_rehash([&] { parallel_rehash_impl(count_, executor); });
+  }
+
+  template <class Executor>
+  void parallel_reserve(size_type count_, Executor&& executor) {
+    parallel_rehash(size_type(std::ceil(float(count_) / max_load_factor())),
+                    executor);
+  }
+
   /*
    * Observers
    */
@@ -1269,6 +2279,423 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     return m_overflow_elements.size();
   }
 
+  /**
+   * Walk the buckets to describe the current layout of the elements, see
+   * hh::hopscotch_analysis. O(bucket_count()).
+   */
+  hh::hopscotch_analysis analyze() const {
+    hh::hopscotch_analysis analysis;
+    analysis.nb_elements = size();
+    analysis.bucket_count = bucket_count();
+    analysis.load_factor = load_factor();
+    analysis.neighborhood_occupancy.assign(NeighborhoodSize + 1, 0);
+    analysis.displacement_distribution.assign(NeighborhoodSize, 0);
+    analysis.overflow_size = m_overflow_elements.size();
+
+    std::size_t nb_bucket_elements = 0;
+    std::size_t displacement_sum = 0;
+    std::size_t successful_lookups_cache_lines = 0;
+    std::size_t unsuccessful_lookups_cache_lines = 0;
+    for (size_type ibucket = 0; ibucket < bucket_count(); ibucket++) {
+      const hopscotch_bucket& home_bucket = buckets()[ibucket];
+      cache_lines_counter cache_lines;
+      cache_lines.add(home_bucket);
+
+      // A lookup reads the neighbors in order until it finds the key.
+      neighborhood_bitmap neighborhood_infos = home_bucket.neighborhood_infos();
+      for (std::size_t ineighbor = 0; neighborhood_infos != 0; ineighbor++) {
+        if ((neighborhood_infos & 1) == 1) {
+          cache_lines.add(buckets()[ibucket + ineighbor]);
+          successful_lookups_cache_lines += cache_lines.nb_cache_lines();
+
+          analysis.displacement_distribution[ineighbor]++;
+          analysis.max_displacement =
+              std::max(analysis.max_displacement, ineighbor);
+          displacement_sum += ineighbor;
+          nb_bucket_elements++;
+        }
+
+        neighborhood_infos = neighborhood_bitmap(neighborhood_infos >> 1);
+      }
+
+      unsuccessful_lookups_cache_lines += cache_lines.nb_cache_lines();
+      if (home_bucket.has_overflow()) {
+        unsuccessful_lookups_cache_lines++;
+        analysis.nb_overflow_home_buckets++;
+      }
+
+      analysis.neighborhood_occupancy[nb_neighbors(home_bucket)]++;
+    }
+
+    std::size_t full_buckets_sum = 0;
+    std::size_t full_bucket_run = 0;
+    for (size_type ibucket = 0; ibucket <= m_buckets_data.size(); ibucket++) {
+      if (ibucket < m_buckets_data.size() && !buckets()[ibucket].empty()) {
+        full_bucket_run++;
+      } else if (full_bucket_run > 0) {
+        analysis.nb_full_bucket_runs++;
+        analysis.max_full_bucket_run =
+            std::max(analysis.max_full_bucket_run, full_bucket_run);
+        full_buckets_sum += full_bucket_run;
+        full_bucket_run = 0;
+      }
+    }
+
+    if (nb_bucket_elements > 0) {
+      analysis.average_displacement =
+          double(displacement_sum) / double(nb_bucket_elements);
+      analysis.cache_lines_per_successful_lookup =
+          double(successful_lookups_cache_lines) / double(nb_bucket_elements);
+    }
+    if (bucket_count() > 0) {
+      analysis.cache_lines_per_unsuccessful_lookup =
+          double(unsuccessful_lookups_cache_lines) / double(bucket_count());
+    }
+    if (analysis.nb_full_bucket_runs > 0) {
+      analysis.average_full_bucket_run =
+          double(full_buckets_sum) / double(analysis.nb_full_bucket_runs);
+    }
+
+    return analysis;
+  }
+
+#ifdef TSL_HH_ENABLE_STATS
+  hh::hopscotch_stats stats() const {
+    hh::hopscotch_stats stats = m_stats;
+    stats.nb_overflow_lookups =
+        m_nb_overflow_lookups.load(std::memory_order_relaxed);
+    stats.overflow_size = m_overflow_elements.size();
+
+    // The padding buckets past bucket_count() are never a home bucket.
+    stats.neighborhood_occupancy.assign(NeighborhoodSize + 1, 0);
+    for (size_type ibucket = 0; ibucket < bucket_count(); ibucket++) {
+      stats.neighborhood_occupancy[nb_neighbors(buckets()[ibucket])]++;
+    }
+
+    return stats;
+  }
+
+  void reset_stats() noexcept {
+    m_stats = hh::hopscotch_stats();
+    m_nb_overflow_lookups.store(0, std::memory_order_relaxed);
+  }
+#endif
+
+  /**
+   * Serialize the table through serializer, which is called as
+   * serializer(const U& value) with U among std::uint64_t, std::uint32_t,
+   * float and value_type.
+   *
+   * The buckets are written with their neighborhood bitmap and, if StoreHash
+   * is true, their stored hash so that deserialize can put them back in place
+   * without rehashing the keys.
+   */
+  template <class Serializer>
+  void serialize(Serializer& serializer) const {
+    serializer(SERIALIZATION_PROTOCOL_VERSION);
+    serializer(std::uint64_t(NeighborhoodSize));
+    serializer(std::uint64_t(StoreHash));
+    serializer(std::uint64_t(bucket_count()));
+    serializer(std::uint64_t(m_nb_elements));
+    serializer(std::uint64_t(m_overflow_elements.size()));
+    serializer(m_max_load_factor);
+
+    for (const hopscotch_bucket& bucket : m_buckets_data) {
+      serializer(bucket.raw_neighborhood_infos());
+      if (!bucket.empty()) {
+        if (StoreHash) {
+          serializer(std::uint32_t(bucket.truncated_bucket_hash()));
+        }
+        serializer(bucket.value());
+      }
+    }
+
+    for (const value_type& value : m_overflow_elements) {
+      serializer(value);
+    }
+  }
+
+  /**
+   * Deserialize a table written by serialize into this empty table.
+   * deserializer is called as deserializer.template operator()<U>() with U
+   * among the types listed in serialize.
+   *
+   * If hash_compatible is true and the serialized table has the same
+   * NeighborhoodSize and StoreHash and a bucket count GrowthPolicy can
+   * represent, the buckets are copied in place with their neighborhood bitmap
+   * and stored hash, no key is hashed. The hash function and the growth
+   * policy must then be the same as the ones used on serialization.
+   * Otherwise the values are inserted one by one.
+   */
+  template <class Deserializer>
+  void deserialize(Deserializer& deserializer, bool hash_compatible) {
+    tsl_hh_assert(m_buckets_data.empty() && m_overflow_elements.empty());
+
+    const std::uint64_t version =
+        deserialize_value<std::uint64_t>(deserializer);
+    if (version != SERIALIZATION_PROTOCOL_VERSION) {
+      TSL_HH_THROW_OR_TERMINATE(std::runtime_error,
+                                "Can't deserialize the hopscotch_map/set. "
+                                "The protocol version header is invalid.");
+    }
+
+    const std::uint64_t neighborhood_size =
+        deserialize_value<std::uint64_t>(deserializer);
+    const bool store_hash = deserialize_value<std::uint64_t>(deserializer) != 0;
+    const std::uint64_t serialized_bucket_count =
+        deserialize_value<std::uint64_t>(deserializer);
+    const std::uint64_t nb_elements =
+        deserialize_value<std::uint64_t>(deserializer);
+    const std::uint64_t nb_overflow_elements =
+        deserialize_value<std::uint64_t>(deserializer);
+    const float max_load_factor_ = deserialize_value<float>(deserializer);
+
+    if (neighborhood_size < hopscotch_bucket::MIN_NEIGHBORHOOD_SIZE ||
+        neighborhood_size > hopscotch_bucket::MAX_NEIGHBORHOOD_SIZE ||
+        nb_overflow_elements > nb_elements) {
+      TSL_HH_THROW_OR_TERMINATE(std::runtime_error,
+                                "Can't deserialize the hopscotch_map/set. "
+                                "The serialized header is invalid.");
+    }
+
+    if (serialized_bucket_count > max_bucket_count() ||
+        nb_elements > max_size()) {
+      TSL_HH_THROW_OR_TERMINATE(std::runtime_error,
+                                "Can't deserialize the hopscotch_map/set. "
+                                "The serialized sizes are too big.");
+    }
+
+    const std::uint64_t nb_buckets =
+        (serialized_bucket_count == 0)
+            ? 0
+            : serialized_bucket_count + neighborhood_size - 1;
+    if (nb_buckets > max_bucket_count()) {
+      TSL_HH_THROW_OR_TERMINATE(std::runtime_error,
+                                "Can't deserialize the hopscotch_map/set. "
+                                "The serialized sizes are too big.");
+    }
+
+    std::size_t bucket_count_ = std::size_t(serialized_bucket_count);
+    GrowthPolicy growth_policy(bucket_count_);
+    hash_compatible = hash_compatible &&
+                      neighborhood_size == NeighborhoodSize &&
+                      store_hash == StoreHash &&
+                      bucket_count_ == serialized_bucket_count;
+
+    if (hash_compatible) {
+      GrowthPolicy::operator=(std::move(growth_policy));
+      m_nb_elements =
+          deserialize_buckets_in_place(deserializer, std::size_t(nb_buckets));
+      if (m_nb_elements != nb_elements - nb_overflow_elements) {
+        TSL_HH_THROW_OR_TERMINATE(std::runtime_error,
+                                  "Can't deserialize the hopscotch_map/set. "
+                                  "The number of elements is invalid.");
+      }
+      max_load_factor(max_load_factor_);
+    } else {
+      max_load_factor(max_load_factor_);
+      reserve(std::size_t(nb_elements));
+      for (std::uint64_t ibucket = 0; ibucket < nb_buckets; ibucket++) {
+        const std::uint64_t neighborhood_infos =
+            deserialize_value<std::uint64_t>(deserializer);
+        if ((neighborhood_infos & 1) != 0) {
+          if (store_hash) {
+            deserialize_value<std::uint32_t>(deserializer);
+          }
+          insert(deserialize_value<value_type>(deserializer));
+        }
+      }
+    }
+
+    for (std::uint64_t i = 0; i < nb_overflow_elements; i++) {
+      if (hash_compatible) {
+        // The overflow bit of the bucket for the hash was deserialized with
+        // the buckets, only the home bucket is needed.
+        value_type value = deserialize_value<value_type>(deserializer);
+        const std::size_t hash = hash_key(KeySelect()(value));
+        insert_in_overflow(bucket_for_hash(hash), hash, std::move(value));
+      } else {
+        insert(deserialize_value<value_type>(deserializer));
+      }
+    }
+
+    if (m_nb_elements != nb_elements) {
+      TSL_HH_THROW_OR_TERMINATE(std::runtime_error,
+                                "Can't deserialize the hopscotch_map/set. "
+                                "The number of elements is invalid.");
+    }
+  }
+
+  /**
+   * Write the table in the flat format described by flat_header. The writer
+   * is called as writer(const void* data, std::size_t size) for each chunk
+   * of bytes, in order. The values are written as their bytes in memory, they
+   * must be trivially copyable. The bytes of the empty buckets are written as
+   * they are.
+   */
+  template <class Writer>
+  void flat_serialize(Writer& writer) const {
+    const std::uint64_t bucket_alignment = std::max(
+        FLAT_ALIGNMENT, std::uint64_t(alignof(hopscotch_bucket)));
+    const std::uint64_t value_alignment =
+        std::max(FLAT_ALIGNMENT, std::uint64_t(alignof(value_type)));
+
+    flat_header header;
+    header.magic = FLAT_MAGIC;
+    header.version = FLAT_VERSION;
+    header.bucket_size = sizeof(hopscotch_bucket);
+    header.bucket_alignment = alignof(hopscotch_bucket);
+    header.key_size = sizeof(key_type);
+    header.value_size = sizeof(value_type);
+    header.neighborhood_size = NeighborhoodSize;
+    header.store_hash = StoreHash;
+    header.bucket_count = bucket_count();
+    header.nb_buckets = m_buckets_data.size();
+    header.nb_elements = m_nb_elements;
+    header.nb_overflow_elements = m_overflow_elements.size();
+    header.buckets_offset = flat_align(sizeof(flat_header), bucket_alignment);
+    header.overflow_offset =
+        flat_align(header.buckets_offset +
+                       header.nb_buckets * sizeof(hopscotch_bucket),
+                   value_alignment);
+    header.overflow_index_offset =
+        flat_align(header.overflow_offset +
+                       header.nb_overflow_elements * sizeof(value_type),
+                   FLAT_ALIGNMENT);
+    header.size = header.overflow_index_offset +
+                  header.nb_overflow_elements * sizeof(flat_overflow_entry);
+
+    // Group the overflow values by home bucket. With StoreHash the kept hash
+    // may be truncated, write the full hash.
+    std::vector<std::pair<flat_overflow_entry, const value_type*>>
+        overflow_values;
+    overflow_values.reserve(m_overflow_elements.size());
+    for (auto it = m_overflow_elements.cbegin();
+         it != m_overflow_elements.cend(); ++it) {
+      const std::size_t hash = StoreHash ? hash_key(KeySelect()(*it))
+                                         : overflow_hash(it, bucket_count());
+      overflow_values.emplace_back(
+          flat_overflow_entry{bucket_for_hash(hash), hash}, std::addressof(*it));
+    }
+    std::sort(overflow_values.begin(), overflow_values.end(),
+              [](const auto& lhs, const auto& rhs) {
+                return lhs.first.ibucket < rhs.first.ibucket;
+              });
+
+    static const unsigned char padding[FLAT_ALIGNMENT] = {};
+    const auto write_padding = [&](std::uint64_t nb_bytes) {
+      while (nb_bytes > 0) {
+        const std::uint64_t chunk = std::min(nb_bytes, FLAT_ALIGNMENT);
+        writer(static_cast<const void*>(padding), std::size_t(chunk));
+        nb_bytes -= chunk;
+      }
+    };
+
+    writer(static_cast<const void*>(&header), sizeof(flat_header));
+    write_padding(header.buckets_offset - sizeof(flat_header));
+    if (!m_buckets_data.empty()) {
+      writer(static_cast<const void*>(m_buckets_data.data()),
+             m_buckets_data.size() * sizeof(hopscotch_bucket));
+    }
+
+    write_padding(header.overflow_offset - header.buckets_offset -
+                  header.nb_buckets * sizeof(hopscotch_bucket));
+    for (const auto& overflow_value : overflow_values) {
+      writer(static_cast<const void*>(overflow_value.second),
+             sizeof(value_type));
+    }
+
+    write_padding(header.overflow_index_offset - header.overflow_offset -
+                  header.nb_overflow_elements * sizeof(value_type));
+    for (const auto& overflow_value : overflow_values) {
+      writer(static_cast<const void*>(&overflow_value.first),
+             sizeof(flat_overflow_entry));
+    }
+  }
+
+  /*
+   * Incremental rehash, see tsl::incremental_hopscotch_map.
+   */
+
+  /**
+   * Insert a value constructed from args, its key must not be in the table.
+   * If the insertion needs a rehash, return (end(), false) without rehashing
+   * and without constructing the value, the arguments are left untouched.
+   */
+  template <class... Args>
+  std::pair<iterator, bool> insert_new_value_without_rehash(std::size_t hash,
+                                                            Args&&... args) {
+    hash = mix_hash(hash);
+    return insert_value<false>(bucket_for_hash(hash), hash,
+                               std::forward<Args>(args)...);
+  }
+
+  /**
+   * Same as insert_new_value_without_rehash but rehash if needed.
+   */
+  template <class... Args>
+  std::pair<iterator, bool> insert_new_value(std::size_t hash,
+                                             Args&&... args) {
+    hash = mix_hash(hash);
+    return insert_value(bucket_for_hash(hash), hash,
+                        std::forward<Args>(args)...);
+  }
+
+  /**
+   * Return a new empty hash table with GrowthPolicy::next_bucket_count()
+   * buckets and the same hash, key equal, allocator and max load factor.
+   */
+  hopscotch_hash new_grown_hopscotch_hash() {
+    return new_hopscotch_hash(GrowthPolicy::next_bucket_count());
+  }
+
+  /**
+   * Move the elements of the buckets [ibucket_cursor, ibucket_cursor +
+   * nb_buckets) to target and advance ibucket_cursor. Once all the buckets have
+   * been moved, move up to nb_buckets elements of the overflow list instead.
+   * The keys of the moved elements must not be in target.
+   *
+   * No element is inserted in the table while it is moved, an element never
+   * changes of bucket and the buckets before ibucket_cursor stay empty.
+   *
+   * Return true once the table is empty.
+   */
+  bool migrate_buckets_to(hopscotch_hash& target, std::size_t& ibucket_cursor,
+                          std::size_t nb_buckets) {
+    const bool use_stored_hash =
+        USE_STORED_HASH_ON_REHASH(target.bucket_count());
+
+    const std::size_t ibucket_end =
+        std::min(ibucket_cursor + nb_buckets, m_buckets_data.size());
+    for (; ibucket_cursor < ibucket_end; ibucket_cursor++) {
+      hopscotch_bucket& bucket = m_buckets_data[ibucket_cursor];
+      if (bucket.empty()) {
+        continue;
+      }
+
+      const std::size_t hash =
+          use_stored_hash ? bucket.truncated_bucket_hash()
+                          : hash_key(KeySelect()(bucket.value()));
+      target.insert_value(target.bucket_for_hash(hash), hash,
+                          std::move_if_noexcept(bucket.value()));
+      erase_from_bucket(bucket, bucket_for_hash(hash));
+    }
+
+    if (ibucket_cursor < m_buckets_data.size()) {
+      return false;
+    }
+
+    for (; nb_buckets > 0 && !m_overflow_elements.empty(); nb_buckets--) {
+      auto it = m_overflow_elements.begin();
+      const std::size_t hash = overflow_hash(it, target.bucket_count());
+      target.insert_value(target.bucket_for_hash(hash), hash,
+                          std::move_if_noexcept(*it));
+      erase_from_overflow(it, bucket_for_hash(hash));
+    }
+
+    return m_nb_elements == 0;
+  }
+
   template <class U = OverflowContainer,
             typename std::enable_if<has_key_compare<U>::value>::type* = nullptr>
   typename U::key_compare key_comp() const {
@@ -1276,9 +2703,74 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
   }
 
  private:
+  /**
+   * Pointer to the first bucket. It points to a static empty bucket when the
+   * table has no bucket, a lookup doesn't have to check if the table is empty.
+   */
+  hopscotch_bucket* buckets() noexcept { return m_buckets_data.data(); }
+
+  const hopscotch_bucket* buckets() const noexcept {
+    return m_buckets_data.data();
+  }
+
+  /**
+   * Hash of key as used in the table, see needs_hash_mixing. All the hashes
+   * stored in the buckets and in the overflow table come from here.
+   */
   template <class K>
   std::size_t hash_key(const K& key) const {
-    return Hash::operator()(key);
+    return mix_hash(Hash::operator()(key));
+  }
+
+  overflow_counters_type& overflow_counters() noexcept { return *this; }
+
+  const overflow_counters_type& overflow_counters() const noexcept {
+    return *this;
+  }
+
+  static std::size_t mix_hash(std::size_t hash) noexcept {
+    if constexpr (needs_hash_mixing<Hash, GrowthPolicy>::value) {
+      return mix_hash_bits(hash);
+    } else {
+      return hash;
+    }
+  }
+
+  template <class U, class Deserializer>
+  static U deserialize_value(Deserializer& deserializer) {
+    // MSVC < 2017 is not conformant, circumvent the problem by removing the
+    // template keyword
+#if defined(_MSC_VER) && _MSC_VER < 1910
+    return deserializer.Deserializer::operator()<U>();
+#else
+    return deserializer.Deserializer::template operator()<U>();
+#endif
+  }
+
+  /**
+   * Return the number of occupied buckets read.
+   */
+  template <class Deserializer>
+  std::size_t deserialize_buckets_in_place(Deserializer& deserializer,
+                                           std::size_t nb_buckets) {
+    m_buckets_data.reset(nb_buckets);
+
+    std::size_t nb_occupied_buckets = 0;
+    for (hopscotch_bucket& bucket : m_buckets_data) {
+      const auto neighborhood_infos = neighborhood_bitmap(
+          deserialize_value<std::uint64_t>(deserializer));
+      if ((neighborhood_infos & 1) != 0) {
+        const truncated_hash_type hash =
+            StoreHash ? deserialize_value<std::uint32_t>(deserializer) : 0;
+        bucket.set_value_of_empty_bucket(
+            hash, deserialize_value<value_type>(deserializer));
+        nb_occupied_buckets++;
+      }
+
+      bucket.set_neighborhood_infos(neighborhood_infos);
+    }
+
+    return nb_occupied_buckets;
   }
 
   template <class K1, class K2>
@@ -1301,14 +2793,9 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     hopscotch_hash new_map = new_hopscotch_hash(count_);
 
     if (!m_overflow_elements.empty()) {
-      new_map.m_overflow_elements.swap(m_overflow_elements);
+      new_map.swap_overflow_elements(*this);
       new_map.m_nb_elements += new_map.m_overflow_elements.size();
-
-      for (const value_type& value : new_map.m_overflow_elements) {
-        const std::size_t ibucket_for_hash =
-            new_map.bucket_for_hash(new_map.hash_key(KeySelect()(value)));
-        new_map.m_buckets[ibucket_for_hash].set_overflow(true);
-      }
+      new_map.rebuild_overflow_home_buckets();
     }
 
 #ifndef TSL_HH_NO_EXCEPTIONS
@@ -1335,14 +2822,250 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
 #ifndef TSL_HH_NO_EXCEPTIONS
     }
     /*
-     * The call to insert_value may throw an exception if an element is added to
-     * the overflow list and the memory allocation fails. Rollback the elements
-     * in this case.
+     * The call to insert_value may throw an exception if an element is added to
+     * the overflow list and the memory allocation fails. Rollback the elements
+     * in this case.
+     */
+    catch (...) {
+      swap_overflow_elements(new_map);
+      rebuild_overflow_home_buckets();
+
+      const bool use_stored_hash =
+          USE_STORED_HASH_ON_REHASH(new_map.bucket_count());
+      for (auto it_bucket = new_map.m_buckets_data.begin();
+           it_bucket != new_map.m_buckets_data.end(); ++it_bucket) {
+        if (it_bucket->empty()) {
+          continue;
+        }
+
+        const std::size_t hash =
+            use_stored_hash ? it_bucket->truncated_bucket_hash()
+                            : hash_key(KeySelect()(it_bucket->value()));
+        const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+
+        // The elements we insert were not in the overflow list before the
+        // switch. They will not be go in the overflow list if we rollback the
+        // switch.
+        insert_value(ibucket_for_hash, hash, std::move(it_bucket->value()));
+      }
+
+      throw;
+    }
+#endif
+
+    new_map.swap(*this);
+  }
+
+  template <typename U = value_type,
+            typename std::enable_if<
+                std::is_copy_constructible<U>::value &&
+                !std::is_nothrow_move_constructible<U>::value>::type* = nullptr>
+  void rehash_impl(size_type count_) {
+    hopscotch_hash new_map = new_hopscotch_hash(count_);
+
+    const bool use_stored_hash =
+        USE_STORED_HASH_ON_REHASH(new_map.bucket_count());
+    for (const hopscotch_bucket& bucket : m_buckets_data) {
+      if (bucket.empty()) {
+        continue;
+      }
+
+      const std::size_t hash =
+          use_stored_hash ? bucket.truncated_bucket_hash()
+                          : new_map.hash_key(KeySelect()(bucket.value()));
+      const std::size_t ibucket_for_hash = new_map.bucket_for_hash(hash);
+
+      new_map.insert_value(ibucket_for_hash, hash, bucket.value());
+    }
+
+    for (auto it = m_overflow_elements.cbegin();
+         it != m_overflow_elements.cend(); ++it) {
+      const std::size_t hash = overflow_hash(it, new_map.bucket_count());
+      const std::size_t ibucket_for_hash = new_map.bucket_for_hash(hash);
+
+      new_map.insert_value(ibucket_for_hash, hash, *it);
+    }
+
+    new_map.swap(*this);
+  }
+
+  /**
+   * Move the elements to a new table of count_ buckets like rehash_impl, with
+   * the bulk of the work split in tasks run through the executor.
+   *
+   * executor(nb_tasks, task) must call task(itask) once for each itask in
+   * [0, nb_tasks), possibly concurrently, and return once all the calls
+   * returned. The tasks call Hash concurrently, it must not throw.
+   *
+   * The old and the new buckets arrays are split in nb_ranges ranges. Each
+   * task owns one range:
+   * 1. Hash the elements of the old range and count them by destination
+   *    range, the range of their home bucket in the new table.
+   * 2. Sort the indexes of the elements by destination range (counting sort,
+   *    the order of the old buckets is kept inside a destination range).
+   * 3. Insert the elements of the destination range in the new table, without
+   *    reading or writing outside of the range. An element needing a bucket
+   *    past the end of the range (or a rehash, or the overflow list) is
+   *    deferred.
+   * Finally the few deferred elements are inserted sequentially with
+   * insert_value, as a sequential rehash would.
+   */
+  template <class Executor, typename U = value_type,
+            typename std::enable_if<
+                std::is_nothrow_move_constructible<U>::value>::type* = nullptr>
+  void parallel_rehash_impl(size_type count_, Executor& executor) {
+    const std::size_t nb_ranges =
+        std::min(PARALLEL_REHASH_MAX_NB_RANGES,
+                 std::min(m_buckets_data.size(), count_) /
+                     PARALLEL_REHASH_MIN_BUCKETS_PER_RANGE);
+    if (nb_ranges <= 1) {
+      rehash_impl(count_);
+      return;
+    }
+
+    hopscotch_hash new_map = new_hopscotch_hash(count_);
+
+    const std::size_t old_nb_buckets = m_buckets_data.size();
+    const std::size_t new_nb_buckets = new_map.m_buckets_data.size();
+    const std::size_t old_range_size =
+        (old_nb_buckets + nb_ranges - 1) / nb_ranges;
+    const std::size_t new_range_size =
+        (new_nb_buckets + nb_ranges - 1) / nb_ranges;
+    const bool use_stored_hash =
+        USE_STORED_HASH_ON_REHASH(new_map.bucket_count());
+
+    std::vector<std::size_t> hashes(old_nb_buckets);
+    std::vector<unsigned char> moved(old_nb_buckets, 0);
+    std::vector<std::size_t> ielements(m_nb_elements -
+                                       m_overflow_elements.size());
+    // Number, then offset in ielements, of the elements of the old range
+    // 'iold_range' going to the new range 'inew_range', at index
+    // iold_range * nb_ranges + inew_range.
+    std::vector<std::size_t> offsets(nb_ranges * nb_ranges, 0);
+    std::vector<std::size_t> new_ranges_offset(nb_ranges + 1);
+    std::vector<std::size_t> nb_deferred(nb_ranges, 0);
+
+    executor(nb_ranges, [&](std::size_t iold_range) {
+      const std::size_t iend =
+          std::min((iold_range + 1) * old_range_size, old_nb_buckets);
+      for (std::size_t i = iold_range * old_range_size; i < iend; i++) {
+        const hopscotch_bucket& bucket = m_buckets_data[i];
+        if (!bucket.empty()) {
+          hashes[i] = use_stored_hash
+                          ? bucket.truncated_bucket_hash()
+                          : new_map.hash_key(KeySelect()(bucket.value()));
+          offsets[iold_range * nb_ranges +
+                  new_map.bucket_for_hash(hashes[i]) / new_range_size]++;
+        }
+      }
+    });
+
+    std::size_t offset = 0;
+    for (std::size_t inew_range = 0; inew_range < nb_ranges; inew_range++) {
+      new_ranges_offset[inew_range] = offset;
+      for (std::size_t iold_range = 0; iold_range < nb_ranges; iold_range++) {
+        const std::size_t nb = offsets[iold_range * nb_ranges + inew_range];
+        offsets[iold_range * nb_ranges + inew_range] = offset;
+        offset += nb;
+      }
+    }
+    new_ranges_offset[nb_ranges] = offset;
+    tsl_hh_assert(offset == ielements.size());
+
+    executor(nb_ranges, [&](std::size_t iold_range) {
+      const std::size_t iend =
+          std::min((iold_range + 1) * old_range_size, old_nb_buckets);
+      for (std::size_t i = iold_range * old_range_size; i < iend; i++) {
+        if (!m_buckets_data[i].empty()) {
+          const std::size_t inew_range =
+              new_map.bucket_for_hash(hashes[i]) / new_range_size;
+          ielements[offsets[iold_range * nb_ranges + inew_range]++] = i;
+        }
+      }
+    });
+
+    if (!m_overflow_elements.empty()) {
+      new_map.swap_overflow_elements(*this);
+      new_map.m_nb_elements += new_map.m_overflow_elements.size();
+      new_map.rebuild_overflow_home_buckets();
+    }
+
+    executor(nb_ranges, [&](std::size_t inew_range) {
+      const std::size_t ibucket_end =
+          std::min((inew_range + 1) * new_range_size, new_nb_buckets);
+      const std::size_t ifirst = new_ranges_offset[inew_range];
+      std::size_t nb_deferred_range = 0;
+
+      for (std::size_t k = ifirst; k < new_ranges_offset[inew_range + 1];
+           k++) {
+        const std::size_t i = ielements[k];
+        if (new_map.insert_value_in_range(
+                new_map.bucket_for_hash(hashes[i]), ibucket_end, hashes[i],
+                std::move(m_buckets_data[i].value()))) {
+          moved[i] = 1;
+        } else {
+          // The slots before k have been processed, reuse them.
+          ielements[ifirst + nb_deferred_range] = i;
+          nb_deferred_range++;
+        }
+      }
+
+      nb_deferred[inew_range] = nb_deferred_range;
+    });
+
+    for (std::size_t nb : nb_deferred) {
+      offset -= nb;
+    }
+    new_map.m_nb_elements += offset;
+
+#ifndef TSL_HH_NO_EXCEPTIONS
+    try {
+#endif
+      for (std::size_t inew_range = 0; inew_range < nb_ranges; inew_range++) {
+        const std::size_t ifirst = new_ranges_offset[inew_range];
+        for (std::size_t k = ifirst; k < ifirst + nb_deferred[inew_range];
+             k++) {
+          const std::size_t i = ielements[k];
+          new_map.insert_value(new_map.bucket_for_hash(hashes[i]), hashes[i],
+                               std::move(m_buckets_data[i].value()));
+          moved[i] = 1;
+        }
+      }
+#ifndef TSL_HH_NO_EXCEPTIONS
+    }
+    /*
+     * insert_value may throw if an element is added to the overflow list and
+     * the memory allocation fails. Remove the moved-from values from the old
+     * buckets, rebuild their neighborhoods and move the elements back.
      */
     catch (...) {
-      m_overflow_elements.swap(new_map.m_overflow_elements);
+      swap_overflow_elements(new_map);
+      rebuild_overflow_home_buckets();
 
-      const bool use_stored_hash =
+      for (std::size_t i = 0; i < old_nb_buckets; i++) {
+        if (moved[i]) {
+          m_buckets_data[i].remove_value();
+        }
+        m_buckets_data[i].clear_neighbors();
+      }
+
+      const bool old_use_stored_hash =
+          USE_STORED_HASH_ON_REHASH(bucket_count());
+      m_nb_elements = m_overflow_elements.size();
+      for (std::size_t i = 0; i < old_nb_buckets; i++) {
+        const hopscotch_bucket& bucket = m_buckets_data[i];
+        if (!bucket.empty()) {
+          const std::size_t hash =
+              old_use_stored_hash ? bucket.truncated_bucket_hash()
+                                  : hash_key(KeySelect()(bucket.value()));
+          const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+          buckets()[ibucket_for_hash].toggle_neighbor_presence(
+              i - ibucket_for_hash);
+          m_nb_elements++;
+        }
+      }
+
+      const bool new_use_stored_hash =
           USE_STORED_HASH_ON_REHASH(new_map.bucket_count());
       for (auto it_bucket = new_map.m_buckets_data.begin();
            it_bucket != new_map.m_buckets_data.end(); ++it_bucket) {
@@ -1351,53 +3074,59 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
         }
 
         const std::size_t hash =
-            use_stored_hash ? it_bucket->truncated_bucket_hash()
-                            : hash_key(KeySelect()(it_bucket->value()));
-        const std::size_t ibucket_for_hash = bucket_for_hash(hash);
-
-        // The elements we insert were not in the overflow list before the
-        // switch. They will not be go in the overflow list if we rollback the
-        // switch.
-        insert_value(ibucket_for_hash, hash, std::move(it_bucket->value()));
+            new_use_stored_hash ? it_bucket->truncated_bucket_hash()
+                                : hash_key(KeySelect()(it_bucket->value()));
+        insert_value(bucket_for_hash(hash), hash,
+                     std::move(it_bucket->value()));
       }
 
       throw;
     }
 #endif
 
+    // The old buckets only contain moved-from values, destroyed with new_map.
     new_map.swap(*this);
   }
 
-  template <typename U = value_type,
+  template <class Executor, typename U = value_type,
             typename std::enable_if<
-                std::is_copy_constructible<U>::value &&
                 !std::is_nothrow_move_constructible<U>::value>::type* = nullptr>
-  void rehash_impl(size_type count_) {
-    hopscotch_hash new_map = new_hopscotch_hash(count_);
-
-    const bool use_stored_hash =
-        USE_STORED_HASH_ON_REHASH(new_map.bucket_count());
-    for (const hopscotch_bucket& bucket : m_buckets_data) {
-      if (bucket.empty()) {
-        continue;
-      }
-
-      const std::size_t hash =
-          use_stored_hash ? bucket.truncated_bucket_hash()
-                          : new_map.hash_key(KeySelect()(bucket.value()));
-      const std::size_t ibucket_for_hash = new_map.bucket_for_hash(hash);
+  void parallel_rehash_impl(size_type count_, Executor& /*executor*/) {
+    rehash_impl(count_);
+  }
 
-      new_map.insert_value(ibucket_for_hash, hash, bucket.value());
-    }
+  /**
+   * Insert the value in a bucket of [ibucket_for_hash, ibucket_end), without
+   * rehash nor overflow list and without reading or writing the buckets past
+   * ibucket_end. m_nb_elements is not updated.
+   *
+   * Return false if the value could not be inserted, value is then untouched.
+   */
+  template <typename P>
+  bool insert_value_in_range(std::size_t ibucket_for_hash,
+                             std::size_t ibucket_end, std::size_t hash,
+                             P&& value) {
+    std::size_t ibucket_empty =
+        find_empty_bucket(ibucket_for_hash, ibucket_end);
+    if (ibucket_empty < ibucket_end) {
+      do {
+        tsl_hh_assert(ibucket_empty >= ibucket_for_hash);
 
-    for (const value_type& value : m_overflow_elements) {
-      const std::size_t hash = new_map.hash_key(KeySelect()(value));
-      const std::size_t ibucket_for_hash = new_map.bucket_for_hash(hash);
+        if (ibucket_empty - ibucket_for_hash < NeighborhoodSize) {
+          buckets()[ibucket_empty].set_value_of_empty_bucket(
+              hopscotch_bucket::truncate_hash(hash), std::forward<P>(value));
+          buckets()[ibucket_for_hash].toggle_neighbor_presence(
+              ibucket_empty - ibucket_for_hash);
 
-      new_map.insert_value(ibucket_for_hash, hash, value);
+          return true;
+        }
+      }
+      // swap_empty_bucket_closer only looks at the buckets in
+      // (ibucket_for_hash, ibucket_empty].
+      while (swap_empty_bucket_closer(ibucket_empty));
     }
 
-    new_map.swap(*this);
+    return false;
   }
 
   iterator_overflow mutable_overflow_iterator(const_iterator_overflow it) {
@@ -1405,22 +3134,40 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
   }
 
   // iterator is in overflow list
+  template <
+      class U = OverflowContainer,
+      typename std::enable_if<!has_key_compare<U>::value>::type* = nullptr>
+  iterator_overflow erase_from_overflow(const_iterator_overflow pos,
+                                        std::size_t ibucket_for_hash) {
+    auto it_next = m_overflow_elements.erase(pos);
+    m_nb_elements--;
+
+    tsl_hh_assert(buckets()[ibucket_for_hash].has_overflow());
+    if (!m_overflow_elements.has_bucket(ibucket_for_hash)) {
+      buckets()[ibucket_for_hash].set_overflow(false);
+    }
+
+    return it_next;
+  }
+
+  template <class U = OverflowContainer,
+            typename std::enable_if<has_key_compare<U>::value>::type* = nullptr>
   iterator_overflow erase_from_overflow(const_iterator_overflow pos,
                                         std::size_t ibucket_for_hash) {
     auto it_next = m_overflow_elements.erase(pos);
     m_nb_elements--;
 
     // Check if we can remove the overflow flag
-    tsl_hh_assert(m_buckets[ibucket_for_hash].has_overflow());
-    for (const value_type& value : m_overflow_elements) {
-      const std::size_t bucket_for_value =
-          bucket_for_hash(hash_key(KeySelect()(value)));
-      if (bucket_for_value == ibucket_for_hash) {
-        return it_next;
-      }
+    tsl_hh_assert(buckets()[ibucket_for_hash].has_overflow());
+    std::size_t* nb_overflow = overflow_counters().find(ibucket_for_hash);
+    tsl_hh_assert(nb_overflow != nullptr && *nb_overflow > 0);
+
+    (*nb_overflow)--;
+    if (*nb_overflow == 0) {
+      overflow_counters().erase(ibucket_for_hash);
+      buckets()[ibucket_for_hash].set_overflow(false);
     }
 
-    m_buckets[ibucket_for_hash].set_overflow(false);
     return it_next;
   }
 
@@ -1435,14 +3182,16 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     tsl_hh_assert(ibucket_for_value >= ibucket_for_hash);
 
     bucket_for_value.remove_value();
-    m_buckets[ibucket_for_hash].toggle_neighbor_presence(ibucket_for_value -
+    buckets()[ibucket_for_hash].toggle_neighbor_presence(ibucket_for_value -
                                                          ibucket_for_hash);
     m_nb_elements--;
   }
 
   template <class K, class M>
-  std::pair<iterator, bool> insert_or_assign_impl(K&& key, M&& obj) {
-    auto it = try_emplace_impl(std::forward<K>(key), std::forward<M>(obj));
+  std::pair<iterator, bool> insert_or_assign_impl(std::size_t hash, K&& key,
+                                                  M&& obj) {
+    auto it =
+        try_emplace_impl(hash, std::forward<K>(key), std::forward<M>(obj));
     if (!it.second) {
       it.first.value() = std::forward<M>(obj);
     }
@@ -1450,13 +3199,38 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     return it;
   }
 
+  template <class K, class U = ValueSelect,
+            typename std::enable_if<has_mapped_type<U>::value>::type* = nullptr>
+  typename U::value_type& subscript_impl(std::size_t hash, K&& key) {
+    using T = typename U::value_type;
+
+    const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+
+    T* value = find_value_impl(key, hash, buckets() + ibucket_for_hash);
+    if (value != nullptr) {
+      return *value;
+    } else {
+      return insert_value(ibucket_for_hash, hash, std::piecewise_construct,
+                          std::forward_as_tuple(std::forward<K>(key)),
+                          std::forward_as_tuple())
+          .first.value();
+    }
+  }
+
+  template <class K>
+  void check_precalculated_hash(const K& key, std::size_t hash) const {
+    (void)key;
+    (void)hash;
+    tsl_hh_assert(hash == Hash::operator()(key));
+  }
+
   template <typename P, class... Args>
-  std::pair<iterator, bool> try_emplace_impl(P&& key, Args&&... args_value) {
-    const std::size_t hash = hash_key(key);
+  std::pair<iterator, bool> try_emplace_impl(std::size_t hash, P&& key,
+                                             Args&&... args_value) {
     const std::size_t ibucket_for_hash = bucket_for_hash(hash);
 
     // Check if already presents
-    auto it_find = find_impl(key, hash, m_buckets + ibucket_for_hash);
+    auto it_find = find_impl(key, hash, buckets() + ibucket_for_hash);
     if (it_find != end()) {
       return std::make_pair(it_find, false);
     }
@@ -1467,14 +3241,46 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
         std::forward_as_tuple(std::forward<Args>(args_value)...));
   }
 
+  /**
+   * Reserve enough buckets to insert nb_elements_insert elements without
+   * rehash (barring overflows).
+   */
+  void reserve_for_insert(std::size_t nb_elements_insert) {
+    const std::size_t nb_elements_in_buckets =
+        m_nb_elements - m_overflow_elements.size();
+    const std::size_t nb_free_buckets =
+        m_max_load_threshold_rehash - nb_elements_in_buckets;
+    tsl_hh_assert(m_nb_elements >= m_overflow_elements.size());
+    tsl_hh_assert(m_max_load_threshold_rehash >= nb_elements_in_buckets);
+
+    if (nb_elements_insert > 0 && nb_free_buckets < nb_elements_insert) {
+      reserve(nb_elements_in_buckets + nb_elements_insert);
+    }
+  }
+
+  template <bool UniqueKeys, typename P>
+  void bulk_insert_value(std::size_t hash, P&& value) {
+    const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+    if constexpr (UniqueKeys) {
+      tsl_hh_assert(find_impl(KeySelect()(value), hash,
+                              buckets() + ibucket_for_hash) == end());
+    } else {
+      if (find_impl(KeySelect()(value), hash, buckets() + ibucket_for_hash) !=
+          end()) {
+        return;
+      }
+    }
+
+    insert_value(ibucket_for_hash, hash, std::forward<P>(value));
+  }
+
   template <typename P>
-  std::pair<iterator, bool> insert_impl(P&& value) {
-    const std::size_t hash = hash_key(KeySelect()(value));
+  std::pair<iterator, bool> insert_impl(std::size_t hash, P&& value) {
     const std::size_t ibucket_for_hash = bucket_for_hash(hash);
 
     // Check if already presents
     auto it_find =
-        find_impl(KeySelect()(value), hash, m_buckets + ibucket_for_hash);
+        find_impl(KeySelect()(value), hash, buckets() + ibucket_for_hash);
     if (it_find != end()) {
       return std::make_pair(it_find, false);
     }
@@ -1482,18 +3288,28 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     return insert_value(ibucket_for_hash, hash, std::forward<P>(value));
   }
 
-  template <typename... Args>
+  /*
+   * If RehashIfNeeded is false, return (end(), false) without constructing the
+   * value instead of rehashing the table.
+   */
+  template <bool RehashIfNeeded = true, typename... Args>
   std::pair<iterator, bool> insert_value(std::size_t ibucket_for_hash,
                                          std::size_t hash,
                                          Args&&... value_type_args) {
     if ((m_nb_elements - m_overflow_elements.size()) >=
         m_max_load_threshold_rehash) {
+      if (!RehashIfNeeded) {
+        return std::make_pair(end(), false);
+      }
+
       rehash(GrowthPolicy::next_bucket_count());
       ibucket_for_hash = bucket_for_hash(hash);
     }
 
     std::size_t ibucket_empty = find_empty_bucket(ibucket_for_hash);
+    record_empty_bucket_search(ibucket_for_hash, ibucket_empty);
     if (ibucket_empty < m_buckets_data.size()) {
+      std::size_t nb_displacements = 0;
       do {
         tsl_hh_assert(ibucket_empty >= ibucket_for_hash);
 
@@ -1501,25 +3317,36 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
         if (ibucket_empty - ibucket_for_hash < NeighborhoodSize) {
           auto it = insert_in_bucket(ibucket_empty, ibucket_for_hash, hash,
                                      std::forward<Args>(value_type_args)...);
+          record_bucket_insert(nb_displacements);
           return std::make_pair(
               iterator(it, m_buckets_data.end(), m_overflow_elements.begin()),
               true);
         }
+
+        nb_displacements++;
       }
       // else, try to swap values to get a closer empty bucket
       while (swap_empty_bucket_closer(ibucket_empty));
+
+      // The last attempt didn't move any value.
+      record_displacements(nb_displacements - 1);
     }
 
     // Load factor is too low or a rehash will not change the neighborhood, put
     // the value in overflow list
     if (size() < m_min_load_threshold_rehash ||
         !will_neighborhood_change_on_rehash(ibucket_for_hash)) {
-      auto it = insert_in_overflow(ibucket_for_hash,
+      record_overflow_insert();
+      auto it = insert_in_overflow(ibucket_for_hash, hash,
                                    std::forward<Args>(value_type_args)...);
       return std::make_pair(
           iterator(m_buckets_data.end(), m_buckets_data.end(), it), true);
     }
 
+    if (!RehashIfNeeded) {
+      return std::make_pair(end(), false);
+    }
+
     rehash(GrowthPolicy::next_bucket_count());
     ibucket_for_hash = bucket_for_hash(hash);
 
@@ -1527,6 +3354,112 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
                         std::forward<Args>(value_type_args)...);
   }
 
+  static std::size_t nb_neighbors(const hopscotch_bucket& bucket) noexcept {
+    neighborhood_bitmap neighborhood_infos = bucket.neighborhood_infos();
+    std::size_t nb_neighbors = 0;
+    while (neighborhood_infos != 0) {
+      neighborhood_infos =
+          neighborhood_bitmap(neighborhood_infos & (neighborhood_infos - 1));
+      nb_neighbors++;
+    }
+
+    return nb_neighbors;
+  }
+
+  /**
+   * Count the distinct cache lines covered by buckets added in increasing
+   * address order.
+   */
+  class cache_lines_counter {
+   public:
+    void add(const hopscotch_bucket& bucket) noexcept {
+      const std::uintptr_t address =
+          reinterpret_cast<std::uintptr_t>(std::addressof(bucket));
+      std::uintptr_t first_line = address / CACHE_LINE_SIZE;
+      const std::uintptr_t last_line =
+          (address + sizeof(hopscotch_bucket) - 1) / CACHE_LINE_SIZE;
+
+      if (m_nb_cache_lines > 0) {
+        first_line = std::max(first_line, m_last_line + 1);
+      }
+      if (last_line >= first_line) {
+        m_nb_cache_lines += std::size_t(last_line - first_line + 1);
+        m_last_line = last_line;
+      }
+    }
+
+    std::size_t nb_cache_lines() const noexcept { return m_nb_cache_lines; }
+
+   private:
+    std::size_t m_nb_cache_lines = 0;
+    std::uintptr_t m_last_line = 0;
+  };
+
+  /*
+   * Statistics, no-ops if TSL_HH_ENABLE_STATS isn't defined.
+   */
+  template <class F>
+  void record_rehash(F&& rehash_function) {
+#ifdef TSL_HH_ENABLE_STATS
+    const auto start = std::chrono::steady_clock::now();
+    rehash_function();
+
+    m_stats.nb_rehashes++;
+    m_stats.rehash_duration +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start);
+#else
+    rehash_function();
+#endif
+  }
+
+  void record_empty_bucket_search(std::size_t ibucket_start,
+                                  std::size_t ibucket_empty) noexcept {
+#ifdef TSL_HH_ENABLE_STATS
+    if (ibucket_empty < m_buckets_data.size()) {
+      const std::uint64_t distance = ibucket_empty - ibucket_start;
+      m_stats.nb_empty_bucket_searches++;
+      m_stats.empty_bucket_distance_sum += distance;
+      m_stats.max_empty_bucket_distance =
+          std::max(m_stats.max_empty_bucket_distance, distance);
+    } else {
+      m_stats.nb_empty_bucket_not_found++;
+    }
+#else
+    (void)ibucket_start;
+    (void)ibucket_empty;
+#endif
+  }
+
+  void record_displacements(std::size_t nb_displacements) noexcept {
+#ifdef TSL_HH_ENABLE_STATS
+    m_stats.nb_displacements += nb_displacements;
+    m_stats.max_displacements =
+        std::max(m_stats.max_displacements, std::uint64_t(nb_displacements));
+#else
+    (void)nb_displacements;
+#endif
+  }
+
+  void record_bucket_insert(std::size_t nb_displacements) noexcept {
+#ifdef TSL_HH_ENABLE_STATS
+    m_stats.nb_bucket_inserts++;
+#endif
+    record_displacements(nb_displacements);
+  }
+
+  void record_overflow_insert() noexcept {
+#ifdef TSL_HH_ENABLE_STATS
+    m_stats.nb_overflow_inserts++;
+#endif
+  }
+
+  void record_overflow_lookup() const noexcept {
+#ifdef TSL_HH_ENABLE_STATS
+    m_nb_overflow_lookups.fetch_add(1, std::memory_order_relaxed);
+#endif
+  }
+
   /*
    * Return true if a rehash will change the position of a key-value in the
    * neighborhood of ibucket_neighborhood_check. In this case a rehash is needed
@@ -1542,11 +3475,11 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
          ibucket < m_buckets_data.size() &&
          (ibucket - ibucket_neighborhood_check) < NeighborhoodSize;
          ++ibucket) {
-      tsl_hh_assert(!m_buckets[ibucket].empty());
+      tsl_hh_assert(!buckets()[ibucket].empty());
 
       const size_t hash =
-          use_stored_hash ? m_buckets[ibucket].truncated_bucket_hash()
-                          : hash_key(KeySelect()(m_buckets[ibucket].value()));
+          use_stored_hash ? buckets()[ibucket].truncated_bucket_hash()
+                          : hash_key(KeySelect()(buckets()[ibucket].value()));
       if (bucket_for_hash(hash) != expand_growth_policy.bucket_for_hash(hash)) {
         return true;
       }
@@ -1560,15 +3493,24 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
    * If none, the returned index equals m_buckets_data.size()
    */
   std::size_t find_empty_bucket(std::size_t ibucket_start) const {
-    const std::size_t limit = std::min(
-        ibucket_start + MAX_PROBES_FOR_EMPTY_BUCKET, m_buckets_data.size());
+    return find_empty_bucket(ibucket_start, m_buckets_data.size());
+  }
+
+  /*
+   * Return the index of an empty bucket in [ibucket_start, ibucket_end).
+   * If none, the returned index equals ibucket_end
+   */
+  std::size_t find_empty_bucket(std::size_t ibucket_start,
+                                std::size_t ibucket_end) const {
+    const std::size_t limit =
+        std::min(ibucket_start + MAX_PROBES_FOR_EMPTY_BUCKET, ibucket_end);
     for (; ibucket_start < limit; ibucket_start++) {
-      if (m_buckets[ibucket_start].empty()) {
+      if (buckets()[ibucket_start].empty()) {
         return ibucket_start;
       }
     }
 
-    return m_buckets_data.size();
+    return ibucket_end;
   }
 
   /*
@@ -1583,13 +3525,13 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
                                     std::size_t hash,
                                     Args&&... value_type_args) {
     tsl_hh_assert(ibucket_empty >= ibucket_for_hash);
-    tsl_hh_assert(m_buckets[ibucket_empty].empty());
-    m_buckets[ibucket_empty].set_value_of_empty_bucket(
+    tsl_hh_assert(buckets()[ibucket_empty].empty());
+    buckets()[ibucket_empty].set_value_of_empty_bucket(
         hopscotch_bucket::truncate_hash(hash),
         std::forward<Args>(value_type_args)...);
 
-    tsl_hh_assert(!m_buckets[ibucket_for_hash].empty());
-    m_buckets[ibucket_for_hash].toggle_neighbor_presence(ibucket_empty -
+    tsl_hh_assert(!buckets()[ibucket_for_hash].empty());
+    buckets()[ibucket_for_hash].toggle_neighbor_presence(ibucket_empty -
                                                          ibucket_for_hash);
     m_nb_elements++;
 
@@ -1600,11 +3542,12 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
       class... Args, class U = OverflowContainer,
       typename std::enable_if<!has_key_compare<U>::value>::type* = nullptr>
   iterator_overflow insert_in_overflow(std::size_t ibucket_for_hash,
+                                       std::size_t hash,
                                        Args&&... value_type_args) {
     auto it = m_overflow_elements.emplace(
-        m_overflow_elements.end(), std::forward<Args>(value_type_args)...);
+        ibucket_for_hash, hash, std::forward<Args>(value_type_args)...);
 
-    m_buckets[ibucket_for_hash].set_overflow(true);
+    buckets()[ibucket_for_hash].set_overflow(true);
     m_nb_elements++;
 
     return it;
@@ -1613,12 +3556,18 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
   template <class... Args, class U = OverflowContainer,
             typename std::enable_if<has_key_compare<U>::value>::type* = nullptr>
   iterator_overflow insert_in_overflow(std::size_t ibucket_for_hash,
+                                       std::size_t /*hash*/,
                                        Args&&... value_type_args) {
+    // One counter per element at most, the counters can then always be
+    // rebuilt without allocation after a rehash.
+    overflow_counters().reserve(m_overflow_elements.size() + 1);
+
     auto it =
         m_overflow_elements.emplace(std::forward<Args>(value_type_args)...)
             .first;
 
-    m_buckets[ibucket_for_hash].set_overflow(true);
+    overflow_counters().insert(ibucket_for_hash, 0)++;
+    buckets()[ibucket_for_hash].set_overflow(true);
     m_nb_elements++;
 
     return it;
@@ -1639,25 +3588,25 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     for (std::size_t to_check = neighborhood_start;
          to_check < ibucket_empty_in_out; to_check++) {
       neighborhood_bitmap neighborhood_infos =
-          m_buckets[to_check].neighborhood_infos();
+          buckets()[to_check].neighborhood_infos();
       std::size_t to_swap = to_check;
 
       while (neighborhood_infos != 0 && to_swap < ibucket_empty_in_out) {
         if ((neighborhood_infos & 1) == 1) {
-          tsl_hh_assert(m_buckets[ibucket_empty_in_out].empty());
-          tsl_hh_assert(!m_buckets[to_swap].empty());
+          tsl_hh_assert(buckets()[ibucket_empty_in_out].empty());
+          tsl_hh_assert(!buckets()[to_swap].empty());
 
-          m_buckets[to_swap].swap_value_into_empty_bucket(
-              m_buckets[ibucket_empty_in_out]);
+          buckets()[to_swap].swap_value_into_empty_bucket(
+              buckets()[ibucket_empty_in_out]);
 
-          tsl_hh_assert(!m_buckets[to_check].check_neighbor_presence(
+          tsl_hh_assert(!buckets()[to_check].check_neighbor_presence(
               ibucket_empty_in_out - to_check));
           tsl_hh_assert(
-              m_buckets[to_check].check_neighbor_presence(to_swap - to_check));
+              buckets()[to_check].check_neighbor_presence(to_swap - to_check));
 
-          m_buckets[to_check].toggle_neighbor_presence(ibucket_empty_in_out -
+          buckets()[to_check].toggle_neighbor_presence(ibucket_empty_in_out -
                                                        to_check);
-          m_buckets[to_check].toggle_neighbor_presence(to_swap - to_check);
+          buckets()[to_check].toggle_neighbor_presence(to_swap - to_check);
 
           ibucket_empty_in_out = to_swap;
 
@@ -1700,7 +3649,8 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     }
 
     if (bucket_for_hash->has_overflow()) {
-      auto it_overflow = find_in_overflow(key);
+      auto it_overflow =
+          find_in_overflow(key, hash, bucket_for_hash - buckets());
       if (it_overflow != m_overflow_elements.end()) {
         return std::addressof(ValueSelect()(*it_overflow));
       }
@@ -1715,13 +3665,34 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     if (find_in_buckets(key, hash, bucket_for_hash) != nullptr) {
       return 1;
     } else if (bucket_for_hash->has_overflow() &&
-               find_in_overflow(key) != m_overflow_elements.cend()) {
+               find_in_overflow(key, hash, bucket_for_hash - buckets()) !=
+                   m_overflow_elements.cend()) {
       return 1;
     } else {
       return 0;
     }
   }
 
+  /**
+   * Hash the next LOOKUP_BATCH_SIZE keys of [first, last), or less if the range
+   * is shorter, and prefetch their home buckets. Return the number of keys
+   * processed.
+   */
+  template <class ForwardIt>
+  std::size_t prefetch_batch(ForwardIt first, ForwardIt last,
+                             std::size_t* hashes,
+                             std::size_t* ibuckets) const {
+    std::size_t nb_keys = 0;
+    for (; first != last && nb_keys < LOOKUP_BATCH_SIZE; ++first, ++nb_keys) {
+      hashes[nb_keys] = hash_key(*first);
+      ibuckets[nb_keys] = bucket_for_hash(hashes[nb_keys]);
+
+      tsl::detail_hopscotch_hash::prefetch(buckets() + ibuckets[nb_keys]);
+    }
+
+    return nb_keys;
+  }
+
   template <class K>
   iterator find_impl(const K& key, std::size_t hash,
                      hopscotch_bucket* bucket_for_hash) {
@@ -1738,7 +3709,7 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     }
 
     return iterator(m_buckets_data.end(), m_buckets_data.end(),
-                    find_in_overflow(key));
+                    find_in_overflow(key, hash, bucket_for_hash - buckets()));
   }
 
   template <class K>
@@ -1757,8 +3728,9 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
       return cend();
     }
 
-    return const_iterator(m_buckets_data.cend(), m_buckets_data.cend(),
-                          find_in_overflow(key));
+    return const_iterator(
+        m_buckets_data.cend(), m_buckets_data.cend(),
+        find_in_overflow(key, hash, bucket_for_hash - buckets()));
   }
 
   template <class K>
@@ -1777,83 +3749,167 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
   const hopscotch_bucket* find_in_buckets(
       const K& key, std::size_t hash,
       const hopscotch_bucket* bucket_for_hash) const {
-    (void)hash;  // Avoid warning of unused variable when StoreHash is false;
-
-    // TODO Try to optimize the function.
-    // I tried to use ffs and  __builtin_ffs functions but I could not reduce
-    // the time the function takes with -march=native
-
-    neighborhood_bitmap neighborhood_infos =
-        bucket_for_hash->neighborhood_infos();
-    while (neighborhood_infos != 0) {
-      if ((neighborhood_infos & 1) == 1) {
-        // Check StoreHash before calling bucket_hash_equal. Functionally it
-        // doesn't change anythin. If StoreHash is false, bucket_hash_equal is a
-        // no-op. Avoiding the call is there to help GCC optimizes `hash`
-        // parameter away, it seems to not be able to do without this hint.
-        if ((!StoreHash || bucket_for_hash->bucket_hash_equal(hash)) &&
-            compare_keys(KeySelect()(bucket_for_hash->value()), key)) {
-          return bucket_for_hash;
-        }
-      }
-
-      ++bucket_for_hash;
-      neighborhood_infos = neighborhood_bitmap(neighborhood_infos >> 1);
-    }
-
-    return nullptr;
+    return find_in_neighborhood<StoreHash>(
+        bucket_for_hash, hash, [&](const value_type& value) {
+          return compare_keys(KeySelect()(value), key);
+        });
   }
 
   template <
       class K, class U = OverflowContainer,
       typename std::enable_if<!has_key_compare<U>::value>::type* = nullptr>
-  iterator_overflow find_in_overflow(const K& key) {
-    return std::find_if(m_overflow_elements.begin(), m_overflow_elements.end(),
-                        [&](const value_type& value) {
-                          return compare_keys(key, KeySelect()(value));
-                        });
+  iterator_overflow find_in_overflow(const K& key, std::size_t hash,
+                                     std::size_t ibucket_for_hash) {
+    record_overflow_lookup();
+    return m_overflow_elements.find(
+        ibucket_for_hash,
+        [&](std::size_t stored_hash, const value_type& value) {
+          return overflow_hash_equal(stored_hash, hash) &&
+                 compare_keys(key, KeySelect()(value));
+        });
   }
 
   template <
       class K, class U = OverflowContainer,
       typename std::enable_if<!has_key_compare<U>::value>::type* = nullptr>
-  const_iterator_overflow find_in_overflow(const K& key) const {
-    return std::find_if(m_overflow_elements.cbegin(),
-                        m_overflow_elements.cend(),
-                        [&](const value_type& value) {
-                          return compare_keys(key, KeySelect()(value));
-                        });
+  const_iterator_overflow find_in_overflow(const K& key, std::size_t hash,
+                                           std::size_t ibucket_for_hash) const {
+    record_overflow_lookup();
+    return m_overflow_elements.find(
+        ibucket_for_hash,
+        [&](std::size_t stored_hash, const value_type& value) {
+          return overflow_hash_equal(stored_hash, hash) &&
+                 compare_keys(key, KeySelect()(value));
+        });
   }
 
   template <class K, class U = OverflowContainer,
             typename std::enable_if<has_key_compare<U>::value>::type* = nullptr>
-  iterator_overflow find_in_overflow(const K& key) {
+  iterator_overflow find_in_overflow(const K& key, std::size_t /*hash*/,
+                                     std::size_t /*ibucket_for_hash*/) {
+    record_overflow_lookup();
     return m_overflow_elements.find(key);
   }
 
   template <class K, class U = OverflowContainer,
             typename std::enable_if<has_key_compare<U>::value>::type* = nullptr>
-  const_iterator_overflow find_in_overflow(const K& key) const {
+  const_iterator_overflow find_in_overflow(
+      const K& key, std::size_t /*hash*/,
+      std::size_t /*ibucket_for_hash*/) const {
+    record_overflow_lookup();
     return m_overflow_elements.find(key);
   }
 
+  /**
+   * The hopscotch_overflow_table keeps the hash of its elements. Without
+   * StoreHash it's the full hash. With StoreHash it may come from a bucket
+   * and be truncated to truncated_hash_type, it can then only be used while
+   * it's enough to map the hash to a bucket, like the hashes stored in the
+   * buckets.
+   */
+  static bool use_overflow_stored_hash(size_type bucket_count) {
+    return !StoreHash || USE_STORED_HASH_ON_REHASH(bucket_count);
+  }
+
+  static bool overflow_hash_equal(std::size_t stored_hash, std::size_t hash) {
+    return StoreHash ? truncated_hash_type(stored_hash) ==
+                           truncated_hash_type(hash)
+                     : stored_hash == hash;
+  }
+
+  /**
+   * Hash of the overflow element pos to map it to a bucket in a table of
+   * bucket_count buckets, without hashing the key if the overflow container
+   * kept a usable hash.
+   */
   template <
       class U = OverflowContainer,
       typename std::enable_if<!has_key_compare<U>::value>::type* = nullptr>
-  hopscotch_hash new_hopscotch_hash(size_type bucket_count) {
+  std::size_t overflow_hash(const_iterator_overflow pos,
+                            size_type bucket_count) const {
+    return use_overflow_stored_hash(bucket_count)
+               ? m_overflow_elements.hash(pos)
+               : hash_key(KeySelect()(*pos));
+  }
+
+  template <class U = OverflowContainer,
+            typename std::enable_if<has_key_compare<U>::value>::type* = nullptr>
+  std::size_t overflow_hash(const_iterator_overflow pos,
+                            size_type /*bucket_count*/) const {
+    return hash_key(KeySelect()(*pos));
+  }
+
+  /**
+   * Set the overflow flag of the home bucket of each overflow element after
+   * the overflow elements were moved to a table with another bucket count.
+   * The hopscotch_overflow_table is also reindexed on the new home buckets.
+   */
+  template <
+      class U = OverflowContainer,
+      typename std::enable_if<!has_key_compare<U>::value>::type* = nullptr>
+  void rebuild_overflow_home_buckets() {
+    const bool use_stored_hash = use_overflow_stored_hash(bucket_count());
+    m_overflow_elements.reindex(
+        [&](std::size_t& hash, const value_type& value) {
+          if (!use_stored_hash) {
+            hash = hash_key(KeySelect()(value));
+          }
+
+          const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+          buckets()[ibucket_for_hash].set_overflow(true);
+
+          return ibucket_for_hash;
+        });
+  }
+
+  template <class U = OverflowContainer,
+            typename std::enable_if<has_key_compare<U>::value>::type* = nullptr>
+  void rebuild_overflow_home_buckets() {
+    tsl_hh_assert(m_overflow_elements.size() <=
+                  overflow_counters().capacity());
+    overflow_counters().clear();
+
+    for (const value_type& value : m_overflow_elements) {
+      const std::size_t ibucket_for_hash =
+          bucket_for_hash(hash_key(KeySelect()(value)));
+      overflow_counters().insert(ibucket_for_hash, 0)++;
+      buckets()[ibucket_for_hash].set_overflow(true);
+    }
+  }
+
+  /**
+   * Swap the overflow elements, and their counters, with the ones of other.
+   * The overflow flags of the buckets are not modified, see
+   * rebuild_overflow_home_buckets.
+   */
+  void swap_overflow_elements(hopscotch_hash& other) noexcept {
+    m_overflow_elements.swap(other.m_overflow_elements);
+    overflow_counters().swap(other.overflow_counters());
+  }
+
+  template <
+      class U = OverflowContainer,
+      typename std::enable_if<!has_key_compare<U>::value>::type* = nullptr>
+  hopscotch_hash new_hopscotch_hash(size_type bucket_count,
+                                    const Allocator& alloc) {
     return hopscotch_hash(bucket_count, static_cast<Hash&>(*this),
-                          static_cast<KeyEqual&>(*this), get_allocator(),
+                          static_cast<KeyEqual&>(*this), alloc,
                           m_max_load_factor);
   }
 
   template <class U = OverflowContainer,
             typename std::enable_if<has_key_compare<U>::value>::type* = nullptr>
-  hopscotch_hash new_hopscotch_hash(size_type bucket_count) {
+  hopscotch_hash new_hopscotch_hash(size_type bucket_count,
+                                    const Allocator& alloc) {
     return hopscotch_hash(bucket_count, static_cast<Hash&>(*this),
-                          static_cast<KeyEqual&>(*this), get_allocator(),
+                          static_cast<KeyEqual&>(*this), alloc,
                           m_max_load_factor, m_overflow_elements.key_comp());
   }
 
+  hopscotch_hash new_hopscotch_hash(size_type bucket_count) {
+    return new_hopscotch_hash(bucket_count, get_allocator());
+  }
+
  public:
   static const size_type DEFAULT_INIT_BUCKETS_SIZE = 0;
   static constexpr float DEFAULT_MAX_LOAD_FACTOR =
@@ -1863,6 +3919,33 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
   static const std::size_t MAX_PROBES_FOR_EMPTY_BUCKET = 12 * NeighborhoodSize;
   static constexpr float MIN_LOAD_FACTOR_FOR_REHASH = 0.1f;
 
+  /**
+   * Number of keys hashed and prefetched together by the batch lookups and by
+   * bulk_build. Large enough to keep the outstanding cache misses of a core
+   * busy, small enough for the prefetched buckets to still be in the L1 cache
+   * when accessed.
+   */
+  static const std::size_t LOOKUP_BATCH_SIZE = 16;
+
+  /**
+   * Cache line size assumed by analyze().
+   */
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+  /**
+   * Protocol version of serialize and deserialize, to increment on each
+   * change of the format.
+   */
+  static constexpr std::uint64_t SERIALIZATION_PROTOCOL_VERSION = 3;
+
+  /**
+   * parallel_rehash splits the buckets in at most PARALLEL_REHASH_MAX_NB_RANGES
+   * ranges of at least PARALLEL_REHASH_MIN_BUCKETS_PER_RANGE buckets. Smaller
+   * tables are rehashed sequentially.
+   */
+  static constexpr std::size_t PARALLEL_REHASH_MIN_BUCKETS_PER_RANGE = 1 << 14;
+  static constexpr std::size_t PARALLEL_REHASH_MAX_NB_RANGES = 256;
+
   /**
    * We can only use the hash on rehash if the size of the hash type is the same
    * as the stored one or if we use a power of two modulo. In the case of the
@@ -1890,28 +3973,10 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
     }
   }
 
-  /**
-   * Return an always valid pointer to an static empty hopscotch_bucket.
-   */
-  hopscotch_bucket* static_empty_bucket_ptr() {
-    static hopscotch_bucket empty_bucket;
-    return &empty_bucket;
-  }
-
  private:
   buckets_container_type m_buckets_data;
   overflow_container_type m_overflow_elements;
 
-  /**
-   * Points to m_buckets_data.data() if !m_buckets_data.empty() otherwise points
-   * to static_empty_bucket_ptr. This variable is useful to avoid the cost of
-   * checking if m_buckets_data is empty when trying to find an element.
-   *
-   * TODO Remove m_buckets_data and only use a pointer+size instead of a
-   * pointer+vector to save some space in the hopscotch_hash object.
-   */
-  hopscotch_bucket* m_buckets;
-
   size_type m_nb_elements;
 
   /**
@@ -1929,10 +3994,87 @@ class hopscotch_hash : private Hash, private KeyEqual, private GrowthPolicy {
   size_type m_max_load_threshold_rehash;
 
   float m_max_load_factor;
+
+#ifdef TSL_HH_ENABLE_STATS
+  /**
+   * Counters of the object itself, not copied, moved or swapped with the
+   * elements. The lookups, which may run concurrently, only update
+   * m_nb_overflow_lookups.
+   */
+  hh::hopscotch_stats m_stats;
+  mutable std::atomic<std::uint64_t> m_nb_overflow_lookups{0};
+#endif
 };
 
 }  // end namespace detail_hopscotch_hash
 
+namespace hh {
+
+/**
+ * Largest NeighborhoodSize for which the buckets of ValueType are no larger
+ * than with the smallest neighborhood: the bitmap then fits in the space the
+ * alignment of the value requires anyway, e.g. a bucket of 8 bytes for a
+ * std::uint32_t instead of 16 with the default neighborhood of 62.
+ *
+ * If StoreHash is false and the value isn't trivially destructible, like a
+ * std::string, its comparison is likely costly and 8 bits of a bitmap of 32
+ * or 64 bits are left for a hash fragment (see
+ * hopscotch_bucket::NB_HASH_FRAGMENT_BITS).
+ *
+ * tsl::hopscotch_set<std::uint32_t, std::hash<std::uint32_t>,
+ *                    std::equal_to<std::uint32_t>,
+ *                    std::allocator<std::uint32_t>,
+ *                    tsl::hh::compact_neighborhood_size<std::uint32_t>::value>
+ */
+template <class ValueType, bool StoreHash = false>
+class compact_neighborhood_size {
+ private:
+  template <unsigned int NeighborhoodSize>
+  static constexpr std::size_t bucket_size =
+      sizeof(detail_hopscotch_hash::hopscotch_bucket<
+             ValueType, NeighborhoodSize, StoreHash>);
+
+  static constexpr unsigned int neighborhood_size_for_bits(
+      unsigned int nb_bits) {
+    const unsigned int nb_hash_fragment_bits =
+        (!StoreHash && nb_bits >= 32 &&
+         !std::is_trivially_destructible<ValueType>::value)
+            ? 8
+            : 0;
+    const unsigned int neighborhood_size =
+        nb_bits -
+        unsigned(detail_hopscotch_hash::NB_RESERVED_BITS_IN_NEIGHBORHOOD) -
+        nb_hash_fragment_bits;
+
+    // The stored hash limits the neighborhood to 30.
+    return (StoreHash && neighborhood_size > 30) ? 30 : neighborhood_size;
+  }
+
+  static constexpr unsigned int NEIGHBORHOOD_SIZE_64 =
+      neighborhood_size_for_bits(64);
+  static constexpr unsigned int NEIGHBORHOOD_SIZE_32 =
+      neighborhood_size_for_bits(32);
+  static constexpr unsigned int NEIGHBORHOOD_SIZE_16 =
+      neighborhood_size_for_bits(16);
+  static constexpr unsigned int NEIGHBORHOOD_SIZE_8 =
+      neighborhood_size_for_bits(8);
+
+  static constexpr std::size_t MIN_BUCKET_SIZE =
+      bucket_size<NEIGHBORHOOD_SIZE_8>;
+
+ public:
+  static constexpr unsigned int value =
+      (bucket_size<NEIGHBORHOOD_SIZE_64> == MIN_BUCKET_SIZE)
+          ? NEIGHBORHOOD_SIZE_64
+      : (bucket_size<NEIGHBORHOOD_SIZE_32> == MIN_BUCKET_SIZE)
+          ? NEIGHBORHOOD_SIZE_32
+      : (bucket_size<NEIGHBORHOOD_SIZE_16> == MIN_BUCKET_SIZE)
+          ? NEIGHBORHOOD_SIZE_16
+          : NEIGHBORHOOD_SIZE_8;
+};
+
+}  // namespace hh
+
 }  // end namespace tsl
 
 #endif
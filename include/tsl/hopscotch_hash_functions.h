@@ -0,0 +1,610 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_HOPSCOTCH_HASH_FUNCTIONS_H
+#define TSL_HOPSCOTCH_HASH_FUNCTIONS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * Same detection as in hopscotch_hash.h, the long inputs of hash_bytes are
+ * hashed with SSE2 or AVX2 when the compiler targets them. Define
+ * TSL_HH_NO_SIMD to always use the scalar code. The result is the same with
+ * or without SIMD.
+ */
+#if !defined(TSL_HH_NO_SIMD) && defined(__AVX2__)
+#define TSL_HH_AVX2
+#include <immintrin.h>
+#elif !defined(TSL_HH_NO_SIMD) &&             \
+    (defined(__SSE2__) || defined(_M_X64) || \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define TSL_HH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace tsl {
+namespace detail_hash_functions {
+
+static constexpr std::uint64_t SECRET0 = UINT64_C(0xa0761d6478bd642f);
+static constexpr std::uint64_t SECRET1 = UINT64_C(0xe7037ed1a0b428db);
+static constexpr std::uint64_t SECRET2 = UINT64_C(0x8ebc6af09c88c6e3);
+static constexpr std::uint64_t SECRET3 = UINT64_C(0x589965cc75374cc3);
+static constexpr std::uint64_t GOLDEN_RATIO = UINT64_C(0x9e3779b97f4a7c15);
+static constexpr std::uint64_t PRIME32 = UINT64_C(0x9e3779b1);
+
+/**
+ * Multiply a and b, put the low 64 bits of the 128-bit product in a and the
+ * high 64 bits in b.
+ */
+inline void multiply_128(std::uint64_t& a, std::uint64_t& b) noexcept {
+#if defined(__SIZEOF_INT128__)
+  __extension__ typedef unsigned __int128 uint128;
+
+  const uint128 product = static_cast<uint128>(a) * b;
+  a = static_cast<std::uint64_t>(product);
+  b = static_cast<std::uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  a = _umul128(a, b, &b);
+#else
+  const std::uint64_t a_hi = a >> 32;
+  const std::uint64_t a_lo = a & 0xffffffff;
+  const std::uint64_t b_hi = b >> 32;
+  const std::uint64_t b_lo = b & 0xffffffff;
+
+  const std::uint64_t hi_hi = a_hi * b_hi;
+  const std::uint64_t hi_lo = a_hi * b_lo;
+  const std::uint64_t lo_hi = a_lo * b_hi;
+  const std::uint64_t lo_lo = a_lo * b_lo;
+
+  const std::uint64_t middle = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+  a = (middle << 32) | (lo_lo & 0xffffffff);
+  b = hi_hi + (hi_lo >> 32) + (middle >> 32);
+#endif
+}
+
+/**
+ * Fold the 128-bit product of a and b into 64 bits. Each bit of the result
+ * depends on all the bits of a and b as long as none of them is 0.
+ */
+inline std::uint64_t mix(std::uint64_t a, std::uint64_t b) noexcept {
+  multiply_128(a, b);
+  return a ^ b;
+}
+
+/**
+ * Mix a 64-bit integer with two 128-bit multiplications. Each bit of the input
+ * flips each bit of the result with a probability close to 1/2. The
+ * multiplier must not be 0.
+ */
+inline std::uint64_t mix_integer(std::uint64_t value, std::uint64_t seed,
+                                 std::uint64_t multiplier) noexcept {
+  std::uint64_t a = value ^ seed ^ SECRET0;
+  std::uint64_t b = multiplier;
+  multiply_128(a, b);
+
+  return mix(a ^ SECRET0, b ^ SECRET1);
+}
+
+inline std::uint64_t read_64(const unsigned char* p) noexcept {
+  std::uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline std::uint64_t read_32(const unsigned char* p) noexcept {
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+/**
+ * Read 1 to 3 bytes in one value. The first, middle and last bytes overlap
+ * when len < 3.
+ */
+inline std::uint64_t read_small(const unsigned char* p,
+                                std::size_t len) noexcept {
+  return (std::uint64_t(p[0]) << 16) | (std::uint64_t(p[len >> 1]) << 8) |
+         p[len - 1];
+}
+
+/**
+ * Long inputs are cut in stripes of STRIPE_SIZE bytes, each stripe is
+ * accumulated in 8 independent 64-bit lanes with a 32x32->64 bits
+ * multiplication per lane. The lanes are scrambled after each block of
+ * NB_STRIPES_PER_BLOCK stripes so that the order of the blocks matters.
+ *
+ * The stripe 's' of a block uses the keys [s, s + 8) of the secret, the
+ * scrambling and the last stripe use the keys [NB_STRIPES_PER_BLOCK,
+ * NB_STRIPES_PER_BLOCK + 8).
+ */
+static constexpr std::size_t NB_LANES = 8;
+static constexpr std::size_t STRIPE_SIZE = NB_LANES * sizeof(std::uint64_t);
+static constexpr std::size_t NB_STRIPES_PER_BLOCK = 16;
+static constexpr std::size_t BLOCK_SIZE = STRIPE_SIZE * NB_STRIPES_PER_BLOCK;
+static constexpr std::size_t NB_KEYS = NB_STRIPES_PER_BLOCK + NB_LANES;
+
+/**
+ * Inputs longer than LONG_INPUT_MIN_SIZE bytes are hashed by stripes.
+ */
+static constexpr std::size_t LONG_INPUT_MIN_SIZE = 256;
+
+/**
+ * NB_KEYS keys followed by the NB_LANES initial values of the lanes, generated
+ * with splitmix64.
+ */
+constexpr std::array<std::uint64_t, NB_KEYS + NB_LANES> make_long_secret() {
+  std::array<std::uint64_t, NB_KEYS + NB_LANES> secret{};
+
+  std::uint64_t state = SECRET0;
+  for (std::size_t i = 0; i < secret.size(); i++) {
+    state += GOLDEN_RATIO;
+
+    std::uint64_t value = state;
+    value = (value ^ (value >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    value = (value ^ (value >> 27)) * UINT64_C(0x94d049bb133111eb);
+    secret[i] = value ^ (value >> 31);
+  }
+
+  return secret;
+}
+
+inline constexpr std::array<std::uint64_t, NB_KEYS + NB_LANES> LONG_SECRET =
+    make_long_secret();
+
+class long_hash_scalar {
+ public:
+  explicit long_hash_scalar(const std::uint64_t* init) noexcept {
+    for (std::size_t i = 0; i < NB_LANES; i++) {
+      m_acc[i] = init[i];
+    }
+  }
+
+  void accumulate(const unsigned char* stripe,
+                  const std::uint64_t* keys) noexcept {
+    for (std::size_t i = 0; i < NB_LANES; i++) {
+      const std::uint64_t data = read_64(stripe + i * sizeof(std::uint64_t));
+      const std::uint64_t data_key = data ^ keys[i];
+
+      m_acc[i ^ 1] += data;
+      m_acc[i] += (data_key & 0xffffffff) * (data_key >> 32);
+    }
+  }
+
+  void scramble(const std::uint64_t* keys) noexcept {
+    for (std::size_t i = 0; i < NB_LANES; i++) {
+      m_acc[i] = (m_acc[i] ^ (m_acc[i] >> 47) ^ keys[i]) * PRIME32;
+    }
+  }
+
+  void store(std::uint64_t* acc) const noexcept {
+    for (std::size_t i = 0; i < NB_LANES; i++) {
+      acc[i] = m_acc[i];
+    }
+  }
+
+ private:
+  std::uint64_t m_acc[NB_LANES];
+};
+
+#if defined(TSL_HH_AVX2)
+class long_hash_avx2 {
+ public:
+  explicit long_hash_avx2(const std::uint64_t* init) noexcept {
+    for (std::size_t i = 0; i < NB_REGISTERS; i++) {
+      m_acc[i] =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(init) + i);
+    }
+  }
+
+  void accumulate(const unsigned char* stripe,
+                  const std::uint64_t* keys) noexcept {
+    for (std::size_t i = 0; i < NB_REGISTERS; i++) {
+      const __m256i data =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(stripe) + i);
+      const __m256i data_key = _mm256_xor_si256(
+          data,
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys) + i));
+
+      const __m256i product = _mm256_mul_epu32(
+          data_key, _mm256_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1)));
+      const __m256i swapped_data =
+          _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+
+      m_acc[i] =
+          _mm256_add_epi64(m_acc[i], _mm256_add_epi64(product, swapped_data));
+    }
+  }
+
+  void scramble(const std::uint64_t* keys) noexcept {
+    const __m256i prime = _mm256_set1_epi32(int(PRIME32));
+
+    for (std::size_t i = 0; i < NB_REGISTERS; i++) {
+      __m256i acc = _mm256_xor_si256(m_acc[i], _mm256_srli_epi64(m_acc[i], 47));
+      acc = _mm256_xor_si256(
+          acc, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys) + i));
+
+      const __m256i product_lo = _mm256_mul_epu32(acc, prime);
+      const __m256i product_hi =
+          _mm256_mul_epu32(_mm256_srli_epi64(acc, 32), prime);
+      m_acc[i] =
+          _mm256_add_epi64(product_lo, _mm256_slli_epi64(product_hi, 32));
+    }
+  }
+
+  void store(std::uint64_t* acc) const noexcept {
+    for (std::size_t i = 0; i < NB_REGISTERS; i++) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc) + i, m_acc[i]);
+    }
+  }
+
+ private:
+  static constexpr std::size_t NB_REGISTERS = NB_LANES / 4;
+
+  __m256i m_acc[NB_REGISTERS];
+};
+
+using long_hash_simd = long_hash_avx2;
+#elif defined(TSL_HH_SSE2)
+class long_hash_sse2 {
+ public:
+  explicit long_hash_sse2(const std::uint64_t* init) noexcept {
+    for (std::size_t i = 0; i < NB_REGISTERS; i++) {
+      m_acc[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(init) + i);
+    }
+  }
+
+  void accumulate(const unsigned char* stripe,
+                  const std::uint64_t* keys) noexcept {
+    for (std::size_t i = 0; i < NB_REGISTERS; i++) {
+      const __m128i data =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(stripe) + i);
+      const __m128i data_key = _mm_xor_si128(
+          data, _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys) + i));
+
+      const __m128i product = _mm_mul_epu32(
+          data_key, _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1)));
+      const __m128i swapped_data =
+          _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+
+      m_acc[i] = _mm_add_epi64(m_acc[i], _mm_add_epi64(product, swapped_data));
+    }
+  }
+
+  void scramble(const std::uint64_t* keys) noexcept {
+    const __m128i prime = _mm_set1_epi32(int(PRIME32));
+
+    for (std::size_t i = 0; i < NB_REGISTERS; i++) {
+      __m128i acc = _mm_xor_si128(m_acc[i], _mm_srli_epi64(m_acc[i], 47));
+      acc = _mm_xor_si128(
+          acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys) + i));
+
+      const __m128i product_lo = _mm_mul_epu32(acc, prime);
+      const __m128i product_hi = _mm_mul_epu32(_mm_srli_epi64(acc, 32), prime);
+      m_acc[i] = _mm_add_epi64(product_lo, _mm_slli_epi64(product_hi, 32));
+    }
+  }
+
+  void store(std::uint64_t* acc) const noexcept {
+    for (std::size_t i = 0; i < NB_REGISTERS; i++) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(acc) + i, m_acc[i]);
+    }
+  }
+
+ private:
+  static constexpr std::size_t NB_REGISTERS = NB_LANES / 2;
+
+  __m128i m_acc[NB_REGISTERS];
+};
+
+using long_hash_simd = long_hash_sse2;
+#else
+using long_hash_simd = long_hash_scalar;
+#endif
+
+/**
+ * Hash an input of more than LONG_INPUT_MIN_SIZE bytes by stripes with
+ * LongHash, one of long_hash_scalar, long_hash_sse2 or long_hash_avx2. They
+ * all give the same result.
+ */
+template <class LongHash>
+std::uint64_t hash_long(const unsigned char* p, std::size_t len,
+                        std::uint64_t seed) noexcept {
+  static_assert(LONG_INPUT_MIN_SIZE >= STRIPE_SIZE, "");
+
+  std::uint64_t keys[NB_KEYS];
+  for (std::size_t i = 0; i < NB_KEYS; i++) {
+    keys[i] = LONG_SECRET[i] ^ seed;
+  }
+
+  LongHash long_hash(LONG_SECRET.data() + NB_KEYS);
+
+  // The last stripe is always hashed separately, even if it's a full one.
+  const std::size_t nb_blocks = (len - 1) / BLOCK_SIZE;
+  for (std::size_t iblock = 0; iblock < nb_blocks; iblock++) {
+    const unsigned char* block = p + iblock * BLOCK_SIZE;
+    for (std::size_t istripe = 0; istripe < NB_STRIPES_PER_BLOCK; istripe++) {
+      long_hash.accumulate(block + istripe * STRIPE_SIZE, keys + istripe);
+    }
+
+    long_hash.scramble(keys + NB_STRIPES_PER_BLOCK);
+  }
+
+  const unsigned char* last_block = p + nb_blocks * BLOCK_SIZE;
+  const std::size_t nb_stripes = ((len - 1) % BLOCK_SIZE) / STRIPE_SIZE;
+  for (std::size_t istripe = 0; istripe < nb_stripes; istripe++) {
+    long_hash.accumulate(last_block + istripe * STRIPE_SIZE, keys + istripe);
+  }
+  long_hash.accumulate(p + len - STRIPE_SIZE, keys + NB_STRIPES_PER_BLOCK);
+
+  std::uint64_t acc[NB_LANES];
+  long_hash.store(acc);
+
+  std::uint64_t result = len * GOLDEN_RATIO;
+  result += mix(acc[0] ^ SECRET0, acc[1] ^ SECRET1);
+  result += mix(acc[2] ^ SECRET2, acc[3] ^ SECRET3);
+  result += mix(acc[4] ^ SECRET1, acc[5] ^ SECRET2);
+  result += mix(acc[6] ^ SECRET3, acc[7] ^ SECRET0);
+
+  return mix(result ^ SECRET0, SECRET1);
+}
+
+template <class T>
+struct is_string : std::false_type {};
+
+template <class CharT, class Traits, class Allocator>
+struct is_string<std::basic_string<CharT, Traits, Allocator>>
+    : std::true_type {};
+
+template <class CharT, class Traits>
+struct is_string<std::basic_string_view<CharT, Traits>> : std::true_type {};
+
+template <bool IsTransparent>
+struct hash_transparency {};
+
+template <>
+struct hash_transparency<true> {
+  using is_transparent = void;
+};
+
+}  // namespace detail_hash_functions
+
+namespace hh {
+
+/**
+ * Hash the len bytes at data. The 64-bit result has all its bits of good
+ * quality, it can be used with a mask (see power_of_two_growth_policy).
+ *
+ * Inputs up to 256 bytes are hashed like wyhash, with three independent lanes
+ * above 48 bytes. Longer inputs are hashed by stripes of 64 bytes in eight
+ * lanes, vectorized with SSE2 or AVX2 when available.
+ *
+ * The result may differ between platforms of different endianness.
+ */
+inline std::uint64_t hash_bytes(const void* data, std::size_t len,
+                                std::uint64_t seed = 0) noexcept {
+  namespace detail = detail_hash_functions;
+
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  if (len > detail::LONG_INPUT_MIN_SIZE) {
+    return detail::hash_long<detail::long_hash_simd>(p, len, seed);
+  }
+
+  seed ^= detail::mix(seed ^ detail::SECRET0, detail::SECRET1);
+
+  std::uint64_t a;
+  std::uint64_t b;
+  if (len <= 16) {
+    if (len >= 4) {
+      const std::size_t shift = (len >> 3) << 2;
+      a = (detail::read_32(p) << 32) | detail::read_32(p + shift);
+      b = (detail::read_32(p + len - 4) << 32) |
+          detail::read_32(p + len - 4 - shift);
+    } else if (len > 0) {
+      a = detail::read_small(p, len);
+      b = 0;
+    } else {
+      a = 0;
+      b = 0;
+    }
+  } else {
+    std::size_t remaining = len;
+    if (remaining > 48) {
+      std::uint64_t seed1 = seed;
+      std::uint64_t seed2 = seed;
+      do {
+        seed = detail::mix(detail::read_64(p) ^ detail::SECRET1,
+                           detail::read_64(p + 8) ^ seed);
+        seed1 = detail::mix(detail::read_64(p + 16) ^ detail::SECRET2,
+                            detail::read_64(p + 24) ^ seed1);
+        seed2 = detail::mix(detail::read_64(p + 32) ^ detail::SECRET3,
+                            detail::read_64(p + 40) ^ seed2);
+        p += 48;
+        remaining -= 48;
+      } while (remaining > 48);
+
+      seed ^= seed1 ^ seed2;
+    }
+
+    while (remaining > 16) {
+      seed = detail::mix(detail::read_64(p) ^ detail::SECRET1,
+                         detail::read_64(p + 8) ^ seed);
+      p += 16;
+      remaining -= 16;
+    }
+
+    a = detail::read_64(p + remaining - 16);
+    b = detail::read_64(p + remaining - 8);
+  }
+
+  a ^= detail::SECRET1;
+  b ^= seed;
+  detail::multiply_128(a, b);
+
+  return detail::mix(a ^ detail::SECRET0 ^ len, b ^ detail::SECRET1);
+}
+
+/**
+ * Trait telling if Hash declares an 'is_avalanching' member type, promising
+ * that each bit of its result depends on every bit of the key. Such a hash
+ * can be used with power_of_two_growth_policy even if the keys only differ in
+ * their high bits, without any extra mixing.
+ */
+template <class Hash, class = void>
+struct is_avalanching : std::false_type {};
+
+template <class Hash>
+struct is_avalanching<Hash, std::void_t<typename Hash::is_avalanching>>
+    : std::true_type {};
+
+}  // namespace hh
+
+namespace detail_hash_functions {
+
+/**
+ * Hash a key with a seed and a multiplier. Integers, enums and pointers are
+ * mixed with mix_integer, strings are hashed with hash_bytes and the result of
+ * std::hash is mixed with mix_integer for the other types.
+ */
+template <class T, class Enable = void>
+struct hash_impl {
+  using argument_type = const T&;
+
+  static std::uint64_t hash(argument_type key, std::uint64_t seed,
+                            std::uint64_t multiplier) noexcept(
+      noexcept(std::hash<T>()(key))) {
+    return mix_integer(std::uint64_t(std::hash<T>()(key)), seed, multiplier);
+  }
+};
+
+template <class T>
+struct hash_impl<T, typename std::enable_if<std::is_integral<T>::value ||
+                                            std::is_enum<T>::value ||
+                                            std::is_pointer<T>::value>::type> {
+  using argument_type = T;
+
+  static std::uint64_t hash(argument_type key, std::uint64_t seed,
+                            std::uint64_t multiplier) noexcept {
+    if constexpr (std::is_pointer<T>::value) {
+      return mix_integer(std::uint64_t(reinterpret_cast<std::uintptr_t>(key)),
+                         seed, multiplier);
+    } else {
+      return mix_integer(static_cast<std::uint64_t>(key), seed, multiplier);
+    }
+  }
+};
+
+template <class T>
+struct hash_impl<T, typename std::enable_if<is_string<T>::value>::type> {
+  using argument_type = std::basic_string_view<typename T::value_type,
+                                               typename T::traits_type>;
+
+  static std::uint64_t hash(argument_type key, std::uint64_t seed,
+                            std::uint64_t /*multiplier*/) noexcept {
+    return hh::hash_bytes(key.data(),
+                          key.size() * sizeof(typename T::value_type), seed);
+  }
+};
+
+}  // namespace detail_hash_functions
+
+namespace hh {
+
+/**
+ * Fast hash function with good quality in all the bits of its result, usable
+ * in place of std::hash<T>. It declares 'is_avalanching'.
+ *
+ * - Integers, enums and pointers are mixed with two 128-bit multiplications,
+ *   each bit of the key affects all the bits of the result.
+ * - std::basic_string and std::basic_string_view are hashed with hash_bytes.
+ *   The hash is transparent, a std::string key can be looked up with a
+ *   std::string_view or a const char* if KeyEqual is transparent too (e.g.
+ *   std::equal_to<>).
+ * - The result of std::hash<T> is mixed like an integer for the other types.
+ *
+ * The hash doesn't change between runs, use seeded_hash with a random seed if
+ * the keys may come from an attacker.
+ */
+template <class T>
+class hash : public detail_hash_functions::hash_transparency<
+                 detail_hash_functions::is_string<T>::value> {
+ private:
+  using impl = detail_hash_functions::hash_impl<T>;
+
+ public:
+  using is_avalanching = void;
+
+  std::size_t operator()(typename impl::argument_type key) const
+      noexcept(noexcept(impl::hash(key, 0, 0))) {
+    return static_cast<std::size_t>(
+        impl::hash(key, 0, detail_hash_functions::GOLDEN_RATIO));
+  }
+};
+
+/**
+ * Same as tsl::hh::hash but the result also depends on a seed given on
+ * construction. With a seed chosen randomly at runtime, the hash of a key
+ * can't be predicted in advance.
+ */
+template <class T>
+class seeded_hash : public detail_hash_functions::hash_transparency<
+                        detail_hash_functions::is_string<T>::value> {
+ private:
+  using impl = detail_hash_functions::hash_impl<T>;
+
+ public:
+  using is_avalanching = void;
+
+  explicit seeded_hash(std::uint64_t seed = 0) noexcept
+      : m_seed(seed),
+        m_multiplier(detail_hash_functions::mix(
+                         seed ^ detail_hash_functions::SECRET0,
+                         detail_hash_functions::SECRET1) |
+                     1) {}
+
+  std::size_t operator()(typename impl::argument_type key) const
+      noexcept(noexcept(impl::hash(key, 0, 0))) {
+    return static_cast<std::size_t>(impl::hash(key, m_seed, m_multiplier));
+  }
+
+  std::uint64_t seed() const noexcept { return m_seed; }
+
+ private:
+  std::uint64_t m_seed;
+  std::uint64_t m_multiplier;
+};
+
+}  // namespace hh
+}  // namespace tsl
+
+#endif
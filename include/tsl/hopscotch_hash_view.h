@@ -0,0 +1,332 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_HOPSCOTCH_HASH_VIEW_H
+#define TSL_HOPSCOTCH_HASH_VIEW_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "hopscotch_hash.h"
+#include "hopscotch_mapped_file.h"
+
+namespace tsl {
+namespace detail_hopscotch_hash {
+
+/**
+ * Internal common class used by hopscotch_map_view and hopscotch_set_view.
+ *
+ * Read-only view over a table written by hopscotch_hash::flat_serialize with
+ * the same ValueType, NeighborhoodSize, StoreHash and GrowthPolicy. The
+ * buckets and the overflow values are read in place, a lookup uses the same
+ * bucket_for_hash and neighborhood search as hopscotch_hash.
+ *
+ * The view doesn't allocate. It either refers to memory owned by the caller,
+ * which must outlive the view, or owns a tsl::hh::mapped_file. The content is
+ * trusted, only the header is checked.
+ */
+template <class ValueType, class KeySelect, class ValueSelect, class Hash,
+          class KeyEqual, unsigned int NeighborhoodSize, bool StoreHash,
+          class GrowthPolicy>
+class hopscotch_hash_view : private Hash,
+                            private KeyEqual,
+                            private GrowthPolicy {
+ public:
+  using key_type = typename KeySelect::key_type;
+  using value_type = ValueType;
+  using size_type = std::size_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+
+ private:
+  using hopscotch_bucket =
+      tsl::detail_hopscotch_hash::hopscotch_bucket<ValueType, NeighborhoodSize,
+                                                   StoreHash>;
+
+ public:
+  /**
+   * View the flat table of size bytes at data. data must be aligned for the
+   * buckets and the values, a mapped file always is.
+   *
+   * Throw std::runtime_error if the header doesn't match the types of the
+   * view or if size is too small for the table it describes.
+   */
+  hopscotch_hash_view(const void* data, std::size_t size, const Hash& hash,
+                      const KeyEqual& equal)
+      : Hash(hash),
+        KeyEqual(equal),
+        GrowthPolicy(checked_growth_policy(data, size)),
+        m_buckets(nullptr),
+        m_overflow_elements(nullptr),
+        m_overflow_index(nullptr),
+        m_bucket_count(0),
+        m_nb_elements(0),
+        m_nb_overflow_elements(0) {
+    const flat_header& header = *static_cast<const flat_header*>(data);
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+    if (header.nb_buckets > 0) {
+      m_buckets = std::launder(reinterpret_cast<const hopscotch_bucket*>(
+          bytes + header.buckets_offset));
+    }
+    if (header.nb_overflow_elements > 0) {
+      m_overflow_elements = std::launder(reinterpret_cast<const value_type*>(
+          bytes + header.overflow_offset));
+      m_overflow_index =
+          std::launder(reinterpret_cast<const flat_overflow_entry*>(
+              bytes + header.overflow_index_offset));
+    }
+
+    m_bucket_count = std::size_t(header.bucket_count);
+    m_nb_elements = std::size_t(header.nb_elements);
+    m_nb_overflow_elements = std::size_t(header.nb_overflow_elements);
+  }
+
+  hopscotch_hash_view(tsl::hh::mapped_file file, const Hash& hash,
+                      const KeyEqual& equal)
+      : hopscotch_hash_view(file.data(), file.size(), hash, equal) {
+    m_file = std::move(file);
+  }
+
+  hopscotch_hash_view(hopscotch_hash_view&& other) = default;
+  hopscotch_hash_view& operator=(hopscotch_hash_view&& other) = default;
+
+  /*
+   * Capacity
+   */
+  bool empty() const noexcept { return m_nb_elements == 0; }
+  size_type size() const noexcept { return m_nb_elements; }
+
+  /*
+   * Lookup
+   */
+  template <class K>
+  const value_type* find(const K& key) const {
+    return find(key, Hash::operator()(key));
+  }
+
+  /**
+   * The hash is the one of hash_function(), mixed here like in hopscotch_hash
+   * if needed (see needs_hash_mixing).
+   */
+  template <class K>
+  const value_type* find(const K& key, std::size_t hash) const {
+    if (m_buckets == nullptr) {
+      return nullptr;
+    }
+
+    if constexpr (needs_hash_mixing<Hash, GrowthPolicy>::value) {
+      hash = mix_hash_bits(hash);
+    }
+
+    const hopscotch_bucket* bucket_for_hash =
+        m_buckets + GrowthPolicy::bucket_for_hash(hash);
+    const hopscotch_bucket* bucket_found = find_in_neighborhood<StoreHash>(
+        bucket_for_hash, hash, [&](const value_type& value) {
+          return compare_keys(KeySelect()(value), key);
+        });
+    if (bucket_found != nullptr) {
+      return std::addressof(bucket_found->value());
+    }
+
+    if (!bucket_for_hash->has_overflow()) {
+      return nullptr;
+    }
+
+    // The overflow values are grouped by home bucket, find the first one of
+    // the bucket and compare the kept hashes before the keys.
+    const std::uint64_t ibucket = std::uint64_t(bucket_for_hash - m_buckets);
+    const flat_overflow_entry* const index_end =
+        m_overflow_index + m_nb_overflow_elements;
+    for (const flat_overflow_entry* entry = std::lower_bound(
+             m_overflow_index, index_end, ibucket,
+             [](const flat_overflow_entry& e, std::uint64_t ib) {
+               return e.ibucket < ib;
+             });
+         entry != index_end && entry->ibucket == ibucket; ++entry) {
+      const value_type* value =
+          m_overflow_elements + (entry - m_overflow_index);
+      if (entry->hash == hash && compare_keys(KeySelect()(*value), key)) {
+        return value;
+      }
+    }
+
+    return nullptr;
+  }
+
+  template <class K>
+  size_type count(const K& key) const {
+    return (find(key) != nullptr) ? 1 : 0;
+  }
+
+  template <class K>
+  bool contains(const K& key) const {
+    return find(key) != nullptr;
+  }
+
+  template <class K, class U = ValueSelect,
+            typename std::enable_if<!std::is_same<U, void>::value>::type* =
+                nullptr>
+  const typename U::value_type& at(const K& key) const {
+    const value_type* value = find(key);
+    if (value == nullptr) {
+      TSL_HH_THROW_OR_TERMINATE(std::out_of_range, "Couldn't find key.");
+    }
+
+    return U()(*value);
+  }
+
+  /**
+   * Call f(const value_type&) on each value of the table.
+   */
+  template <class F>
+  void for_each(F f) const {
+    if (m_buckets != nullptr) {
+      const std::size_t nb_buckets = m_bucket_count + NeighborhoodSize - 1;
+      for (std::size_t ibucket = 0; ibucket < nb_buckets; ibucket++) {
+        if (!m_buckets[ibucket].empty()) {
+          f(m_buckets[ibucket].value());
+        }
+      }
+    }
+
+    for (std::size_t i = 0; i < m_nb_overflow_elements; i++) {
+      f(m_overflow_elements[i]);
+    }
+  }
+
+  /*
+   * Bucket interface
+   */
+  size_type bucket_count() const noexcept { return m_bucket_count; }
+
+  /*
+   * Hash policy
+   */
+  float load_factor() const noexcept {
+    if (m_bucket_count == 0) {
+      return 0;
+    }
+
+    return float(m_nb_elements) / float(m_bucket_count);
+  }
+
+  /*
+   * Observers
+   */
+  hasher hash_function() const { return static_cast<const Hash&>(*this); }
+  key_equal key_eq() const { return static_cast<const KeyEqual&>(*this); }
+
+ private:
+  template <class K1, class K2>
+  bool compare_keys(const K1& key1, const K2& key2) const {
+    return KeyEqual::operator()(key1, key2);
+  }
+
+  /**
+   * Check that the flat table at data matches the view and return the
+   * GrowthPolicy for its bucket count.
+   */
+  static GrowthPolicy checked_growth_policy(const void* data,
+                                            std::size_t size) {
+    if (data == nullptr || size < sizeof(flat_header) ||
+        reinterpret_cast<std::uintptr_t>(data) % alignof(hopscotch_bucket) !=
+            0 ||
+        reinterpret_cast<std::uintptr_t>(data) % alignof(value_type) != 0 ||
+        reinterpret_cast<std::uintptr_t>(data) % alignof(flat_overflow_entry) !=
+            0) {
+      TSL_HH_THROW_OR_TERMINATE(std::runtime_error,
+                                "The flat table is too small or misaligned.");
+    }
+
+    const flat_header& header = *static_cast<const flat_header*>(data);
+    if (header.magic != FLAT_MAGIC || header.version != FLAT_VERSION) {
+      TSL_HH_THROW_OR_TERMINATE(
+          std::runtime_error,
+          "The flat table has an invalid magic number or version.");
+    }
+
+    if (header.bucket_size != sizeof(hopscotch_bucket) ||
+        header.bucket_alignment != alignof(hopscotch_bucket) ||
+        header.key_size != sizeof(key_type) ||
+        header.value_size != sizeof(value_type) ||
+        header.neighborhood_size != NeighborhoodSize ||
+        header.store_hash != StoreHash) {
+      TSL_HH_THROW_OR_TERMINATE(
+          std::runtime_error,
+          "The layout of the flat table doesn't match the view.");
+    }
+
+    const std::uint64_t expected_nb_buckets =
+        (header.bucket_count == 0)
+            ? 0
+            : header.bucket_count + NeighborhoodSize - 1;
+    if (header.nb_buckets != expected_nb_buckets ||
+        header.buckets_offset % FLAT_ALIGNMENT != 0 ||
+        header.overflow_offset % FLAT_ALIGNMENT != 0 ||
+        header.overflow_index_offset % FLAT_ALIGNMENT != 0 ||
+        header.buckets_offset < sizeof(flat_header) ||
+        header.overflow_offset <
+            header.buckets_offset +
+                header.nb_buckets * sizeof(hopscotch_bucket) ||
+        header.overflow_index_offset <
+            header.overflow_offset +
+                header.nb_overflow_elements * sizeof(value_type) ||
+        header.size != header.overflow_index_offset +
+                           header.nb_overflow_elements *
+                               sizeof(flat_overflow_entry) ||
+        header.size > size) {
+      TSL_HH_THROW_OR_TERMINATE(std::runtime_error,
+                                "The flat table is truncated or corrupted.");
+    }
+
+    std::size_t bucket_count = std::size_t(header.bucket_count);
+    GrowthPolicy growth_policy(bucket_count);
+    if (bucket_count != header.bucket_count) {
+      TSL_HH_THROW_OR_TERMINATE(
+          std::runtime_error,
+          "The bucket count of the flat table doesn't match the GrowthPolicy.");
+    }
+
+    return growth_policy;
+  }
+
+ private:
+  const hopscotch_bucket* m_buckets;
+  const value_type* m_overflow_elements;
+  const flat_overflow_entry* m_overflow_index;
+  std::size_t m_bucket_count;
+  std::size_t m_nb_elements;
+  std::size_t m_nb_overflow_elements;
+
+  tsl::hh::mapped_file m_file;
+};
+
+}  // end namespace detail_hopscotch_hash
+}  // end namespace tsl
+
+#endif
@@ -0,0 +1,320 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_HOPSCOTCH_HUGE_PAGE_ALLOCATOR_H
+#define TSL_HOPSCOTCH_HUGE_PAGE_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "hopscotch_growth_policy.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace tsl {
+namespace hh {
+
+/**
+ * Placement of the pages of the allocations of tsl::hh::huge_page_allocator
+ * on the NUMA nodes.
+ *
+ * - first_touch: the default policy of the system, a page is placed on the
+ *   node of the thread which touches it first. The buckets of a hash table are
+ *   initialized by the thread creating or rehashing the table.
+ * - interleave: the pages are spread round-robin over the nodes the process
+ *   is allowed to use, so that a table shared by the threads of all the nodes
+ *   gets the bandwidth of all the nodes. Ignored if the system doesn't support
+ *   it.
+ */
+enum class numa_policy { first_touch, interleave };
+
+namespace detail_huge_page_allocator {
+
+/**
+ * Size of a transparent huge page on x86-64 and of the smallest huge page on
+ * most other architectures. Allocations smaller than that don't go through
+ * mmap.
+ */
+static constexpr std::size_t TRANSPARENT_HUGE_PAGE_SIZE =
+    std::size_t(2) << 20;
+
+inline std::size_t round_up(std::size_t size, std::size_t alignment) noexcept {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+inline void interleave_pages(void* data, std::size_t size) noexcept {
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_get_mempolicy)
+  // Values of MPOL_F_MEMS_ALLOWED and MPOL_INTERLEAVE in <linux/mempolicy.h>,
+  // not included to avoid a dependency on the kernel headers or libnuma.
+  const int mpol_f_mems_allowed = 1 << 2;
+  const int mpol_interleave = 3;
+  const unsigned long max_nb_nodes = 1024;
+
+  unsigned long nodes_mask[max_nb_nodes / (8 * sizeof(unsigned long))] = {};
+  int mode = 0;
+  if (::syscall(SYS_get_mempolicy, &mode, nodes_mask, max_nb_nodes, nullptr,
+                mpol_f_mems_allowed) != 0) {
+    return;
+  }
+
+  // mbind reads one bit less than maxnode.
+  ::syscall(SYS_mbind, data, size, mpol_interleave, nodes_mask,
+            max_nb_nodes + 1, 0);
+#else
+  (void)data;
+  (void)size;
+#endif
+}
+
+/**
+ * Map size bytes, a multiple of TRANSPARENT_HUGE_PAGE_SIZE, with huge pages.
+ *
+ * Explicit huge pages of huge_page_size bytes (MAP_HUGETLB) are used if size
+ * is a multiple of huge_page_size and the system has enough of them reserved.
+ * Otherwise the mapping falls back to normal pages aligned on
+ * TRANSPARENT_HUGE_PAGE_SIZE with MADV_HUGEPAGE, which the kernel backs with
+ * transparent huge pages when it can. Return nullptr if nothing could be
+ * mapped.
+ */
+inline void* map_huge_pages(std::size_t size,
+                            std::size_t huge_page_size) noexcept {
+#ifdef __linux__
+#ifdef MAP_HUGETLB
+  if (size % huge_page_size == 0) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+    int log2_huge_page_size = 0;
+    while ((std::size_t(1) << log2_huge_page_size) < huge_page_size) {
+      log2_huge_page_size++;
+    }
+    flags |= log2_huge_page_size << MAP_HUGE_SHIFT;
+#endif
+
+    void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (data != MAP_FAILED) {
+      return data;
+    }
+  }
+#endif
+
+  // Over-map by one huge page and unmap what's around the aligned range.
+  const std::size_t mapped_size = size + TRANSPARENT_HUGE_PAGE_SIZE;
+  void* data = ::mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+
+  const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(data);
+  const std::uintptr_t aligned_begin =
+      round_up(begin, TRANSPARENT_HUGE_PAGE_SIZE);
+  if (aligned_begin != begin) {
+    ::munmap(data, aligned_begin - begin);
+  }
+
+  const std::uintptr_t end = begin + mapped_size;
+  const std::uintptr_t aligned_end = aligned_begin + size;
+  if (end != aligned_end) {
+    ::munmap(reinterpret_cast<void*>(aligned_end), end - aligned_end);
+  }
+
+  void* aligned_data = reinterpret_cast<void*>(aligned_begin);
+#ifdef MADV_HUGEPAGE
+  ::madvise(aligned_data, size, MADV_HUGEPAGE);
+#endif
+
+  return aligned_data;
+#else
+  (void)size;
+  (void)huge_page_size;
+  return nullptr;
+#endif
+}
+
+inline void unmap_huge_pages(void* data, std::size_t size) noexcept {
+#ifdef __linux__
+  ::munmap(data, size);
+#else
+  (void)data;
+  (void)size;
+#endif
+}
+
+}  // namespace detail_huge_page_allocator
+
+/**
+ * Stateless allocator backing the large allocations with huge pages to reduce
+ * the TLB misses of the random accesses in a large hash table, e.g.
+ *
+ * tsl::hopscotch_map<Key, T, Hash, KeyEqual,
+ *                    tsl::hh::huge_page_allocator<std::pair<Key, T>>>
+ *
+ * The allocator is rebound by the map for its bucket array, which is the
+ * allocation that matters. The allocations of at least 2 MiB are mapped with
+ * mmap: with explicit huge pages of HugePageSize bytes (2 MiB or 1 GiB on
+ * x86-64) if the allocation is at least that large and the system has enough
+ * of them reserved (see /proc/sys/vm/nr_hugepages), with transparent huge
+ * pages otherwise. An allocation using explicit huge pages is rounded up to a
+ * multiple of HugePageSize, the others to a multiple of 2 MiB. The pages are
+ * then placed on the NUMA nodes according to NumaPolicy.
+ *
+ * Smaller allocations, and all the allocations on systems other than Linux,
+ * go through std::allocator.
+ */
+template <class T,
+          std::size_t HugePageSize =
+              detail_huge_page_allocator::TRANSPARENT_HUGE_PAGE_SIZE,
+          numa_policy NumaPolicy = numa_policy::first_touch>
+class huge_page_allocator {
+  static_assert(
+      HugePageSize >= detail_huge_page_allocator::TRANSPARENT_HUGE_PAGE_SIZE &&
+          (HugePageSize & (HugePageSize - 1)) == 0,
+      "HugePageSize must be a power of two of at least 2 MiB.");
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using propagate_on_container_move_assignment = std::true_type;
+  using is_always_equal = std::true_type;
+
+  template <class U>
+  struct rebind {
+    using other = huge_page_allocator<U, HugePageSize, NumaPolicy>;
+  };
+
+  huge_page_allocator() noexcept = default;
+
+  template <class U>
+  huge_page_allocator(
+      const huge_page_allocator<U, HugePageSize, NumaPolicy>&) noexcept {}
+
+  T* allocate(size_type n) {
+    if (n > max_size()) {
+      throw_bad_alloc();
+    }
+
+    const std::size_t size = n * sizeof(T);
+    if (!uses_huge_pages(size)) {
+      return std::allocator<T>().allocate(n);
+    }
+
+    const std::size_t size_mapped = mapped_size(size);
+    void* data =
+        detail_huge_page_allocator::map_huge_pages(size_mapped, HugePageSize);
+    if (data == nullptr) {
+      throw_bad_alloc();
+    }
+
+    // The pages must be placed before they are touched.
+    if (NumaPolicy == numa_policy::interleave) {
+      detail_huge_page_allocator::interleave_pages(data, size_mapped);
+    }
+
+    return static_cast<T*>(data);
+  }
+
+  /**
+   * Same as allocate but the memory is zeroed. The memory of a new mapping is
+   * already zeroed by the system, only the smaller allocations are cleared.
+   * Used by the hash tables to allocate their buckets without constructing
+   * them one by one.
+   */
+  T* allocate_zeroed(size_type n) {
+    T* p = allocate(n);
+    if (!uses_huge_pages(n * sizeof(T))) {
+      std::memset(static_cast<void*>(p), 0, n * sizeof(T));
+    }
+
+    return p;
+  }
+
+  void deallocate(T* p, size_type n) noexcept {
+    const std::size_t size = n * sizeof(T);
+    if (!uses_huge_pages(size)) {
+      std::allocator<T>().deallocate(p, n);
+    } else {
+      detail_huge_page_allocator::unmap_huge_pages(p, mapped_size(size));
+    }
+  }
+
+  size_type max_size() const noexcept {
+    return (std::numeric_limits<size_type>::max() - HugePageSize) / sizeof(T);
+  }
+
+  /**
+   * True if an allocation of size bytes is mapped with huge pages instead of
+   * going through std::allocator.
+   */
+  static constexpr bool uses_huge_pages(std::size_t size) noexcept {
+#ifdef __linux__
+    return size >= detail_huge_page_allocator::TRANSPARENT_HUGE_PAGE_SIZE;
+#else
+    (void)size;
+    return false;
+#endif
+  }
+
+ private:
+  static std::size_t mapped_size(std::size_t size) noexcept {
+    return detail_huge_page_allocator::round_up(
+        size, (size >= HugePageSize)
+                  ? HugePageSize
+                  : detail_huge_page_allocator::TRANSPARENT_HUGE_PAGE_SIZE);
+  }
+
+  [[noreturn]] static void throw_bad_alloc() {
+#ifdef TSL_HH_NO_EXCEPTIONS
+    std::terminate();
+#else
+    throw std::bad_alloc();
+#endif
+  }
+};
+
+template <class T, class U, std::size_t HugePageSize, numa_policy NumaPolicy>
+bool operator==(const huge_page_allocator<T, HugePageSize, NumaPolicy>&,
+                const huge_page_allocator<U, HugePageSize, NumaPolicy>&) {
+  return true;
+}
+
+template <class T, class U, std::size_t HugePageSize, numa_policy NumaPolicy>
+bool operator!=(const huge_page_allocator<T, HugePageSize, NumaPolicy>&,
+                const huge_page_allocator<U, HugePageSize, NumaPolicy>&) {
+  return false;
+}
+
+}  // namespace hh
+}  // namespace tsl
+
+#endif
@@ -0,0 +1,172 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_HOPSCOTCH_MAP_VIEW_H
+#define TSL_HOPSCOTCH_MAP_VIEW_H
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+#include "hopscotch_hash_view.h"
+#include "hopscotch_mapped_file.h"
+
+namespace tsl {
+
+/**
+ * Read-only view over a tsl::hopscotch_map written with
+ * hopscotch_map::flat_serialize, for example to a file mapped in memory with
+ * tsl::hh::mapped_file. The lookups read the buckets in place, there is no
+ * deserialization and no allocation.
+ *
+ * Key, T, NeighborhoodSize, StoreHash and GrowthPolicy must be the same as the
+ * ones of the serialized map, Hash and KeyEqual must give the same results.
+ * The layout is checked when the view is constructed, a std::runtime_error is
+ * thrown on mismatch. The file is not portable between platforms with a
+ * different byte order or different type layouts.
+ *
+ * There are no iterators, find returns a pointer to the key-value pair or
+ * nullptr.
+ */
+template <class Key, class T, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>,
+          unsigned int NeighborhoodSize = 62, bool StoreHash = false,
+          class GrowthPolicy = tsl::hh::power_of_two_growth_policy<2>>
+class hopscotch_map_view {
+ private:
+  class KeySelect {
+   public:
+    using key_type = Key;
+
+    const key_type& operator()(const std::pair<Key, T>& key_value) const {
+      return key_value.first;
+    }
+  };
+
+  class ValueSelect {
+   public:
+    using value_type = T;
+
+    const value_type& operator()(const std::pair<Key, T>& key_value) const {
+      return key_value.second;
+    }
+  };
+
+  using ht_view = detail_hopscotch_hash::hopscotch_hash_view<
+      std::pair<Key, T>, KeySelect, ValueSelect, Hash, KeyEqual,
+      NeighborhoodSize, StoreHash, GrowthPolicy>;
+
+ public:
+  using key_type = typename ht_view::key_type;
+  using mapped_type = T;
+  using value_type = typename ht_view::value_type;
+  using size_type = typename ht_view::size_type;
+  using hasher = typename ht_view::hasher;
+  using key_equal = typename ht_view::key_equal;
+
+  /*
+   * Constructors
+   */
+
+  /**
+   * View the flat map of size bytes at data, which must outlive the view.
+   * data must be aligned like the memory returned by operator new.
+   */
+  hopscotch_map_view(const void* data, std::size_t size,
+                     const Hash& hash = Hash(),
+                     const KeyEqual& equal = KeyEqual())
+      : m_ht_view(data, size, hash, equal) {}
+
+  /**
+   * View the flat map in file, the view owns the mapping.
+   */
+  explicit hopscotch_map_view(tsl::hh::mapped_file file,
+                              const Hash& hash = Hash(),
+                              const KeyEqual& equal = KeyEqual())
+      : m_ht_view(std::move(file), hash, equal) {}
+
+  /**
+   * Map the file at path and view the flat map it contains.
+   */
+  explicit hopscotch_map_view(const char* path, const Hash& hash = Hash(),
+                              const KeyEqual& equal = KeyEqual())
+      : m_ht_view(tsl::hh::mapped_file(path), hash, equal) {}
+
+  /*
+   * Capacity
+   */
+  bool empty() const noexcept { return m_ht_view.empty(); }
+  size_type size() const noexcept { return m_ht_view.size(); }
+
+  /*
+   * Lookup
+   */
+  const T& at(const Key& key) const { return m_ht_view.at(key); }
+
+  size_type count(const Key& key) const { return m_ht_view.count(key); }
+
+  const value_type* find(const Key& key) const { return m_ht_view.find(key); }
+
+  /**
+   * Use the hash value 'precalculated_hash' instead of hashing the key. The
+   * hash value should be the same as hash_function()(key). Useful to speed-up
+   * the lookup to the value if you already have the hash.
+   */
+  const value_type* find(const Key& key,
+                         std::size_t precalculated_hash) const {
+    return m_ht_view.find(key, precalculated_hash);
+  }
+
+  bool contains(const Key& key) const { return m_ht_view.contains(key); }
+
+  /**
+   * Call f(const value_type&) on each key-value pair.
+   */
+  template <class F>
+  void for_each(F f) const {
+    m_ht_view.for_each(f);
+  }
+
+  /*
+   * Bucket interface
+   */
+  size_type bucket_count() const { return m_ht_view.bucket_count(); }
+
+  /*
+   * Hash policy
+   */
+  float load_factor() const { return m_ht_view.load_factor(); }
+
+  /*
+   * Observers
+   */
+  hasher hash_function() const { return m_ht_view.hash_function(); }
+  key_equal key_eq() const { return m_ht_view.key_eq(); }
+
+ private:
+  ht_view m_ht_view;
+};
+
+}  // end namespace tsl
+
+#endif
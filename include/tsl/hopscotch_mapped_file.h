@@ -0,0 +1,242 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_HOPSCOTCH_MAPPED_FILE_H
+#define TSL_HOPSCOTCH_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "hopscotch_growth_policy.h"
+
+#ifdef _WIN32
+/*
+ * Declare the few Win32 functions used instead of including <windows.h> in a
+ * public header, which would define its macros (min, max, ...) in the user's
+ * code. The declarations are the same as in <windows.h>, both can be seen in a
+ * same translation unit. The HANDLE, DWORD, BOOL and SIZE_T types are written
+ * as their underlying types.
+ */
+struct _SECURITY_ATTRIBUTES;
+
+extern "C" {
+__declspec(dllimport) void* __stdcall CreateFileA(
+    const char* lpFileName, unsigned long dwDesiredAccess,
+    unsigned long dwShareMode, _SECURITY_ATTRIBUTES* lpSecurityAttributes,
+    unsigned long dwCreationDisposition, unsigned long dwFlagsAndAttributes,
+    void* hTemplateFile);
+__declspec(dllimport) unsigned long __stdcall GetFileSize(
+    void* hFile, unsigned long* lpFileSizeHigh);
+__declspec(dllimport) void* __stdcall CreateFileMappingA(
+    void* hFile, _SECURITY_ATTRIBUTES* lpFileMappingAttributes,
+    unsigned long flProtect, unsigned long dwMaximumSizeHigh,
+    unsigned long dwMaximumSizeLow, const char* lpName);
+#ifdef _WIN64
+__declspec(dllimport) void* __stdcall MapViewOfFile(
+    void* hFileMappingObject, unsigned long dwDesiredAccess,
+    unsigned long dwFileOffsetHigh, unsigned long dwFileOffsetLow,
+    unsigned __int64 dwNumberOfBytesToMap);
+#else
+__declspec(dllimport) void* __stdcall MapViewOfFile(
+    void* hFileMappingObject, unsigned long dwDesiredAccess,
+    unsigned long dwFileOffsetHigh, unsigned long dwFileOffsetLow,
+    unsigned long dwNumberOfBytesToMap);
+#endif
+__declspec(dllimport) int __stdcall UnmapViewOfFile(const void* lpBaseAddress);
+__declspec(dllimport) int __stdcall CloseHandle(void* hObject);
+__declspec(dllimport) unsigned long __stdcall GetLastError();
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tsl {
+namespace hh {
+
+/**
+ * Read-only memory mapping of a whole file, used by tsl::hopscotch_map_view
+ * and tsl::hopscotch_set_view to read a file written by flat_serialize in
+ * place. The mapping is released on destruction.
+ *
+ * The mapping starts on a page boundary, it is aligned enough for the flat
+ * format.
+ */
+class mapped_file {
+ public:
+  mapped_file() noexcept : m_data(nullptr), m_size(0) {}
+
+  /**
+   * Map the file at path. Throw std::runtime_error if the file can't be
+   * opened or mapped.
+   */
+  explicit mapped_file(const char* path) : mapped_file() { map(path); }
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  mapped_file(mapped_file&& other) noexcept
+      : m_data(other.m_data), m_size(other.m_size) {
+    other.m_data = nullptr;
+    other.m_size = 0;
+  }
+
+  mapped_file& operator=(mapped_file&& other) noexcept {
+    if (this != &other) {
+      unmap();
+      std::swap(m_data, other.m_data);
+      std::swap(m_size, other.m_size);
+    }
+
+    return *this;
+  }
+
+  ~mapped_file() { unmap(); }
+
+  const void* data() const noexcept { return m_data; }
+  std::size_t size() const noexcept { return m_size; }
+
+ private:
+#ifdef _WIN32
+  // Values of the <windows.h> constants used by map.
+  static constexpr unsigned long WIN_GENERIC_READ = 0x80000000UL;
+  static constexpr unsigned long WIN_FILE_SHARE_READ = 0x1;
+  static constexpr unsigned long WIN_OPEN_EXISTING = 3;
+  static constexpr unsigned long WIN_FILE_ATTRIBUTE_NORMAL = 0x80;
+  static constexpr unsigned long WIN_PAGE_READONLY = 0x2;
+  static constexpr unsigned long WIN_FILE_MAP_READ = 0x4;
+  static constexpr unsigned long WIN_INVALID_FILE_SIZE = 0xFFFFFFFFUL;
+  static constexpr unsigned long WIN_NO_ERROR = 0;
+
+  static void* win_invalid_handle_value() noexcept {
+    return reinterpret_cast<void*>(static_cast<std::intptr_t>(-1));
+  }
+
+  void map(const char* path) {
+    void* file = ::CreateFileA(path, WIN_GENERIC_READ, WIN_FILE_SHARE_READ,
+                               nullptr, WIN_OPEN_EXISTING,
+                               WIN_FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == win_invalid_handle_value()) {
+      TSL_HH_THROW_OR_TERMINATE(std::runtime_error, "Couldn't open the file.");
+    }
+
+    unsigned long size_high = 0;
+    const unsigned long size_low = ::GetFileSize(file, &size_high);
+    if (size_low == WIN_INVALID_FILE_SIZE && ::GetLastError() != WIN_NO_ERROR) {
+      ::CloseHandle(file);
+      TSL_HH_THROW_OR_TERMINATE(std::runtime_error,
+                                "Couldn't get the size of the file.");
+    }
+
+    const std::uint64_t file_size =
+        (std::uint64_t(size_high) << 32) | std::uint64_t(size_low);
+    if (file_size > std::numeric_limits<std::size_t>::max()) {
+      ::CloseHandle(file);
+      TSL_HH_THROW_OR_TERMINATE(std::runtime_error,
+                                "The file is too large to be mapped.");
+    }
+
+    if (file_size > 0) {
+      void* mapping = ::CreateFileMappingA(file, nullptr, WIN_PAGE_READONLY, 0,
+                                           0, nullptr);
+      void* data = (mapping == nullptr)
+                       ? nullptr
+                       : ::MapViewOfFile(mapping, WIN_FILE_MAP_READ, 0, 0, 0);
+      if (mapping != nullptr) {
+        ::CloseHandle(mapping);
+      }
+
+      if (data == nullptr) {
+        ::CloseHandle(file);
+        TSL_HH_THROW_OR_TERMINATE(std::runtime_error,
+                                  "Couldn't map the file.");
+      }
+
+      m_data = data;
+      m_size = std::size_t(file_size);
+    }
+
+    ::CloseHandle(file);
+  }
+
+  void unmap() noexcept {
+    if (m_data != nullptr) {
+      ::UnmapViewOfFile(m_data);
+      m_data = nullptr;
+      m_size = 0;
+    }
+  }
+#else
+  void map(const char* path) {
+    const int fd = ::open(path, O_RDONLY);
+    if (fd == -1) {
+      TSL_HH_THROW_OR_TERMINATE(std::runtime_error, "Couldn't open the file.");
+    }
+
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) == -1) {
+      ::close(fd);
+      TSL_HH_THROW_OR_TERMINATE(std::runtime_error,
+                                "Couldn't get the size of the file.");
+    }
+
+    // mmap fails on an empty file, keep an empty mapping.
+    if (file_stat.st_size > 0) {
+      void* data = ::mmap(nullptr, std::size_t(file_stat.st_size), PROT_READ,
+                          MAP_SHARED, fd, 0);
+      if (data == MAP_FAILED) {
+        ::close(fd);
+        TSL_HH_THROW_OR_TERMINATE(std::runtime_error,
+                                  "Couldn't map the file.");
+      }
+
+      m_data = data;
+      m_size = std::size_t(file_stat.st_size);
+    }
+
+    ::close(fd);
+  }
+
+  void unmap() noexcept {
+    if (m_data != nullptr) {
+      ::munmap(m_data, m_size);
+      m_data = nullptr;
+      m_size = 0;
+    }
+  }
+#endif
+
+ private:
+  void* m_data;
+  std::size_t m_size;
+};
+
+}  // namespace hh
+}  // namespace tsl
+
+#endif
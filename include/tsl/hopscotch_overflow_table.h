@@ -0,0 +1,914 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_HOPSCOTCH_OVERFLOW_TABLE_H
+#define TSL_HOPSCOTCH_OVERFLOW_TABLE_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "hopscotch_growth_policy.h"
+
+namespace tsl {
+namespace detail_hopscotch_hash {
+
+/**
+ * Small open-addressing map from the index of a home bucket to a std::size_t,
+ * with linear probing and a backward shift on erase. Used to index the
+ * overflow elements by home bucket.
+ *
+ * The index never grows by itself, reserve must be called before inserting a
+ * new bucket.
+ */
+template <class Allocator>
+class hopscotch_bucket_index {
+ public:
+  static const std::size_t NPOS = std::numeric_limits<std::size_t>::max();
+
+ private:
+  /**
+   * The slot is empty if m_ibucket is NPOS.
+   */
+  struct slot {
+    std::size_t m_ibucket;
+    std::size_t m_value;
+  };
+
+  using slots_allocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<slot>;
+  using slots_container_type = std::vector<slot, slots_allocator>;
+
+ public:
+  explicit hopscotch_bucket_index(const Allocator& alloc = Allocator())
+      : m_slots(alloc), m_nb_buckets(0) {}
+
+  hopscotch_bucket_index(const hopscotch_bucket_index& other) = default;
+
+  hopscotch_bucket_index(const hopscotch_bucket_index& other,
+                         const Allocator& alloc)
+      : m_slots(other.m_slots, alloc), m_nb_buckets(other.m_nb_buckets) {}
+
+  hopscotch_bucket_index(hopscotch_bucket_index&& other) noexcept
+      : m_slots(std::move(other.m_slots)), m_nb_buckets(other.m_nb_buckets) {
+    other.m_slots.clear();
+    other.m_nb_buckets = 0;
+  }
+
+  hopscotch_bucket_index& operator=(const hopscotch_bucket_index& other) =
+      default;
+
+  hopscotch_bucket_index& operator=(hopscotch_bucket_index&& other) noexcept {
+    other.swap(*this);
+    other.clear();
+
+    return *this;
+  }
+
+  bool empty() const noexcept { return m_nb_buckets == 0; }
+
+  std::size_t size() const noexcept { return m_nb_buckets; }
+
+  /**
+   * Number of buckets which can be in the index without growing it.
+   */
+  std::size_t capacity() const noexcept { return m_slots.size() / 2; }
+
+  /**
+   * Remove all the buckets, keep the memory.
+   */
+  void clear() noexcept {
+    for (slot& s : m_slots) {
+      s.m_ibucket = NPOS;
+    }
+
+    m_nb_buckets = 0;
+  }
+
+  /**
+   * Grow the index if needed so that it can hold nb_buckets buckets with a
+   * load factor <= 0.5.
+   */
+  void reserve(std::size_t nb_buckets) {
+    if (nb_buckets <= capacity()) {
+      return;
+    }
+
+    std::size_t new_size =
+        (m_slots.size() == 0) ? MIN_SLOTS_SIZE : m_slots.size() * 2;
+    while (nb_buckets * 2 > new_size) {
+      new_size *= 2;
+    }
+
+    slots_container_type new_slots(new_size, slot{NPOS, NPOS},
+                                   m_slots.get_allocator());
+    m_slots.swap(new_slots);
+
+    const std::size_t mask = m_slots.size() - 1;
+    for (const slot& s : new_slots) {
+      if (s.m_ibucket != NPOS) {
+        std::size_t islot = slot_for_bucket(s.m_ibucket);
+        while (m_slots[islot].m_ibucket != NPOS) {
+          islot = (islot + 1) & mask;
+        }
+
+        m_slots[islot] = s;
+      }
+    }
+  }
+
+  /**
+   * Return a pointer to the value of ibucket, nullptr if ibucket is not in the
+   * index.
+   */
+  std::size_t* find(std::size_t ibucket) noexcept {
+    const std::size_t islot = find_slot(ibucket);
+    return (islot == NPOS) ? nullptr : &m_slots[islot].m_value;
+  }
+
+  const std::size_t* find(std::size_t ibucket) const noexcept {
+    const std::size_t islot = find_slot(ibucket);
+    return (islot == NPOS) ? nullptr : &m_slots[islot].m_value;
+  }
+
+  /**
+   * Return a reference to the value of ibucket, inserting it with value if
+   * ibucket is not in the index yet. There must be room for a new bucket.
+   */
+  std::size_t& insert(std::size_t ibucket, std::size_t value) noexcept {
+    tsl_hh_assert(ibucket != NPOS);
+    tsl_hh_assert(m_nb_buckets < capacity());
+
+    const std::size_t mask = m_slots.size() - 1;
+    std::size_t islot = slot_for_bucket(ibucket);
+    while (m_slots[islot].m_ibucket != NPOS &&
+           m_slots[islot].m_ibucket != ibucket) {
+      islot = (islot + 1) & mask;
+    }
+
+    if (m_slots[islot].m_ibucket == NPOS) {
+      m_slots[islot].m_ibucket = ibucket;
+      m_slots[islot].m_value = value;
+      m_nb_buckets++;
+    }
+
+    return m_slots[islot].m_value;
+  }
+
+  /**
+   * Remove ibucket, which must be in the index, with a backward shift of the
+   * following slots of the cluster. No tombstone is needed.
+   */
+  void erase(std::size_t ibucket) noexcept {
+    const std::size_t mask = m_slots.size() - 1;
+
+    std::size_t ihole = find_slot(ibucket);
+    tsl_hh_assert(ihole != NPOS);
+
+    for (std::size_t inext = (ihole + 1) & mask;
+         m_slots[inext].m_ibucket != NPOS; inext = (inext + 1) & mask) {
+      const std::size_t ihome = slot_for_bucket(m_slots[inext].m_ibucket);
+
+      // Move the slot in the hole if the hole is between its home slot and
+      // its current position (cyclically).
+      if (((inext - ihome) & mask) >= ((inext - ihole) & mask)) {
+        m_slots[ihole] = m_slots[inext];
+        ihole = inext;
+      }
+    }
+
+    m_slots[ihole].m_ibucket = NPOS;
+    m_nb_buckets--;
+  }
+
+  void swap(hopscotch_bucket_index& other) noexcept {
+    using std::swap;
+
+    swap(m_slots, other.m_slots);
+    swap(m_nb_buckets, other.m_nb_buckets);
+  }
+
+ private:
+  std::size_t slot_for_bucket(std::size_t ibucket) const noexcept {
+    tsl_hh_assert(!m_slots.empty());
+
+    // Fibonacci hashing, the consecutive home buckets of an overflowing
+    // neighborhood end up in different slots.
+    const std::size_t hash =
+        ibucket * std::size_t(UINT64_C(0x9E3779B97F4A7C15));
+    return (hash ^ (hash >> (sizeof(std::size_t) * 4))) & (m_slots.size() - 1);
+  }
+
+  /**
+   * Return the index of the slot of ibucket, NPOS if there is none.
+   */
+  std::size_t find_slot(std::size_t ibucket) const noexcept {
+    if (m_nb_buckets == 0) {
+      return NPOS;
+    }
+
+    const std::size_t mask = m_slots.size() - 1;
+    for (std::size_t islot = slot_for_bucket(ibucket);;
+         islot = (islot + 1) & mask) {
+      if (m_slots[islot].m_ibucket == ibucket) {
+        return islot;
+      }
+
+      if (m_slots[islot].m_ibucket == NPOS) {
+        return NPOS;
+      }
+    }
+  }
+
+ private:
+  static const std::size_t MIN_SLOTS_SIZE = 8;
+
+  slots_container_type m_slots;
+  std::size_t m_nb_buckets;
+};
+
+/**
+ * Placeholder for the per-bucket counters of the overflow elements when the
+ * overflow container doesn't need them.
+ */
+class hopscotch_no_bucket_index {
+ public:
+  template <class Allocator>
+  explicit hopscotch_no_bucket_index(const Allocator& /*alloc*/) noexcept {}
+
+  void clear() noexcept {}
+
+  void swap(hopscotch_no_bucket_index& /*other*/) noexcept {}
+};
+
+/**
+ * Container for the elements which didn't fit in the neighborhood of their
+ * bucket in a hopscotch_hash.
+ *
+ * The elements are stored contiguously in a vector of entries. The entries of
+ * a same home bucket are chained together and a small open-addressing table,
+ * keyed by the index of the home bucket, gives the first entry of each chain.
+ * Finding an element of a bucket or checking if a bucket still has some
+ * overflow elements are thus O(1) on average instead of a scan of all the
+ * overflow elements.
+ *
+ * Most tables never get an overflow element. The entries, the index and the
+ * bookkeeping are thus kept in a state allocated on the first insertion, an
+ * empty table is a single pointer (the allocator is an empty base if it is
+ * stateless).
+ *
+ * An erased entry is kept as a hole in the vector and reused by the next
+ * insertion. An erase only invalidates the iterators on the erased element.
+ * An insertion may reallocate the vector and invalidate all the iterators.
+ */
+template <class ValueType, class Allocator>
+class hopscotch_overflow_table
+    : private std::allocator_traits<Allocator>::template rebind_alloc<
+          char> {
+ public:
+  template <bool IsConst>
+  class overflow_iterator;
+
+  using value_type = ValueType;
+  using allocator_type = Allocator;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using iterator = overflow_iterator<false>;
+  using const_iterator = overflow_iterator<true>;
+
+ private:
+  using bucket_index = hopscotch_bucket_index<Allocator>;
+
+  static const std::size_t NPOS = bucket_index::NPOS;
+
+  /**
+   * Storage of one overflow element. m_ibucket is the home bucket of the
+   * element, or NPOS if the entry is a hole. m_hash is the hash of the element
+   * given on insertion. m_next is the next entry of the same home bucket or,
+   * for a hole, the next hole.
+   */
+  class entry {
+   public:
+    entry() noexcept : m_ibucket(NPOS), m_hash(0), m_next(NPOS) {}
+
+    entry(const entry& other) noexcept(
+        std::is_nothrow_copy_constructible<value_type>::value)
+        : m_ibucket(NPOS), m_hash(other.m_hash), m_next(other.m_next) {
+      if (!other.empty()) {
+        ::new (static_cast<void*>(std::addressof(m_value)))
+            value_type(other.value());
+      }
+
+      m_ibucket = other.m_ibucket;
+    }
+
+    entry(entry&& other) noexcept(
+        std::is_nothrow_move_constructible<value_type>::value)
+        : m_ibucket(NPOS), m_hash(other.m_hash), m_next(other.m_next) {
+      if (!other.empty()) {
+        ::new (static_cast<void*>(std::addressof(m_value)))
+            value_type(std::move(other.value()));
+      }
+
+      m_ibucket = other.m_ibucket;
+    }
+
+    entry& operator=(const entry& other) noexcept(
+        std::is_nothrow_copy_constructible<value_type>::value) {
+      if (this != &other) {
+        remove_value();
+
+        if (!other.empty()) {
+          ::new (static_cast<void*>(std::addressof(m_value)))
+              value_type(other.value());
+        }
+
+        m_ibucket = other.m_ibucket;
+        m_hash = other.m_hash;
+        m_next = other.m_next;
+      }
+
+      return *this;
+    }
+
+    entry& operator=(entry&&) = delete;
+
+    ~entry() noexcept { remove_value(); }
+
+    bool empty() const noexcept { return m_ibucket == NPOS; }
+
+    std::size_t ibucket() const noexcept { return m_ibucket; }
+
+    value_type& value() noexcept {
+      tsl_hh_assert(!empty());
+      return *std::launder(
+          reinterpret_cast<value_type*>(std::addressof(m_value)));
+    }
+
+    const value_type& value() const noexcept {
+      tsl_hh_assert(!empty());
+      return *std::launder(
+          reinterpret_cast<const value_type*>(std::addressof(m_value)));
+    }
+
+    template <typename... Args>
+    void set_value(std::size_t ibucket, std::size_t hash,
+                   Args&&... value_type_args) {
+      tsl_hh_assert(empty() && ibucket != NPOS);
+
+      ::new (static_cast<void*>(std::addressof(m_value)))
+          value_type(std::forward<Args>(value_type_args)...);
+      m_ibucket = ibucket;
+      m_hash = hash;
+    }
+
+    void remove_value() noexcept {
+      if (!empty()) {
+        value().~value_type();
+        m_ibucket = NPOS;
+      }
+    }
+
+   private:
+    friend class hopscotch_overflow_table;
+
+    std::size_t m_ibucket;
+    std::size_t m_hash;
+    std::size_t m_next;
+    alignas(value_type) unsigned char m_value[sizeof(value_type)];
+  };
+
+  using entries_allocator = typename std::allocator_traits<
+      allocator_type>::template rebind_alloc<entry>;
+  using entries_container_type = std::vector<entry, entries_allocator>;
+
+  struct state {
+    explicit state(const Allocator& alloc)
+        : m_entries(alloc),
+          m_index(alloc),
+          m_ifirst(0),
+          m_ifree(NPOS),
+          m_nb_elements(0) {}
+
+    state(const state& other, const Allocator& alloc)
+        : m_entries(other.m_entries, alloc),
+          m_index(other.m_index, alloc),
+          m_ifirst(other.m_ifirst),
+          m_ifree(other.m_ifree),
+          m_nb_elements(other.m_nb_elements) {}
+
+    entries_container_type m_entries;
+
+    /**
+     * First entry of the chain of each home bucket.
+     */
+    bucket_index m_index;
+
+    /**
+     * Index of the first non-empty entry, m_entries.size() if there is none.
+     * Keep begin() O(1) even with holes at the beginning of m_entries.
+     */
+    std::size_t m_ifirst;
+
+    /**
+     * First hole of m_entries, the holes are chained through entry::m_next.
+     */
+    std::size_t m_ifree;
+
+    std::size_t m_nb_elements;
+  };
+
+  using base_allocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<char>;
+  using state_allocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<state>;
+  using state_allocator_traits = std::allocator_traits<state_allocator>;
+
+ public:
+  template <bool IsConst>
+  class overflow_iterator {
+    friend class hopscotch_overflow_table;
+    template <bool>
+    friend class overflow_iterator;
+
+   private:
+    using entry_pointer =
+        typename std::conditional<IsConst, const entry*, entry*>::type;
+
+    overflow_iterator(entry_pointer entry, entry_pointer end) noexcept
+        : m_entry(entry), m_end(end) {}
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename std::conditional<
+        IsConst, const typename hopscotch_overflow_table::value_type,
+        typename hopscotch_overflow_table::value_type>::type;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type&;
+    using pointer = value_type*;
+
+    overflow_iterator() noexcept : m_entry(nullptr), m_end(nullptr) {}
+
+    // Copy constructor from iterator to const_iterator.
+    template <bool TIsConst = IsConst,
+              typename std::enable_if<TIsConst>::type* = nullptr>
+    overflow_iterator(const overflow_iterator<!TIsConst>& other) noexcept
+        : m_entry(other.m_entry), m_end(other.m_end) {}
+
+    overflow_iterator(const overflow_iterator& other) = default;
+    overflow_iterator(overflow_iterator&& other) = default;
+    overflow_iterator& operator=(const overflow_iterator& other) = default;
+    overflow_iterator& operator=(overflow_iterator&& other) = default;
+
+    reference operator*() const { return m_entry->value(); }
+
+    pointer operator->() const { return std::addressof(m_entry->value()); }
+
+    overflow_iterator& operator++() {
+      do {
+        ++m_entry;
+      } while (m_entry != m_end && m_entry->empty());
+
+      return *this;
+    }
+
+    overflow_iterator operator++(int) {
+      overflow_iterator tmp(*this);
+      ++*this;
+
+      return tmp;
+    }
+
+    friend bool operator==(const overflow_iterator& lhs,
+                           const overflow_iterator& rhs) {
+      return lhs.m_entry == rhs.m_entry;
+    }
+
+    friend bool operator!=(const overflow_iterator& lhs,
+                           const overflow_iterator& rhs) {
+      return !(lhs == rhs);
+    }
+
+   private:
+    entry_pointer m_entry;
+    entry_pointer m_end;
+  };
+
+ public:
+  explicit hopscotch_overflow_table(const Allocator& alloc = Allocator())
+      : base_allocator(alloc), m_state(nullptr) {}
+
+  hopscotch_overflow_table(const hopscotch_overflow_table& other)
+      : base_allocator(
+            std::allocator_traits<base_allocator>::
+                select_on_container_copy_construction(other.base_alloc())),
+        m_state(nullptr) {
+    if (other.m_state != nullptr) {
+      m_state = create_state(*other.m_state);
+    }
+  }
+
+  hopscotch_overflow_table(hopscotch_overflow_table&& other) noexcept
+      : base_allocator(std::move(other.base_alloc())), m_state(other.m_state) {
+    other.m_state = nullptr;
+  }
+
+  hopscotch_overflow_table& operator=(const hopscotch_overflow_table& other) {
+    if (this != &other) {
+      hopscotch_overflow_table tmp(
+          other, std::allocator_traits<base_allocator>::
+                         propagate_on_container_copy_assignment::value
+                     ? other.get_allocator()
+                     : get_allocator());
+      destroy_state();
+
+      if constexpr (std::allocator_traits<base_allocator>::
+                        propagate_on_container_copy_assignment::value) {
+        base_alloc() = other.base_alloc();
+      }
+      m_state = tmp.m_state;
+      tmp.m_state = nullptr;
+    }
+
+    return *this;
+  }
+
+  hopscotch_overflow_table& operator=(
+      hopscotch_overflow_table&& other) noexcept {
+    other.swap(*this);
+    other.clear();
+
+    return *this;
+  }
+
+  ~hopscotch_overflow_table() { destroy_state(); }
+
+  allocator_type get_allocator() const { return allocator_type(base_alloc()); }
+
+  iterator begin() noexcept {
+    return (m_state == nullptr)
+               ? iterator(nullptr, nullptr)
+               : iterator(m_state->m_entries.data() + m_state->m_ifirst,
+                          entries_end());
+  }
+
+  const_iterator begin() const noexcept { return cbegin(); }
+
+  const_iterator cbegin() const noexcept {
+    return (m_state == nullptr)
+               ? const_iterator(nullptr, nullptr)
+               : const_iterator(m_state->m_entries.data() + m_state->m_ifirst,
+                                entries_end());
+  }
+
+  iterator end() noexcept { return iterator(entries_end(), entries_end()); }
+
+  const_iterator end() const noexcept { return cend(); }
+
+  const_iterator cend() const noexcept {
+    return const_iterator(entries_end(), entries_end());
+  }
+
+  bool empty() const noexcept { return size() == 0; }
+
+  size_type size() const noexcept {
+    return (m_state == nullptr) ? 0 : m_state->m_nb_elements;
+  }
+
+  /**
+   * Remove all the elements, keep the memory.
+   */
+  void clear() noexcept {
+    if (m_state != nullptr) {
+      m_state->m_entries.clear();
+      m_state->m_index.clear();
+
+      m_state->m_ifirst = 0;
+      m_state->m_ifree = NPOS;
+      m_state->m_nb_elements = 0;
+    }
+  }
+
+  /**
+   * Insert a new element with ibucket as home bucket and keep its hash. The
+   * container doesn't check for duplicates.
+   */
+  template <class... Args>
+  iterator emplace(std::size_t ibucket, std::size_t hash,
+                   Args&&... value_type_args) {
+    tsl_hh_assert(ibucket != NPOS);
+    if (m_state == nullptr) {
+      m_state = create_state();
+    }
+
+    state& st = *m_state;
+    // The index is sized on the number of elements, not on the number of home
+    // buckets currently indexed, so that a reindex never needs more room.
+    st.m_index.reserve(st.m_nb_elements + 1);
+
+    std::size_t ientry;
+    if (st.m_ifree != NPOS) {
+      ientry = st.m_ifree;
+      const std::size_t inext_free = st.m_entries[ientry].m_next;
+
+      st.m_entries[ientry].set_value(ibucket, hash,
+                                     std::forward<Args>(value_type_args)...);
+      st.m_ifree = inext_free;
+    } else {
+      ientry = st.m_entries.size();
+      st.m_entries.emplace_back();
+
+#ifndef TSL_HH_NO_EXCEPTIONS
+      try {
+#endif
+        st.m_entries.back().set_value(ibucket, hash,
+                                      std::forward<Args>(value_type_args)...);
+#ifndef TSL_HH_NO_EXCEPTIONS
+      } catch (...) {
+        st.m_entries.pop_back();
+        throw;
+      }
+#endif
+    }
+
+    link_entry(ientry);
+    st.m_nb_elements++;
+    if (ientry < st.m_ifirst || st.m_nb_elements == 1) {
+      st.m_ifirst = ientry;
+    }
+
+    return iterator(st.m_entries.data() + ientry, entries_end());
+  }
+
+  /**
+   * Return an iterator to the first element with ibucket as home bucket for
+   * which pred(hash, value) is true, end() otherwise. hash is the hash kept
+   * with the element.
+   */
+  template <class Predicate>
+  iterator find(std::size_t ibucket, Predicate pred) {
+    const std::size_t ientry =
+        static_cast<const hopscotch_overflow_table*>(this)->find_entry(ibucket,
+                                                                       pred);
+    return (ientry == NPOS)
+               ? end()
+               : iterator(m_state->m_entries.data() + ientry, entries_end());
+  }
+
+  template <class Predicate>
+  const_iterator find(std::size_t ibucket, Predicate pred) const {
+    const std::size_t ientry = find_entry(ibucket, pred);
+    return (ientry == NPOS) ? cend()
+                            : const_iterator(
+                                  m_state->m_entries.data() + ientry,
+                                  entries_end());
+  }
+
+  /**
+   * Hash given when the element was inserted, or by the last reindex.
+   */
+  std::size_t hash(const_iterator pos) const noexcept {
+    tsl_hh_assert(pos.m_entry != nullptr && !pos.m_entry->empty());
+    return pos.m_entry->m_hash;
+  }
+
+  /**
+   * Return true if there is at least one element with ibucket as home bucket.
+   */
+  bool has_bucket(std::size_t ibucket) const noexcept {
+    return m_state != nullptr && m_state->m_index.find(ibucket) != nullptr;
+  }
+
+  iterator erase(const_iterator pos) noexcept {
+    tsl_hh_assert(m_state != nullptr);
+    state& st = *m_state;
+
+    const std::size_t ientry =
+        static_cast<std::size_t>(pos.m_entry - st.m_entries.data());
+    tsl_hh_assert(ientry < st.m_entries.size() &&
+                  !st.m_entries[ientry].empty());
+
+    unlink_entry(ientry);
+
+    entry& erased = st.m_entries[ientry];
+    erased.remove_value();
+    erased.m_next = st.m_ifree;
+    st.m_ifree = ientry;
+    st.m_nb_elements--;
+
+    iterator it_next(st.m_entries.data() + ientry, entries_end());
+    ++it_next;
+
+    if (ientry == st.m_ifirst) {
+      st.m_ifirst =
+          static_cast<std::size_t>(it_next.m_entry - st.m_entries.data());
+    }
+
+    return it_next;
+  }
+
+  /**
+   * Only used to get a non-const iterator from a const_iterator, the range
+   * must be empty.
+   */
+  iterator erase(const_iterator first, const_iterator last) noexcept {
+    tsl_hh_assert(first == last);
+    (void)last;
+
+    return iterator(const_cast<entry*>(first.m_entry),
+                    const_cast<entry*>(first.m_end));
+  }
+
+  /**
+   * Rebuild the index with ibucket_for_value(hash, value) as new home bucket of
+   * each element, e.g. after a rehash of the buckets. hash is a reference to
+   * the hash kept with the element which may be updated by ibucket_for_value.
+   * If ibucket_for_value throws, the index is left incomplete and reindex must
+   * be called again.
+   *
+   * The index is always large enough for one home bucket per element, reindex
+   * doesn't allocate and can be used to rollback a failed rehash.
+   */
+  template <class F>
+  void reindex(F&& ibucket_for_value) {
+    if (m_state == nullptr) {
+      return;
+    }
+
+    state& st = *m_state;
+    tsl_hh_assert(st.m_nb_elements <= st.m_index.capacity());
+    st.m_index.clear();
+
+    for (std::size_t ientry = st.m_ifirst; ientry < st.m_entries.size();
+         ientry++) {
+      entry& e = st.m_entries[ientry];
+      if (!e.empty()) {
+        const std::size_t ibucket = ibucket_for_value(e.m_hash, e.value());
+        tsl_hh_assert(ibucket != NPOS);
+
+        e.m_ibucket = ibucket;
+
+        link_entry(ientry);
+      }
+    }
+  }
+
+  void swap(hopscotch_overflow_table& other) noexcept {
+    using std::swap;
+
+    if constexpr (std::allocator_traits<
+                      base_allocator>::propagate_on_container_swap::value) {
+      swap(base_alloc(), other.base_alloc());
+    }
+    swap(m_state, other.m_state);
+  }
+
+  friend void swap(hopscotch_overflow_table& lhs,
+                   hopscotch_overflow_table& rhs) noexcept {
+    lhs.swap(rhs);
+  }
+
+ private:
+  hopscotch_overflow_table(const hopscotch_overflow_table& other,
+                           const Allocator& alloc)
+      : base_allocator(alloc), m_state(nullptr) {
+    if (other.m_state != nullptr) {
+      m_state = create_state(*other.m_state);
+    }
+  }
+
+  base_allocator& base_alloc() noexcept { return *this; }
+
+  const base_allocator& base_alloc() const noexcept { return *this; }
+
+  /**
+   * Allocate a state with the allocator of the table, constructed from args
+   * followed by the allocator.
+   */
+  template <class... Args>
+  state* create_state(const Args&... args) {
+    state_allocator alloc(base_alloc());
+    state* st = std::addressof(*state_allocator_traits::allocate(alloc, 1));
+
+#ifndef TSL_HH_NO_EXCEPTIONS
+    try {
+#endif
+      ::new (static_cast<void*>(st)) state(args..., get_allocator());
+#ifndef TSL_HH_NO_EXCEPTIONS
+    } catch (...) {
+      state_allocator_traits::deallocate(alloc, st, 1);
+      throw;
+    }
+#endif
+
+    return st;
+  }
+
+  void destroy_state() noexcept {
+    if (m_state != nullptr) {
+      state_allocator alloc(base_alloc());
+      m_state->~state();
+      state_allocator_traits::deallocate(alloc, m_state, 1);
+      m_state = nullptr;
+    }
+  }
+
+  entry* entries_end() const noexcept {
+    return (m_state == nullptr)
+               ? nullptr
+               : m_state->m_entries.data() + m_state->m_entries.size();
+  }
+
+  template <class Predicate>
+  std::size_t find_entry(std::size_t ibucket, Predicate& pred) const {
+    if (m_state == nullptr) {
+      return NPOS;
+    }
+
+    const std::size_t* ifirst = m_state->m_index.find(ibucket);
+    if (ifirst == nullptr) {
+      return NPOS;
+    }
+
+    const entries_container_type& entries = m_state->m_entries;
+    for (std::size_t ientry = *ifirst; ientry != NPOS;
+         ientry = entries[ientry].m_next) {
+      if (pred(entries[ientry].m_hash, entries[ientry].value())) {
+        return ientry;
+      }
+    }
+
+    return NPOS;
+  }
+
+  /**
+   * Add the entry in front of the chain of its home bucket. The index must
+   * have room for a new bucket.
+   */
+  void link_entry(std::size_t ientry) noexcept {
+    entry& e = m_state->m_entries[ientry];
+
+    std::size_t& ifirst = m_state->m_index.insert(e.m_ibucket, NPOS);
+    e.m_next = ifirst;
+    ifirst = ientry;
+  }
+
+  /**
+   * Remove the entry from the chain of its home bucket and remove the bucket
+   * from the index if the chain is now empty.
+   */
+  void unlink_entry(std::size_t ientry) noexcept {
+    const entry& e = m_state->m_entries[ientry];
+    std::size_t* const ifirst = m_state->m_index.find(e.m_ibucket);
+    tsl_hh_assert(ifirst != nullptr);
+
+    std::size_t* link = ifirst;
+    while (*link != ientry) {
+      tsl_hh_assert(*link != NPOS);
+      link = &m_state->m_entries[*link].m_next;
+    }
+    *link = e.m_next;
+
+    if (*ifirst == NPOS) {
+      m_state->m_index.erase(e.m_ibucket);
+    }
+  }
+
+ private:
+  /**
+   * nullptr until the first insertion.
+   */
+  state* m_state;
+};
+
+}  // end namespace detail_hopscotch_hash
+}  // end namespace tsl
+
+#endif
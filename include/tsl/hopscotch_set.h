@@ -28,8 +28,10 @@
 #include <cstddef>
 #include <functional>
 #include <initializer_list>
-#include <list>
 #include <memory>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
 #include <type_traits>
 #include <utility>
 
@@ -71,7 +73,8 @@ namespace tsl {
  *  - insert, emplace, emplace_hint, operator[]: if there is an effective
  * insert, invalidate the iterators if a displacement is needed to resolve a
  * collision (which mean that most of the time, insert will invalidate the
- * iterators). Or if there is a rehash.
+ * iterators). Or if there is a rehash or if the element is added to the
+ * overflow elements.
  *  - erase: iterator on the erased element is the only one which become
  * invalid.
  */
@@ -100,7 +103,8 @@ class hopscotch_set {
     }
   };
 
-  using overflow_container_type = std::list<Key, Allocator>;
+  using overflow_container_type =
+      detail_hopscotch_hash::hopscotch_overflow_table<Key, Allocator>;
   using ht = detail_hopscotch_hash::hopscotch_hash<
       Key, KeySelect, void, Hash, KeyEqual, Allocator, NeighborhoodSize,
       StoreHash, GrowthPolicy, overflow_container_type>;
@@ -258,6 +262,25 @@ class hopscotch_set {
     m_ht.insert(ilist.begin(), ilist.end());
   }
 
+  /**
+   * Same as insert(first, last) but optimized for large ranges. The elements
+   * are inserted in small groups, the buckets of a whole group are prefetched
+   * before its insertion to overlap the cache misses.
+   */
+  template <class ForwardIt>
+  void bulk_build(ForwardIt first, ForwardIt last) {
+    m_ht.template bulk_build<false>(first, last);
+  }
+
+  /**
+   * Same as bulk_build(first, last), but the keys of [first, last) must be
+   * distinct and not already in the set, the check for duplicates is skipped.
+   */
+  template <class ForwardIt>
+  void bulk_build(tsl::hh::unique_keys_t, ForwardIt first, ForwardIt last) {
+    m_ht.template bulk_build<true>(first, last);
+  }
+
   /**
    * Due to the way elements are stored, emplace will need to move or copy the
    * key-value once. The method is equivalent to
@@ -282,6 +305,41 @@ class hopscotch_set {
     return m_ht.emplace_hint(hint, std::forward<Args>(args)...);
   }
 
+  /**
+   * Same as insert(value), but use the hash value 'precalculated_hash'
+   * instead of hashing the key. The hash value must be the same as
+   * hash_function()(value), which is checked in debug mode. Useful if the hash
+   * was already computed, e.g. to find the shard of a sharded set.
+   */
+  std::pair<iterator, bool> insert(const value_type& value,
+                                   std::size_t precalculated_hash) {
+    return m_ht.insert_with_hash(value, precalculated_hash);
+  }
+
+  std::pair<iterator, bool> insert(value_type&& value,
+                                   std::size_t precalculated_hash) {
+    return m_ht.insert_with_hash(std::move(value), precalculated_hash);
+  }
+
+  /**
+   * Same as emplace(args...) and emplace_hint(hint, args...) with the hash
+   * value of the key, see insert(value, precalculated_hash).
+   */
+  template <class... Args>
+  std::pair<iterator, bool> emplace_with_hash(std::size_t precalculated_hash,
+                                              Args&&... args) {
+    return m_ht.emplace_with_hash(precalculated_hash,
+                                  std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  iterator emplace_hint_with_hash(const_iterator hint,
+                                  std::size_t precalculated_hash,
+                                  Args&&... args) {
+    return m_ht.emplace_hint_with_hash(hint, precalculated_hash,
+                                       std::forward<Args>(args)...);
+  }
+
   iterator erase(iterator pos) { return m_ht.erase(pos); }
   iterator erase(const_iterator pos) { return m_ht.erase(pos); }
   iterator erase(const_iterator first, const_iterator last) {
@@ -475,6 +533,41 @@ class hopscotch_set {
     return m_ht.contains(key, precalculated_hash);
   }
 
+  /**
+   * Look up each key of [first, last) and write the resulting iterators, end()
+   * if the key is absent, to out. Return the output iterator past the last
+   * written element.
+   *
+   * Equivalent to calling find on each key, but the keys are hashed and their
+   * buckets prefetched in small groups before being looked up, which hides
+   * most of the cache misses when the map doesn't fit in the cache.
+   *
+   * The keys must be of type Key, or of a type K hashable and comparable to Key
+   * if the typedef KeyEqual::is_transparent exists.
+   */
+  template <class ForwardIt, class OutputIt>
+  OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) {
+    return m_ht.find_batch(first, last, out);
+  }
+
+  /**
+   * @copydoc find_batch(ForwardIt first, ForwardIt last, OutputIt out)
+   */
+  template <class ForwardIt, class OutputIt>
+  OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+    return m_ht.find_batch(first, last, out);
+  }
+
+  /**
+   * Same as find_batch but write a bool telling if the key is in the set for
+   * each key of [first, last).
+   */
+  template <class ForwardIt, class OutputIt>
+  OutputIt contains_batch(ForwardIt first, ForwardIt last,
+                          OutputIt out) const {
+    return m_ht.contains_batch(first, last, out);
+  }
+
   std::pair<iterator, iterator> equal_range(const Key& key) {
     return m_ht.equal_range(key);
   }
@@ -565,6 +658,31 @@ class hopscotch_set {
   void rehash(size_type count_) { m_ht.rehash(count_); }
   void reserve(size_type count_) { m_ht.reserve(count_); }
 
+  /**
+   * Same as rehash(count_), but the elements are moved to the new buckets by
+   * several tasks run through the executor, e.g. a tsl::hh::thread_executor.
+   * The result is the same as a sequential rehash.
+   *
+   * executor(nb_tasks, task) must call task(itask) once for each itask in
+   * [0, nb_tasks), possibly concurrently, and return once all the tasks
+   * returned. The hash function is called concurrently and must not throw.
+   *
+   * Small sets and value types which are not nothrow move constructible are
+   * rehashed sequentially.
+   */
+  template <class Executor>
+  void parallel_rehash(size_type count_, Executor&& executor) {
+    m_ht.parallel_rehash(count_, executor);
+  }
+
+  /**
+   * Same as reserve(count_) with a parallel rehash, see parallel_rehash.
+   */
+  template <class Executor>
+  void parallel_reserve(size_type count_, Executor&& executor) {
+    m_ht.parallel_reserve(count_, executor);
+  }
+
   /*
    * Observers
    */
@@ -584,6 +702,99 @@ class hopscotch_set {
 
   size_type overflow_size() const noexcept { return m_ht.overflow_size(); }
 
+  /**
+   * Describe the current layout of the elements of the set: occupancy of the
+   * neighborhoods, distances of the elements to their home bucket, runs of
+   * non-empty buckets, overflow and expected cache lines read per lookup, see
+   * tsl::hh::hopscotch_analysis. Walks all the buckets.
+   */
+  tsl::hh::hopscotch_analysis analyze() const { return m_ht.analyze(); }
+
+#ifdef TSL_HH_ENABLE_STATS
+  /**
+   * Counters of the operations done on the set since its construction or the
+   * last call to reset_stats() and histogram of the current occupancy of the
+   * neighborhoods, see tsl::hh::hopscotch_stats. Only available when
+   * TSL_HH_ENABLE_STATS is defined.
+   */
+  tsl::hh::hopscotch_stats stats() const { return m_ht.stats(); }
+
+  void reset_stats() noexcept { m_ht.reset_stats(); }
+#endif
+
+  /**
+   * Serialize the set through the serializer parameter.
+   *
+   * The serializer parameter must be a function object that supports the
+   * following call:
+   *  - `template<typename U> void operator()(const U& value);` where the types
+   * `std::uint64_t`, `std::uint32_t`, `float` and `Key` must be supported
+   * for U.
+   *
+   * The implementation leaves binary compatibility (endianness, IEEE 754 for
+   * floats, ...) of the types it serializes in the hands of the serializer
+   * function object if compatibility is required.
+   */
+  template <class Serializer>
+  void serialize(Serializer& serializer) const {
+    m_ht.serialize(serializer);
+  }
+
+  /**
+   * Deserialize a previously serialized set through the deserializer
+   * parameter.
+   *
+   * The deserializer parameter must be a function object that supports the
+   * following call:
+   *  - `template<typename U> U operator()();` where the types `std::uint64_t`,
+   * `std::uint32_t`, `float` and `Key` must be supported for U.
+   *
+   * If the deserialized hash set type is hash compatible with the
+   * serialized set, the deserialization process can be sped up by setting
+   * `hash_compatible` to true. To be hash compatible, the Hash, KeyEqual and
+   * GrowthPolicy must behave the same way than the ones used on the serialized
+   * set. The std::size_t must also be of the same size as the one on the
+   * platform used to serialize the set. If these criteria are not met,
+   * the behaviour is undefined with `hash_compatible` sets to true.
+   *
+   * The buckets are then copied in place with their neighborhood bitmaps and
+   * stored hashes, without hashing any key. If NeighborhoodSize or StoreHash
+   * differ from the serialized set, the values are inserted one by one as
+   * if `hash_compatible` was false.
+   *
+   * The behaviour is undefined if the type `Key` of the `hopscotch_set` is not
+   * the same as the type used during serialization.
+   *
+   * The implementation leaves binary compatibility (endianness, IEEE 754 for
+   * floats, size of int, ...) of the types it deserializes in the hands of the
+   * deserializer function object if compatibility is required.
+   */
+  template <class Deserializer>
+  static hopscotch_set deserialize(Deserializer& deserializer,
+                                   bool hash_compatible = false) {
+    hopscotch_set set(0);
+    set.m_ht.deserialize(deserializer, hash_compatible);
+
+    return set;
+  }
+
+  /**
+   * Write the set in a flat format which can be read in place, without
+   * deserialization, by a tsl::hopscotch_set_view with the same template
+   * parameters. The writer is called as writer(const void* data,
+   * std::size_t size) with consecutive chunks of the output, e.g. to append
+   * them to a file.
+   *
+   * The elements are written as their bytes in memory, Key must be trivially
+   * copyable.
+   */
+  template <class Writer>
+  void flat_serialize(Writer& writer) const {
+    static_assert(std::is_trivially_copyable<Key>::value,
+                  "Key must be trivially copyable.");
+    m_ht.flat_serialize(writer);
+  }
+
   friend bool operator==(const hopscotch_set& lhs, const hopscotch_set& rhs) {
     if (lhs.size() != rhs.size()) {
       return false;
@@ -624,6 +835,33 @@ using hopscotch_pg_set =
     hopscotch_set<Key, Hash, KeyEqual, Allocator, NeighborhoodSize, StoreHash,
                   tsl::hh::prime_growth_policy>;
 
+#if __has_include(<memory_resource>)
+namespace pmr {
+
+/**
+ * Aliases of `tsl::hopscotch_set` and of its prime growth policy variant
+ * using a `std::pmr::polymorphic_allocator`, like the `std::pmr` containers.
+ */
+template <class Key, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>,
+          unsigned int NeighborhoodSize = 62, bool StoreHash = false,
+          class GrowthPolicy = tsl::hh::power_of_two_growth_policy<2>>
+using hopscotch_set =
+    tsl::hopscotch_set<Key, Hash, KeyEqual,
+                       std::pmr::polymorphic_allocator<Key>, NeighborhoodSize,
+                       StoreHash, GrowthPolicy>;
+
+template <class Key, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>,
+          unsigned int NeighborhoodSize = 62, bool StoreHash = false>
+using hopscotch_pg_set =
+    tsl::hopscotch_pg_set<Key, Hash, KeyEqual,
+                          std::pmr::polymorphic_allocator<Key>,
+                          NeighborhoodSize, StoreHash>;
+
+}  // end namespace pmr
+#endif
+
 }  // end namespace tsl
 
 #endif
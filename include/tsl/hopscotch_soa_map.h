@@ -0,0 +1,1591 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_HOPSCOTCH_SOA_MAP_H
+#define TSL_HOPSCOTCH_SOA_MAP_H
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "hopscotch_hash.h"
+#include "hopscotch_overflow_table.h"
+
+namespace tsl {
+
+/**
+ * Implementation of a hash map using the hopscotch hashing algorithm with a
+ * structure-of-arrays layout.
+ *
+ * Where tsl::hopscotch_map stores the neighborhood bitmap, the optional hash
+ * and the value of a bucket next to each other, tsl::hopscotch_soa_map splits
+ * them in three parallel arrays:
+ * - the neighborhood bitmaps (and the overflow flags) of the buckets;
+ * - a one-byte fragment of the hash of the value stored in each bucket, 0 if
+ * the bucket is empty;
+ * - the values.
+ *
+ * On lookup only the bitmap of the home bucket and the NeighborhoodSize hash
+ * fragments of the neighborhood are read (one or two cache lines). The
+ * fragments are compared all at once with SSE2 or AVX2 if available and a
+ * value is only read on a fragment match. It makes the map interesting for
+ * large values and lookups that often miss, where tsl::hopscotch_map would
+ * touch many cache lines while scanning a neighborhood. On a successful lookup
+ * the value is in another cache line than the metadata, with small values or
+ * mostly successful lookups tsl::hopscotch_map is usually faster.
+ *
+ * There is no StoreHash parameter, the hash fragment is always stored. The
+ * other template parameters, the requirements on Key and T and the iterators
+ * invalidation rules are the same as tsl::hopscotch_map.
+ */
+template <class Key, class T, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>,
+          class Allocator = std::allocator<std::pair<Key, T>>,
+          unsigned int NeighborhoodSize = 62,
+          class GrowthPolicy = tsl::hh::power_of_two_growth_policy<2>>
+class hopscotch_soa_map : private Hash, private KeyEqual, private GrowthPolicy {
+ private:
+  template <typename U>
+  using has_is_transparent = tsl::detail_hopscotch_hash::has_is_transparent<U>;
+
+  static_assert(NeighborhoodSize >= 4, "NeighborhoodSize should be >= 4.");
+  static_assert(NeighborhoodSize <= 62, "NeighborhoodSize should be <= 62.");
+
+  static_assert(
+      noexcept(std::declval<GrowthPolicy>().bucket_for_hash(std::size_t(0))),
+      "GrowthPolicy::bucket_for_hash must be noexcept.");
+  static_assert(noexcept(std::declval<GrowthPolicy>().clear()),
+                "GrowthPolicy::clear must be noexcept.");
+
+  /*
+   * The least significant bit of a neighborhood bitmap is set to 1 if there
+   * is an overflow for the bucket. For a bucket 'ibucket', the bit 'i + 1' is
+   * set to 1 if the bucket 'ibucket + i' contains a value with a hash
+   * belonging to 'ibucket'.
+   */
+  static const std::size_t NB_RESERVED_BITS_IN_NEIGHBORHOOD = 1;
+  using neighborhood_bitmap =
+      typename tsl::detail_hopscotch_hash::smallest_type_for_min_bits<
+          NeighborhoodSize + NB_RESERVED_BITS_IN_NEIGHBORHOOD>::type;
+
+ public:
+  template <bool IsConst>
+  class soa_iterator;
+
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<Key, T>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher = Hash;
+  using key_equal = KeyEqual;
+  using allocator_type = Allocator;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using iterator = soa_iterator<false>;
+  using const_iterator = soa_iterator<true>;
+
+ private:
+  /**
+   * Uninitialized storage for a value, the value is constructed in place when
+   * the bucket becomes non-empty.
+   */
+  struct value_slot {
+    alignas(value_type) unsigned char m_storage[sizeof(value_type)];
+  };
+
+  using neighborhoods_allocator = typename std::allocator_traits<
+      allocator_type>::template rebind_alloc<neighborhood_bitmap>;
+  using fragments_allocator = typename std::allocator_traits<
+      allocator_type>::template rebind_alloc<std::uint8_t>;
+  using slots_allocator = typename std::allocator_traits<
+      allocator_type>::template rebind_alloc<value_slot>;
+
+  /**
+   * Same overflow container as tsl::hopscotch_map, the elements are indexed by
+   * home bucket and keep their full hash.
+   */
+  using overflow_container_type =
+      tsl::detail_hopscotch_hash::hopscotch_overflow_table<value_type,
+                                                           Allocator>;
+  using iterator_overflow = typename overflow_container_type::iterator;
+  using const_iterator_overflow =
+      typename overflow_container_type::const_iterator;
+
+ public:
+  /**
+   * The `operator*()` and `operator->()` methods return a const reference and
+   * const pointer respectively to the stored value type.
+   *
+   * To get a modifiable reference to the value associated to a key (the
+   * `.second` in the stored pair), you have to call `value()`.
+   */
+  template <bool IsConst>
+  class soa_iterator {
+    friend class hopscotch_soa_map;
+
+   private:
+    using map_pointer =
+        typename std::conditional<IsConst, const hopscotch_soa_map*,
+                                  hopscotch_soa_map*>::type;
+    using iterator_overflow = typename std::conditional<
+        IsConst, typename hopscotch_soa_map::const_iterator_overflow,
+        typename hopscotch_soa_map::iterator_overflow>::type;
+
+    soa_iterator(map_pointer map, std::size_t ibucket,
+                 iterator_overflow overflow_iterator) noexcept
+        : m_map(map),
+          m_ibucket(ibucket),
+          m_overflow_iterator(overflow_iterator) {}
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = const typename hopscotch_soa_map::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type&;
+    using pointer = value_type*;
+
+    soa_iterator() noexcept {}
+
+    // Copy constructor from iterator to const_iterator.
+    template <bool TIsConst = IsConst,
+              typename std::enable_if<TIsConst>::type* = nullptr>
+    soa_iterator(const soa_iterator<!TIsConst>& other) noexcept
+        : m_map(other.m_map),
+          m_ibucket(other.m_ibucket),
+          m_overflow_iterator(other.m_overflow_iterator) {}
+
+    soa_iterator(const soa_iterator& other) = default;
+    soa_iterator(soa_iterator&& other) = default;
+    soa_iterator& operator=(const soa_iterator& other) = default;
+    soa_iterator& operator=(soa_iterator&& other) = default;
+
+    const typename hopscotch_soa_map::key_type& key() const {
+      return (**this).first;
+    }
+
+    typename std::conditional<IsConst, const T&, T&>::type value() const {
+      if (m_ibucket != m_map->nb_buckets()) {
+        return m_map->bucket_value(m_ibucket).second;
+      }
+
+      return m_overflow_iterator->second;
+    }
+
+    reference operator*() const {
+      if (m_ibucket != m_map->nb_buckets()) {
+        return m_map->bucket_value(m_ibucket);
+      }
+
+      return *m_overflow_iterator;
+    }
+
+    pointer operator->() const { return std::addressof(**this); }
+
+    soa_iterator& operator++() {
+      if (m_ibucket == m_map->nb_buckets()) {
+        ++m_overflow_iterator;
+        return *this;
+      }
+
+      m_ibucket = m_map->next_non_empty_bucket(m_ibucket + 1);
+      return *this;
+    }
+
+    soa_iterator operator++(int) {
+      soa_iterator tmp(*this);
+      ++*this;
+
+      return tmp;
+    }
+
+    friend bool operator==(const soa_iterator& lhs, const soa_iterator& rhs) {
+      return lhs.m_ibucket == rhs.m_ibucket &&
+             lhs.m_overflow_iterator == rhs.m_overflow_iterator;
+    }
+
+    friend bool operator!=(const soa_iterator& lhs, const soa_iterator& rhs) {
+      return !(lhs == rhs);
+    }
+
+   private:
+    map_pointer m_map;
+    std::size_t m_ibucket;
+    iterator_overflow m_overflow_iterator;
+  };
+
+ public:
+  /*
+   * Constructors
+   */
+  hopscotch_soa_map() noexcept(
+      std::is_nothrow_default_constructible<Hash>::value &&
+      std::is_nothrow_default_constructible<KeyEqual>::value &&
+      std::is_nothrow_default_constructible<Allocator>::value &&
+      (std::is_nothrow_constructible<GrowthPolicy, std::size_t&>::value ||
+       hh::is_noexcept_on_zero_init<GrowthPolicy>::value))
+      : hopscotch_soa_map(DEFAULT_INIT_BUCKETS_SIZE) {}
+
+  explicit hopscotch_soa_map(size_type bucket_count, const Hash& hash = Hash(),
+                             const KeyEqual& equal = KeyEqual(),
+                             const Allocator& alloc = Allocator())
+      : Hash(hash),
+        KeyEqual(equal),
+        GrowthPolicy(bucket_count),
+        m_neighborhoods(alloc),
+        m_fragments(alloc),
+        m_slots(alloc),
+        m_overflow_elements(alloc),
+        m_nb_elements(0) {
+    if (bucket_count > max_bucket_count()) {
+      TSL_HH_THROW_OR_TERMINATE(std::length_error,
+                                "The map exceeds its maximum size.");
+    }
+
+    if (bucket_count > 0) {
+      const std::size_t nb_buckets = bucket_count + NeighborhoodSize - 1;
+      m_neighborhoods.resize(nb_buckets);
+      m_fragments.resize(nb_buckets + FRAGMENTS_PADDING);
+      m_slots.resize(nb_buckets);
+    }
+
+    this->max_load_factor(DEFAULT_MAX_LOAD_FACTOR);
+
+    static_assert(std::is_nothrow_move_constructible<value_type>::value ||
+                      std::is_copy_constructible<value_type>::value,
+                  "value_type must be either copy constructible or nothrow "
+                  "move constructible.");
+  }
+
+  hopscotch_soa_map(size_type bucket_count, const Allocator& alloc)
+      : hopscotch_soa_map(bucket_count, Hash(), KeyEqual(), alloc) {}
+
+  hopscotch_soa_map(size_type bucket_count, const Hash& hash,
+                    const Allocator& alloc)
+      : hopscotch_soa_map(bucket_count, hash, KeyEqual(), alloc) {}
+
+  explicit hopscotch_soa_map(const Allocator& alloc)
+      : hopscotch_soa_map(DEFAULT_INIT_BUCKETS_SIZE, alloc) {}
+
+  template <class InputIt>
+  hopscotch_soa_map(InputIt first, InputIt last,
+                    size_type bucket_count = DEFAULT_INIT_BUCKETS_SIZE,
+                    const Hash& hash = Hash(),
+                    const KeyEqual& equal = KeyEqual(),
+                    const Allocator& alloc = Allocator())
+      : hopscotch_soa_map(bucket_count, hash, equal, alloc) {
+    insert(first, last);
+  }
+
+  hopscotch_soa_map(std::initializer_list<value_type> init,
+                    size_type bucket_count = DEFAULT_INIT_BUCKETS_SIZE,
+                    const Hash& hash = Hash(),
+                    const KeyEqual& equal = KeyEqual(),
+                    const Allocator& alloc = Allocator())
+      : hopscotch_soa_map(init.begin(), init.end(), bucket_count, hash, equal,
+                          alloc) {}
+
+  hopscotch_soa_map(const hopscotch_soa_map& other)
+      : Hash(other),
+        KeyEqual(other),
+        GrowthPolicy(other),
+        m_neighborhoods(other.m_neighborhoods),
+        m_fragments(other.m_fragments),
+        m_slots(other.m_slots.size(), value_slot(),
+                other.m_slots.get_allocator()),
+        m_overflow_elements(other.m_overflow_elements),
+        m_nb_elements(other.m_nb_elements),
+        m_min_load_threshold_rehash(other.m_min_load_threshold_rehash),
+        m_max_load_threshold_rehash(other.m_max_load_threshold_rehash),
+        m_max_load_factor(other.m_max_load_factor) {
+    std::size_t ibucket = 0;
+#ifndef TSL_HH_NO_EXCEPTIONS
+    try {
+#endif
+      for (; ibucket < nb_buckets(); ibucket++) {
+        if (!bucket_empty(ibucket)) {
+          ::new (static_cast<void*>(m_slots[ibucket].m_storage))
+              value_type(other.bucket_value(ibucket));
+        }
+      }
+#ifndef TSL_HH_NO_EXCEPTIONS
+    } catch (...) {
+      destroy_bucket_values(ibucket);
+      throw;
+    }
+#endif
+  }
+
+  hopscotch_soa_map(hopscotch_soa_map&& other) noexcept(
+      std::is_nothrow_move_constructible<Hash>::value &&
+      std::is_nothrow_move_constructible<KeyEqual>::value &&
+      std::is_nothrow_move_constructible<GrowthPolicy>::value &&
+      std::is_nothrow_move_constructible<overflow_container_type>::value)
+      : Hash(std::move(static_cast<Hash&>(other))),
+        KeyEqual(std::move(static_cast<KeyEqual&>(other))),
+        GrowthPolicy(std::move(static_cast<GrowthPolicy&>(other))),
+        m_neighborhoods(std::move(other.m_neighborhoods)),
+        m_fragments(std::move(other.m_fragments)),
+        m_slots(std::move(other.m_slots)),
+        m_overflow_elements(std::move(other.m_overflow_elements)),
+        m_nb_elements(other.m_nb_elements),
+        m_min_load_threshold_rehash(other.m_min_load_threshold_rehash),
+        m_max_load_threshold_rehash(other.m_max_load_threshold_rehash),
+        m_max_load_factor(other.m_max_load_factor) {
+    other.GrowthPolicy::clear();
+    other.m_neighborhoods.clear();
+    other.m_fragments.clear();
+    other.m_slots.clear();
+    other.m_overflow_elements.clear();
+    other.m_nb_elements = 0;
+    other.m_min_load_threshold_rehash = 0;
+    other.m_max_load_threshold_rehash = 0;
+  }
+
+  hopscotch_soa_map& operator=(const hopscotch_soa_map& other) {
+    if (&other != this) {
+      hopscotch_soa_map tmp(other);
+      swap(tmp);
+    }
+
+    return *this;
+  }
+
+  hopscotch_soa_map& operator=(hopscotch_soa_map&& other) noexcept(
+      noexcept(other.swap(*this))) {
+    other.swap(*this);
+    other.clear();
+
+    return *this;
+  }
+
+  hopscotch_soa_map& operator=(std::initializer_list<value_type> ilist) {
+    clear();
+
+    reserve(ilist.size());
+    insert(ilist.begin(), ilist.end());
+
+    return *this;
+  }
+
+  ~hopscotch_soa_map() { destroy_bucket_values(nb_buckets()); }
+
+  allocator_type get_allocator() const {
+    return m_overflow_elements.get_allocator();
+  }
+
+  /*
+   * Iterators
+   */
+  iterator begin() noexcept {
+    return iterator(this, next_non_empty_bucket(0),
+                    m_overflow_elements.begin());
+  }
+
+  const_iterator begin() const noexcept { return cbegin(); }
+
+  const_iterator cbegin() const noexcept {
+    return const_iterator(this, next_non_empty_bucket(0),
+                          m_overflow_elements.cbegin());
+  }
+
+  iterator end() noexcept {
+    return iterator(this, nb_buckets(), m_overflow_elements.end());
+  }
+
+  const_iterator end() const noexcept { return cend(); }
+
+  const_iterator cend() const noexcept {
+    return const_iterator(this, nb_buckets(), m_overflow_elements.cend());
+  }
+
+  /*
+   * Capacity
+   */
+  bool empty() const noexcept { return m_nb_elements == 0; }
+  size_type size() const noexcept { return m_nb_elements; }
+  size_type max_size() const noexcept { return m_slots.max_size(); }
+
+  /*
+   * Modifiers
+   */
+  void clear() noexcept {
+    destroy_bucket_values(nb_buckets());
+    std::fill(m_neighborhoods.begin(), m_neighborhoods.end(),
+              neighborhood_bitmap(0));
+    std::fill(m_fragments.begin(), m_fragments.end(), std::uint8_t(0));
+
+    m_overflow_elements.clear();
+    m_nb_elements = 0;
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    return insert_impl(value);
+  }
+
+  template <class P, typename std::enable_if<std::is_constructible<
+                         value_type, P&&>::value>::type* = nullptr>
+  std::pair<iterator, bool> insert(P&& value) {
+    return insert_impl(value_type(std::forward<P>(value)));
+  }
+
+  std::pair<iterator, bool> insert(value_type&& value) {
+    return insert_impl(std::move(value));
+  }
+
+  iterator insert(const_iterator hint, const value_type& value) {
+    if (hint != cend() && compare_keys(hint->first, value.first)) {
+      return mutable_iterator(hint);
+    }
+
+    return insert(value).first;
+  }
+
+  iterator insert(const_iterator hint, value_type&& value) {
+    if (hint != cend() && compare_keys(hint->first, value.first)) {
+      return mutable_iterator(hint);
+    }
+
+    return insert(std::move(value)).first;
+  }
+
+  template <class InputIt>
+  void insert(InputIt first, InputIt last) {
+    if (std::is_base_of<
+            std::forward_iterator_tag,
+            typename std::iterator_traits<InputIt>::iterator_category>::value) {
+      const auto nb_elements_insert = std::distance(first, last);
+      const std::size_t nb_elements_in_buckets =
+          m_nb_elements - m_overflow_elements.size();
+      const std::size_t nb_free_buckets =
+          m_max_load_threshold_rehash - nb_elements_in_buckets;
+
+      if (nb_elements_insert > 0 &&
+          nb_free_buckets < std::size_t(nb_elements_insert)) {
+        reserve(nb_elements_in_buckets + std::size_t(nb_elements_insert));
+      }
+    }
+
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(const key_type& k, M&& obj) {
+    return insert_or_assign_impl(k, std::forward<M>(obj));
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(key_type&& k, M&& obj) {
+    return insert_or_assign_impl(std::move(k), std::forward<M>(obj));
+  }
+
+  /**
+   * Due to the way elements are stored, emplace will need to move or copy the
+   * key-value once. The method is equivalent to
+   * insert(value_type(std::forward<Args>(args)...));
+   */
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return insert(value_type(std::forward<Args>(args)...));
+  }
+
+  template <class... Args>
+  iterator emplace_hint(const_iterator hint, Args&&... args) {
+    return insert(hint, value_type(std::forward<Args>(args)...));
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& k, Args&&... args) {
+    return try_emplace_impl(k, std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(key_type&& k, Args&&... args) {
+    return try_emplace_impl(std::move(k), std::forward<Args>(args)...);
+  }
+
+  iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+  iterator erase(const_iterator pos) {
+    if (pos.m_ibucket != nb_buckets()) {
+      erase_from_bucket(pos.m_ibucket, bucket_for_hash(hash_key(pos.key())));
+
+      return iterator(this, next_non_empty_bucket(pos.m_ibucket + 1),
+                      m_overflow_elements.begin());
+    } else {
+      auto it_next_overflow = erase_from_overflow(pos.m_overflow_iterator);
+      return iterator(this, nb_buckets(), it_next_overflow);
+    }
+  }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    if (first == last) {
+      return mutable_iterator(first);
+    }
+
+    auto to_delete = erase(first);
+    while (to_delete != last) {
+      to_delete = erase(to_delete);
+    }
+
+    return to_delete;
+  }
+
+  size_type erase(const key_type& key) {
+    return erase_impl(key, hash_key(key));
+  }
+
+  /**
+   * Use the hash value 'precalculated_hash' instead of hashing the key. The
+   * hash value should be the same as hash_function()(key). Useful to speed-up
+   * the lookup to the value if you already have the hash.
+   */
+  size_type erase(const key_type& key, std::size_t precalculated_hash) {
+    return erase_impl(key, mix_hash(precalculated_hash));
+  }
+
+  /**
+   * This overload only participates in the overload resolution if the typedef
+   * KeyEqual::is_transparent exists. If so, K must be hashable and comparable
+   * to Key.
+   */
+  template <
+      class K, class KE = KeyEqual,
+      typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+  size_type erase(const K& key) {
+    return erase_impl(key, hash_key(key));
+  }
+
+  void swap(hopscotch_soa_map& other) noexcept(
+      std::is_nothrow_swappable<Hash>::value &&
+      std::is_nothrow_swappable<KeyEqual>::value &&
+      std::is_nothrow_swappable<GrowthPolicy>::value &&
+      std::is_nothrow_swappable<overflow_container_type>::value) {
+    using std::swap;
+
+    swap(static_cast<Hash&>(*this), static_cast<Hash&>(other));
+    swap(static_cast<KeyEqual&>(*this), static_cast<KeyEqual&>(other));
+    swap(static_cast<GrowthPolicy&>(*this), static_cast<GrowthPolicy&>(other));
+    swap(m_neighborhoods, other.m_neighborhoods);
+    swap(m_fragments, other.m_fragments);
+    swap(m_slots, other.m_slots);
+    swap(m_overflow_elements, other.m_overflow_elements);
+    swap(m_nb_elements, other.m_nb_elements);
+    swap(m_min_load_threshold_rehash, other.m_min_load_threshold_rehash);
+    swap(m_max_load_threshold_rehash, other.m_max_load_threshold_rehash);
+    swap(m_max_load_factor, other.m_max_load_factor);
+  }
+
+  /*
+   * Lookup
+   */
+  T& at(const Key& key) { return at(key, Hash::operator()(key)); }
+
+  /**
+   * Use the hash value 'precalculated_hash' instead of hashing the key. The
+   * hash value should be the same as hash_function()(key). Useful to speed-up
+   * the lookup if you already have the hash.
+   */
+  T& at(const Key& key, std::size_t precalculated_hash) {
+    return const_cast<T&>(
+        static_cast<const hopscotch_soa_map*>(this)->at(key,
+                                                        precalculated_hash));
+  }
+
+  const T& at(const Key& key) const {
+    return at(key, Hash::operator()(key));
+  }
+
+  /**
+   * @copydoc at(const Key& key, std::size_t precalculated_hash)
+   */
+  const T& at(const Key& key, std::size_t precalculated_hash) const {
+    const_iterator it = find(key, precalculated_hash);
+    if (it == cend()) {
+      TSL_HH_THROW_OR_TERMINATE(std::out_of_range, "Couldn't find key.");
+    }
+
+    return it.value();
+  }
+
+  T& operator[](const Key& key) { return try_emplace(key).first.value(); }
+  T& operator[](Key&& key) {
+    return try_emplace(std::move(key)).first.value();
+  }
+
+  size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+
+  /**
+   * Use the hash value 'precalculated_hash' instead of hashing the key. The
+   * hash value should be the same as hash_function()(key). Useful to speed-up
+   * the lookup if you already have the hash.
+   */
+  size_type count(const Key& key, std::size_t precalculated_hash) const {
+    return contains(key, precalculated_hash) ? 1 : 0;
+  }
+
+  /**
+   * This overload only participates in the overload resolution if the typedef
+   * KeyEqual::is_transparent exists. If so, K must be hashable and comparable
+   * to Key.
+   */
+  template <
+      class K, class KE = KeyEqual,
+      typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+  size_type count(const K& key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  /**
+   * @copydoc count(const K& key) const
+   *
+   * Use the hash value 'precalculated_hash' instead of hashing the key. The
+   * hash value should be the same as hash_function()(key). Useful to speed-up
+   * the lookup if you already have the hash.
+   */
+  template <
+      class K, class KE = KeyEqual,
+      typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+  size_type count(const K& key, std::size_t precalculated_hash) const {
+    return contains(key, precalculated_hash) ? 1 : 0;
+  }
+
+  iterator find(const Key& key) { return find_impl(key, hash_key(key)); }
+
+  /**
+   * Use the hash value 'precalculated_hash' instead of hashing the key. The
+   * hash value should be the same as hash_function()(key). Useful to speed-up
+   * the lookup if you already have the hash.
+   */
+  iterator find(const Key& key, std::size_t precalculated_hash) {
+    return find_impl(key, mix_hash(precalculated_hash));
+  }
+
+  const_iterator find(const Key& key) const {
+    return find_impl(key, hash_key(key));
+  }
+
+  /**
+   * @copydoc find(const Key& key, std::size_t precalculated_hash)
+   */
+  const_iterator find(const Key& key, std::size_t precalculated_hash) const {
+    return find_impl(key, mix_hash(precalculated_hash));
+  }
+
+  /**
+   * This overload only participates in the overload resolution if the typedef
+   * KeyEqual::is_transparent exists. If so, K must be hashable and comparable
+   * to Key.
+   */
+  template <
+      class K, class KE = KeyEqual,
+      typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+  iterator find(const K& key) {
+    return find_impl(key, hash_key(key));
+  }
+
+  /**
+   * @copydoc find(const K& key)
+   *
+   * Use the hash value 'precalculated_hash' instead of hashing the key. The
+   * hash value should be the same as hash_function()(key). Useful to speed-up
+   * the lookup if you already have the hash.
+   */
+  template <
+      class K, class KE = KeyEqual,
+      typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+  iterator find(const K& key, std::size_t precalculated_hash) {
+    return find_impl(key, mix_hash(precalculated_hash));
+  }
+
+  /**
+   * @copydoc find(const K& key)
+   */
+  template <
+      class K, class KE = KeyEqual,
+      typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+  const_iterator find(const K& key) const {
+    return find_impl(key, hash_key(key));
+  }
+
+  /**
+   * @copydoc find(const K& key, std::size_t precalculated_hash)
+   */
+  template <
+      class K, class KE = KeyEqual,
+      typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+  const_iterator find(const K& key, std::size_t precalculated_hash) const {
+    return find_impl(key, mix_hash(precalculated_hash));
+  }
+
+  bool contains(const Key& key) const {
+    return find_impl(key, hash_key(key)) != cend();
+  }
+
+  /**
+   * Use the hash value 'precalculated_hash' instead of hashing the key. The
+   * hash value should be the same as hash_function()(key). Useful to speed-up
+   * the lookup if you already have the hash.
+   */
+  bool contains(const Key& key, std::size_t precalculated_hash) const {
+    return find_impl(key, mix_hash(precalculated_hash)) != cend();
+  }
+
+  /**
+   * This overload only participates in the overload resolution if the typedef
+   * KeyEqual::is_transparent exists. If so, K must be hashable and comparable
+   * to Key.
+   */
+  template <
+      class K, class KE = KeyEqual,
+      typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+  bool contains(const K& key) const {
+    return find_impl(key, hash_key(key)) != cend();
+  }
+
+  /**
+   * @copydoc contains(const K& key) const
+   *
+   * Use the hash value 'precalculated_hash' instead of hashing the key. The
+   * hash value should be the same as hash_function()(key). Useful to speed-up
+   * the lookup if you already have the hash.
+   */
+  template <
+      class K, class KE = KeyEqual,
+      typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+  bool contains(const K& key, std::size_t precalculated_hash) const {
+    return find_impl(key, mix_hash(precalculated_hash)) != cend();
+  }
+
+  std::pair<iterator, iterator> equal_range(const Key& key) {
+    return equal_range_impl(key, hash_key(key));
+  }
+
+  /**
+   * Use the hash value 'precalculated_hash' instead of hashing the key. The
+   * hash value should be the same as hash_function()(key). Useful to speed-up
+   * the lookup if you already have the hash.
+   */
+  std::pair<iterator, iterator> equal_range(const Key& key,
+                                            std::size_t precalculated_hash) {
+    return equal_range_impl(key, mix_hash(precalculated_hash));
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+    return equal_range_impl(key, hash_key(key));
+  }
+
+  /**
+   * @copydoc equal_range(const Key& key, std::size_t precalculated_hash)
+   */
+  std::pair<const_iterator, const_iterator> equal_range(
+      const Key& key, std::size_t precalculated_hash) const {
+    return equal_range_impl(key, mix_hash(precalculated_hash));
+  }
+
+  /**
+   * This overload only participates in the overload resolution if the typedef
+   * KeyEqual::is_transparent exists. If so, K must be hashable and comparable
+   * to Key.
+   */
+  template <
+      class K, class KE = KeyEqual,
+      typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+  std::pair<iterator, iterator> equal_range(const K& key) {
+    return equal_range_impl(key, hash_key(key));
+  }
+
+  /**
+   * @copydoc equal_range(const K& key)
+   *
+   * Use the hash value 'precalculated_hash' instead of hashing the key. The
+   * hash value should be the same as hash_function()(key). Useful to speed-up
+   * the lookup if you already have the hash.
+   */
+  template <
+      class K, class KE = KeyEqual,
+      typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+  std::pair<iterator, iterator> equal_range(const K& key,
+                                            std::size_t precalculated_hash) {
+    return equal_range_impl(key, mix_hash(precalculated_hash));
+  }
+
+  /**
+   * @copydoc equal_range(const K& key)
+   */
+  template <
+      class K, class KE = KeyEqual,
+      typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+  std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+    return equal_range_impl(key, hash_key(key));
+  }
+
+  /**
+   * @copydoc equal_range(const K& key, std::size_t precalculated_hash)
+   */
+  template <
+      class K, class KE = KeyEqual,
+      typename std::enable_if<has_is_transparent<KE>::value>::type* = nullptr>
+  std::pair<const_iterator, const_iterator> equal_range(
+      const K& key, std::size_t precalculated_hash) const {
+    return equal_range_impl(key, mix_hash(precalculated_hash));
+  }
+
+  /*
+   * Bucket interface
+   */
+  size_type bucket_count() const {
+    if (m_slots.empty()) {
+      return 0;
+    }
+
+    return m_slots.size() - NeighborhoodSize + 1;
+  }
+
+  size_type max_bucket_count() const {
+    const std::size_t max_bucket_count =
+        std::min(GrowthPolicy::max_bucket_count(), m_slots.max_size());
+    return max_bucket_count - NeighborhoodSize + 1;
+  }
+
+  /*
+   *  Hash policy
+   */
+  float load_factor() const {
+    if (bucket_count() == 0) {
+      return 0;
+    }
+
+    return float(m_nb_elements) / float(bucket_count());
+  }
+
+  float max_load_factor() const { return m_max_load_factor; }
+
+  void max_load_factor(float ml) {
+    m_max_load_factor = std::max(0.1f, std::min(ml, 0.95f));
+    m_min_load_threshold_rehash =
+        size_type(float(bucket_count()) * MIN_LOAD_FACTOR_FOR_REHASH);
+    m_max_load_threshold_rehash =
+        size_type(float(bucket_count()) * m_max_load_factor);
+  }
+
+  void rehash(size_type count_) {
+    count_ = std::max(count_,
+                      size_type(std::ceil(float(size()) / max_load_factor())));
+    rehash_impl(count_);
+  }
+
+  void reserve(size_type count_) {
+    rehash(size_type(std::ceil(float(count_) / max_load_factor())));
+  }
+
+  /*
+   * Observers
+   */
+  hasher hash_function() const { return static_cast<const Hash&>(*this); }
+  key_equal key_eq() const { return static_cast<const KeyEqual&>(*this); }
+
+  /*
+   * Other
+   */
+
+  /**
+   * Convert a const_iterator to an iterator.
+   */
+  iterator mutable_iterator(const_iterator pos) {
+    return iterator(this, pos.m_ibucket,
+                    m_overflow_elements.erase(pos.m_overflow_iterator,
+                                              pos.m_overflow_iterator));
+  }
+
+  size_type overflow_size() const noexcept {
+    return m_overflow_elements.size();
+  }
+
+  friend bool operator==(const hopscotch_soa_map& lhs,
+                         const hopscotch_soa_map& rhs) {
+    if (lhs.size() != rhs.size()) {
+      return false;
+    }
+
+    for (const auto& element_lhs : lhs) {
+      const auto it_element_rhs = rhs.find(element_lhs.first);
+      if (it_element_rhs == rhs.cend() ||
+          element_lhs.second != it_element_rhs->second) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  friend bool operator!=(const hopscotch_soa_map& lhs,
+                         const hopscotch_soa_map& rhs) {
+    return !operator==(lhs, rhs);
+  }
+
+  friend void swap(hopscotch_soa_map& lhs,
+                   hopscotch_soa_map& rhs) noexcept(noexcept(lhs.swap(rhs))) {
+    lhs.swap(rhs);
+  }
+
+ private:
+  /**
+   * Hash of key as used in the table, mixed like in hopscotch_hash (see
+   * needs_hash_mixing).
+   */
+  template <class K>
+  std::size_t hash_key(const K& key) const {
+    return mix_hash(Hash::operator()(key));
+  }
+
+  static std::size_t mix_hash(std::size_t hash) noexcept {
+    if constexpr (tsl::detail_hopscotch_hash::needs_hash_mixing<
+                      Hash, GrowthPolicy>::value) {
+      return tsl::detail_hopscotch_hash::mix_hash_bits(hash);
+    } else {
+      return hash;
+    }
+  }
+
+  template <class K1, class K2>
+  bool compare_keys(const K1& key1, const K2& key2) const {
+    return KeyEqual::operator()(key1, key2);
+  }
+
+  std::size_t bucket_for_hash(std::size_t hash) const {
+    const std::size_t bucket = GrowthPolicy::bucket_for_hash(hash);
+    tsl_hh_assert(bucket < m_slots.size() || (bucket == 0 && m_slots.empty()));
+
+    return bucket;
+  }
+
+  /**
+   * Return the hash fragment stored for a value with the hash 'hash'. The most
+   * significant bit is always set so that a fragment is never equal to 0,
+   * which marks an empty bucket. The other bits are taken from the bits of
+   * the hash the growth policy doesn't use to map the hash to a bucket,
+   * otherwise all the values of a neighborhood would mostly share the same
+   * fragment.
+   */
+  static std::uint8_t hash_fragment(std::size_t hash) noexcept {
+    constexpr std::size_t shift = sizeof(std::size_t) * CHAR_BIT - 7;
+
+    if constexpr (tsl::detail_hopscotch_hash::is_power_of_two_policy<
+                      GrowthPolicy>::value) {
+      return std::uint8_t(0x80 | (hash >> shift));
+    } else if constexpr (tsl::detail_hopscotch_hash::is_fastrange_policy<
+                             GrowthPolicy>::value) {
+      return std::uint8_t(0x80 | (hash & 0x7F));
+    } else {
+      return std::uint8_t(
+          0x80 | (tsl::detail_hopscotch_hash::mix_hash_bits(hash) >> shift));
+    }
+  }
+
+  std::size_t nb_buckets() const noexcept { return m_slots.size(); }
+
+  bool bucket_empty(std::size_t ibucket) const noexcept {
+    return m_fragments[ibucket] == 0;
+  }
+
+  value_type& bucket_value(std::size_t ibucket) noexcept {
+    tsl_hh_assert(!bucket_empty(ibucket));
+    return *std::launder(
+        reinterpret_cast<value_type*>(m_slots[ibucket].m_storage));
+  }
+
+  const value_type& bucket_value(std::size_t ibucket) const noexcept {
+    tsl_hh_assert(!bucket_empty(ibucket));
+    return *std::launder(
+        reinterpret_cast<const value_type*>(m_slots[ibucket].m_storage));
+  }
+
+  std::uint64_t neighborhood_infos(std::size_t ibucket) const noexcept {
+    return std::uint64_t(m_neighborhoods[ibucket] >>
+                         NB_RESERVED_BITS_IN_NEIGHBORHOOD);
+  }
+
+  bool has_overflow(std::size_t ibucket) const noexcept {
+    return (m_neighborhoods[ibucket] & 1) != 0;
+  }
+
+  void set_overflow(std::size_t ibucket, bool has_overflow) noexcept {
+    if (has_overflow) {
+      m_neighborhoods[ibucket] =
+          neighborhood_bitmap(m_neighborhoods[ibucket] | 1);
+    } else {
+      m_neighborhoods[ibucket] =
+          neighborhood_bitmap(m_neighborhoods[ibucket] & ~1);
+    }
+  }
+
+  void toggle_neighbor_presence(std::size_t ibucket,
+                                std::size_t ineighbor) noexcept {
+    tsl_hh_assert(ineighbor < NeighborhoodSize);
+    m_neighborhoods[ibucket] = neighborhood_bitmap(
+        m_neighborhoods[ibucket] ^
+        (1ull << (ineighbor + NB_RESERVED_BITS_IN_NEIGHBORHOOD)));
+  }
+
+  std::size_t next_non_empty_bucket(std::size_t ibucket) const noexcept {
+    while (ibucket < nb_buckets() && bucket_empty(ibucket)) {
+      ibucket++;
+    }
+
+    return ibucket;
+  }
+
+  /**
+   * Destroy the values in the non-empty buckets of [0, ibucket_end). The
+   * buckets are not marked as empty.
+   */
+  void destroy_bucket_values(std::size_t ibucket_end) noexcept {
+    if (std::is_trivially_destructible<value_type>::value) {
+      return;
+    }
+
+    for (std::size_t ibucket = 0; ibucket < ibucket_end; ibucket++) {
+      if (!bucket_empty(ibucket)) {
+        bucket_value(ibucket).~value_type();
+      }
+    }
+  }
+
+  template <typename U = value_type,
+            typename std::enable_if<
+                std::is_nothrow_move_constructible<U>::value>::type* = nullptr>
+  void rehash_impl(size_type count_) {
+    hopscotch_soa_map new_map = new_hopscotch_soa_map(count_);
+
+    if (!m_overflow_elements.empty()) {
+      new_map.m_overflow_elements.swap(m_overflow_elements);
+      new_map.m_nb_elements += new_map.m_overflow_elements.size();
+      new_map.rebuild_overflow_home_buckets();
+    }
+
+#ifndef TSL_HH_NO_EXCEPTIONS
+    try {
+#endif
+      for (std::size_t ibucket = 0; ibucket < nb_buckets(); ibucket++) {
+        if (bucket_empty(ibucket)) {
+          continue;
+        }
+
+        const std::size_t hash =
+            new_map.hash_key(bucket_value(ibucket).first);
+        new_map.insert_value(new_map.bucket_for_hash(hash), hash,
+                             std::move(bucket_value(ibucket)));
+
+        erase_from_bucket(ibucket, bucket_for_hash(hash));
+      }
+#ifndef TSL_HH_NO_EXCEPTIONS
+    }
+    /*
+     * The call to insert_value may throw an exception if an element is added to
+     * the overflow list and the memory allocation fails. Rollback the elements
+     * in this case.
+     */
+    catch (...) {
+      m_overflow_elements.swap(new_map.m_overflow_elements);
+      rebuild_overflow_home_buckets();
+
+      for (std::size_t ibucket = 0; ibucket < new_map.nb_buckets();
+           ibucket++) {
+        if (new_map.bucket_empty(ibucket)) {
+          continue;
+        }
+
+        const std::size_t hash = hash_key(new_map.bucket_value(ibucket).first);
+
+        // The elements we insert were not in the overflow list before the
+        // switch. They will not be go in the overflow list if we rollback the
+        // switch.
+        insert_value(bucket_for_hash(hash), hash,
+                     std::move(new_map.bucket_value(ibucket)));
+      }
+
+      throw;
+    }
+#endif
+
+    new_map.swap(*this);
+  }
+
+  template <typename U = value_type,
+            typename std::enable_if<
+                std::is_copy_constructible<U>::value &&
+                !std::is_nothrow_move_constructible<U>::value>::type* = nullptr>
+  void rehash_impl(size_type count_) {
+    hopscotch_soa_map new_map = new_hopscotch_soa_map(count_);
+
+    for (std::size_t ibucket = 0; ibucket < nb_buckets(); ibucket++) {
+      if (bucket_empty(ibucket)) {
+        continue;
+      }
+
+      const std::size_t hash = new_map.hash_key(bucket_value(ibucket).first);
+      new_map.insert_value(new_map.bucket_for_hash(hash), hash,
+                           bucket_value(ibucket));
+    }
+
+    for (auto it = m_overflow_elements.cbegin();
+         it != m_overflow_elements.cend(); ++it) {
+      const std::size_t hash = m_overflow_elements.hash(it);
+      new_map.insert_value(new_map.bucket_for_hash(hash), hash, *it);
+    }
+
+    new_map.swap(*this);
+  }
+
+  hopscotch_soa_map new_hopscotch_soa_map(size_type bucket_count) {
+    hopscotch_soa_map new_map(bucket_count, static_cast<Hash&>(*this),
+                              static_cast<KeyEqual&>(*this), get_allocator());
+    new_map.max_load_factor(m_max_load_factor);
+
+    return new_map;
+  }
+
+  /**
+   * Set the overflow flag of the home bucket of each overflow element, and
+   * reindex the overflow elements on their home bucket, after they were moved
+   * to a table with another bucket count. Doesn't allocate.
+   */
+  void rebuild_overflow_home_buckets() noexcept {
+    m_overflow_elements.reindex([&](std::size_t& hash, const value_type&) {
+      const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+      set_overflow(ibucket_for_hash, true);
+
+      return ibucket_for_hash;
+    });
+  }
+
+  // iterator is in overflow list
+  iterator_overflow erase_from_overflow(const_iterator_overflow pos) {
+    const std::size_t ibucket_for_hash =
+        bucket_for_hash(m_overflow_elements.hash(pos));
+
+    auto it_next = m_overflow_elements.erase(pos);
+    m_nb_elements--;
+
+    // Check if we can remove the overflow flag
+    tsl_hh_assert(has_overflow(ibucket_for_hash));
+    if (!m_overflow_elements.has_bucket(ibucket_for_hash)) {
+      set_overflow(ibucket_for_hash, false);
+    }
+
+    return it_next;
+  }
+
+  /**
+   * ibucket_for_value is the bucket in which the value is.
+   * ibucket_for_hash is the bucket where the value belongs.
+   */
+  void erase_from_bucket(std::size_t ibucket_for_value,
+                         std::size_t ibucket_for_hash) noexcept {
+    tsl_hh_assert(ibucket_for_value >= ibucket_for_hash);
+
+    bucket_value(ibucket_for_value).~value_type();
+    m_fragments[ibucket_for_value] = 0;
+    toggle_neighbor_presence(ibucket_for_hash,
+                             ibucket_for_value - ibucket_for_hash);
+    m_nb_elements--;
+  }
+
+  template <class K>
+  size_type erase_impl(const K& key, std::size_t hash) {
+    const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+
+    const std::size_t ibucket_found =
+        find_in_buckets(key, hash, ibucket_for_hash);
+    if (ibucket_found != nb_buckets()) {
+      erase_from_bucket(ibucket_found, ibucket_for_hash);
+
+      return 1;
+    }
+
+    if (!m_slots.empty() && has_overflow(ibucket_for_hash)) {
+      auto it_overflow = find_in_overflow(key, hash, ibucket_for_hash);
+      if (it_overflow != m_overflow_elements.cend()) {
+        erase_from_overflow(it_overflow);
+
+        return 1;
+      }
+    }
+
+    return 0;
+  }
+
+  template <class K, class M>
+  std::pair<iterator, bool> insert_or_assign_impl(K&& key, M&& obj) {
+    auto it = try_emplace_impl(std::forward<K>(key), std::forward<M>(obj));
+    if (!it.second) {
+      it.first.value() = std::forward<M>(obj);
+    }
+
+    return it;
+  }
+
+  template <typename P, class... Args>
+  std::pair<iterator, bool> try_emplace_impl(P&& key, Args&&... args_value) {
+    const std::size_t hash = hash_key(key);
+
+    // Check if already presents
+    auto it_find = find_impl(key, hash);
+    if (it_find != end()) {
+      return std::make_pair(it_find, false);
+    }
+
+    return insert_value(
+        bucket_for_hash(hash), hash, std::piecewise_construct,
+        std::forward_as_tuple(std::forward<P>(key)),
+        std::forward_as_tuple(std::forward<Args>(args_value)...));
+  }
+
+  template <typename P>
+  std::pair<iterator, bool> insert_impl(P&& value) {
+    const std::size_t hash = hash_key(value.first);
+
+    // Check if already presents
+    auto it_find = find_impl(value.first, hash);
+    if (it_find != end()) {
+      return std::make_pair(it_find, false);
+    }
+
+    return insert_value(bucket_for_hash(hash), hash, std::forward<P>(value));
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> insert_value(std::size_t ibucket_for_hash,
+                                         std::size_t hash,
+                                         Args&&... value_type_args) {
+    if ((m_nb_elements - m_overflow_elements.size()) >=
+        m_max_load_threshold_rehash) {
+      rehash(GrowthPolicy::next_bucket_count());
+      ibucket_for_hash = bucket_for_hash(hash);
+    }
+
+    std::size_t ibucket_empty = find_empty_bucket(ibucket_for_hash);
+    if (ibucket_empty < nb_buckets()) {
+      do {
+        tsl_hh_assert(ibucket_empty >= ibucket_for_hash);
+
+        // Empty bucket is in range of NeighborhoodSize, use it
+        if (ibucket_empty - ibucket_for_hash < NeighborhoodSize) {
+          insert_in_bucket(ibucket_empty, ibucket_for_hash, hash,
+                           std::forward<Args>(value_type_args)...);
+          return std::make_pair(
+              iterator(this, ibucket_empty, m_overflow_elements.begin()),
+              true);
+        }
+      }
+      // else, try to swap values to get a closer empty bucket
+      while (swap_empty_bucket_closer(ibucket_empty));
+    }
+
+    // Load factor is too low or a rehash will not change the neighborhood, put
+    // the value in overflow list
+    if (size() < m_min_load_threshold_rehash ||
+        !will_neighborhood_change_on_rehash(ibucket_for_hash)) {
+      auto it = m_overflow_elements.emplace(
+          ibucket_for_hash, hash, std::forward<Args>(value_type_args)...);
+
+      set_overflow(ibucket_for_hash, true);
+      m_nb_elements++;
+
+      return std::make_pair(iterator(this, nb_buckets(), it), true);
+    }
+
+    rehash(GrowthPolicy::next_bucket_count());
+    ibucket_for_hash = bucket_for_hash(hash);
+
+    return insert_value(ibucket_for_hash, hash,
+                        std::forward<Args>(value_type_args)...);
+  }
+
+  /*
+   * Return true if a rehash will change the position of a key-value in the
+   * neighborhood of ibucket_neighborhood_check. In this case a rehash is needed
+   * instead of puting the value in overflow list.
+   */
+  bool will_neighborhood_change_on_rehash(
+      std::size_t ibucket_neighborhood_check) const {
+    std::size_t expand_bucket_count = GrowthPolicy::next_bucket_count();
+    GrowthPolicy expand_growth_policy(expand_bucket_count);
+
+    for (std::size_t ibucket = ibucket_neighborhood_check;
+         ibucket < nb_buckets() &&
+         (ibucket - ibucket_neighborhood_check) < NeighborhoodSize;
+         ++ibucket) {
+      tsl_hh_assert(!bucket_empty(ibucket));
+
+      const std::size_t hash = hash_key(bucket_value(ibucket).first);
+      if (bucket_for_hash(hash) != expand_growth_policy.bucket_for_hash(hash)) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /*
+   * Return the index of an empty bucket in [ibucket_start, ibucket_start +
+   * MAX_PROBES_FOR_EMPTY_BUCKET). If none, the returned index equals
+   * nb_buckets(). Empty buckets have a 0 fragment, they are searched 64 at a
+   * time.
+   */
+  std::size_t find_empty_bucket(std::size_t ibucket_start) const {
+    const std::size_t limit =
+        std::min(ibucket_start + MAX_PROBES_FOR_EMPTY_BUCKET, nb_buckets());
+    for (; ibucket_start < limit; ibucket_start += 64) {
+      const std::uint64_t empty_buckets =
+          tsl::detail_hopscotch_hash::fragments_equal_mask(
+              m_fragments.data() + ibucket_start, 0,
+              std::min(std::size_t(64), limit - ibucket_start));
+      if (empty_buckets != 0) {
+        return ibucket_start +
+               tsl::detail_hopscotch_hash::count_trailing_zeros(empty_buckets);
+      }
+    }
+
+    return nb_buckets();
+  }
+
+  /*
+   * Insert value in ibucket_empty where value originally belongs to
+   * ibucket_for_hash
+   */
+  template <typename... Args>
+  void insert_in_bucket(std::size_t ibucket_empty, std::size_t ibucket_for_hash,
+                        std::size_t hash, Args&&... value_type_args) {
+    tsl_hh_assert(ibucket_empty >= ibucket_for_hash);
+    tsl_hh_assert(bucket_empty(ibucket_empty));
+
+    ::new (static_cast<void*>(m_slots[ibucket_empty].m_storage))
+        value_type(std::forward<Args>(value_type_args)...);
+    m_fragments[ibucket_empty] = hash_fragment(hash);
+
+    toggle_neighbor_presence(ibucket_for_hash,
+                             ibucket_empty - ibucket_for_hash);
+    m_nb_elements++;
+  }
+
+  /*
+   * Try to swap the bucket ibucket_empty_in_out with a bucket preceding it
+   * while keeping the neighborhood conditions correct.
+   *
+   * If a swap was possible, the position of ibucket_empty_in_out will be closer
+   * to 0 and true will re returned.
+   */
+  bool swap_empty_bucket_closer(std::size_t& ibucket_empty_in_out) {
+    tsl_hh_assert(ibucket_empty_in_out >= NeighborhoodSize);
+    const std::size_t neighborhood_start =
+        ibucket_empty_in_out - NeighborhoodSize + 1;
+
+    for (std::size_t to_check = neighborhood_start;
+         to_check < ibucket_empty_in_out; to_check++) {
+      std::uint64_t neighborhood = neighborhood_infos(to_check);
+      std::size_t to_swap = to_check;
+
+      while (neighborhood != 0 && to_swap < ibucket_empty_in_out) {
+        if ((neighborhood & 1) == 1) {
+          tsl_hh_assert(bucket_empty(ibucket_empty_in_out));
+          tsl_hh_assert(!bucket_empty(to_swap));
+
+          ::new (static_cast<void*>(m_slots[ibucket_empty_in_out].m_storage))
+              value_type(std::move(bucket_value(to_swap)));
+          m_fragments[ibucket_empty_in_out] = m_fragments[to_swap];
+
+          bucket_value(to_swap).~value_type();
+          m_fragments[to_swap] = 0;
+
+          toggle_neighbor_presence(to_check, ibucket_empty_in_out - to_check);
+          toggle_neighbor_presence(to_check, to_swap - to_check);
+
+          ibucket_empty_in_out = to_swap;
+
+          return true;
+        }
+
+        to_swap++;
+        neighborhood >>= 1;
+      }
+    }
+
+    return false;
+  }
+
+  /**
+   * Return the index of the bucket which has the value, nb_buckets()
+   * otherwise.
+   *
+   * The hash fragments of the whole neighborhood are compared at once, only
+   * the values of the buckets with a matching fragment are read.
+   */
+  template <class K>
+  std::size_t find_in_buckets(const K& key, std::size_t hash,
+                              std::size_t ibucket_for_hash) const {
+    if (m_slots.empty()) {
+      return nb_buckets();
+    }
+
+    std::uint64_t neighborhood = neighborhood_infos(ibucket_for_hash);
+    if (neighborhood == 0) {
+      return nb_buckets();
+    }
+
+    neighborhood &= tsl::detail_hopscotch_hash::fragments_equal_mask(
+        m_fragments.data() + ibucket_for_hash, hash_fragment(hash),
+        NeighborhoodSize);
+    while (neighborhood != 0) {
+      const std::size_t ibucket =
+          ibucket_for_hash +
+          tsl::detail_hopscotch_hash::count_trailing_zeros(neighborhood);
+      if (compare_keys(bucket_value(ibucket).first, key)) {
+        return ibucket;
+      }
+
+      // Clear the least significant bit set to 1.
+      neighborhood &= neighborhood - 1;
+    }
+
+    return nb_buckets();
+  }
+
+  template <class K>
+  iterator find_impl(const K& key, std::size_t hash) {
+    const const_iterator it =
+        static_cast<const hopscotch_soa_map*>(this)->find_impl(key, hash);
+    return mutable_iterator(it);
+  }
+
+  template <class K>
+  const_iterator find_impl(const K& key, std::size_t hash) const {
+    const std::size_t ibucket_for_hash = bucket_for_hash(hash);
+
+    const std::size_t ibucket_found =
+        find_in_buckets(key, hash, ibucket_for_hash);
+    if (ibucket_found != nb_buckets()) {
+      return const_iterator(this, ibucket_found,
+                            m_overflow_elements.cbegin());
+    }
+
+    if (m_slots.empty() || !has_overflow(ibucket_for_hash)) {
+      return cend();
+    }
+
+    return const_iterator(this, nb_buckets(),
+                          find_in_overflow(key, hash, ibucket_for_hash));
+  }
+
+  /**
+   * Only the overflow elements of ibucket_for_hash with the same hash are
+   * compared to key.
+   */
+  template <class K>
+  const_iterator_overflow find_in_overflow(const K& key, std::size_t hash,
+                                           std::size_t ibucket_for_hash) const {
+    return m_overflow_elements.find(
+        ibucket_for_hash, [&](std::size_t stored_hash, const value_type& value) {
+          return stored_hash == hash && compare_keys(key, value.first);
+        });
+  }
+
+  template <class K>
+  std::pair<iterator, iterator> equal_range_impl(const K& key,
+                                                 std::size_t hash) {
+    iterator it = find_impl(key, hash);
+    return std::make_pair(it, (it == end()) ? it : std::next(it));
+  }
+
+  template <class K>
+  std::pair<const_iterator, const_iterator> equal_range_impl(
+      const K& key, std::size_t hash) const {
+    const_iterator it = find_impl(key, hash);
+    return std::make_pair(it, (it == cend()) ? it : std::next(it));
+  }
+
+ public:
+  static const size_type DEFAULT_INIT_BUCKETS_SIZE = 0;
+  static constexpr float DEFAULT_MAX_LOAD_FACTOR =
+      (NeighborhoodSize <= 30) ? 0.8f : 0.9f;
+
+ private:
+  static const std::size_t MAX_PROBES_FOR_EMPTY_BUCKET = 12 * NeighborhoodSize;
+  static constexpr float MIN_LOAD_FACTOR_FOR_REHASH = 0.1f;
+
+  /**
+   * Number of zero bytes after the fragments of the last bucket so that the
+   * SIMD loads of a neighborhood can always read 64 bytes.
+   */
+  static const std::size_t FRAGMENTS_PADDING = 64;
+
+ private:
+  std::vector<neighborhood_bitmap, neighborhoods_allocator> m_neighborhoods;
+  std::vector<std::uint8_t, fragments_allocator> m_fragments;
+  std::vector<value_slot, slots_allocator> m_slots;
+  overflow_container_type m_overflow_elements;
+
+  size_type m_nb_elements;
+
+  /**
+   * Min size of the hash table before a rehash can occurs automatically (except
+   * if m_max_load_threshold_rehash os reached). If the neighborhood of a bucket
+   * is full before the min is reacher, the elements are put into
+   * m_overflow_elements.
+   */
+  size_type m_min_load_threshold_rehash;
+
+  /**
+   * Max size of the hash table before a rehash occurs automatically to grow the
+   * table.
+   */
+  size_type m_max_load_threshold_rehash;
+
+  float m_max_load_factor;
+};
+
+}  // end namespace tsl
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_HOPSCOTCH_THREAD_EXECUTOR_H
+#define TSL_HOPSCOTCH_THREAD_EXECUTOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace tsl {
+namespace hh {
+
+/**
+ * Executor for parallel_rehash and parallel_reserve running the tasks on up to
+ * nb_threads threads, the calling thread included. The threads are created on
+ * each call.
+ *
+ * Any executor with the same call signature can be used instead, e.g. to run
+ * the tasks on an existing thread pool. The call must run task(itask) once for
+ * each itask in [0, nb_tasks) and only return once all the tasks returned.
+ */
+class thread_executor {
+ public:
+  explicit thread_executor(
+      std::size_t nb_threads = std::thread::hardware_concurrency())
+      : m_nb_threads(std::max(nb_threads, std::size_t(1))) {}
+
+  template <class Task>
+  void operator()(std::size_t nb_tasks, const Task& task) const {
+    std::atomic<std::size_t> next_task(0);
+    auto worker = [&]() {
+      for (std::size_t itask = next_task++; itask < nb_tasks;
+           itask = next_task++) {
+        task(itask);
+      }
+    };
+
+    std::vector<std::thread> threads;
+    const std::size_t nb_threads = std::min(m_nb_threads, nb_tasks);
+#ifndef TSL_HH_NO_EXCEPTIONS
+    try {
+#endif
+      threads.reserve(nb_threads);
+      for (std::size_t i = 1; i < nb_threads; i++) {
+        threads.emplace_back(worker);
+      }
+#ifndef TSL_HH_NO_EXCEPTIONS
+    }
+    /*
+     * If a thread can't be created, the tasks are run by the threads already
+     * created. The caller may have started to modify its data in a previous
+     * call and counts on all the tasks being run.
+     */
+    catch (const std::system_error&) {
+    } catch (const std::bad_alloc&) {
+    }
+#endif
+
+    worker();
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+
+  std::size_t nb_threads() const noexcept { return m_nb_threads; }
+
+ private:
+  std::size_t m_nb_threads;
+};
+
+}  // namespace hh
+}  // namespace tsl
+
+#endif
@@ -0,0 +1,427 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_INCREMENTAL_HOPSCOTCH_MAP_H
+#define TSL_INCREMENTAL_HOPSCOTCH_MAP_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "hopscotch_hash.h"
+
+namespace tsl {
+
+/**
+ * Hash map using the hopscotch hashing algorithm with an incremental rehash,
+ * to bound the worst-case latency of an insertion.
+ *
+ * When an insertion would rehash the map, because the maximum load factor is
+ * reached or because a neighborhood is full, the elements are not all moved at
+ * once to a new buckets array. The old array is kept and a new one, with
+ * GrowthPolicy::next_bucket_count() buckets, receives the new elements. Each
+ * following call to insert, insert_or_assign, operator[], erase or find (the
+ * non-const overloads) moves the elements of MigrationStep old buckets to the
+ * new array. The lookups check both arrays until the old one is empty.
+ *
+ * With the default MigrationStep and max load factor, the old array is empty
+ * well before the new one is full. If it is not, the migration is completed
+ * before growing again. A full rehash can still happen if a neighborhood of
+ * the new array is full while an element is moved to it, but it is rare with
+ * a good hash.
+ *
+ * There are no iterators as the elements are spread over two arrays, use
+ * for_each. The pointers and references to the elements are invalidated by
+ * any non-const call.
+ *
+ * The other template parameters are the same as tsl::hopscotch_map.
+ */
+template <class Key, class T, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>,
+          class Allocator = std::allocator<std::pair<Key, T>>,
+          unsigned int NeighborhoodSize = 62, bool StoreHash = false,
+          class GrowthPolicy = tsl::hh::power_of_two_growth_policy<2>,
+          std::size_t MigrationStep = 8>
+class incremental_hopscotch_map {
+ private:
+  static_assert(MigrationStep > 0, "MigrationStep should be > 0.");
+
+  class KeySelect {
+   public:
+    using key_type = Key;
+
+    const key_type& operator()(const std::pair<Key, T>& key_value) const {
+      return key_value.first;
+    }
+
+    key_type& operator()(std::pair<Key, T>& key_value) {
+      return key_value.first;
+    }
+  };
+
+  class ValueSelect {
+   public:
+    using value_type = T;
+
+    const value_type& operator()(const std::pair<Key, T>& key_value) const {
+      return key_value.second;
+    }
+
+    value_type& operator()(std::pair<Key, T>& key_value) {
+      return key_value.second;
+    }
+  };
+
+  using overflow_container_type =
+      detail_hopscotch_hash::hopscotch_overflow_table<std::pair<Key, T>,
+                                                      Allocator>;
+  using ht = detail_hopscotch_hash::hopscotch_hash<
+      std::pair<Key, T>, KeySelect, ValueSelect, Hash, KeyEqual, Allocator,
+      NeighborhoodSize, StoreHash, GrowthPolicy, overflow_container_type>;
+
+ public:
+  using key_type = typename ht::key_type;
+  using mapped_type = T;
+  using value_type = typename ht::value_type;
+  using size_type = typename ht::size_type;
+  using hasher = typename ht::hasher;
+  using key_equal = typename ht::key_equal;
+  using allocator_type = typename ht::allocator_type;
+
+  /*
+   * Constructors
+   */
+  incremental_hopscotch_map()
+      : incremental_hopscotch_map(ht::DEFAULT_INIT_BUCKETS_SIZE) {}
+
+  explicit incremental_hopscotch_map(size_type bucket_count,
+                                     const Hash& hash = Hash(),
+                                     const KeyEqual& equal = KeyEqual(),
+                                     const Allocator& alloc = Allocator())
+      : m_ht(bucket_count, hash, equal, alloc, ht::DEFAULT_MAX_LOAD_FACTOR),
+        m_old_ht(0, hash, equal, alloc, ht::DEFAULT_MAX_LOAD_FACTOR),
+        m_ibucket_migration(0) {}
+
+  /*
+   * Capacity
+   */
+  bool empty() const noexcept { return size() == 0; }
+  size_type size() const noexcept { return m_ht.size() + m_old_ht.size(); }
+  size_type max_size() const noexcept { return m_ht.max_size(); }
+
+  /*
+   * Modifiers
+   */
+  void clear() noexcept {
+    m_ht.clear();
+    m_old_ht.clear();
+    m_ibucket_migration = 0;
+  }
+
+  /**
+   * Insert the value if its key is not in the map. Return true if the value
+   * was inserted.
+   */
+  bool insert(const value_type& value) { return insert_impl(value); }
+  bool insert(value_type&& value) { return insert_impl(std::move(value)); }
+
+  /**
+   * Insert the key-value or assign obj to the existing key. Return true if the
+   * key-value was inserted, false if it was assigned.
+   */
+  template <class M>
+  bool insert_or_assign(const key_type& k, M&& obj) {
+    migrate_step();
+
+    const std::size_t hash = m_ht.hash_function()(k);
+    T* value = find_value(k, hash);
+    if (value != nullptr) {
+      *value = std::forward<M>(obj);
+      return false;
+    }
+
+    insert_new_value(hash, k, std::forward<M>(obj));
+    return true;
+  }
+
+  size_type erase(const key_type& key) {
+    migrate_step();
+
+    const std::size_t hash = m_ht.hash_function()(key);
+    if (m_ht.erase(key, hash) == 1) {
+      return 1;
+    }
+
+    return m_old_ht.erase(key, hash);
+  }
+
+  /*
+   * Lookup
+   */
+  T& at(const Key& key) {
+    migrate_step();
+    return at_impl(find_value(key));
+  }
+
+  const T& at(const Key& key) const { return at_impl(find(key)); }
+
+  T& operator[](const Key& key) {
+    migrate_step();
+
+    const std::size_t hash = m_ht.hash_function()(key);
+    T* value = find_value(key, hash);
+    if (value != nullptr) {
+      return *value;
+    }
+
+    return insert_new_value(hash, std::piecewise_construct,
+                            std::forward_as_tuple(key),
+                            std::forward_as_tuple());
+  }
+
+  size_type count(const Key& key) const {
+    return (find(key) != nullptr) ? 1 : 0;
+  }
+
+  bool contains(const Key& key) const { return find(key) != nullptr; }
+
+  /**
+   * Return a pointer to the value of the key, nullptr if the key is not in the
+   * map.
+   */
+  T* find(const Key& key) {
+    migrate_step();
+    return find_value(key);
+  }
+
+  /**
+   * Same as find(key), but no element is moved from the old buckets array.
+   */
+  const T* find(const Key& key) const { return find_value(key); }
+
+  /**
+   * Call f(const key_type&, mapped_type&) on each element of the map.
+   */
+  template <class F>
+  void for_each(F f) {
+    for (auto it = m_ht.begin(); it != m_ht.end(); ++it) {
+      f(it->first, it.value());
+    }
+    for (auto it = m_old_ht.begin(); it != m_old_ht.end(); ++it) {
+      f(it->first, it.value());
+    }
+  }
+
+  template <class F>
+  void for_each(F f) const {
+    for (auto it = m_ht.cbegin(); it != m_ht.cend(); ++it) {
+      f(it->first, it->second);
+    }
+    for (auto it = m_old_ht.cbegin(); it != m_old_ht.cend(); ++it) {
+      f(it->first, it->second);
+    }
+  }
+
+  /*
+   * Bucket interface
+   */
+  size_type bucket_count() const { return m_ht.bucket_count(); }
+
+  /*
+   * Hash policy
+   */
+  float load_factor() const { return m_ht.load_factor(); }
+  float max_load_factor() const { return m_ht.max_load_factor(); }
+
+  void max_load_factor(float ml) {
+    m_ht.max_load_factor(ml);
+    m_old_ht.max_load_factor(ml);
+  }
+
+  /**
+   * Complete the pending migration, if any, then rehash as
+   * tsl::hopscotch_map::rehash does.
+   */
+  void rehash(size_type count_) {
+    complete_migration();
+    m_ht.rehash(count_);
+  }
+
+  void reserve(size_type count_) {
+    complete_migration();
+    m_ht.reserve(count_);
+  }
+
+  /*
+   * Observers
+   */
+  hasher hash_function() const { return m_ht.hash_function(); }
+  key_equal key_eq() const { return m_ht.key_eq(); }
+  allocator_type get_allocator() const { return m_ht.get_allocator(); }
+
+  /*
+   * Other
+   */
+
+  /**
+   * Return true if elements remain to be moved from the old buckets array.
+   */
+  bool is_migrating() const noexcept { return !m_old_ht.empty(); }
+
+  /**
+   * Move all the remaining elements of the old buckets array.
+   */
+  void complete_migration() {
+    while (!m_old_ht.migrate_buckets_to(m_ht, m_ibucket_migration,
+                                        MigrationStep)) {
+    }
+    release_old_buckets();
+  }
+
+  size_type overflow_size() const noexcept {
+    return m_ht.overflow_size() + m_old_ht.overflow_size();
+  }
+
+ private:
+  template <class U>
+  static U& at_impl(U* value) {
+    if (value == nullptr) {
+      TSL_HH_THROW_OR_TERMINATE(std::out_of_range, "Couldn't find key.");
+    }
+
+    return *value;
+  }
+
+  template <class P>
+  bool insert_impl(P&& value) {
+    migrate_step();
+
+    const std::size_t hash = m_ht.hash_function()(KeySelect()(value));
+    if (find_value(KeySelect()(value), hash) != nullptr) {
+      return false;
+    }
+
+    insert_new_value(hash, std::forward<P>(value));
+    return true;
+  }
+
+  T* find_value(const Key& key) {
+    return find_value(key, m_ht.hash_function()(key));
+  }
+
+  T* find_value(const Key& key, std::size_t hash) {
+    auto it = m_ht.find(key, hash);
+    if (it != m_ht.end()) {
+      return &it.value();
+    }
+
+    if (is_migrating()) {
+      auto it_old = m_old_ht.find(key, hash);
+      if (it_old != m_old_ht.end()) {
+        return &it_old.value();
+      }
+    }
+
+    return nullptr;
+  }
+
+  const T* find_value(const Key& key) const {
+    return find_value(key, m_ht.hash_function()(key));
+  }
+
+  const T* find_value(const Key& key, std::size_t hash) const {
+    auto it = m_ht.find(key, hash);
+    if (it != m_ht.cend()) {
+      return &it.value();
+    }
+
+    if (is_migrating()) {
+      auto it_old = m_old_ht.find(key, hash);
+      if (it_old != m_old_ht.cend()) {
+        return &it_old.value();
+      }
+    }
+
+    return nullptr;
+  }
+
+  void migrate_step() {
+    if (is_migrating() &&
+        m_old_ht.migrate_buckets_to(m_ht, m_ibucket_migration,
+                                    MigrationStep)) {
+      release_old_buckets();
+    }
+  }
+
+  /**
+   * Insert a value whose key is in neither table. If m_ht would need a rehash,
+   * start a migration to a new buckets array instead and insert the value in
+   * it.
+   */
+  template <class... Args>
+  T& insert_new_value(std::size_t hash, Args&&... args) {
+    // The arguments are not moved from if the insertion fails.
+    auto it = m_ht.insert_new_value_without_rehash(
+        hash, std::forward<Args>(args)...);
+    if (it.second) {
+      return it.first.value();
+    }
+
+    start_migration();
+    return m_ht.insert_new_value(hash, std::forward<Args>(args)...)
+        .first.value();
+  }
+
+  void start_migration() {
+    complete_migration();
+
+    ht new_ht = m_ht.new_grown_hopscotch_hash();
+    m_old_ht.swap(m_ht);
+    m_ht.swap(new_ht);
+    m_ibucket_migration = 0;
+  }
+
+  void release_old_buckets() {
+    m_old_ht.clear();
+    m_old_ht.rehash(0);
+    m_ibucket_migration = 0;
+  }
+
+ private:
+  ht m_ht;
+
+  /**
+   * Buckets array being emptied into m_ht, with no bucket if there is no
+   * migration in progress. The buckets before m_ibucket_migration are empty.
+   */
+  ht m_old_ht;
+  std::size_t m_ibucket_migration;
+};
+
+}  // end namespace tsl
+
+#endif
@@ -0,0 +1,510 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_SHARDED_HOPSCOTCH_MAP_H
+#define TSL_SHARDED_HOPSCOTCH_MAP_H
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "hopscotch_map.h"
+
+namespace tsl {
+
+/**
+ * Hash map split in NbShards independent tsl::hopscotch_map, each with its own
+ * mutex, so that several threads can insert and erase at the same time as long
+ * as they work on different shards.
+ *
+ * The key is hashed once. The shard is selected with bits of the hash that
+ * the growth policy of the shards doesn't use to find the bucket (the high
+ * bits with power_of_two_growth_policy, the low bits with
+ * fastrange_growth_policy, the high bits of the mixed hash otherwise), and the
+ * same hash is then passed to the shard as a precalculated hash.
+ *
+ * The insert, erase and lookup methods lock the shard of the key for the
+ * duration of the operation. The batch methods group the keys by shard first
+ * and lock each shard only once for all its keys.
+ *
+ * A thread which owns a shard, i.e. no other thread accesses it, can also use
+ * the map of the shard directly without any lock through shard(), e.g.
+ * `map.shard(map.shard_for_hash(hash)).insert(value, hash)` with
+ * `hash = map.hash_function()(value.first)`.
+ *
+ * Each shard is aligned on a cache line so that the mutexes and the maps of
+ * two shards never share a cache line.
+ *
+ * There are no iterators, the values are returned by copy. The methods which
+ * look at all the shards (size, clear, reserve, ...) lock them one after the
+ * other, they are not atomic relative to the other operations.
+ *
+ * NbShards must be a power of two. The other template parameters are the same
+ * as tsl::hopscotch_map.
+ */
+template <class Key, class T, std::size_t NbShards = 16,
+          class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>,
+          class Allocator = std::allocator<std::pair<Key, T>>,
+          unsigned int NeighborhoodSize = 62, bool StoreHash = false,
+          class GrowthPolicy = tsl::hh::power_of_two_growth_policy<2>>
+class sharded_hopscotch_map : private Hash, private KeyEqual {
+ private:
+  static_assert(NbShards > 0 && (NbShards & (NbShards - 1)) == 0,
+                "NbShards should be a power of two.");
+
+ public:
+  using map_type =
+      tsl::hopscotch_map<Key, T, Hash, KeyEqual, Allocator, NeighborhoodSize,
+                         StoreHash, GrowthPolicy>;
+
+  using key_type = typename map_type::key_type;
+  using mapped_type = typename map_type::mapped_type;
+  using value_type = typename map_type::value_type;
+  using size_type = typename map_type::size_type;
+  using hasher = typename map_type::hasher;
+  using key_equal = typename map_type::key_equal;
+  using allocator_type = typename map_type::allocator_type;
+
+ private:
+  struct alignas(64) shard_type {
+    shard_type(size_type bucket_count, const Hash& hash, const KeyEqual& equal,
+               const Allocator& alloc)
+        : m_map(bucket_count, hash, equal, alloc) {}
+
+    mutable std::mutex m_mutex;
+    map_type m_map;
+  };
+
+  static constexpr std::size_t log2(std::size_t value) {
+    std::size_t power = 0;
+    while (value > 1) {
+      value /= 2;
+      power++;
+    }
+
+    return power;
+  }
+
+  static const std::size_t NB_SHARD_BITS = log2(NbShards);
+  static const std::size_t SHARD_SHIFT =
+      std::numeric_limits<std::size_t>::digits - NB_SHARD_BITS;
+
+ public:
+  sharded_hopscotch_map() : sharded_hopscotch_map(0) {}
+
+  explicit sharded_hopscotch_map(size_type bucket_count,
+                                 const Hash& hash = Hash(),
+                                 const KeyEqual& equal = KeyEqual(),
+                                 const Allocator& alloc = Allocator())
+      : Hash(hash),
+        KeyEqual(equal),
+        m_shards(make_shards(per_shard(bucket_count), hash, equal, alloc,
+                             std::make_index_sequence<NbShards>())) {}
+
+  sharded_hopscotch_map(const sharded_hopscotch_map& other) = delete;
+  sharded_hopscotch_map& operator=(const sharded_hopscotch_map& other) =
+      delete;
+
+  /*
+   * Capacity
+   */
+  bool empty() const { return size() == 0; }
+
+  size_type size() const {
+    size_type nb_elements = 0;
+    for (const shard_type& s : m_shards) {
+      std::lock_guard<std::mutex> lock(s.m_mutex);
+      nb_elements += s.m_map.size();
+    }
+
+    return nb_elements;
+  }
+
+  /*
+   * Modifiers
+   */
+  void clear() {
+    for (shard_type& s : m_shards) {
+      std::lock_guard<std::mutex> lock(s.m_mutex);
+      s.m_map.clear();
+    }
+  }
+
+  /**
+   * Return true if the value was inserted, false if the key was already in
+   * the map (the value is then not modified).
+   */
+  bool insert(const value_type& value) {
+    const std::size_t hash = hash_key(value.first);
+    shard_type& s = m_shards[shard_for_hash(hash)];
+
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+    return s.m_map.insert(value, hash).second;
+  }
+
+  bool insert(value_type&& value) {
+    const std::size_t hash = hash_key(value.first);
+    shard_type& s = m_shards[shard_for_hash(hash)];
+
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+    return s.m_map.insert(std::move(value), hash).second;
+  }
+
+  /**
+   * Return true if the value was inserted, false if it was assigned.
+   */
+  template <class M>
+  bool insert_or_assign(const key_type& k, M&& obj) {
+    const std::size_t hash = hash_key(k);
+    shard_type& s = m_shards[shard_for_hash(hash)];
+
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+    return s.m_map.insert_or_assign(k, std::forward<M>(obj), hash).second;
+  }
+
+  template <class M>
+  bool insert_or_assign(key_type&& k, M&& obj) {
+    const std::size_t hash = hash_key(k);
+    shard_type& s = m_shards[shard_for_hash(hash)];
+
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+    return s.m_map
+        .insert_or_assign(std::move(k), std::forward<M>(obj), hash)
+        .second;
+  }
+
+  size_type erase(const key_type& key) {
+    const std::size_t hash = hash_key(key);
+    shard_type& s = m_shards[shard_for_hash(hash)];
+
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+    return s.m_map.erase(key, hash);
+  }
+
+  /**
+   * Insert the values in [first, last) in the map, locking each shard only
+   * once. Return the number of values inserted, the values whose key was
+   * already in the map are not inserted. Use std::make_move_iterator to move
+   * the values.
+   */
+  template <class ForwardIt>
+  size_type insert_batch(ForwardIt first, ForwardIt last) {
+    size_type nb_inserted = 0;
+    for_each_by_shard(
+        m_shards, first, last, [](const auto& value) -> const key_type& {
+          return value.first;
+        },
+        [&](map_type& map, ForwardIt it, std::size_t hash, size_type) {
+          if (map.insert(*it, hash).second) {
+            nb_inserted++;
+          }
+        });
+
+    return nb_inserted;
+  }
+
+  /**
+   * Erase the keys in [first, last) from the map, locking each shard only
+   * once. Return the number of elements erased.
+   */
+  template <class ForwardIt>
+  size_type erase_batch(ForwardIt first, ForwardIt last) {
+    size_type nb_erased = 0;
+    for_each_by_shard(
+        m_shards, first, last,
+        [](const key_type& key) -> const key_type& { return key; },
+        [&](map_type& map, ForwardIt it, std::size_t hash, size_type) {
+          nb_erased += map.erase(*it, hash);
+        });
+
+    return nb_erased;
+  }
+
+  /*
+   * Lookup
+   */
+
+  /**
+   * If the key is in the map, copy its value in `value` and return true.
+   * Otherwise, return false and leave `value` unmodified.
+   */
+  bool find(const key_type& key, T& value) const {
+    const std::size_t hash = hash_key(key);
+    const shard_type& s = m_shards[shard_for_hash(hash)];
+
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+    auto it = s.m_map.find(key, hash);
+    if (it == s.m_map.end()) {
+      return false;
+    }
+
+    value = it->second;
+    return true;
+  }
+
+  bool contains(const key_type& key) const {
+    const std::size_t hash = hash_key(key);
+    const shard_type& s = m_shards[shard_for_hash(hash)];
+
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+    return s.m_map.contains(key, hash);
+  }
+
+  size_type count(const key_type& key) const { return contains(key) ? 1 : 0; }
+
+  /**
+   * Write a bool telling if the key is in the map for each key in
+   * [first, last), in the same order as the keys, locking each shard only
+   * once. Return the output iterator past the last bool written.
+   */
+  template <class ForwardIt, class OutputIt>
+  OutputIt contains_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+    std::vector<char> found(
+        static_cast<std::size_t>(std::distance(first, last)), 0);
+    for_each_by_shard(
+        m_shards, first, last,
+        [](const key_type& key) -> const key_type& { return key; },
+        [&](const map_type& map, ForwardIt it, std::size_t hash,
+            size_type ikey) { found[ikey] = map.contains(*it, hash); });
+
+    for (const char f : found) {
+      *out = (f != 0);
+      ++out;
+    }
+
+    return out;
+  }
+
+  /*
+   * Shards
+   */
+  static constexpr size_type shard_count() noexcept { return NbShards; }
+
+  /**
+   * Index of the shard of a key with the hash `hash`, which must be the hash
+   * of the key as returned by hash_function().
+   */
+  size_type shard_for_hash(std::size_t hash) const noexcept {
+    if constexpr (NbShards == 1) {
+      (void)hash;
+      return 0;
+    } else {
+      // The hash as seen by bucket_for_hash in the shards.
+      if constexpr (detail_hopscotch_hash::needs_hash_mixing<
+                        Hash, GrowthPolicy>::value) {
+        hash = detail_hopscotch_hash::mix_hash_bits(hash);
+      }
+
+      if constexpr (detail_hopscotch_hash::is_power_of_two_policy<
+                        GrowthPolicy>::value) {
+        return hash >> SHARD_SHIFT;
+      } else if constexpr (detail_hopscotch_hash::is_fastrange_policy<
+                               GrowthPolicy>::value) {
+        return hash & (NbShards - 1);
+      } else {
+        return detail_hopscotch_hash::mix_hash_bits(hash) >> SHARD_SHIFT;
+      }
+    }
+  }
+
+  size_type shard_for_key(const key_type& key) const {
+    return shard_for_hash(hash_key(key));
+  }
+
+  /**
+   * Map of the shard `ishard`, without any lock. Only use it if no other
+   * thread can access the shard at the same time, e.g. from the thread owning
+   * the shard or while holding shard_mutex(ishard).
+   */
+  map_type& shard(size_type ishard) noexcept {
+    tsl_hh_assert(ishard < NbShards);
+    return m_shards[ishard].m_map;
+  }
+
+  const map_type& shard(size_type ishard) const noexcept {
+    tsl_hh_assert(ishard < NbShards);
+    return m_shards[ishard].m_map;
+  }
+
+  std::mutex& shard_mutex(size_type ishard) const noexcept {
+    tsl_hh_assert(ishard < NbShards);
+    return m_shards[ishard].m_mutex;
+  }
+
+  /**
+   * Call `f(map)` with the map of the shard `ishard` while holding its mutex
+   * and return the result of `f`.
+   */
+  template <class F>
+  decltype(auto) visit_shard(size_type ishard, F&& f) {
+    tsl_hh_assert(ishard < NbShards);
+    std::lock_guard<std::mutex> lock(m_shards[ishard].m_mutex);
+    return std::forward<F>(f)(m_shards[ishard].m_map);
+  }
+
+  template <class F>
+  decltype(auto) visit_shard(size_type ishard, F&& f) const {
+    tsl_hh_assert(ishard < NbShards);
+    std::lock_guard<std::mutex> lock(m_shards[ishard].m_mutex);
+    return std::forward<F>(f)(
+        static_cast<const map_type&>(m_shards[ishard].m_map));
+  }
+
+  /*
+   * Hash policy
+   */
+  size_type bucket_count() const {
+    size_type nb_buckets = 0;
+    for (const shard_type& s : m_shards) {
+      std::lock_guard<std::mutex> lock(s.m_mutex);
+      nb_buckets += s.m_map.bucket_count();
+    }
+
+    return nb_buckets;
+  }
+
+  float load_factor() const {
+    const size_type nb_buckets = bucket_count();
+    if (nb_buckets == 0) {
+      return 0;
+    }
+
+    return float(size()) / float(nb_buckets);
+  }
+
+  float max_load_factor() const {
+    std::lock_guard<std::mutex> lock(m_shards[0].m_mutex);
+    return m_shards[0].m_map.max_load_factor();
+  }
+
+  void max_load_factor(float ml) {
+    for (shard_type& s : m_shards) {
+      std::lock_guard<std::mutex> lock(s.m_mutex);
+      s.m_map.max_load_factor(ml);
+    }
+  }
+
+  /**
+   * Reserve enough space in each shard for count / shard_count() elements.
+   */
+  void reserve(size_type count_) {
+    for (shard_type& s : m_shards) {
+      std::lock_guard<std::mutex> lock(s.m_mutex);
+      s.m_map.reserve(per_shard(count_));
+    }
+  }
+
+  /*
+   * Observers
+   */
+  hasher hash_function() const { return static_cast<const Hash&>(*this); }
+
+  key_equal key_eq() const { return static_cast<const KeyEqual&>(*this); }
+
+ private:
+  std::size_t hash_key(const key_type& key) const {
+    return Hash::operator()(key);
+  }
+
+  /**
+   * The shards hold a mutex and can't be moved, construct them in place with
+   * the allocator.
+   */
+  template <std::size_t... Is>
+  static std::array<shard_type, NbShards> make_shards(
+      size_type bucket_count, const Hash& hash, const KeyEqual& equal,
+      const Allocator& alloc, std::index_sequence<Is...>) {
+    return {{(static_cast<void>(Is),
+              shard_type(bucket_count, hash, equal, alloc))...}};
+  }
+
+  static size_type per_shard(size_type count_) noexcept {
+    return count_ / NbShards + (count_ % NbShards != 0 ? 1 : 0);
+  }
+
+  /*
+   * Hash the keys of [first, last) (KeySelect gives the key of an element),
+   * sort them by shard and call `f(map, it, hash, index)` for each element
+   * while holding the mutex of its shard, each mutex is taken only once.
+   * `index` is the position of the element in [first, last). Shards is the
+   * const or non-const m_shards, the map given to `f` has the same constness.
+   */
+  template <class Shards, class ForwardIt, class KeySelect, class F>
+  void for_each_by_shard(Shards& shards, ForwardIt first, ForwardIt last,
+                         KeySelect key_select, F&& f) const {
+    const std::size_t nb_elements =
+        static_cast<std::size_t>(std::distance(first, last));
+
+    std::vector<std::size_t> hashes(nb_elements);
+    std::vector<size_type> ishards(nb_elements);
+    std::array<size_type, NbShards + 1> shard_offsets = {};
+
+    std::size_t i = 0;
+    for (ForwardIt it = first; it != last; ++it, ++i) {
+      hashes[i] = hash_key(key_select(*it));
+      ishards[i] = shard_for_hash(hashes[i]);
+      shard_offsets[ishards[i] + 1]++;
+    }
+
+    for (std::size_t ishard = 0; ishard < NbShards; ishard++) {
+      shard_offsets[ishard + 1] += shard_offsets[ishard];
+    }
+
+    std::vector<std::pair<ForwardIt, size_type>> sorted(
+        nb_elements, std::make_pair(first, size_type(0)));
+    std::array<size_type, NbShards + 1> positions = shard_offsets;
+
+    i = 0;
+    for (ForwardIt it = first; it != last; ++it, ++i) {
+      sorted[positions[ishards[i]]++] = std::make_pair(it, size_type(i));
+    }
+
+    for (std::size_t ishard = 0; ishard < NbShards; ishard++) {
+      if (shard_offsets[ishard] == shard_offsets[ishard + 1]) {
+        continue;
+      }
+
+      auto& s = shards[ishard];
+      std::lock_guard<std::mutex> lock(s.m_mutex);
+      for (size_type j = shard_offsets[ishard]; j < shard_offsets[ishard + 1];
+           j++) {
+        f(s.m_map, sorted[j].first, hashes[sorted[j].second],
+          sorted[j].second);
+      }
+    }
+  }
+
+ private:
+  std::array<shard_type, NbShards> m_shards;
+};
+
+}  // end namespace tsl
+
+#endif
@@ -0,0 +1,679 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef TSL_SMALL_HOPSCOTCH_MAP_H
+#define TSL_SMALL_HOPSCOTCH_MAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "hopscotch_map.h"
+
+namespace tsl {
+
+/**
+ * Hash map storing up to InlineCapacity elements inline, without any
+ * allocation, for the many maps which stay tiny.
+ *
+ * While the map is inline, the elements are kept contiguously in insertion
+ * order, except that an erase moves the last element into the hole, and the
+ * lookups are a linear scan comparing the keys with KeyEqual, no hash is
+ * computed. The first insertion which would exceed InlineCapacity moves all
+ * the elements to a tsl::hopscotch_map, which is then used until the map is
+ * destroyed, cleared or not (the memory of the buckets is kept). A reserve of
+ * more than InlineCapacity elements also switches to the hopscotch_map.
+ *
+ * The inline elements are invalidated by any insertion or erase, as in the
+ * hopscotch_map. An erase of an inline element also invalidates the iterators
+ * to the last element.
+ *
+ * The other template parameters are the same as tsl::hopscotch_map.
+ */
+template <class Key, class T, std::size_t InlineCapacity = 8,
+          class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>,
+          class Allocator = std::allocator<std::pair<Key, T>>,
+          unsigned int NeighborhoodSize = 62, bool StoreHash = false,
+          class GrowthPolicy = tsl::hh::power_of_two_growth_policy<2>>
+class small_hopscotch_map {
+ private:
+  static_assert(InlineCapacity > 0, "InlineCapacity should be > 0.");
+
+  using map_type =
+      tsl::hopscotch_map<Key, T, Hash, KeyEqual, Allocator, NeighborhoodSize,
+                         StoreHash, GrowthPolicy>;
+
+ public:
+  template <bool IsConst>
+  class small_iterator;
+
+  using key_type = typename map_type::key_type;
+  using mapped_type = T;
+  using value_type = typename map_type::value_type;
+  using size_type = typename map_type::size_type;
+  using difference_type = typename map_type::difference_type;
+  using hasher = typename map_type::hasher;
+  using key_equal = typename map_type::key_equal;
+  using allocator_type = typename map_type::allocator_type;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = value_type*;
+  using const_pointer = const value_type*;
+  using iterator = small_iterator<false>;
+  using const_iterator = small_iterator<true>;
+
+  static constexpr size_type INLINE_CAPACITY = InlineCapacity;
+
+  /**
+   * Iterator over the inline elements or over the hopscotch_map. As with the
+   * hopscotch_map iterators, the key can't be modified, the value can through
+   * value().
+   */
+  template <bool IsConst>
+  class small_iterator {
+    friend class small_hopscotch_map;
+
+   private:
+    using inline_pointer = typename std::conditional<
+        IsConst, const typename small_hopscotch_map::value_type*,
+        typename small_hopscotch_map::value_type*>::type;
+    using map_iterator =
+        typename std::conditional<IsConst, typename map_type::const_iterator,
+                                  typename map_type::iterator>::type;
+
+    explicit small_iterator(inline_pointer inline_value) noexcept
+        : m_inline_value(inline_value), m_map_iterator() {}
+
+    explicit small_iterator(map_iterator it) noexcept
+        : m_inline_value(nullptr), m_map_iterator(it) {}
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = const typename small_hopscotch_map::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type&;
+    using pointer = value_type*;
+
+    small_iterator() noexcept : m_inline_value(nullptr), m_map_iterator() {}
+
+    // Copy constructor from iterator to const_iterator.
+    template <bool TIsConst = IsConst,
+              typename std::enable_if<TIsConst>::type* = nullptr>
+    small_iterator(const small_iterator<!TIsConst>& other) noexcept
+        : m_inline_value(other.m_inline_value),
+          m_map_iterator(other.m_map_iterator) {}
+
+    small_iterator(const small_iterator& other) = default;
+    small_iterator(small_iterator&& other) = default;
+    small_iterator& operator=(const small_iterator& other) = default;
+    small_iterator& operator=(small_iterator&& other) = default;
+
+    const typename small_hopscotch_map::key_type& key() const {
+      return operator*().first;
+    }
+
+    template <class U = T,
+              typename std::enable_if<IsConst, U>::type* = nullptr>
+    const typename small_hopscotch_map::mapped_type& value() const {
+      return operator*().second;
+    }
+
+    template <class U = T,
+              typename std::enable_if<!IsConst, U>::type* = nullptr>
+    typename small_hopscotch_map::mapped_type& value() const {
+      if (m_inline_value != nullptr) {
+        return m_inline_value->second;
+      }
+
+      return m_map_iterator.value();
+    }
+
+    reference operator*() const {
+      if (m_inline_value != nullptr) {
+        return *m_inline_value;
+      }
+
+      return *m_map_iterator;
+    }
+
+    pointer operator->() const { return std::addressof(operator*()); }
+
+    small_iterator& operator++() {
+      if (m_inline_value != nullptr) {
+        ++m_inline_value;
+      } else {
+        ++m_map_iterator;
+      }
+
+      return *this;
+    }
+
+    small_iterator operator++(int) {
+      small_iterator tmp(*this);
+      ++*this;
+
+      return tmp;
+    }
+
+    friend bool operator==(const small_iterator& lhs,
+                           const small_iterator& rhs) {
+      return lhs.m_inline_value == rhs.m_inline_value &&
+             lhs.m_map_iterator == rhs.m_map_iterator;
+    }
+
+    friend bool operator!=(const small_iterator& lhs,
+                           const small_iterator& rhs) {
+      return !(lhs == rhs);
+    }
+
+   private:
+    inline_pointer m_inline_value;
+    map_iterator m_map_iterator;
+  };
+
+  /*
+   * Constructors
+   */
+  small_hopscotch_map() : small_hopscotch_map(0) {}
+
+  /**
+   * The map is inline as long as bucket_count is 0.
+   */
+  explicit small_hopscotch_map(size_type bucket_count,
+                               const Hash& hash = Hash(),
+                               const KeyEqual& equal = KeyEqual(),
+                               const Allocator& alloc = Allocator())
+      : m_map(bucket_count, hash, equal, alloc),
+        m_nb_inline(0),
+        m_is_inline(bucket_count == 0) {}
+
+  explicit small_hopscotch_map(const Allocator& alloc)
+      : small_hopscotch_map(0, Hash(), KeyEqual(), alloc) {}
+
+  template <class InputIt>
+  small_hopscotch_map(InputIt first, InputIt last) : small_hopscotch_map() {
+    insert(first, last);
+  }
+
+  small_hopscotch_map(std::initializer_list<value_type> init)
+      : small_hopscotch_map(init.begin(), init.end()) {}
+
+  small_hopscotch_map(const small_hopscotch_map& other)
+      : m_map(other.m_map), m_nb_inline(0), m_is_inline(other.m_is_inline) {
+    const value_type* other_values = other.inline_values();
+#ifndef TSL_HH_NO_EXCEPTIONS
+    try {
+#endif
+      for (; m_nb_inline < other.m_nb_inline; m_nb_inline++) {
+        ::new (static_cast<void*>(inline_slot(m_nb_inline)))
+            value_type(other_values[m_nb_inline]);
+      }
+#ifndef TSL_HH_NO_EXCEPTIONS
+    } catch (...) {
+      destroy_inline_values();
+      throw;
+    }
+#endif
+  }
+
+  /**
+   * The moved map is left empty and inline.
+   */
+  small_hopscotch_map(small_hopscotch_map&& other) noexcept(
+      std::is_nothrow_move_constructible<map_type>::value &&
+      std::is_nothrow_move_constructible<value_type>::value)
+      : m_map(std::move(other.m_map)),
+        m_nb_inline(0),
+        m_is_inline(other.m_is_inline) {
+    move_inline_values_from(other);
+    other.m_map.clear();
+    other.m_is_inline = true;
+  }
+
+  small_hopscotch_map& operator=(const small_hopscotch_map& other) {
+    if (this != &other) {
+      small_hopscotch_map tmp(other);
+      *this = std::move(tmp);
+    }
+
+    return *this;
+  }
+
+  small_hopscotch_map& operator=(small_hopscotch_map&& other) noexcept(
+      std::is_nothrow_move_assignable<map_type>::value &&
+      std::is_nothrow_move_constructible<value_type>::value) {
+    if (this != &other) {
+      destroy_inline_values();
+      m_map = std::move(other.m_map);
+      m_is_inline = other.m_is_inline;
+      move_inline_values_from(other);
+
+      other.m_map.clear();
+      other.m_is_inline = true;
+    }
+
+    return *this;
+  }
+
+  ~small_hopscotch_map() { destroy_inline_values(); }
+
+  allocator_type get_allocator() const { return m_map.get_allocator(); }
+
+  /*
+   * Iterators
+   */
+  iterator begin() noexcept {
+    return m_is_inline ? iterator(inline_values()) : iterator(m_map.begin());
+  }
+  const_iterator begin() const noexcept { return cbegin(); }
+  const_iterator cbegin() const noexcept {
+    return m_is_inline ? const_iterator(inline_values())
+                       : const_iterator(m_map.cbegin());
+  }
+
+  iterator end() noexcept {
+    return m_is_inline ? iterator(inline_values() + m_nb_inline)
+                       : iterator(m_map.end());
+  }
+  const_iterator end() const noexcept { return cend(); }
+  const_iterator cend() const noexcept {
+    return m_is_inline ? const_iterator(inline_values() + m_nb_inline)
+                       : const_iterator(m_map.cend());
+  }
+
+  /*
+   * Capacity
+   */
+  bool empty() const noexcept { return size() == 0; }
+  size_type size() const noexcept {
+    return m_is_inline ? m_nb_inline : m_map.size();
+  }
+  size_type max_size() const noexcept { return m_map.max_size(); }
+
+  /*
+   * Modifiers
+   */
+  void clear() noexcept {
+    destroy_inline_values();
+    m_map.clear();
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    return try_emplace(value.first, value.second);
+  }
+
+  std::pair<iterator, bool> insert(value_type&& value) {
+    return try_emplace(std::move(value.first), std::move(value.second));
+  }
+
+  template <class P, typename std::enable_if<std::is_constructible<
+                         value_type, P&&>::value>::type* = nullptr>
+  std::pair<iterator, bool> insert(P&& value) {
+    return emplace(std::forward<P>(value));
+  }
+
+  template <class InputIt>
+  void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(const key_type& k, M&& obj) {
+    auto it = try_emplace(k, std::forward<M>(obj));
+    if (!it.second) {
+      it.first.value() = std::forward<M>(obj);
+    }
+
+    return it;
+  }
+
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(key_type&& k, M&& obj) {
+    auto it = try_emplace(std::move(k), std::forward<M>(obj));
+    if (!it.second) {
+      it.first.value() = std::forward<M>(obj);
+    }
+
+    return it;
+  }
+
+  /**
+   * The value is constructed before checking if the key is already present.
+   */
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    value_type value(std::forward<Args>(args)...);
+    return try_emplace(std::move(value.first), std::move(value.second));
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& k, Args&&... args) {
+    return try_emplace_impl(k, std::forward<Args>(args)...);
+  }
+
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(key_type&& k, Args&&... args) {
+    return try_emplace_impl(std::move(k), std::forward<Args>(args)...);
+  }
+
+  /**
+   * Return the iterator to the element following the erased one.
+   */
+  iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+  iterator erase(const_iterator pos) {
+    if (!m_is_inline) {
+      return iterator(m_map.erase(pos.m_map_iterator));
+    }
+
+    // The last element takes the place of the erased one.
+    value_type* values = inline_values();
+    const size_type ivalue = size_type(pos.m_inline_value - values);
+    tsl_hh_assert(ivalue < m_nb_inline);
+
+    if (ivalue != m_nb_inline - 1) {
+      values[ivalue].~value_type();
+      ::new (static_cast<void*>(values + ivalue))
+          value_type(std::move(values[m_nb_inline - 1]));
+    }
+    values[m_nb_inline - 1].~value_type();
+    m_nb_inline--;
+
+    return iterator(values + ivalue);
+  }
+
+  size_type erase(const key_type& key) {
+    if (!m_is_inline) {
+      return m_map.erase(key);
+    }
+
+    value_type* value = find_inline(key);
+    if (value == nullptr) {
+      return 0;
+    }
+
+    erase(const_iterator(value));
+    return 1;
+  }
+
+  void swap(small_hopscotch_map& other) noexcept(
+      std::is_nothrow_move_constructible<small_hopscotch_map>::value &&
+      std::is_nothrow_move_assignable<small_hopscotch_map>::value) {
+    small_hopscotch_map tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  /*
+   * Lookup
+   */
+  T& at(const Key& key) {
+    iterator it = find(key);
+    if (it == end()) {
+      TSL_HH_THROW_OR_TERMINATE(std::out_of_range, "Couldn't find key.");
+    }
+
+    return it.value();
+  }
+
+  const T& at(const Key& key) const {
+    const_iterator it = find(key);
+    if (it == cend()) {
+      TSL_HH_THROW_OR_TERMINATE(std::out_of_range, "Couldn't find key.");
+    }
+
+    return it.value();
+  }
+
+  T& operator[](const Key& key) { return try_emplace(key).first.value(); }
+  T& operator[](Key&& key) {
+    return try_emplace(std::move(key)).first.value();
+  }
+
+  size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+
+  bool contains(const Key& key) const { return find(key) != cend(); }
+
+  iterator find(const Key& key) {
+    if (!m_is_inline) {
+      return iterator(m_map.find(key));
+    }
+
+    value_type* value = find_inline(key);
+    return (value != nullptr) ? iterator(value) : end();
+  }
+
+  const_iterator find(const Key& key) const {
+    if (!m_is_inline) {
+      return const_iterator(m_map.find(key));
+    }
+
+    const value_type* value =
+        const_cast<small_hopscotch_map&>(*this).find_inline(key);
+    return (value != nullptr) ? const_iterator(value) : cend();
+  }
+
+  /*
+   * Hash policy
+   */
+  /**
+   * Switch to the hopscotch_map if count_ > InlineCapacity.
+   */
+  void reserve(size_type count_) {
+    if (!m_is_inline) {
+      m_map.reserve(count_);
+    } else if (count_ > InlineCapacity) {
+      move_to_map(count_);
+    }
+  }
+
+  /*
+   * Observers
+   */
+  hasher hash_function() const { return m_map.hash_function(); }
+  key_equal key_eq() const { return m_map.key_eq(); }
+
+  /*
+   * Other
+   */
+  /**
+   * True while the elements are stored inline, without any allocation.
+   */
+  bool is_inline() const noexcept { return m_is_inline; }
+
+  friend bool operator==(const small_hopscotch_map& lhs,
+                         const small_hopscotch_map& rhs) {
+    if (lhs.size() != rhs.size()) {
+      return false;
+    }
+
+    for (const auto& element_lhs : lhs) {
+      const auto it_element_rhs = rhs.find(element_lhs.first);
+      if (it_element_rhs == rhs.cend() ||
+          element_lhs.second != it_element_rhs.value()) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  friend bool operator!=(const small_hopscotch_map& lhs,
+                         const small_hopscotch_map& rhs) {
+    return !operator==(lhs, rhs);
+  }
+
+  friend void swap(small_hopscotch_map& lhs,
+                   small_hopscotch_map& rhs) noexcept(noexcept(lhs.swap(rhs))) {
+    lhs.swap(rhs);
+  }
+
+ private:
+  value_type* inline_slot(size_type ivalue) noexcept {
+    return reinterpret_cast<value_type*>(m_inline_storage) + ivalue;
+  }
+
+  value_type* inline_values() noexcept {
+    return std::launder(inline_slot(0));
+  }
+
+  const value_type* inline_values() const noexcept {
+    return const_cast<small_hopscotch_map&>(*this).inline_values();
+  }
+
+  value_type* find_inline(const Key& key) {
+    const key_equal equal = m_map.key_eq();
+
+    value_type* values = inline_values();
+    for (size_type ivalue = 0; ivalue < m_nb_inline; ivalue++) {
+      if (equal(values[ivalue].first, key)) {
+        return values + ivalue;
+      }
+    }
+
+    return nullptr;
+  }
+
+  template <class K, class... Args>
+  std::pair<iterator, bool> try_emplace_impl(K&& key, Args&&... args) {
+    if (!m_is_inline) {
+      auto it = m_map.try_emplace(std::forward<K>(key),
+                                  std::forward<Args>(args)...);
+      return std::make_pair(iterator(it.first), it.second);
+    }
+
+    value_type* value = find_inline(key);
+    if (value != nullptr) {
+      return std::make_pair(iterator(value), false);
+    }
+
+    if (m_nb_inline < InlineCapacity) {
+      value = ::new (static_cast<void*>(inline_slot(m_nb_inline)))
+          value_type(std::piecewise_construct,
+                     std::forward_as_tuple(std::forward<K>(key)),
+                     std::forward_as_tuple(std::forward<Args>(args)...));
+      m_nb_inline++;
+
+      return std::make_pair(iterator(std::launder(value)), true);
+    }
+
+    move_to_map(InlineCapacity + 1);
+
+    auto it =
+        m_map.try_emplace(std::forward<K>(key), std::forward<Args>(args)...);
+    return std::make_pair(iterator(it.first), it.second);
+  }
+
+  /**
+   * Move the inline elements to m_map, reserved for count_ elements.
+   *
+   * If an exception is thrown, the map stays inline with all its elements,
+   * the elements already moved to m_map are moved back but may change of
+   * order. If value_type can't be copied and its move constructor may throw,
+   * only the basic guarantee holds: the elements already moved are lost.
+   */
+  void move_to_map(size_type count_) {
+    tsl_hh_assert(m_is_inline && m_map.empty());
+
+    m_map.reserve(count_);
+
+    value_type* values = inline_values();
+    size_type ivalue = 0;
+#ifndef TSL_HH_NO_EXCEPTIONS
+    try {
+#endif
+      for (; ivalue < m_nb_inline; ivalue++) {
+        m_map.insert(std::move_if_noexcept(values[ivalue]));
+      }
+#ifndef TSL_HH_NO_EXCEPTIONS
+    } catch (...) {
+      if constexpr (std::is_nothrow_move_constructible<value_type>::value) {
+        // The insert which threw didn't move its value, values[0, ivalue)
+        // are the moved-from values now in m_map. The stored pairs of m_map
+        // are not const, only its iterators are.
+        tsl_hh_assert(m_map.size() == ivalue);
+
+        size_type imoved = 0;
+        for (auto it = m_map.begin(); it != m_map.end(); ++it, imoved++) {
+          values[imoved].~value_type();
+          ::new (static_cast<void*>(inline_slot(imoved)))
+              value_type(std::move(const_cast<value_type&>(*it)));
+        }
+      }
+
+      m_map.clear();
+      throw;
+    }
+#endif
+
+    destroy_inline_values();
+    m_is_inline = false;
+  }
+
+  void move_inline_values_from(small_hopscotch_map& other) noexcept(
+      std::is_nothrow_move_constructible<value_type>::value) {
+    tsl_hh_assert(m_nb_inline == 0);
+
+    value_type* other_values = other.inline_values();
+    for (; m_nb_inline < other.m_nb_inline; m_nb_inline++) {
+      ::new (static_cast<void*>(inline_slot(m_nb_inline)))
+          value_type(std::move(other_values[m_nb_inline]));
+    }
+
+    other.destroy_inline_values();
+  }
+
+  void destroy_inline_values() noexcept {
+    value_type* values = inline_values();
+    for (size_type ivalue = 0; ivalue < m_nb_inline; ivalue++) {
+      values[ivalue].~value_type();
+    }
+
+    m_nb_inline = 0;
+  }
+
+ private:
+  map_type m_map;
+  alignas(value_type) unsigned char
+      m_inline_storage[InlineCapacity * sizeof(value_type)];
+  size_type m_nb_inline;
+  bool m_is_inline;
+};
+
+}  // end namespace tsl
+
+#endif
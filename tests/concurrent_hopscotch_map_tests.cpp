@@ -0,0 +1,275 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <tsl/concurrent_hopscotch_map.h>
+
+#include <boost/mpl/list.hpp>
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "utils.h"
+
+BOOST_AUTO_TEST_SUITE(test_concurrent_hopscotch_map)
+
+using test_types = boost::mpl::list<
+    tsl::concurrent_hopscotch_map<std::int64_t, std::int64_t>,
+    // Test with hash having a lot of collisions
+    tsl::concurrent_hopscotch_map<std::int64_t, std::int64_t, mod_hash<9>,
+                                  std::equal_to<std::int64_t>, 6>,
+    tsl::concurrent_hopscotch_map<std::int64_t, std::int64_t,
+                                  std::hash<std::int64_t>,
+                                  std::equal_to<std::int64_t>, 30,
+                                  tsl::hh::prime_growth_policy>>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert_find_erase, HMap, test_types) {
+  // insert x values, insert them again, erase half of them, check values
+  const std::int64_t nb_values = 1000;
+  HMap map(0);
+
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK(map.insert(i, i * 2));
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values);
+
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK(!map.insert(i, i * 3));
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values);
+
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    std::int64_t value = -1;
+    BOOST_CHECK(map.find(i, value));
+    BOOST_CHECK_EQUAL(value, i * 2);
+  }
+
+  for (std::int64_t i = 0; i < nb_values; i += 2) {
+    BOOST_CHECK_EQUAL(map.erase(i), 1);
+    BOOST_CHECK_EQUAL(map.erase(i), 0);
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values / 2);
+
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(map.count(i), std::size_t(i % 2));
+  }
+
+  std::int64_t value = -1;
+  BOOST_CHECK(!map.find(nb_values, value));
+  BOOST_CHECK_EQUAL(value, -1);
+}
+
+BOOST_AUTO_TEST_CASE(test_insert_or_assign_overflow) {
+  // mod_hash<50> with a small neighborhood puts elements in the overflow list
+  tsl::concurrent_hopscotch_map<std::int64_t, std::int64_t, mod_hash<50>,
+                                std::equal_to<std::int64_t>, 6>
+      map;
+
+  const std::int64_t nb_values = 5000;
+  for (std::int64_t i = 1; i < nb_values; i += 50) {
+    BOOST_CHECK(map.insert_or_assign(i, i));
+  }
+  BOOST_CHECK(map.overflow_size() > 0);
+
+  for (std::int64_t i = 1; i < nb_values; i += 50) {
+    BOOST_CHECK(!map.insert_or_assign(i, i + 1));
+  }
+
+  for (std::int64_t i = 1; i < nb_values; i += 50) {
+    std::int64_t value = 0;
+    BOOST_CHECK(map.find(i, value));
+    BOOST_CHECK_EQUAL(value, i + 1);
+
+    BOOST_CHECK_EQUAL(map.erase(i), 1);
+    BOOST_CHECK(!map.contains(i));
+  }
+
+  BOOST_CHECK(map.empty());
+  BOOST_CHECK_EQUAL(map.overflow_size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_reserve_clear) {
+  tsl::concurrent_hopscotch_map<std::int64_t, std::int64_t> map;
+  map.reserve(1000);
+  BOOST_CHECK(map.bucket_count() * map.max_load_factor() >= 1000);
+
+  const std::size_t bucket_count = map.bucket_count();
+  for (std::int64_t i = 0; i < 1000; i++) {
+    map.insert(i, i);
+  }
+  BOOST_CHECK_EQUAL(map.bucket_count(), bucket_count);
+  BOOST_CHECK(map.load_factor() <= map.max_load_factor());
+
+  map.clear();
+  BOOST_CHECK(map.empty());
+  BOOST_CHECK(!map.contains(1));
+
+  BOOST_CHECK(map.insert(1, 1));
+  BOOST_CHECK(map.contains(1));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_concurrent_insert_find, HMap, test_types) {
+  // Each writer inserts and updates its own range of keys while readers look up
+  // all the keys. The value of a key is always a multiple of the key.
+  const std::int64_t nb_writers = 3;
+  const std::int64_t nb_values_per_writer = 20000;
+  HMap map;
+
+  std::atomic<bool> writers_done(false);
+  std::atomic<std::size_t> nb_errors(0);
+
+  std::vector<std::thread> threads;
+  for (std::int64_t iwriter = 0; iwriter < nb_writers; iwriter++) {
+    threads.emplace_back([&, iwriter]() {
+      const std::int64_t first = iwriter * nb_values_per_writer;
+      for (std::int64_t i = first; i < first + nb_values_per_writer; i++) {
+        map.insert(i, i);
+        if (i % 3 == 0) {
+          map.insert_or_assign(i, i * 2);
+        }
+        if (i % 7 == 0) {
+          map.erase(i);
+        }
+      }
+    });
+  }
+
+  for (int ireader = 0; ireader < 2; ireader++) {
+    threads.emplace_back([&]() {
+      while (!writers_done.load()) {
+        for (std::int64_t i = 1; i < nb_writers * nb_values_per_writer;
+             i += 13) {
+          std::int64_t value = 0;
+          if (map.find(i, value) && value != i && value != i * 2) {
+            nb_errors++;
+          }
+        }
+      }
+    });
+  }
+
+  for (std::int64_t iwriter = 0; iwriter < nb_writers; iwriter++) {
+    threads[std::size_t(iwriter)].join();
+  }
+  writers_done = true;
+  for (std::size_t i = std::size_t(nb_writers); i < threads.size(); i++) {
+    threads[i].join();
+  }
+
+  BOOST_CHECK_EQUAL(nb_errors.load(), 0);
+
+  std::size_t nb_expected = 0;
+  for (std::int64_t i = 0; i < nb_writers * nb_values_per_writer; i++) {
+    std::int64_t value = 0;
+    if (i % 7 == 0) {
+      BOOST_CHECK(!map.find(i, value));
+    } else {
+      nb_expected++;
+      BOOST_CHECK(map.find(i, value));
+      BOOST_CHECK_EQUAL(value, (i % 3 == 0) ? i * 2 : i);
+    }
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_expected);
+}
+
+BOOST_AUTO_TEST_CASE(test_concurrent_insert_erase_same_keys) {
+  // Threads insert and erase the same small set of keys, the size must stay
+  // consistent with the content of the map.
+  tsl::concurrent_hopscotch_map<std::int64_t, std::int64_t> map;
+  const std::int64_t nb_keys = 64;
+
+  std::vector<std::thread> threads;
+  for (int ithread = 0; ithread < 4; ithread++) {
+    threads.emplace_back([&, ithread]() {
+      for (std::int64_t i = 0; i < 20000; i++) {
+        const std::int64_t key = (i * (ithread + 1)) % nb_keys;
+        if ((i + ithread) % 2 == 0) {
+          map.insert(key, key);
+        } else {
+          map.erase(key);
+        }
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::size_t nb_found = 0;
+  for (std::int64_t key = 0; key < nb_keys; key++) {
+    std::int64_t value = -1;
+    if (map.find(key, value)) {
+      nb_found++;
+      BOOST_CHECK_EQUAL(value, key);
+    }
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_found);
+}
+
+BOOST_AUTO_TEST_CASE(test_concurrent_clear_find) {
+  // A thread clears the map in a loop while others insert and look up the
+  // keys. The replaced tables are freed while the other threads may still be
+  // reading them.
+  tsl::concurrent_hopscotch_map<std::int64_t, std::int64_t> map;
+  const std::int64_t nb_keys = 2000;
+
+  std::atomic<bool> done(false);
+  std::atomic<std::size_t> nb_errors(0);
+
+  std::vector<std::thread> threads;
+  for (int ithread = 0; ithread < 3; ithread++) {
+    threads.emplace_back([&]() {
+      while (!done.load()) {
+        for (std::int64_t i = 0; i < nb_keys; i++) {
+          map.insert(i, i);
+
+          std::int64_t value = -1;
+          if (map.find(i, value) && value != i) {
+            nb_errors++;
+          }
+        }
+      }
+    });
+  }
+
+  for (int i = 0; i < 200; i++) {
+    map.clear();
+    if (i % 10 == 0) {
+      map.reserve(std::size_t(nb_keys) * std::size_t(i + 1));
+    }
+  }
+  done = true;
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  BOOST_CHECK_EQUAL(nb_errors.load(), 0);
+  BOOST_CHECK(map.size() <= std::size_t(nb_keys));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -21,12 +21,23 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
+#include <tsl/bhopscotch_set.h>
+#include <tsl/hopscotch_arena_allocator.h>
+#include <tsl/hopscotch_huge_page_allocator.h>
 #include <tsl/hopscotch_map.h>
 
+#include <boost/mpl/list.hpp>
 #include <boost/test/unit_test.hpp>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <limits>
+#include <memory>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
 #include <stdexcept>
+#include <string>
 #include <type_traits>
 #include <utility>
 
@@ -103,6 +114,47 @@ bool operator!=(const custom_allocator<T>&, const custom_allocator<U>&) {
   return false;
 }
 
+static std::size_t nb_zeroed_allocs = 0;
+
+/**
+ * Allocator with an allocate_zeroed method, used by the maps to allocate their
+ * buckets.
+ */
+template <typename T>
+class zeroed_allocator {
+ public:
+  using value_type = T;
+
+  zeroed_allocator() = default;
+
+  template <typename U>
+  zeroed_allocator(const zeroed_allocator<U>&) {}
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  T* allocate_zeroed(std::size_t n) {
+    nb_zeroed_allocs++;
+
+    T* p = allocate(n);
+    std::memset(static_cast<void*>(p), 0, n * sizeof(T));
+    return p;
+  }
+
+  void deallocate(T* p, std::size_t /*n*/) { ::operator delete(p); }
+};
+
+template <class T, class U>
+bool operator==(const zeroed_allocator<T>&, const zeroed_allocator<U>&) {
+  return true;
+}
+
+template <class T, class U>
+bool operator!=(const zeroed_allocator<T>&, const zeroed_allocator<U>&) {
+  return false;
+}
+
 // TODO Avoid overloading new to check number of global new
 // static std::size_t nb_global_new = 0;
 // void* operator new(std::size_t sz) {
@@ -134,4 +186,275 @@ BOOST_AUTO_TEST_CASE(test_custom_allocator_1) {
   //    BOOST_CHECK_EQUAL(nb_global_new, 0);
 }
 
+BOOST_AUTO_TEST_CASE(test_allocate_zeroed) {
+  // The buckets are allocated with allocate_zeroed on each rehash, the
+  // copies allocate them with allocate and copy them.
+  nb_zeroed_allocs = 0;
+
+  using value_type = std::pair<std::int64_t, std::string>;
+  using map_type =
+      tsl::hopscotch_map<std::int64_t, std::string, std::hash<std::int64_t>,
+                         std::equal_to<std::int64_t>,
+                         zeroed_allocator<value_type>>;
+
+  const std::int64_t nb_values = 1000;
+  map_type map;
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    map.insert({i, utils::get_value<std::string>(i)});
+  }
+
+  BOOST_CHECK_GT(nb_zeroed_allocs, 1);
+
+  const std::size_t nb_zeroed_allocs_before_copy = nb_zeroed_allocs;
+  map_type map_copy = map;
+  BOOST_CHECK_EQUAL(nb_zeroed_allocs, nb_zeroed_allocs_before_copy);
+  BOOST_CHECK(map_copy == map);
+
+  map.clear();
+  BOOST_CHECK(map.empty());
+  BOOST_CHECK(map.begin() == map.end());
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK(map.find(i) == map.end());
+    BOOST_CHECK_EQUAL(map_copy.at(i), utils::get_value<std::string>(i));
+  }
+
+  map = map_copy;
+  BOOST_CHECK(map == map_copy);
+}
+
+using huge_page_allocator_types = boost::mpl::list<
+    tsl::hh::huge_page_allocator<std::uint64_t>,
+    tsl::hh::huge_page_allocator<std::uint64_t, std::size_t(1) << 30>,
+    tsl::hh::huge_page_allocator<std::uint64_t, std::size_t(2) << 20,
+                                 tsl::hh::numa_policy::interleave>>;
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_huge_page_allocator, Allocator,
+                              huge_page_allocator_types) {
+  // Small allocations go through std::allocator, the large ones are mapped on
+  // a huge page boundary on Linux. Both must be usable and freed.
+  Allocator allocator;
+  for (const std::size_t n : {std::size_t(1), std::size_t(1000),
+                              std::size_t(3) << 18, std::size_t(5) << 20}) {
+    std::uint64_t* p = allocator.allocate(n);
+    std::memset(p, 0xff, n * sizeof(std::uint64_t));
+    p[n - 1] = n;
+    BOOST_CHECK_EQUAL(p[n - 1], n);
+
+#ifdef __linux__
+    const bool uses_huge_pages = n * sizeof(std::uint64_t) >= (2 << 20);
+    BOOST_CHECK_EQUAL(Allocator::uses_huge_pages(n * sizeof(std::uint64_t)),
+                      uses_huge_pages);
+    if (uses_huge_pages) {
+      BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(p) % (2 << 20), 0);
+    }
+#endif
+
+    allocator.deallocate(p, n);
+  }
+
+  typename Allocator::template rebind<char>::other char_allocator(allocator);
+  BOOST_CHECK(char_allocator == allocator);
+  TSL_HH_CHECK_THROW(allocator.allocate(allocator.max_size() + 1),
+                     std::bad_alloc);
+}
+
+BOOST_AUTO_TEST_CASE(test_huge_page_allocator_map) {
+  // The bucket array of the map is large enough to be mapped with huge pages.
+  using map_type = tsl::hopscotch_map<
+      std::int64_t, std::int64_t, std::hash<std::int64_t>,
+      std::equal_to<std::int64_t>,
+      tsl::hh::huge_page_allocator<std::pair<std::int64_t, std::int64_t>>>;
+
+  const std::int64_t nb_values = 200000;
+  map_type map;
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    map.insert({i, i * 2});
+  }
+
+  map_type map_copy = map;
+  map.rehash(map.bucket_count() * 2);
+  map_type map_move = std::move(map);
+
+  BOOST_CHECK_EQUAL(map_copy.size(), std::size_t(nb_values));
+  BOOST_CHECK(map_copy == map_move);
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(map_move.at(i), i * 2);
+  }
+
+  map_move.clear();
+  map_move.rehash(0);
+  BOOST_CHECK(map_move.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_arena) {
+  unsigned char buffer[1024];
+  tsl::hh::arena arena(buffer + 1, sizeof(buffer) - 1);
+
+  // The allocations are aligned even if the buffer isn't.
+  void* p1 = arena.allocate(3, 1);
+  void* p2 = arena.allocate(24, 8);
+  void* p3 = arena.allocate(512, 64);
+  BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(p2) % 8, 0);
+  BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(p3) % 64, 0);
+  BOOST_CHECK(p1 >= buffer && p3 < buffer + sizeof(buffer));
+  BOOST_CHECK_EQUAL(arena.heap_size(), 0);
+
+  // The last allocation can be given back, the small blocks are reused by the
+  // allocations of the same size class.
+  arena.deallocate(p3, 512, 64);
+  BOOST_CHECK_EQUAL(arena.allocate(512, 64), p3);
+  arena.deallocate(p2, 24, 8);
+  BOOST_CHECK_EQUAL(arena.allocate(20, 4), p2);
+
+  // Heap chunks are used once the buffer is full.
+  void* p4 = arena.allocate(1000, 16);
+  void* p5 = arena.allocate(100000, 16);
+  std::memset(p4, 1, 1000);
+  std::memset(p5, 1, 100000);
+  BOOST_CHECK_GE(arena.heap_size(), 101000);
+
+  arena.release();
+  BOOST_CHECK_EQUAL(arena.heap_size(), 0);
+  BOOST_CHECK_EQUAL(arena.allocate(3, 1), p1);
+
+  tsl::hh::arena heap_arena;
+  BOOST_CHECK(heap_arena.allocate(8, 8) != nullptr);
+  BOOST_CHECK_EQUAL(heap_arena.heap_size(), tsl::hh::arena::MIN_CHUNK_SIZE);
+
+  tsl::hh::arena_allocator<std::int64_t> allocator(arena);
+  tsl::hh::arena_allocator<char> char_allocator(allocator);
+  BOOST_CHECK(char_allocator == allocator);
+  BOOST_CHECK(tsl::hh::arena_allocator<char>(heap_arena) != allocator);
+  TSL_HH_CHECK_THROW(allocator.allocate(allocator.max_size() + 1),
+                     std::bad_alloc);
+}
+
+BOOST_AUTO_TEST_CASE(test_arena_allocator_map) {
+  // mod_hash<9> with a small neighborhood puts elements in the overflow
+  // container.
+  using value_type = std::pair<std::int64_t, std::string>;
+  using map_type =
+      tsl::hopscotch_map<std::int64_t, std::string, mod_hash<9>,
+                         std::equal_to<std::int64_t>,
+                         tsl::hh::arena_allocator<value_type>, 6>;
+  using set_type =
+      tsl::bhopscotch_set<std::int64_t, mod_hash<9>,
+                          std::equal_to<std::int64_t>, std::less<std::int64_t>,
+                          tsl::hh::arena_allocator<std::int64_t>, 6>;
+
+  static unsigned char buffer[1 << 20];
+  tsl::hh::arena arena(buffer, sizeof(buffer));
+  tsl::hh::arena other_arena;
+
+  const std::int64_t nb_values = 1000;
+  map_type map{tsl::hh::arena_allocator<value_type>(arena)};
+  set_type set{tsl::hh::arena_allocator<std::int64_t>(arena)};
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    map.insert({i, utils::get_value<std::string>(i)});
+    set.insert(i);
+  }
+  BOOST_CHECK_GT(map.overflow_size(), 0);
+  BOOST_CHECK_GT(set.overflow_size(), 0);
+  BOOST_CHECK_EQUAL(arena.heap_size(), 0);
+
+  for (std::int64_t i = 0; i < nb_values; i += 2) {
+    BOOST_CHECK_EQUAL(map.erase(i), 1);
+    BOOST_CHECK_EQUAL(set.erase(i), 1);
+  }
+
+  map_type map_other_arena{tsl::hh::arena_allocator<value_type>(other_arena)};
+  map_other_arena = map;
+  BOOST_CHECK(&map_other_arena.get_allocator().get_arena() == &other_arena);
+  BOOST_CHECK(map_other_arena == map);
+
+  map_type map_move = std::move(map_other_arena);
+  map_other_arena = map_type{tsl::hh::arena_allocator<value_type>(arena)};
+  map_other_arena.swap(map_move);
+  BOOST_CHECK(&map_move.get_allocator().get_arena() == &arena);
+  BOOST_CHECK(&map_other_arena.get_allocator().get_arena() == &other_arena);
+
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(map_other_arena.count(i), std::size_t(i % 2));
+    BOOST_CHECK_EQUAL(set.count(i), std::size_t(i % 2));
+  }
+}
+
+#if __has_include(<memory_resource>)
+BOOST_AUTO_TEST_CASE(test_pmr_map) {
+  using map_type = tsl::pmr::hopscotch_map<std::int64_t, std::string>;
+  static_assert(
+      std::is_same<map_type::allocator_type,
+                   std::pmr::polymorphic_allocator<
+                       std::pair<std::int64_t, std::string>>>::value,
+      "");
+
+  std::pmr::monotonic_buffer_resource resource;
+  std::pmr::monotonic_buffer_resource other_resource;
+
+  const std::int64_t nb_values = 1000;
+  map_type map(&resource);
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    map.insert({i, utils::get_value<std::string>(i)});
+  }
+  BOOST_CHECK(map.get_allocator().resource() == &resource);
+
+  // The allocator doesn't propagate, the elements are moved one by one on a
+  // move assignment between two resources.
+  map_type map_other_resource(&other_resource);
+  map_other_resource = std::move(map);
+  BOOST_CHECK(map.empty());
+  BOOST_CHECK(map_other_resource.get_allocator().resource() ==
+              &other_resource);
+
+  map = map_other_resource;
+  BOOST_CHECK(map.get_allocator().resource() == &resource);
+  BOOST_CHECK(map == map_other_resource);
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(map.at(i), utils::get_value<std::string>(i));
+  }
+
+  tsl::pmr::hopscotch_pg_map<std::int64_t, std::int64_t> pg_map(&resource);
+  tsl::pmr::bhopscotch_pg_set<std::int64_t> set(&resource);
+  pg_map.insert({1, 2});
+  set.insert(1);
+  BOOST_CHECK_EQUAL(pg_map.at(1), 2);
+  BOOST_CHECK_EQUAL(set.count(1), 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_pmr_map_move_only) {
+  // mod_hash<9> with a small neighborhood puts elements in the overflow
+  // container.
+  using map_type =
+      tsl::pmr::hopscotch_map<std::int64_t, std::unique_ptr<std::int64_t>,
+                              mod_hash<9>, std::equal_to<std::int64_t>, 6>;
+
+  std::pmr::monotonic_buffer_resource resource;
+  std::pmr::monotonic_buffer_resource other_resource;
+
+  const std::int64_t nb_values = 1000;
+  map_type map(&resource);
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    map.insert({i, std::make_unique<std::int64_t>(i)});
+  }
+  BOOST_CHECK_GT(map.overflow_size(), 0);
+
+  map_type map_other_resource(&other_resource);
+  map_other_resource.insert({-1, std::make_unique<std::int64_t>(-1)});
+  map_other_resource = std::move(map);
+  BOOST_CHECK(map.empty());
+  BOOST_CHECK(map_other_resource.get_allocator().resource() ==
+              &other_resource);
+
+  BOOST_CHECK_EQUAL(map_other_resource.size(), std::size_t(nb_values));
+  BOOST_CHECK_EQUAL(map_other_resource.count(-1), 0);
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_REQUIRE(map_other_resource.at(i) != nullptr);
+    BOOST_CHECK_EQUAL(*map_other_resource.at(i), i);
+  }
+
+  // The moved-from map can still be used.
+  map.insert({1, std::make_unique<std::int64_t>(2)});
+  BOOST_CHECK_EQUAL(*map.at(1), 2);
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,236 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <tsl/hopscotch_hash_functions.h>
+#include <tsl/hopscotch_map.h>
+
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "utils.h"
+
+namespace {
+
+enum class test_enum : std::uint8_t { a, b };
+
+/**
+ * Flip each of the 64 bits of random inputs and count how often each of the
+ * 64 bits of the result flips. Return the largest deviation from 1/2.
+ */
+template <class F>
+double max_avalanche_bias(F hash_function) {
+  const std::size_t nb_inputs = 1000;
+  std::mt19937_64 generator(42);
+
+  std::vector<std::size_t> nb_flips(64 * 64, 0);
+  for (std::size_t i = 0; i < nb_inputs; i++) {
+    const std::uint64_t input = generator();
+    const std::uint64_t hash = hash_function(input);
+
+    for (std::size_t in_bit = 0; in_bit < 64; in_bit++) {
+      const std::uint64_t flipped_hash =
+          hash_function(input ^ (std::uint64_t(1) << in_bit));
+      for (std::size_t out_bit = 0; out_bit < 64; out_bit++) {
+        if (((hash ^ flipped_hash) >> out_bit) & 1) {
+          nb_flips[in_bit * 64 + out_bit]++;
+        }
+      }
+    }
+  }
+
+  double max_bias = 0;
+  for (const std::size_t flips : nb_flips) {
+    const double bias = double(flips) / double(nb_inputs) - 0.5;
+    max_bias = std::max(max_bias, bias < 0 ? -bias : bias);
+  }
+
+  return max_bias;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(test_hash_functions)
+
+BOOST_AUTO_TEST_CASE(test_is_avalanching) {
+  static_assert(tsl::hh::is_avalanching<tsl::hh::hash<int>>::value, "");
+  static_assert(tsl::hh::is_avalanching<tsl::hh::hash<std::string>>::value,
+                "");
+  static_assert(tsl::hh::is_avalanching<tsl::hh::seeded_hash<int>>::value,
+                "");
+  static_assert(!tsl::hh::is_avalanching<std::hash<int>>::value, "");
+  static_assert(!tsl::hh::is_avalanching<identity_hash<int>>::value, "");
+
+  static_assert(
+      tsl::detail_hopscotch_hash::has_is_transparent<
+          tsl::hh::hash<std::string>>::value,
+      "");
+  static_assert(!tsl::detail_hopscotch_hash::has_is_transparent<
+                    tsl::hh::hash<std::uint64_t>>::value,
+                "");
+}
+
+BOOST_AUTO_TEST_CASE(test_integer_hash_avalanche) {
+  // Each bit of the key flips each bit of the result with a probability close
+  // to 1/2, the keys can be used with a mask even if they only differ in their
+  // high bits.
+  BOOST_CHECK_LT(max_avalanche_bias(tsl::hh::hash<std::uint64_t>()), 0.1);
+  BOOST_CHECK_LT(max_avalanche_bias(tsl::hh::seeded_hash<std::uint64_t>(7)),
+                 0.1);
+  BOOST_CHECK_LT(max_avalanche_bias([](std::uint64_t key) {
+                   return tsl::hh::hash_bytes(&key, sizeof(key));
+                 }),
+                 0.1);
+
+  tsl::hh::hash<std::uint64_t> hash;
+  std::unordered_set<std::size_t> low_bits;
+  for (std::uint64_t i = 0; i < 1024; i++) {
+    low_bits.insert(hash(i << 32) & 0xffff);
+  }
+  BOOST_CHECK_GT(low_bits.size(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(test_integer_hash_types) {
+  int value = 0;
+
+  BOOST_CHECK_NE(tsl::hh::hash<int>()(1), tsl::hh::hash<int>()(2));
+  BOOST_CHECK_EQUAL(tsl::hh::hash<int>()(-1),
+                    tsl::hh::hash<std::int64_t>()(-1));
+  BOOST_CHECK_NE(tsl::hh::hash<test_enum>()(test_enum::a),
+                 tsl::hh::hash<test_enum>()(test_enum::b));
+  BOOST_CHECK_NE(tsl::hh::hash<int*>()(&value),
+                 tsl::hh::hash<int*>()(&value + 1));
+  BOOST_CHECK_NE(tsl::hh::hash<double>()(1.0), tsl::hh::hash<double>()(2.0));
+}
+
+BOOST_AUTO_TEST_CASE(test_hash_bytes_lengths) {
+  // Hash all the prefixes of a buffer, up to several blocks of the long input
+  // path, with and without a seed. There should be no collision.
+  std::mt19937_64 generator(42);
+  std::vector<unsigned char> buffer(3000);
+  for (auto& byte : buffer) {
+    byte = static_cast<unsigned char>(generator());
+  }
+
+  std::unordered_set<std::uint64_t> hashes;
+  for (std::size_t len = 0; len <= buffer.size(); len++) {
+    hashes.insert(tsl::hh::hash_bytes(buffer.data(), len));
+    hashes.insert(tsl::hh::hash_bytes(buffer.data(), len, 1));
+  }
+  BOOST_CHECK_EQUAL(hashes.size(), 2 * (buffer.size() + 1));
+
+  // Same with one byte flipped at each position of a long input.
+  hashes.clear();
+  const std::size_t len = 2500;
+  for (std::size_t i = 0; i < len; i++) {
+    buffer[i] ^= 1;
+    hashes.insert(tsl::hh::hash_bytes(buffer.data(), len));
+    buffer[i] ^= 1;
+  }
+  BOOST_CHECK_EQUAL(hashes.size(), len);
+}
+
+BOOST_AUTO_TEST_CASE(test_hash_bytes_long_scalar) {
+  // The SSE2 or AVX2 path must give the same result as the scalar one.
+  std::mt19937_64 generator(42);
+  std::vector<unsigned char> buffer(5000);
+  for (auto& byte : buffer) {
+    byte = static_cast<unsigned char>(generator());
+  }
+
+  for (std::size_t len =
+           tsl::detail_hash_functions::LONG_INPUT_MIN_SIZE + 1;
+       len <= buffer.size(); len += 7) {
+    for (const std::uint64_t seed : {std::uint64_t(0), std::uint64_t(99)}) {
+      BOOST_CHECK_EQUAL(tsl::hh::hash_bytes(buffer.data(), len, seed),
+                        tsl::detail_hash_functions::hash_long<
+                            tsl::detail_hash_functions::long_hash_scalar>(
+                            buffer.data(), len, seed));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_string_hash) {
+  const tsl::hh::hash<std::string> hash;
+  const std::string str(300, 'a');
+
+  BOOST_CHECK_EQUAL(hash("abc"), hash(std::string("abc")));
+  BOOST_CHECK_EQUAL(hash(std::string_view("abc")), hash(std::string("abc")));
+  BOOST_CHECK_EQUAL(hash(str), tsl::hh::hash<std::string_view>()(str));
+  BOOST_CHECK_EQUAL(hash(""), std::size_t(tsl::hh::hash_bytes("", 0)));
+  BOOST_CHECK_NE(hash("abc"), hash("abd"));
+  BOOST_CHECK_NE(tsl::hh::hash<std::u16string>()(u"ab"),
+                 tsl::hh::hash<std::u16string>()(u"ba"));
+}
+
+BOOST_AUTO_TEST_CASE(test_seeded_hash) {
+  const tsl::hh::seeded_hash<std::string> hash1(1);
+  const tsl::hh::seeded_hash<std::string> hash1_copy(1);
+  const tsl::hh::seeded_hash<std::string> hash2(2);
+
+  BOOST_CHECK_EQUAL(hash1.seed(), 1);
+  BOOST_CHECK_EQUAL(hash1("key"), hash1_copy("key"));
+  BOOST_CHECK_NE(hash1("key"), hash2("key"));
+
+  const tsl::hh::seeded_hash<std::uint64_t> int_hash1(1);
+  const tsl::hh::seeded_hash<std::uint64_t> int_hash2(2);
+  BOOST_CHECK_NE(int_hash1(10), int_hash2(10));
+}
+
+BOOST_AUTO_TEST_CASE(test_hash_in_map) {
+  // Heterogeneous lookups of std::string keys with std::string_view.
+  tsl::hopscotch_map<std::string, std::int64_t, tsl::hh::hash<std::string>,
+                     std::equal_to<>>
+      map;
+  for (std::int64_t i = 0; i < 1000; i++) {
+    map.insert({utils::get_key<std::string>(i), i});
+  }
+
+  BOOST_CHECK_EQUAL(map.overflow_size(), 0);
+  for (std::int64_t i = 0; i < 1000; i++) {
+    const std::string key = utils::get_key<std::string>(i);
+    BOOST_CHECK_EQUAL(map.at(std::string_view(key)), i);
+  }
+  BOOST_CHECK(map.find("unknown") == map.end());
+
+  // Keys differing only in their high bits don't overflow with a mask.
+  tsl::hopscotch_map<std::uint64_t, std::uint64_t,
+                     tsl::hh::seeded_hash<std::uint64_t>>
+      int_map(0, tsl::hh::seeded_hash<std::uint64_t>(12345));
+  for (std::uint64_t i = 0; i < 10000; i++) {
+    int_map.insert({i << 40, i});
+  }
+
+  BOOST_CHECK_EQUAL(int_map.overflow_size(), 0);
+  BOOST_CHECK_EQUAL(int_map.hash_function().seed(), 12345);
+  BOOST_CHECK_EQUAL(int_map.at(std::uint64_t(9999) << 40), 9999);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
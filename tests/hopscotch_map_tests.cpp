@@ -23,11 +23,13 @@
  */
 #include <tsl/bhopscotch_map.h>
 #include <tsl/hopscotch_map.h>
+#include <tsl/hopscotch_thread_executor.h>
 
 #include <boost/functional/hash.hpp>
 #include <boost/mpl/list.hpp>
 #include <boost/test/unit_test.hpp>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <iterator>
 #include <limits>
@@ -76,6 +78,13 @@ using test_types = boost::mpl::list<
                        std::allocator<std::pair<self_reference_member_test,
                                                 self_reference_member_test>>,
                        6, true>,
+    // Hash fragment in the unused bits of the bitmap
+    tsl::hopscotch_map<std::string, std::string, std::hash<std::string>,
+                       std::equal_to<std::string>,
+                       std::allocator<std::pair<std::string, std::string>>, 22>,
+    tsl::hopscotch_map<
+        std::int64_t, std::int64_t, mod_hash<9>, std::equal_to<std::int64_t>,
+        std::allocator<std::pair<std::int64_t, std::int64_t>>, 10>,
     // bhopscotch_map
     tsl::bhopscotch_map<std::int64_t, std::int64_t, mod_hash<9>>,
     tsl::bhopscotch_pg_map<std::int64_t, std::int64_t, mod_hash<9>>,
@@ -94,7 +103,17 @@ using test_types = boost::mpl::list<
     tsl::hopscotch_map<std::string, std::string, mod_hash<9>,
                        std::equal_to<std::string>,
                        std::allocator<std::pair<std::string, std::string>>, 30,
-                       true, tsl::hh::mod_growth_policy<std::ratio<4, 3>>>>;
+                       true, tsl::hh::mod_growth_policy<std::ratio<4, 3>>>,
+    // with tsl::hh::fastrange_growth_policy
+    tsl::hopscotch_map<std::string, std::string, mod_hash<9>,
+                       std::equal_to<std::string>,
+                       std::allocator<std::pair<std::string, std::string>>, 62,
+                       false, tsl::hh::fastrange_growth_policy<>>,
+    tsl::hopscotch_map<
+        std::int64_t, std::int64_t, std::hash<std::int64_t>,
+        std::equal_to<std::int64_t>,
+        std::allocator<std::pair<std::int64_t, std::int64_t>>, 30, true,
+        tsl::hh::fastrange_growth_policy<std::ratio<5, 4>>>>;
 
 using heterogeneous_test_types = boost::mpl::list<
     tsl::hopscotch_map<heterogeneous_test, std::int64_t,
@@ -253,6 +272,357 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert_overflow_rehash_copy_only, HMap,
   }
 }
 
+using test_overflow_find_erase_types = boost::mpl::list<
+    tsl::hopscotch_map<std::int64_t, std::int64_t, mod_hash<overflow_mod>,
+                       std::equal_to<std::int64_t>,
+                       std::allocator<std::pair<std::int64_t, std::int64_t>>,
+                       6>,
+    tsl::bhopscotch_map<
+        std::int64_t, std::int64_t, mod_hash<overflow_mod>,
+        std::equal_to<std::int64_t>, std::less<std::int64_t>,
+        std::allocator<std::pair<const std::int64_t, std::int64_t>>, 6>>;
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_overflow_find_erase, HMap,
+                              test_overflow_find_erase_types) {
+  // insert x values with only overflow_mod different hashes, erase half of
+  // them by key and the other half while iterating, check that the overflow
+  // flags and the overflow elements stay coherent.
+  const std::int64_t nb_values = 2000;
+  HMap map;
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    map.insert({i, i * 2});
+  }
+
+  BOOST_REQUIRE(map.overflow_size() > 0);
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(map.at(i), i * 2);
+  }
+  BOOST_CHECK(map.find(nb_values) == map.end());
+
+  for (std::int64_t i = 0; i < nb_values; i += 2) {
+    BOOST_CHECK_EQUAL(map.erase(i), 1);
+    BOOST_CHECK_EQUAL(map.erase(i), 0);
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values / 2);
+
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(map.count(i), (i % 2 == 0) ? 0 : 1);
+  }
+
+  // Reinsert in the holes left by the erased overflow elements.
+  for (std::int64_t i = 0; i < nb_values; i += 2) {
+    BOOST_CHECK(map.insert({i, i * 2}).second);
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values);
+
+  const HMap map_copy = map;
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(map_copy.at(i), i * 2);
+  }
+
+  auto it = map.begin();
+  std::size_t nb_erased = 0;
+  while (it != map.end()) {
+    if (it->first % 2 == 1) {
+      it = map.erase(it);
+      nb_erased++;
+    } else {
+      ++it;
+    }
+  }
+  BOOST_CHECK_EQUAL(nb_erased, std::size_t(nb_values / 2));
+  BOOST_CHECK_EQUAL(map.size(), nb_values / 2);
+  BOOST_CHECK_EQUAL(std::distance(map.begin(), map.end()), nb_values / 2);
+
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(map.count(i), (i % 2 == 0) ? 1 : 0);
+  }
+
+  map.rehash(0);
+  for (std::int64_t i = 0; i < nb_values; i += 2) {
+    BOOST_CHECK_EQUAL(map.at(i), i * 2);
+  }
+}
+
+static std::size_t nb_overflow_hash_calls = 0;
+
+struct counting_mod_hash {
+  std::size_t operator()(std::int64_t value) const {
+    nb_overflow_hash_calls++;
+    return std::size_t(value % overflow_mod);
+  }
+};
+
+using test_overflow_cached_hash_types = boost::mpl::list<
+    tsl::hopscotch_map<std::int64_t, std::int64_t, counting_mod_hash,
+                       std::equal_to<std::int64_t>,
+                       std::allocator<std::pair<std::int64_t, std::int64_t>>,
+                       6, false>,
+    tsl::hopscotch_map<std::int64_t, std::int64_t, counting_mod_hash,
+                       std::equal_to<std::int64_t>,
+                       std::allocator<std::pair<std::int64_t, std::int64_t>>,
+                       6, true>>;
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_overflow_cached_hash, HMap,
+                              test_overflow_cached_hash_types) {
+  // insert x values with only overflow_mod different hashes, check that
+  // rehash and erase through an iterator don't hash the overflow keys again.
+  const std::int64_t nb_values = 1000;
+  HMap map;
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    map.insert({i, i});
+  }
+
+  const std::size_t nb_overflow = map.overflow_size();
+  BOOST_REQUIRE(nb_overflow > 0);
+
+  nb_overflow_hash_calls = 0;
+  map.rehash(map.bucket_count() * 2);
+  BOOST_CHECK(nb_overflow_hash_calls <= map.size() - nb_overflow);
+  BOOST_CHECK_EQUAL(map.overflow_size(), nb_overflow);
+
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(map.at(i), i);
+  }
+
+  nb_overflow_hash_calls = 0;
+  std::size_t nb_erased = 0;
+  for (auto it = map.begin(); it != map.end();) {
+    it = map.erase(it);
+    nb_erased++;
+  }
+  BOOST_CHECK(map.empty());
+  BOOST_CHECK_EQUAL(nb_erased, std::size_t(nb_values));
+  BOOST_CHECK(nb_overflow_hash_calls <= std::size_t(nb_values) - nb_overflow);
+}
+
+/**
+ * Identity hash declared as avalanching, the map uses it as is.
+ */
+struct avalanching_identity_hash {
+  using is_avalanching = void;
+
+  std::size_t operator()(std::uint64_t value) const {
+    return std::size_t(value);
+  }
+};
+
+using test_hash_mixing_types = boost::mpl::list<
+    tsl::hopscotch_map<std::uint64_t, std::uint64_t,
+                       identity_hash<std::uint64_t>,
+                       std::equal_to<std::uint64_t>,
+                       std::allocator<std::pair<std::uint64_t, std::uint64_t>>,
+                       62, false>,
+    tsl::hopscotch_map<std::uint64_t, std::uint64_t,
+                       identity_hash<std::uint64_t>,
+                       std::equal_to<std::uint64_t>,
+                       std::allocator<std::pair<std::uint64_t, std::uint64_t>>,
+                       30, true>,
+    tsl::bhopscotch_map<std::uint64_t, std::uint64_t,
+                        identity_hash<std::uint64_t>>,
+    tsl::hopscotch_map<std::uint64_t, std::uint64_t,
+                       identity_hash<std::uint64_t>,
+                       std::equal_to<std::uint64_t>,
+                       std::allocator<std::pair<std::uint64_t, std::uint64_t>>,
+                       30, true, tsl::hh::fastrange_growth_policy<>>>;
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_hash_mixing, HMap, test_hash_mixing_types) {
+  // With an identity hash and power_of_two_growth_policy, keys with a stride
+  // of a large power of two would all go to the same bucket, and small keys
+  // would all go to the first bucket with fastrange_growth_policy. The hashes
+  // are mixed, the keys must spread over the buckets without overflow or
+  // premature rehash, with sequential keys too.
+  for (const std::size_t shift : {0, 10, 20, 32}) {
+    const std::uint64_t nb_values = 10000;
+    HMap map;
+    for (std::uint64_t i = 0; i < nb_values; i++) {
+      map.insert({i << shift, i});
+    }
+
+    BOOST_CHECK_EQUAL(map.overflow_size(), 0);
+    BOOST_CHECK_GT(map.load_factor(), 0.3f);
+
+    // The stored hashes are reused on rehash, they must be the mixed ones.
+    map.rehash(map.bucket_count() * 4);
+    map.rehash(0);
+    for (std::uint64_t i = 0; i < nb_values; i++) {
+      const std::uint64_t key = i << shift;
+      BOOST_CHECK_EQUAL(map.at(key), i);
+      BOOST_CHECK(map.find(key, map.hash_function()(key)) != map.end());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_hash_mixing_avalanching_hash) {
+  // A hash declared as avalanching is not mixed, keys differing only in their
+  // high bits all go to the same bucket.
+  tsl::hopscotch_map<std::uint64_t, std::uint64_t, avalanching_identity_hash>
+      map;
+  tsl::hopscotch_map<std::uint64_t, std::uint64_t, identity_hash<std::uint64_t>>
+      mixed_map;
+  for (std::uint64_t i = 0; i < 100; i++) {
+    map.insert({i << 40, i});
+    mixed_map.insert({i << 40, i});
+  }
+
+  BOOST_CHECK_GT(map.overflow_size(), 0);
+  BOOST_CHECK_EQUAL(mixed_map.overflow_size(), 0);
+  BOOST_CHECK_EQUAL(map.at(std::uint64_t(99) << 40), 99);
+}
+
+BOOST_AUTO_TEST_CASE(test_bucket_footprint) {
+  // Size of the buckets with the default neighborhood and with
+  // compact_neighborhood_size for common value types.
+  using tsl::detail_hopscotch_hash::hopscotch_bucket;
+  using tsl::hh::compact_neighborhood_size;
+
+  using string_pair = std::pair<std::string, std::uint64_t>;
+  using pair_32 = std::pair<std::uint32_t, std::uint32_t>;
+  using pair_64 = std::pair<std::uint64_t, std::uint64_t>;
+
+  BOOST_CHECK_EQUAL(compact_neighborhood_size<std::uint8_t>::value, 6);
+  BOOST_CHECK_EQUAL(compact_neighborhood_size<std::uint16_t>::value, 14);
+  BOOST_CHECK_EQUAL(compact_neighborhood_size<std::uint32_t>::value, 30);
+  BOOST_CHECK_EQUAL(compact_neighborhood_size<std::uint64_t>::value, 62);
+  BOOST_CHECK_EQUAL(compact_neighborhood_size<pair_32>::value, 30);
+  BOOST_CHECK_EQUAL(compact_neighborhood_size<string_pair>::value, 54);
+  BOOST_CHECK_EQUAL((compact_neighborhood_size<string_pair, true>::value), 30);
+
+  BOOST_CHECK_EQUAL(sizeof(hopscotch_bucket<std::uint32_t, 62, false>), 16);
+  BOOST_CHECK_EQUAL(sizeof(hopscotch_bucket<std::uint8_t, 6, false>), 2);
+  BOOST_CHECK_EQUAL(sizeof(hopscotch_bucket<std::uint16_t, 14, false>), 4);
+  BOOST_CHECK_EQUAL(sizeof(hopscotch_bucket<std::uint32_t, 30, false>), 8);
+  BOOST_CHECK_EQUAL(sizeof(hopscotch_bucket<std::uint32_t, 30, true>), 12);
+  BOOST_CHECK_EQUAL(sizeof(hopscotch_bucket<std::uint64_t, 62, false>), 16);
+  BOOST_CHECK_EQUAL(sizeof(hopscotch_bucket<pair_32, 30, false>), 12);
+  BOOST_CHECK_EQUAL(sizeof(hopscotch_bucket<pair_64, 62, false>), 24);
+  BOOST_CHECK_EQUAL(sizeof(hopscotch_bucket<string_pair, 54, false>),
+                    sizeof(string_pair) + 8);
+
+  BOOST_CHECK_EQUAL((hopscotch_bucket<string_pair, 54, false>::
+                         NB_HASH_FRAGMENT_BITS),
+                    8);
+  BOOST_CHECK_EQUAL(
+      (hopscotch_bucket<std::uint64_t, 62, false>::NB_HASH_FRAGMENT_BITS), 0);
+  BOOST_CHECK_EQUAL(
+      (hopscotch_bucket<std::uint64_t, 12, true>::NB_HASH_FRAGMENT_BITS), 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_hash_fragment) {
+  // With an 8-bit hash fragment in the bitmap, the lookups of absent keys
+  // only compare a few keys.
+  static std::size_t nb_comparisons;
+  struct counting_equal {
+    bool operator()(const std::string& lhs, const std::string& rhs) const {
+      nb_comparisons++;
+      return lhs == rhs;
+    }
+  };
+
+  tsl::hopscotch_map<std::string, std::int64_t, std::hash<std::string>,
+                     counting_equal,
+                     std::allocator<std::pair<std::string, std::int64_t>>, 22>
+      map;
+  const std::int64_t nb_values = 10000;
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    map.insert({utils::get_key<std::string>(i), i});
+  }
+
+  nb_comparisons = 0;
+  for (std::int64_t i = nb_values; i < 2 * nb_values; i++) {
+    BOOST_CHECK(map.find(utils::get_key<std::string>(i)) == map.end());
+  }
+  BOOST_CHECK_LT(nb_comparisons, std::size_t(nb_values / 10));
+
+  // The fragment follows the values when they are moved.
+  map.rehash(map.bucket_count() * 4);
+  for (std::int64_t i = 0; i < nb_values; i += 2) {
+    map.erase(utils::get_key<std::string>(i));
+  }
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(map.count(utils::get_key<std::string>(i)),
+                      std::size_t(i % 2));
+  }
+}
+
+namespace {
+
+/**
+ * Identity without mixing, each key goes in the bucket of its value.
+ */
+struct identity_avalanching_hash {
+  using is_avalanching = void;
+  std::size_t operator()(int value) const { return std::size_t(value); }
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(test_analyze) {
+  using map_t =
+      tsl::hopscotch_map<int, int, identity_avalanching_hash,
+                         std::equal_to<int>,
+                         std::allocator<std::pair<int, int>>, 6>;
+
+  map_t map;
+  tsl::hh::hopscotch_analysis analysis = map.analyze();
+  BOOST_CHECK_EQUAL(analysis.nb_elements, 0);
+  BOOST_CHECK_EQUAL(analysis.bucket_count, 0);
+  BOOST_CHECK_EQUAL(analysis.neighborhood_occupancy.size(), 7);
+  BOOST_CHECK_EQUAL(analysis.displacement_distribution.size(), 6);
+  BOOST_CHECK_EQUAL(analysis.nb_full_bucket_runs, 0);
+  BOOST_CHECK_EQUAL(analysis.cache_lines_per_unsuccessful_lookup, 0);
+
+  // Keys 0 to 5 in buckets 0 to 5 of 128. 128 needs the bucket 6, out of the
+  // neighborhood of its home bucket 0, key 1 moves there and 128 takes its
+  // bucket. Same for 129, home bucket 1, with key 2 moved to bucket 7. The
+  // keys 10 and 20 are in their home bucket.
+  map.reserve(64);
+  BOOST_REQUIRE_EQUAL(map.bucket_count(), 128);
+  for (int key : {0, 1, 2, 3, 4, 5, 128, 129, 10, 20}) {
+    map.insert({key, key});
+  }
+
+  analysis = map.analyze();
+  BOOST_CHECK_EQUAL(analysis.nb_elements, 10);
+  BOOST_CHECK_EQUAL(analysis.bucket_count, 128);
+  BOOST_CHECK_EQUAL(analysis.neighborhood_occupancy[0], 128 - 8);
+  BOOST_CHECK_EQUAL(analysis.neighborhood_occupancy[1], 6);
+  BOOST_CHECK_EQUAL(analysis.neighborhood_occupancy[2], 2);
+
+  BOOST_CHECK_EQUAL(analysis.displacement_distribution[0], 6);
+  BOOST_CHECK_EQUAL(analysis.displacement_distribution[1], 2);
+  BOOST_CHECK_EQUAL(analysis.displacement_distribution[5], 2);
+  BOOST_CHECK_EQUAL(analysis.max_displacement, 5);
+  BOOST_CHECK_CLOSE(analysis.average_displacement, 12.0 / 10.0, 0.001);
+
+  // Buckets [0, 8), 10 and 20
+  BOOST_CHECK_EQUAL(analysis.nb_full_bucket_runs, 3);
+  BOOST_CHECK_EQUAL(analysis.max_full_bucket_run, 8);
+  BOOST_CHECK_CLOSE(analysis.average_full_bucket_run, 10.0 / 3.0, 0.001);
+
+  BOOST_CHECK_EQUAL(analysis.nb_overflow_home_buckets, 0);
+  BOOST_CHECK_EQUAL(analysis.overflow_size, 0);
+
+  // A bucket of 8 bytes covers at most 2 cache lines, as the 6 buckets of a
+  // neighborhood.
+  BOOST_CHECK_GE(analysis.cache_lines_per_successful_lookup, 1.0);
+  BOOST_CHECK_LE(analysis.cache_lines_per_successful_lookup, 2.0);
+  BOOST_CHECK_GE(analysis.cache_lines_per_unsuccessful_lookup, 1.0);
+  BOOST_CHECK_LE(analysis.cache_lines_per_unsuccessful_lookup, 2.0);
+
+  // 8 keys with the home bucket 0. The buckets 1 to 5 have no neighbor to
+  // move, the last 2 keys go to the overflow list.
+  map.clear();
+  for (int i = 0; i < 8; i++) {
+    map.insert({i * 128, i});
+  }
+  BOOST_REQUIRE_EQUAL(map.bucket_count(), 128);
+
+  analysis = map.analyze();
+  BOOST_CHECK_EQUAL(analysis.neighborhood_occupancy[6], 1);
+  BOOST_CHECK_EQUAL(analysis.nb_overflow_home_buckets, 1);
+  BOOST_CHECK_EQUAL(analysis.overflow_size, 2);
+  BOOST_CHECK_EQUAL(analysis.max_full_bucket_run, 6);
+  BOOST_CHECK_GT(analysis.cache_lines_per_unsuccessful_lookup, 1.0);
+}
+
 BOOST_AUTO_TEST_CASE(test_range_insert) {
   // create a vector<std::pair> of values to insert, insert part of them in the
   // map, check values
@@ -276,6 +646,48 @@ BOOST_AUTO_TEST_CASE(test_range_insert) {
   }
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_bulk_build, HMap, test_types) {
+  // bulk_build x values, some of them twice, in a map already holding some of
+  // the keys, check values
+  using key_t = typename HMap::key_type;
+  using value_t = typename HMap::mapped_type;
+
+  const std::size_t nb_values = 1000;
+  HMap map = utils::get_filled_hash_map<HMap>(100);
+
+  std::vector<std::pair<key_t, value_t>> values;
+  for (std::size_t i = 0; i < nb_values; i++) {
+    values.emplace_back(utils::get_key<key_t>(i), utils::get_value<value_t>(i));
+  }
+  for (std::size_t i = 0; i < nb_values; i += 3) {
+    values.emplace_back(utils::get_key<key_t>(i),
+                        utils::get_value<value_t>(i + 1));
+  }
+
+  map.bulk_build(std::make_move_iterator(values.begin()),
+                 std::make_move_iterator(values.end()));
+  BOOST_CHECK_EQUAL(map.size(), nb_values);
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    auto it = map.find(utils::get_key<key_t>(i));
+
+    BOOST_REQUIRE(it != map.end());
+    BOOST_CHECK_EQUAL(it->second, utils::get_value<value_t>(i));
+  }
+
+  HMap map_unique_keys;
+  std::vector<std::pair<key_t, value_t>> unique_values;
+  for (std::size_t i = 0; i < nb_values; i++) {
+    unique_values.emplace_back(utils::get_key<key_t>(i),
+                               utils::get_value<value_t>(i));
+  }
+
+  map_unique_keys.bulk_build(tsl::hh::unique_keys,
+                             std::make_move_iterator(unique_values.begin()),
+                             std::make_move_iterator(unique_values.end()));
+  BOOST_CHECK(map_unique_keys == map);
+}
+
 BOOST_AUTO_TEST_CASE(test_insert_with_hint) {
   tsl::hopscotch_map<int, int> map{{1, 0}, {2, 1}, {3, 2}};
 
@@ -788,6 +1200,96 @@ BOOST_AUTO_TEST_CASE(test_rehash_empty) {
   BOOST_CHECK_EQUAL(map.at(1), 10);
 }
 
+/**
+ * parallel_rehash
+ */
+using parallel_rehash_test_types = boost::mpl::list<
+    tsl::hopscotch_map<std::int64_t, std::int64_t>,
+    tsl::hopscotch_map<std::string, std::string>,
+    tsl::hopscotch_map<std::int64_t, move_only_test>,
+    // Store hash
+    tsl::hopscotch_map<std::string, std::string, std::hash<std::string>,
+                       std::equal_to<std::string>,
+                       std::allocator<std::pair<std::string, std::string>>, 30,
+                       true>,
+    tsl::bhopscotch_map<std::int64_t, std::int64_t>,
+    tsl::hopscotch_pg_map<std::int64_t, std::int64_t>,
+    tsl::hopscotch_map<std::string, std::string, std::hash<std::string>,
+                       std::equal_to<std::string>,
+                       std::allocator<std::pair<std::string, std::string>>, 62,
+                       false, tsl::hh::mod_growth_policy<>>>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_parallel_rehash, HMap,
+                              parallel_rehash_test_types) {
+  // fill two maps with x values, grow one with rehash and the other with
+  // parallel_rehash, compare. Same with a shrink after erasing half of the
+  // values.
+  using key_t = typename HMap::key_type;
+  using value_t = typename HMap::mapped_type;
+
+  const std::size_t nb_values = 100000;
+  HMap map = utils::get_filled_hash_map<HMap>(nb_values);
+  HMap map_sequential = utils::get_filled_hash_map<HMap>(nb_values);
+
+  map.parallel_rehash(map.bucket_count() * 4, tsl::hh::thread_executor(4));
+  map_sequential.rehash(map_sequential.bucket_count() * 4);
+
+  BOOST_CHECK_EQUAL(map.bucket_count(), map_sequential.bucket_count());
+  BOOST_CHECK_EQUAL(map.size(), nb_values);
+  BOOST_CHECK(map == map_sequential);
+
+  for (std::size_t i = 0; i < nb_values; i += 2) {
+    map.erase(utils::get_key<key_t>(i));
+    map_sequential.erase(utils::get_key<key_t>(i));
+  }
+
+  // Run the tasks sequentially, in reverse order.
+  map.parallel_rehash(0, [](std::size_t nb_tasks, const auto& task) {
+    for (std::size_t itask = nb_tasks; itask-- > 0;) {
+      task(itask);
+    }
+  });
+  map_sequential.rehash(0);
+
+  BOOST_CHECK_EQUAL(map.bucket_count(), map_sequential.bucket_count());
+  BOOST_CHECK_EQUAL(map.size(), nb_values / 2);
+  BOOST_CHECK(map == map_sequential);
+
+  for (std::size_t i = 1; i < nb_values; i += 2) {
+    auto it = map.find(utils::get_key<key_t>(i));
+
+    BOOST_REQUIRE(it != map.end());
+    BOOST_CHECK_EQUAL(it->second, utils::get_value<value_t>(i));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_parallel_rehash_overflow) {
+  // the keys multiple of 1000 all have the same hash and some end in the
+  // overflow list, parallel_reserve and compare with reserve
+  struct overflow_hash {
+    std::size_t operator()(std::int64_t key) const {
+      return (key % 1000 == 0) ? 0 : std::size_t(key);
+    }
+  };
+  using HMap = tsl::hopscotch_map<std::int64_t, std::int64_t, overflow_hash>;
+
+  const std::size_t nb_values = 200000;
+  HMap map = utils::get_filled_hash_map<HMap>(nb_values);
+  BOOST_REQUIRE(map.overflow_size() > 0);
+
+  HMap map_sequential = map;
+  map.parallel_reserve(nb_values * 4, tsl::hh::thread_executor(3));
+  map_sequential.reserve(nb_values * 4);
+
+  BOOST_CHECK_EQUAL(map.bucket_count(), map_sequential.bucket_count());
+  BOOST_CHECK_EQUAL(map.overflow_size(), map_sequential.overflow_size());
+  BOOST_CHECK(map == map_sequential);
+
+  for (std::int64_t i = 0; i < std::int64_t(nb_values); i += 1000) {
+    BOOST_CHECK_EQUAL(map.at(i), utils::get_value<std::int64_t>(i));
+  }
+}
+
 /**
  * operator== and operator!=
  */
@@ -1173,6 +1675,47 @@ BOOST_AUTO_TEST_CASE(test_contains) {
   BOOST_CHECK(!map.contains(-3));
 }
 
+/**
+ * find_batch, contains_batch
+ */
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_find_contains_batch, HMap, test_types) {
+  // insert x values, look up 2x keys in one batch, check against find
+  using key_t = typename HMap::key_type;
+
+  const std::size_t nb_values = 1000;
+  HMap map = utils::get_filled_hash_map<HMap>(nb_values);
+  const HMap& const_map = map;
+
+  std::vector<key_t> keys;
+  for (std::size_t i = 0; i < 2 * nb_values; i++) {
+    keys.push_back(utils::get_key<key_t>(i));
+  }
+
+  std::vector<typename HMap::iterator> its;
+  map.find_batch(keys.begin(), keys.end(), std::back_inserter(its));
+
+  std::vector<typename HMap::const_iterator> const_its(keys.size());
+  BOOST_CHECK(const_map.find_batch(keys.cbegin(), keys.cend(),
+                                   const_its.begin()) == const_its.end());
+
+  std::vector<bool> contained;
+  const_map.contains_batch(keys.cbegin(), keys.cend(),
+                           std::back_inserter(contained));
+
+  BOOST_REQUIRE_EQUAL(its.size(), keys.size());
+  BOOST_REQUIRE_EQUAL(contained.size(), keys.size());
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    BOOST_CHECK(its[i] == map.find(keys[i]));
+    BOOST_CHECK(const_its[i] == const_map.find(keys[i]));
+    BOOST_CHECK_EQUAL(contained[i], i < nb_values);
+  }
+
+  std::vector<bool> empty_batch;
+  map.contains_batch(keys.cbegin(), keys.cbegin(),
+                     std::back_inserter(empty_batch));
+  BOOST_CHECK(empty_batch.empty());
+}
+
 /**
  * equal_range
  */
@@ -1510,6 +2053,263 @@ BOOST_AUTO_TEST_CASE(test_precalculated_hash) {
   BOOST_CHECK_EQUAL(map.erase(4, map.hash_function()(2)), 0);
 }
 
+using precalculated_hash_test_types = boost::mpl::list<
+    tsl::hopscotch_map<std::string, std::string>,
+    tsl::hopscotch_map<
+        std::int64_t, std::int64_t, mod_hash<9>, std::equal_to<std::int64_t>,
+        std::allocator<std::pair<std::int64_t, std::int64_t>>, 6>,
+    tsl::hopscotch_pg_map<std::string, std::int64_t>,
+    tsl::bhopscotch_map<std::int64_t, std::int64_t, mod_hash<9>>>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_precalculated_hash_modifiers, HMap,
+                              precalculated_hash_test_types) {
+  // Insert with the hash through all the modifiers, the elements must then be
+  // found without it.
+  using key_t = typename HMap::key_type;
+  using value_t = typename HMap::mapped_type;
+
+  HMap map;
+  const auto hash = [&](const key_t& key) { return map.hash_function()(key); };
+
+  const std::size_t nb_values = 1000;
+  for (std::size_t i = 0; i < nb_values; i++) {
+    const key_t key = utils::get_key<key_t>(i);
+    std::pair<typename HMap::iterator, bool> it_inserted;
+
+    switch (i % 6) {
+      case 0:
+        it_inserted = map.insert(
+            typename HMap::value_type(key, utils::get_value<value_t>(i)),
+            hash(key));
+        break;
+      case 1:
+        it_inserted = map.insert_or_assign(key, utils::get_value<value_t>(i),
+                                           hash(key));
+        break;
+      case 2:
+        it_inserted = map.try_emplace_with_hash(key, hash(key),
+                                                utils::get_value<value_t>(i));
+        break;
+      case 3:
+        it_inserted = map.emplace_with_hash(hash(key), key,
+                                            utils::get_value<value_t>(i));
+        break;
+      case 4:
+        it_inserted.first = map.emplace_hint_with_hash(
+            map.cend(), hash(key), key, utils::get_value<value_t>(i));
+        it_inserted.second = true;
+        break;
+      default:
+        map.subscript_with_hash(key, hash(key)) =
+            utils::get_value<value_t>(i);
+        it_inserted.first = map.find(key);
+        it_inserted.second = true;
+        break;
+    }
+
+    BOOST_CHECK(it_inserted.second);
+    BOOST_CHECK(it_inserted.first->first == key);
+  }
+
+  BOOST_CHECK_EQUAL(map.size(), nb_values);
+  for (std::size_t i = 0; i < nb_values; i++) {
+    const key_t key = utils::get_key<key_t>(i);
+    auto it = map.find(key);
+    BOOST_REQUIRE(it != map.end());
+    BOOST_CHECK(it->second == utils::get_value<value_t>(i));
+  }
+
+  // Existing keys
+  const key_t key = utils::get_key<key_t>(10);
+  BOOST_CHECK(!map.insert(typename HMap::value_type(
+                                key, utils::get_value<value_t>(20)),
+                          hash(key))
+                   .second);
+  BOOST_CHECK(!map.try_emplace_with_hash(key, hash(key),
+                                         utils::get_value<value_t>(20))
+                   .second);
+  BOOST_CHECK(map.at(key) == utils::get_value<value_t>(10));
+
+  BOOST_CHECK(!map.insert_or_assign(key, utils::get_value<value_t>(20),
+                                    hash(key))
+                   .second);
+  BOOST_CHECK(map.at(key) == utils::get_value<value_t>(20));
+  BOOST_CHECK(map.subscript_with_hash(key, hash(key)) ==
+              utils::get_value<value_t>(20));
+  BOOST_CHECK_EQUAL(map.size(), nb_values);
+}
+
+/**
+ * serialize and deserialize
+ */
+using serialize_test_types = boost::mpl::list<
+    tsl::hopscotch_map<std::int64_t, std::int64_t>,
+    // Test with hash having a lot of collisions, some values in the overflow
+    // list
+    tsl::hopscotch_map<std::string, move_only_test, mod_hash<9>,
+                       std::equal_to<std::string>,
+                       std::allocator<std::pair<std::string, move_only_test>>,
+                       6>,
+    tsl::hopscotch_map<std::int64_t, std::string, std::hash<std::int64_t>,
+                       std::equal_to<std::int64_t>,
+                       std::allocator<std::pair<std::int64_t, std::string>>,
+                       30, true, tsl::hh::prime_growth_policy>,
+    tsl::hopscotch_map<std::string, std::int64_t, std::hash<std::string>,
+                       std::equal_to<std::string>,
+                       std::allocator<std::pair<std::string, std::int64_t>>,
+                       tsl::hh::compact_neighborhood_size<
+                           std::pair<std::string, std::int64_t>>::value>,
+    tsl::bhopscotch_map<
+        std::string, std::string, mod_hash<9>, std::equal_to<std::string>,
+        std::less<std::string>,
+        std::allocator<std::pair<const std::string, std::string>>, 6, true>>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_serialize_deserialize, HMap,
+                              serialize_test_types) {
+  // insert x values; erase some; serialize map; deserialize in new map with
+  // and without hash compatibility; check equal.
+  using key_t = typename HMap::key_type;
+  using value_t = typename HMap::mapped_type;
+
+  const std::size_t nb_values = 1000;
+  HMap map(0);
+  for (std::size_t i = 0; i < nb_values; i++) {
+    map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)});
+  }
+  for (std::size_t i = 0; i < nb_values; i += 3) {
+    map.erase(utils::get_key<key_t>(i));
+  }
+
+  serializer serial;
+  map.serialize(serial);
+
+  deserializer dserial(serial.str());
+  auto map_deserialized = HMap::deserialize(dserial, true);
+  BOOST_CHECK(map == map_deserialized);
+  BOOST_CHECK_EQUAL(map.bucket_count(), map_deserialized.bucket_count());
+  BOOST_CHECK_EQUAL(map.overflow_size(), map_deserialized.overflow_size());
+
+  deserializer dserial2(serial.str());
+  map_deserialized = HMap::deserialize(dserial2, false);
+  BOOST_CHECK(map == map_deserialized);
+
+  // The deserialized map is usable
+  for (std::size_t i = 0; i < nb_values; i++) {
+    map_deserialized.insert(
+        {utils::get_key<key_t>(i), utils::get_value<value_t>(i)});
+  }
+  BOOST_CHECK_EQUAL(map_deserialized.size(), nb_values);
+  for (std::size_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK(map_deserialized.contains(utils::get_key<key_t>(i)));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_serialize_deserialize_empty) {
+  tsl::hopscotch_map<std::string, std::string> map(0);
+
+  serializer serial;
+  map.serialize(serial);
+
+  deserializer dserial(serial.str());
+  auto map_deserialized =
+      tsl::hopscotch_map<std::string, std::string>::deserialize(dserial, true);
+  BOOST_CHECK(map_deserialized.empty());
+  BOOST_CHECK_EQUAL(map_deserialized.bucket_count(), 0);
+
+  map_deserialized["key"] = "value";
+  BOOST_CHECK_EQUAL(map_deserialized.at("key"), "value");
+}
+
+BOOST_AUTO_TEST_CASE(test_deserialize_other_neighborhood_size) {
+  // hash_compatible with a different NeighborhoodSize falls back to inserting
+  // the values one by one
+  auto map = utils::get_filled_hash_map<
+      tsl::hopscotch_map<std::int64_t, std::int64_t>>(1000);
+
+  serializer serial;
+  map.serialize(serial);
+
+  using HMap30 = tsl::hopscotch_map<
+      std::int64_t, std::int64_t, std::hash<std::int64_t>,
+      std::equal_to<std::int64_t>,
+      std::allocator<std::pair<std::int64_t, std::int64_t>>, 30, true>;
+  deserializer dserial(serial.str());
+  const auto map_deserialized = HMap30::deserialize(dserial, true);
+
+  BOOST_CHECK_EQUAL(map_deserialized.size(), map.size());
+  for (const auto& key_value : map) {
+    BOOST_CHECK_EQUAL(map_deserialized.at(key_value.first), key_value.second);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_deserialize_invalid_version) {
+  serializer serial;
+  serial(std::uint64_t(0));
+
+  deserializer dserial(serial.str());
+  TSL_HH_CHECK_THROW(
+      (tsl::hopscotch_map<std::int64_t, std::int64_t>::deserialize(dserial)),
+      std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_deserialize_invalid_header) {
+  using HMap = tsl::hopscotch_map<std::int64_t, std::int64_t>;
+
+  // The protocol version is the first value written.
+  serializer serial_empty;
+  HMap().serialize(serial_empty);
+  deserializer dserial_empty(serial_empty.str());
+  const std::uint64_t version = dserial_empty.operator()<std::uint64_t>();
+
+  // Invalid neighborhood size
+  serializer serial;
+  serial(version);
+  serial(std::uint64_t(1000));
+  serial(std::uint64_t(0));
+  serial(std::uint64_t(std::numeric_limits<std::uint64_t>::max()));
+  serial(std::uint64_t(0));
+  serial(std::uint64_t(0));
+  serial(0.5f);
+
+  deserializer dserial(serial.str());
+  TSL_HH_CHECK_THROW((HMap::deserialize(dserial, true)), std::runtime_error);
+
+  // More overflow elements than elements
+  serializer serial2;
+  serial2(version);
+  serial2(std::uint64_t(62));
+  serial2(std::uint64_t(0));
+  serial2(std::uint64_t(0));
+  serial2(std::uint64_t(1));
+  serial2(std::uint64_t(2));
+  serial2(0.5f);
+
+  deserializer dserial2(serial2.str());
+  TSL_HH_CHECK_THROW((HMap::deserialize(dserial2, true)), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_deserialize_invalid_nb_elements) {
+  // Change the number of elements in the header, the buckets read in place
+  // don't match it anymore.
+  using HMap = tsl::hopscotch_map<std::int64_t, std::int64_t>;
+  HMap map;
+  for (std::int64_t i = 0; i < 100; i++) {
+    map.insert({i, i});
+  }
+  BOOST_REQUIRE_EQUAL(map.overflow_size(), 0);
+
+  serializer serial;
+  map.serialize(serial);
+
+  std::string str = serial.str();
+  const std::uint64_t nb_elements = map.size() + 1;
+  std::memcpy(&str[4 * sizeof(std::uint64_t)], &nb_elements,
+              sizeof(nb_elements));
+
+  deserializer dserial(str);
+  TSL_HH_CHECK_THROW((HMap::deserialize(dserial, true)), std::runtime_error);
+}
+
 #ifndef _MSC_VER
 BOOST_AUTO_TEST_CASE_TEMPLATE(test_noexcept, HSet, test_types) {
   static_assert(std::is_nothrow_default_constructible<HSet>::value, "");
@@ -27,7 +27,10 @@
 #include <boost/mpl/list.hpp>
 #include <boost/test/unit_test.hpp>
 #include <cstdint>
+#include <iterator>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "utils.h"
 
@@ -80,6 +83,57 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert, HSet, test_types) {
   }
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_bulk_build, HSet, test_types) {
+  // bulk_build x values, some of them twice, check values
+  using key_t = typename HSet::key_type;
+
+  const std::size_t nb_values = 1000;
+  std::vector<key_t> keys;
+  for (std::size_t i = 0; i < nb_values; i++) {
+    keys.push_back(utils::get_key<key_t>(i));
+    if (i % 3 == 0) {
+      keys.push_back(utils::get_key<key_t>(i));
+    }
+  }
+
+  HSet set;
+  set.bulk_build(std::make_move_iterator(keys.begin()),
+                 std::make_move_iterator(keys.end()));
+  BOOST_CHECK_EQUAL(set.size(), nb_values);
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(set.count(utils::get_key<key_t>(i)), 1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_find_contains_batch, HSet, test_types) {
+  // insert x values, look up 2x keys in one batch, check against find
+  using key_t = typename HSet::key_type;
+
+  const std::size_t nb_values = 1000;
+  HSet set;
+  std::vector<key_t> keys;
+  for (std::size_t i = 0; i < 2 * nb_values; i++) {
+    if (i < nb_values) {
+      set.insert(utils::get_key<key_t>(i));
+    }
+    keys.push_back(utils::get_key<key_t>(i));
+  }
+
+  std::vector<typename HSet::iterator> its;
+  set.find_batch(keys.cbegin(), keys.cend(), std::back_inserter(its));
+
+  std::vector<bool> contained;
+  set.contains_batch(keys.cbegin(), keys.cend(), std::back_inserter(contained));
+
+  BOOST_REQUIRE_EQUAL(its.size(), keys.size());
+  BOOST_REQUIRE_EQUAL(contained.size(), keys.size());
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    BOOST_CHECK(its[i] == set.find(keys[i]));
+    BOOST_CHECK_EQUAL(contained[i], i < nb_values);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(test_compare) {
   const tsl::hopscotch_set<std::string> set1_1 = {"a", "e", "d", "c", "b"};
   const tsl::hopscotch_set<std::string> set1_2 = {"e", "c", "b", "a", "d"};
@@ -107,6 +161,39 @@ BOOST_AUTO_TEST_CASE(test_compare) {
   BOOST_CHECK(set3_1 != set2_1);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert_precalculated_hash, HSet,
+                              test_types) {
+  using key_t = typename HSet::key_type;
+
+  HSet set;
+  const std::size_t nb_values = 1000;
+  for (std::size_t i = 0; i < nb_values; i++) {
+    const std::size_t hash = set.hash_function()(utils::get_key<key_t>(i));
+    switch (i % 3) {
+      case 0:
+        BOOST_CHECK(set.insert(utils::get_key<key_t>(i), hash).second);
+        break;
+      case 1:
+        BOOST_CHECK(
+            set.emplace_with_hash(hash, utils::get_key<key_t>(i)).second);
+        break;
+      default:
+        BOOST_CHECK(*set.emplace_hint_with_hash(set.cend(), hash,
+                                                utils::get_key<key_t>(i)) ==
+                    utils::get_key<key_t>(i));
+        break;
+    }
+  }
+
+  const std::size_t hash = set.hash_function()(utils::get_key<key_t>(5));
+  BOOST_CHECK(!set.insert(utils::get_key<key_t>(5), hash).second);
+
+  BOOST_CHECK_EQUAL(set.size(), nb_values);
+  for (std::size_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK(set.find(utils::get_key<key_t>(i)) != set.end());
+  }
+}
+
 BOOST_AUTO_TEST_CASE(test_insert_pointer) {
   // Test added mainly to be sure that the code compiles with MSVC
   std::string value;
@@ -163,6 +250,37 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert_transparent_hint, HSet,
   BOOST_CHECK_EQUAL(*otherIt, 2);
 }
 
+using serialize_test_types =
+    boost::mpl::list<tsl::hopscotch_set<std::int64_t, mod_hash<9>>,
+                     tsl::hopscotch_set<move_only_test, mod_hash<9>>,
+                     tsl::bhopscotch_set<std::int64_t>,
+                     tsl::bhopscotch_set<move_only_test, mod_hash<9>>>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_serialize_deserialize, HSet,
+                              serialize_test_types) {
+  // insert x values; serialize set; deserialize in new set with and without
+  // hash compatibility; check equal.
+  using key_t = typename HSet::key_type;
+
+  const std::size_t nb_values = 1000;
+  HSet set(0);
+  for (std::size_t i = 0; i < nb_values; i++) {
+    set.insert(utils::get_key<key_t>(i));
+  }
+
+  serializer serial;
+  set.serialize(serial);
+
+  deserializer dserial(serial.str());
+  auto set_deserialized = HSet::deserialize(dserial, true);
+  BOOST_CHECK(set == set_deserialized);
+  BOOST_CHECK_EQUAL(set.bucket_count(), set_deserialized.bucket_count());
+
+  deserializer dserial2(serial.str());
+  set_deserialized = HSet::deserialize(dserial2, false);
+  BOOST_CHECK(set == set_deserialized);
+}
+
 #ifndef _MSC_VER
 BOOST_AUTO_TEST_CASE_TEMPLATE(test_noexcept, HSet, test_types) {
   static_assert(std::is_nothrow_default_constructible<HSet>::value, "");
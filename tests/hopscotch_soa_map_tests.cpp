@@ -0,0 +1,520 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <tsl/hopscotch_soa_map.h>
+
+#include <boost/mpl/list.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "utils.h"
+
+BOOST_AUTO_TEST_SUITE(test_hopscotch_soa_map)
+
+using test_types = boost::mpl::list<
+    tsl::hopscotch_soa_map<std::string, std::string>,
+    // Test with hash having a lot of collisions
+    tsl::hopscotch_soa_map<
+        std::int64_t, std::int64_t, mod_hash<9>, std::equal_to<std::int64_t>,
+        std::allocator<std::pair<std::int64_t, std::int64_t>>, 6>,
+    tsl::hopscotch_soa_map<
+        std::string, std::string, mod_hash<9>, std::equal_to<std::string>,
+        std::allocator<std::pair<std::string, std::string>>, 6>,
+    tsl::hopscotch_soa_map<
+        move_only_test, move_only_test, mod_hash<9>,
+        std::equal_to<move_only_test>,
+        std::allocator<std::pair<move_only_test, move_only_test>>, 6>,
+    tsl::hopscotch_soa_map<
+        copy_only_test, copy_only_test, mod_hash<9>,
+        std::equal_to<copy_only_test>,
+        std::allocator<std::pair<copy_only_test, copy_only_test>>, 6>,
+    tsl::hopscotch_soa_map<
+        self_reference_member_test, self_reference_member_test, mod_hash<9>,
+        std::equal_to<self_reference_member_test>,
+        std::allocator<std::pair<self_reference_member_test,
+                                 self_reference_member_test>>,
+        6>,
+    // Other growth policies
+    tsl::hopscotch_soa_map<
+        std::int64_t, std::int64_t, std::hash<std::int64_t>,
+        std::equal_to<std::int64_t>,
+        std::allocator<std::pair<std::int64_t, std::int64_t>>, 30,
+        tsl::hh::mod_growth_policy<>>,
+    tsl::hopscotch_soa_map<
+        std::int64_t, std::int64_t, std::hash<std::int64_t>,
+        std::equal_to<std::int64_t>,
+        std::allocator<std::pair<std::int64_t, std::int64_t>>, 62,
+        tsl::hh::prime_growth_policy>,
+    tsl::hopscotch_soa_map<
+        std::int64_t, std::int64_t, std::hash<std::int64_t>,
+        std::equal_to<std::int64_t>,
+        std::allocator<std::pair<std::int64_t, std::int64_t>>, 62,
+        tsl::hh::fastrange_growth_policy<>>>;
+
+/**
+ * insert
+ */
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert, HMap, test_types) {
+  // insert x values, insert them again, check values
+  using key_t = typename HMap::key_type;
+  using value_t = typename HMap::mapped_type;
+
+  const std::size_t nb_values = 1000;
+  HMap map(0);
+  BOOST_CHECK_EQUAL(map.bucket_count(), 0);
+
+  typename HMap::iterator it;
+  bool inserted;
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    std::tie(it, inserted) =
+        map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)});
+
+    BOOST_CHECK_EQUAL(it->first, utils::get_key<key_t>(i));
+    BOOST_CHECK_EQUAL(it->second, utils::get_value<value_t>(i));
+    BOOST_CHECK(inserted);
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values);
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    std::tie(it, inserted) = map.insert(
+        {utils::get_key<key_t>(i), utils::get_value<value_t>(i + 1)});
+
+    BOOST_CHECK_EQUAL(it->first, utils::get_key<key_t>(i));
+    BOOST_CHECK_EQUAL(it->second, utils::get_value<value_t>(i));
+    BOOST_CHECK(!inserted);
+  }
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    it = map.find(utils::get_key<key_t>(i));
+
+    BOOST_CHECK_EQUAL(it->first, utils::get_key<key_t>(i));
+    BOOST_CHECK_EQUAL(it->second, utils::get_value<value_t>(i));
+  }
+
+  BOOST_CHECK_EQUAL(std::distance(map.begin(), map.end()), nb_values);
+}
+
+// Get elements into the overflow list before rehash.
+static const unsigned int overflow_mod = 50;
+using test_overflow_rehash_types = boost::mpl::list<
+    tsl::hopscotch_soa_map<
+        std::int64_t, move_only_test, mod_hash<overflow_mod>,
+        std::equal_to<std::int64_t>,
+        std::allocator<std::pair<std::int64_t, move_only_test>>, 6>,
+    tsl::hopscotch_soa_map<
+        std::int64_t, copy_only_test, mod_hash<overflow_mod>,
+        std::equal_to<std::int64_t>,
+        std::allocator<std::pair<std::int64_t, copy_only_test>>, 6>>;
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert_overflow_rehash, HMap,
+                              test_overflow_rehash_types) {
+  // insert x/mod values, insert x values, check values
+  using value_t = typename HMap::mapped_type;
+
+  HMap map;
+  typename HMap::iterator it;
+  bool inserted;
+
+  const std::size_t nb_values = 5000;
+  for (std::size_t i = 1; i < nb_values; i += overflow_mod) {
+    std::tie(it, inserted) = map.insert({i, value_t(i + 1)});
+
+    BOOST_CHECK_EQUAL(it->first, i);
+    BOOST_CHECK_EQUAL(it->second, value_t(i + 1));
+    BOOST_CHECK(inserted);
+  }
+
+  BOOST_CHECK(map.overflow_size() > 0);
+  BOOST_CHECK_EQUAL(map.size(), nb_values / overflow_mod);
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    std::tie(it, inserted) = map.insert({i, value_t(i + 1)});
+
+    BOOST_CHECK_EQUAL(it->first, i);
+    BOOST_CHECK_EQUAL(it->second, value_t(i + 1));
+    BOOST_CHECK((i % overflow_mod == 1) ? !inserted : inserted);
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values);
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    it = map.find(i);
+
+    BOOST_CHECK_EQUAL(it->first, i);
+    BOOST_CHECK_EQUAL(it->second, value_t(i + 1));
+
+    BOOST_CHECK_EQUAL(map.at(i), value_t(i + 1));
+    BOOST_CHECK_EQUAL(map.count(i), 1);
+  }
+
+  for (std::size_t i = 0; i < nb_values; i += 2) {
+    BOOST_CHECK_EQUAL(map.erase(i), 1);
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values / 2);
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(map.count(i), i % 2);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_emplace_try_emplace_insert_or_assign) {
+  tsl::hopscotch_soa_map<std::int64_t, move_only_test> map;
+  tsl::hopscotch_soa_map<std::int64_t, move_only_test>::iterator it;
+  bool inserted;
+
+  std::tie(it, inserted) =
+      map.emplace(std::piecewise_construct, std::forward_as_tuple(10),
+                  std::forward_as_tuple(1));
+  BOOST_CHECK_EQUAL(it->first, 10);
+  BOOST_CHECK_EQUAL(it->second, move_only_test(1));
+  BOOST_CHECK(inserted);
+
+  std::tie(it, inserted) = map.try_emplace(10, 3);
+  BOOST_CHECK_EQUAL(it->second, move_only_test(1));
+  BOOST_CHECK(!inserted);
+
+  std::tie(it, inserted) = map.try_emplace(11, 3);
+  BOOST_CHECK_EQUAL(it->second, move_only_test(3));
+  BOOST_CHECK(inserted);
+
+  std::tie(it, inserted) = map.insert_or_assign(10, move_only_test(4));
+  BOOST_CHECK_EQUAL(it->second, move_only_test(4));
+  BOOST_CHECK(!inserted);
+
+  it.value() = move_only_test(5);
+  BOOST_CHECK_EQUAL(map.at(10), move_only_test(5));
+
+  std::tie(it, inserted) = map.insert_or_assign(12, move_only_test(6));
+  BOOST_CHECK_EQUAL(map.at(12), move_only_test(6));
+  BOOST_CHECK(inserted);
+  BOOST_CHECK_EQUAL(map.size(), 3);
+}
+
+/**
+ * erase
+ */
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_erase_loop, HMap, test_types) {
+  // insert x values, delete all one by one
+  std::size_t nb_values = 1000;
+
+  HMap map = utils::get_filled_hash_map<HMap>(nb_values);
+  HMap map2 = utils::get_filled_hash_map<HMap>(nb_values);
+
+  auto it = map.begin();
+  // Use second map to check for key after delete as we may not copy the key
+  // with move-only types.
+  auto it2 = map2.begin();
+  while (it != map.end()) {
+    it = map.erase(it);
+    --nb_values;
+
+    BOOST_CHECK_EQUAL(map.count(it2->first), 0);
+    BOOST_CHECK_EQUAL(map.size(), nb_values);
+    ++it2;
+  }
+
+  BOOST_CHECK(map.empty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert_erase_insert, HMap, test_types) {
+  // insert x/2 values, delete x/4 values, insert x/2 values, find each value
+  using key_t = typename HMap::key_type;
+  using value_t = typename HMap::mapped_type;
+
+  const std::size_t nb_values = 2000;
+  HMap map(10);
+
+  for (std::size_t i = 0; i < nb_values / 2; i++) {
+    map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)});
+  }
+
+  for (std::size_t i = 0; i < nb_values / 2; i++) {
+    if (i % 2 == 0) {
+      BOOST_CHECK_EQUAL(map.erase(utils::get_key<key_t>(i)), 1);
+    }
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values / 4);
+
+  for (std::size_t i = nb_values / 2; i < nb_values; i++) {
+    map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)});
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values - nb_values / 4);
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    auto it = map.find(utils::get_key<key_t>(i));
+    if (i % 2 == 0 && i < nb_values / 2) {
+      BOOST_CHECK(it == map.end());
+    } else {
+      BOOST_REQUIRE(it != map.end());
+      BOOST_CHECK_EQUAL(it->first, utils::get_key<key_t>(i));
+      BOOST_CHECK_EQUAL(it->second, utils::get_value<value_t>(i));
+    }
+  }
+}
+
+/**
+ * copy, move, swap
+ */
+BOOST_AUTO_TEST_CASE(test_copy_move_swap) {
+  using HMap = tsl::hopscotch_soa_map<std::string, std::string>;
+  const std::size_t nb_values = 500;
+
+  HMap map = utils::get_filled_hash_map<HMap>(nb_values);
+  HMap map_copy(map);
+  BOOST_CHECK(map == map_copy);
+
+  HMap map_assigned;
+  map_assigned = map_copy;
+  BOOST_CHECK(map == map_assigned);
+
+  HMap map_moved(std::move(map_copy));
+  BOOST_CHECK(map == map_moved);
+  BOOST_CHECK(map_copy.empty());
+  BOOST_CHECK(map_copy.find(utils::get_key<std::string>(1)) ==
+              map_copy.end());
+
+  // Reuse the moved object
+  map_copy.insert({"Key", "Value"});
+  BOOST_CHECK_EQUAL(map_copy.at("Key"), "Value");
+
+  map_copy = std::move(map_moved);
+  BOOST_CHECK(map == map_copy);
+
+  HMap map_empty;
+  swap(map_empty, map_copy);
+  BOOST_CHECK(map_copy.empty());
+  BOOST_CHECK(map == map_empty);
+
+  map_empty.clear();
+  BOOST_CHECK(map_empty.empty());
+  BOOST_CHECK(map_empty.begin() == map_empty.end());
+  BOOST_CHECK(map != map_empty);
+}
+
+/**
+ * lookup
+ */
+BOOST_AUTO_TEST_CASE(test_at_contains_precalculated_hash) {
+  tsl::hopscotch_soa_map<std::int64_t, std::int64_t> map = {{1, 10}, {2, 20}};
+  const auto hash_1 = map.hash_function()(1);
+
+  BOOST_CHECK_EQUAL(map.at(1), 10);
+  BOOST_CHECK_EQUAL(map.at(1, hash_1), 10);
+  TSL_HH_CHECK_THROW(map.at(3), std::out_of_range);
+
+  BOOST_CHECK(map.contains(2));
+  BOOST_CHECK(map.contains(1, hash_1));
+  BOOST_CHECK(!map.contains(3));
+  BOOST_CHECK_EQUAL(map.count(1, hash_1), 1);
+
+  BOOST_CHECK(map.find(1, hash_1) == map.find(1));
+  BOOST_CHECK_EQUAL(map.erase(1, hash_1), 1);
+  BOOST_CHECK(!map.contains(1));
+}
+
+BOOST_AUTO_TEST_CASE(test_heterogeneous_lookups) {
+  tsl::hopscotch_soa_map<heterogeneous_test, std::int64_t,
+                         std::hash<heterogeneous_test>, heterogeneous_test::eq>
+      map;
+  map.insert({heterogeneous_test(1), 10});
+  map.insert({heterogeneous_test(2), 20});
+
+  const int constructed = heterogeneous_test::constructed();
+  const std::size_t hash_1 = map.hash_function()(1);
+  BOOST_CHECK(map.find(1) != map.end());
+  BOOST_CHECK(map.find(1, hash_1) == map.find(1));
+  BOOST_CHECK(map.contains(2));
+  BOOST_CHECK(map.contains(1, hash_1));
+  BOOST_CHECK(!map.contains(3));
+  BOOST_CHECK_EQUAL(map.count(1), 1);
+  BOOST_CHECK_EQUAL(map.count(1, hash_1), 1);
+  BOOST_CHECK_EQUAL(map.count(3), 0);
+
+  auto range = map.equal_range(1);
+  BOOST_CHECK(range.first == map.find(1));
+  BOOST_CHECK_EQUAL(std::distance(range.first, range.second), 1);
+  BOOST_CHECK(map.equal_range(1, hash_1) == range);
+  const auto& const_map = map;
+  BOOST_CHECK_EQUAL(std::distance(const_map.equal_range(3).first,
+                                  const_map.equal_range(3).second),
+                    0);
+
+  BOOST_CHECK_EQUAL(map.erase(2), 1);
+  BOOST_CHECK_EQUAL(map.erase(2), 0);
+  BOOST_CHECK_EQUAL(heterogeneous_test::constructed(), constructed);
+}
+
+BOOST_AUTO_TEST_CASE(test_empty_map) {
+  tsl::hopscotch_soa_map<std::string, int> map(0);
+
+  BOOST_CHECK_EQUAL(map.bucket_count(), 0);
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find("") == map.end());
+  BOOST_CHECK(!map.contains(""));
+  BOOST_CHECK_EQUAL(map.erase(""), 0);
+  TSL_HH_CHECK_THROW(map.at(""), std::out_of_range);
+
+  map[""] = 1;
+  BOOST_CHECK_EQUAL(map.at(""), 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_rehash_reserve) {
+  using HMap = tsl::hopscotch_soa_map<std::int64_t, std::int64_t>;
+  const std::size_t nb_values = 1000;
+
+  HMap map = utils::get_filled_hash_map<HMap>(nb_values);
+  map.rehash(map.bucket_count() * 4);
+  map.reserve(nb_values * 8);
+  BOOST_CHECK(map.bucket_count() >= nb_values * 8);
+  map.rehash(0);
+  BOOST_CHECK(map.load_factor() <= map.max_load_factor());
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(map.at(utils::get_key<std::int64_t>(i)),
+                      utils::get_value<std::int64_t>(i));
+  }
+}
+
+/**
+ * hash fragments
+ */
+struct counting_equal_to {
+  bool operator()(std::int64_t lhs, std::int64_t rhs) const {
+    nb_calls++;
+    return lhs == rhs;
+  }
+
+  static std::size_t nb_calls;
+};
+
+std::size_t counting_equal_to::nb_calls = 0;
+
+using fragment_test_types = boost::mpl::list<
+    tsl::hopscotch_soa_map<
+        std::int64_t, std::int64_t, std::hash<std::int64_t>, counting_equal_to,
+        std::allocator<std::pair<std::int64_t, std::int64_t>>, 62,
+        tsl::hh::power_of_two_growth_policy<2>>,
+    tsl::hopscotch_soa_map<
+        std::int64_t, std::int64_t, std::hash<std::int64_t>, counting_equal_to,
+        std::allocator<std::pair<std::int64_t, std::int64_t>>, 62,
+        tsl::hh::fastrange_growth_policy<>>,
+    tsl::hopscotch_soa_map<
+        std::int64_t, std::int64_t, std::hash<std::int64_t>, counting_equal_to,
+        std::allocator<std::pair<std::int64_t, std::int64_t>>, 62,
+        tsl::hh::prime_growth_policy>>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_hash_fragments_filter, HMap,
+                              fragment_test_types) {
+  // The fragments must come from bits the growth policy doesn't use, the
+  // values sharing a home bucket would otherwise share the same fragment and
+  // each lookup would compare the keys of the whole home bucket.
+  const std::int64_t nb_values = 10000;
+
+  HMap map;
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    map.insert({i, i});
+  }
+
+  counting_equal_to::nb_calls = 0;
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK(map.contains(i));
+  }
+  BOOST_CHECK_LT(counting_equal_to::nb_calls,
+                 std::size_t(nb_values + nb_values / 10));
+
+  counting_equal_to::nb_calls = 0;
+  for (std::int64_t i = nb_values; i < 2 * nb_values; i++) {
+    BOOST_CHECK(!map.contains(i));
+  }
+  BOOST_CHECK_LT(counting_equal_to::nb_calls, std::size_t(nb_values / 10));
+}
+
+/**
+ * All the keys have the same home bucket as long as the table has less than
+ * 2^20 buckets, but different hashes. Declared as avalanching so that the hash
+ * is not mixed.
+ */
+struct shifted_hash {
+  using is_avalanching = void;
+
+  std::size_t operator()(std::int64_t value) const noexcept {
+    return std::size_t(value) << 20;
+  }
+};
+
+BOOST_AUTO_TEST_CASE(test_overflow_lookups) {
+  // The overflow elements are found through their home bucket and only the
+  // ones with the same hash are compared.
+  using HMap = tsl::hopscotch_soa_map<
+      std::int64_t, std::int64_t, shifted_hash, counting_equal_to,
+      std::allocator<std::pair<std::int64_t, std::int64_t>>, 6>;
+  const std::int64_t nb_values = 1000;
+
+  HMap map;
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK(map.insert({i, i * 2}).second);
+  }
+  BOOST_CHECK_GT(map.overflow_size(), std::size_t(nb_values - 10));
+
+  counting_equal_to::nb_calls = 0;
+  for (std::int64_t i = nb_values; i < 2 * nb_values; i++) {
+    BOOST_CHECK(!map.contains(i));
+  }
+  BOOST_CHECK_LE(counting_equal_to::nb_calls, std::size_t(6 * nb_values));
+
+  for (std::int64_t i = 0; i < nb_values; i += 2) {
+    BOOST_CHECK_EQUAL(map.erase(i), 1);
+  }
+  for (auto it = map.begin(); it != map.end();) {
+    it = (it->first % 4 == 1) ? map.erase(it) : std::next(it);
+  }
+
+  BOOST_CHECK_EQUAL(map.size(), std::size_t(nb_values / 4));
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(map.count(i), std::size_t(i % 4 == 3));
+  }
+
+  map.rehash(0);
+  for (std::int64_t i = 3; i < nb_values; i += 4) {
+    BOOST_CHECK_EQUAL(map.at(i), i * 2);
+  }
+}
+
+#ifndef _MSC_VER
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_noexcept, HMap, test_types) {
+  static_assert(std::is_nothrow_default_constructible<HMap>::value, "");
+  static_assert(std::is_nothrow_move_constructible<HMap>::value, "");
+  static_assert(std::is_nothrow_move_assignable<HMap>::value, "");
+  static_assert(std::is_nothrow_swappable<HMap>::value, "");
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
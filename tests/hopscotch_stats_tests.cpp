@@ -0,0 +1,253 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+// The counters are only there with TSL_HH_ENABLE_STATS. The containers below
+// all use hash functions local to this file, the other files of the tests
+// don't instantiate the same types without the counters.
+#define TSL_HH_ENABLE_STATS
+
+#include <tsl/bhopscotch_set.h>
+#include <tsl/hopscotch_map.h>
+#include <tsl/hopscotch_set.h>
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <utility>
+
+namespace {
+
+/**
+ * Identity, declared as avalanching to put the keys in the bucket of their
+ * value without mixing.
+ */
+class stats_identity_hash {
+ public:
+  using is_avalanching = void;
+
+  std::size_t operator()(int value) const {
+    return static_cast<std::size_t>(value);
+  }
+};
+
+class stats_zero_hash {
+ public:
+  using is_avalanching = void;
+
+  std::size_t operator()(int /*value*/) const { return 0; }
+};
+
+template <class Hash>
+using stats_map =
+    tsl::hopscotch_map<int, int, Hash, std::equal_to<int>,
+                       std::allocator<std::pair<int, int>>, 6>;
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(test_hopscotch_stats)
+
+BOOST_AUTO_TEST_CASE(test_stats_empty) {
+  stats_map<stats_identity_hash> map;
+  const tsl::hh::hopscotch_stats stats = map.stats();
+
+  BOOST_CHECK_EQUAL(stats.nb_rehashes, 0);
+  BOOST_CHECK_EQUAL(stats.rehash_duration.count(), 0);
+  BOOST_CHECK_EQUAL(stats.nb_bucket_inserts, 0);
+  BOOST_CHECK_EQUAL(stats.nb_overflow_inserts, 0);
+  BOOST_CHECK_EQUAL(stats.nb_overflow_lookups, 0);
+  BOOST_CHECK_EQUAL(stats.overflow_size, 0);
+  BOOST_CHECK_EQUAL(stats.neighborhood_occupancy.size(), 7);
+  BOOST_CHECK_EQUAL(std::accumulate(stats.neighborhood_occupancy.begin(),
+                                    stats.neighborhood_occupancy.end(),
+                                    std::size_t(0)),
+                    map.bucket_count());
+}
+
+BOOST_AUTO_TEST_CASE(test_stats_inserts_in_home_bucket) {
+  stats_map<stats_identity_hash> map;
+  map.reserve(64);
+  BOOST_REQUIRE_EQUAL(map.bucket_count(), 128);
+
+  for (int i = 0; i < 50; i++) {
+    map.insert({i, i});
+  }
+
+  const tsl::hh::hopscotch_stats stats = map.stats();
+  BOOST_CHECK_EQUAL(stats.nb_rehashes, 1);
+  BOOST_CHECK_EQUAL(stats.nb_bucket_inserts, 50);
+  BOOST_CHECK_EQUAL(stats.nb_displacements, 0);
+  BOOST_CHECK_EQUAL(stats.max_displacements, 0);
+  BOOST_CHECK_EQUAL(stats.nb_empty_bucket_searches, 50);
+  BOOST_CHECK_EQUAL(stats.empty_bucket_distance_sum, 0);
+  BOOST_CHECK_EQUAL(stats.max_empty_bucket_distance, 0);
+  BOOST_CHECK_EQUAL(stats.nb_empty_bucket_not_found, 0);
+  BOOST_CHECK_EQUAL(stats.nb_overflow_inserts, 0);
+
+  BOOST_CHECK_EQUAL(stats.neighborhood_occupancy[0], 128 - 50);
+  BOOST_CHECK_EQUAL(stats.neighborhood_occupancy[1], 50);
+  BOOST_CHECK_EQUAL(stats.neighborhood_occupancy[2], 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_stats_displacement) {
+  // Keys 0 to 5 in buckets 0 to 5. The empty bucket 6 is out of the
+  // neighborhood of 6 buckets of 128, key 1 is moved there and 128 takes its
+  // bucket.
+  stats_map<stats_identity_hash> map;
+  map.reserve(64);
+  BOOST_REQUIRE_EQUAL(map.bucket_count(), 128);
+
+  for (int i = 0; i < 6; i++) {
+    map.insert({i, i});
+  }
+  map.insert({128, 128});
+
+  const tsl::hh::hopscotch_stats stats = map.stats();
+  BOOST_CHECK_EQUAL(stats.nb_bucket_inserts, 7);
+  BOOST_CHECK_EQUAL(stats.nb_displacements, 1);
+  BOOST_CHECK_EQUAL(stats.max_displacements, 1);
+  BOOST_CHECK_EQUAL(stats.nb_empty_bucket_searches, 7);
+  BOOST_CHECK_EQUAL(stats.empty_bucket_distance_sum, 6);
+  BOOST_CHECK_EQUAL(stats.max_empty_bucket_distance, 6);
+  BOOST_CHECK_EQUAL(stats.nb_overflow_inserts, 0);
+
+  BOOST_CHECK_EQUAL(stats.neighborhood_occupancy[0], 128 - 6);
+  BOOST_CHECK_EQUAL(stats.neighborhood_occupancy[1], 5);
+  BOOST_CHECK_EQUAL(stats.neighborhood_occupancy[2], 1);
+
+  for (int key : {0, 1, 2, 3, 4, 5, 128}) {
+    BOOST_CHECK_EQUAL(map.at(key), key);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_stats_overflow) {
+  // All the keys in bucket 0, the neighborhood of 6 buckets is full after 6
+  // keys. The table being almost empty, the next ones go to the overflow list.
+  stats_map<stats_zero_hash> map;
+  map.reserve(64);
+  BOOST_REQUIRE_EQUAL(map.bucket_count(), 128);
+
+  for (int i = 0; i < 8; i++) {
+    map.insert({i, i});
+  }
+
+  tsl::hh::hopscotch_stats stats = map.stats();
+  BOOST_CHECK_EQUAL(stats.nb_rehashes, 1);
+  BOOST_CHECK_EQUAL(stats.nb_bucket_inserts, 6);
+  BOOST_CHECK_EQUAL(stats.nb_overflow_inserts, 2);
+  BOOST_CHECK_EQUAL(stats.overflow_size, 2);
+  BOOST_CHECK_EQUAL(stats.nb_displacements, 0);
+  BOOST_CHECK_EQUAL(stats.nb_empty_bucket_searches, 8);
+  BOOST_CHECK_EQUAL(stats.empty_bucket_distance_sum, 1 + 2 + 3 + 4 + 5 + 12);
+  BOOST_CHECK_EQUAL(stats.max_empty_bucket_distance, 6);
+  BOOST_CHECK_EQUAL(stats.neighborhood_occupancy[6], 1);
+  BOOST_CHECK_EQUAL(stats.neighborhood_occupancy[0], 127);
+
+  map.reset_stats();
+  stats = map.stats();
+  BOOST_CHECK_EQUAL(stats.nb_rehashes, 0);
+  BOOST_CHECK_EQUAL(stats.nb_bucket_inserts, 0);
+  BOOST_CHECK_EQUAL(stats.nb_overflow_inserts, 0);
+  BOOST_CHECK_EQUAL(stats.overflow_size, 2);
+
+  // Found in the neighborhood
+  BOOST_CHECK_EQUAL(map.at(3), 3);
+  BOOST_CHECK_EQUAL(map.stats().nb_overflow_lookups, 0);
+
+  // Found in the overflow list
+  BOOST_CHECK_EQUAL(map.at(7), 7);
+  BOOST_CHECK_EQUAL(map.stats().nb_overflow_lookups, 1);
+
+  // Not found
+  const stats_map<stats_zero_hash>& const_map = map;
+  BOOST_CHECK(const_map.find(100) == const_map.end());
+  BOOST_CHECK_EQUAL(map.stats().nb_overflow_lookups, 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_stats_rehash) {
+  stats_map<stats_identity_hash> map;
+
+  std::size_t nb_rehashes = 0;
+  std::size_t bucket_count = map.bucket_count();
+  for (int i = 0; i < 1000; i++) {
+    map.insert({i, i});
+    if (map.bucket_count() != bucket_count) {
+      bucket_count = map.bucket_count();
+      nb_rehashes++;
+    }
+  }
+
+  map.rehash(map.bucket_count() * 2);
+  nb_rehashes++;
+
+  const tsl::hh::hopscotch_stats stats = map.stats();
+  BOOST_CHECK_EQUAL(stats.nb_rehashes, nb_rehashes);
+  BOOST_CHECK(stats.rehash_duration > std::chrono::nanoseconds(0));
+  // The elements moved by the rehashes are not counted as inserts.
+  BOOST_CHECK_EQUAL(stats.nb_bucket_inserts + stats.nb_overflow_inserts,
+                    1000);
+  BOOST_CHECK_EQUAL(stats.neighborhood_occupancy[0] +
+                        stats.neighborhood_occupancy[1],
+                    map.bucket_count());
+}
+
+BOOST_AUTO_TEST_CASE(test_stats_not_copied) {
+  stats_map<stats_identity_hash> map;
+  for (int i = 0; i < 100; i++) {
+    map.insert({i, i});
+  }
+  const std::uint64_t nb_rehashes = map.stats().nb_rehashes;
+
+  stats_map<stats_identity_hash> map_copy = map;
+  BOOST_CHECK_EQUAL(map_copy.stats().nb_bucket_inserts, 0);
+  BOOST_CHECK_EQUAL(map_copy.stats().nb_rehashes, 0);
+
+  stats_map<stats_identity_hash> map_move = std::move(map_copy);
+  BOOST_CHECK_EQUAL(map_move.stats().nb_bucket_inserts, 0);
+
+  map.swap(map_move);
+  BOOST_CHECK_EQUAL(map.stats().nb_bucket_inserts, 100);
+  BOOST_CHECK_EQUAL(map.stats().nb_rehashes, nb_rehashes);
+  BOOST_CHECK_EQUAL(map_move.stats().nb_bucket_inserts, 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_stats_set) {
+  tsl::hopscotch_set<int, stats_zero_hash> set;
+  tsl::bhopscotch_set<int, stats_zero_hash> bset;
+  for (int i = 0; i < 100; i++) {
+    set.insert(i);
+    bset.insert(i);
+  }
+
+  BOOST_CHECK_EQUAL(
+      set.stats().nb_bucket_inserts + set.stats().nb_overflow_inserts, 100);
+  BOOST_CHECK_EQUAL(set.stats().overflow_size, set.overflow_size());
+  BOOST_CHECK_EQUAL(
+      bset.stats().nb_bucket_inserts + bset.stats().nb_overflow_inserts, 100);
+  BOOST_CHECK_EQUAL(bset.stats().overflow_size, bset.overflow_size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
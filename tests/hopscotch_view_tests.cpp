@@ -0,0 +1,287 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <tsl/hopscotch_map.h>
+#include <tsl/hopscotch_map_view.h>
+#include <tsl/hopscotch_set.h>
+#include <tsl/hopscotch_set_view.h>
+
+#include <boost/mpl/list.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+
+namespace {
+
+/**
+ * Write the flat format of a map or set to a buffer of std::uint64_t to have
+ * an aligned copy.
+ */
+class flat_buffer {
+ public:
+  template <class HMap>
+  explicit flat_buffer(const HMap& map) {
+    std::string bytes;
+    auto writer = [&](const void* data, std::size_t size) {
+      bytes.append(static_cast<const char*>(data), size);
+    };
+    map.flat_serialize(writer);
+
+    m_size = bytes.size();
+    m_buffer.resize((bytes.size() + sizeof(std::uint64_t) - 1) /
+                    sizeof(std::uint64_t));
+    std::memcpy(m_buffer.data(), bytes.data(), bytes.size());
+  }
+
+  const void* data() const { return m_buffer.data(); }
+  std::size_t size() const { return m_size; }
+
+  std::uint64_t* words() { return m_buffer.data(); }
+
+ private:
+  std::vector<std::uint64_t> m_buffer;
+  std::size_t m_size;
+};
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(test_hopscotch_view)
+
+using test_types = boost::mpl::list<
+    std::pair<tsl::hopscotch_map<std::int64_t, std::int64_t>,
+              tsl::hopscotch_map_view<std::int64_t, std::int64_t>>,
+    // Test with hash having a lot of collisions, some values in the overflow
+    // list
+    std::pair<tsl::hopscotch_map<
+                  std::int64_t, std::int64_t, mod_hash<9>,
+                  std::equal_to<std::int64_t>,
+                  std::allocator<std::pair<std::int64_t, std::int64_t>>, 6>,
+              tsl::hopscotch_map_view<std::int64_t, std::int64_t, mod_hash<9>,
+                                      std::equal_to<std::int64_t>, 6>>,
+    std::pair<tsl::hopscotch_map<
+                  std::int64_t, std::int64_t, std::hash<std::int64_t>,
+                  std::equal_to<std::int64_t>,
+                  std::allocator<std::pair<std::int64_t, std::int64_t>>, 30,
+                  true, tsl::hh::prime_growth_policy>,
+              tsl::hopscotch_map_view<std::int64_t, std::int64_t,
+                                      std::hash<std::int64_t>,
+                                      std::equal_to<std::int64_t>, 30, true,
+                                      tsl::hh::prime_growth_policy>>,
+    std::pair<tsl::hopscotch_map<
+                  std::int64_t, std::int64_t, std::hash<std::int64_t>,
+                  std::equal_to<std::int64_t>,
+                  std::allocator<std::pair<std::int64_t, std::int64_t>>, 62,
+                  false, tsl::hh::mod_growth_policy<>>,
+              tsl::hopscotch_map_view<std::int64_t, std::int64_t,
+                                      std::hash<std::int64_t>,
+                                      std::equal_to<std::int64_t>, 62, false,
+                                      tsl::hh::mod_growth_policy<>>>>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_map_view, HMapAndView, test_types) {
+  using HMap = typename HMapAndView::first_type;
+  using HMapView = typename HMapAndView::second_type;
+  using key_t = typename HMap::key_type;
+  using value_t = typename HMap::mapped_type;
+
+  const std::size_t nb_values = 1000;
+  HMap map;
+  for (std::size_t i = 0; i < nb_values; i++) {
+    map.insert({utils::get_key<key_t>(i), utils::get_value<value_t>(i)});
+  }
+  for (std::size_t i = 0; i < nb_values; i += 3) {
+    map.erase(utils::get_key<key_t>(i));
+  }
+
+  const flat_buffer buffer(map);
+  const HMapView view(buffer.data(), buffer.size());
+  BOOST_CHECK_EQUAL(view.size(), map.size());
+  BOOST_CHECK_EQUAL(view.bucket_count(), map.bucket_count());
+
+  for (std::size_t i = 0; i < nb_values + 10; i++) {
+    const key_t key = utils::get_key<key_t>(i);
+    const auto it = map.find(key);
+    const auto* value = view.find(key);
+    if (it == map.end()) {
+      BOOST_CHECK(value == nullptr);
+      BOOST_CHECK(!view.contains(key));
+      TSL_HH_CHECK_THROW(view.at(key), std::out_of_range);
+    } else {
+      BOOST_REQUIRE(value != nullptr);
+      BOOST_CHECK(*value == *it);
+      BOOST_CHECK_EQUAL(view.at(key), it->second);
+      BOOST_CHECK(view.find(key, map.hash_function()(key)) == value);
+    }
+  }
+
+  std::size_t nb_elements = 0;
+  view.for_each([&](const typename HMapView::value_type& key_value) {
+    BOOST_CHECK(map.count(key_value.first) == 1);
+    nb_elements++;
+  });
+  BOOST_CHECK_EQUAL(nb_elements, map.size());
+}
+
+BOOST_AUTO_TEST_CASE(test_map_view_overflow) {
+  // mod_hash<50> with a small neighborhood puts elements in the overflow list
+  using HMap = tsl::hopscotch_map<
+      std::int64_t, std::int64_t, mod_hash<50>, std::equal_to<std::int64_t>,
+      std::allocator<std::pair<std::int64_t, std::int64_t>>, 6>;
+  using HMapView = tsl::hopscotch_map_view<std::int64_t, std::int64_t,
+                                           mod_hash<50>,
+                                           std::equal_to<std::int64_t>, 6>;
+
+  HMap map;
+  for (std::int64_t i = 1; i < 5000; i += 50) {
+    map.insert({i, -i});
+  }
+  BOOST_CHECK(map.overflow_size() > 0);
+
+  const flat_buffer buffer(map);
+  const HMapView view(buffer.data(), buffer.size());
+  for (std::int64_t i = 1; i < 5000; i += 50) {
+    BOOST_CHECK_EQUAL(view.at(i), -i);
+  }
+  BOOST_CHECK(!view.contains(0));
+  BOOST_CHECK(!view.contains(51 * 50));
+}
+
+BOOST_AUTO_TEST_CASE(test_map_view_overflow_store_hash) {
+  // The overflow values are found through their home bucket and full hash
+  // even if the map only keeps a truncated hash.
+  using HMap = tsl::hopscotch_map<
+      std::int64_t, std::int64_t, mod_hash<9>, std::equal_to<std::int64_t>,
+      std::allocator<std::pair<std::int64_t, std::int64_t>>, 6, true>;
+  using HMapView =
+      tsl::hopscotch_map_view<std::int64_t, std::int64_t, mod_hash<9>,
+                              std::equal_to<std::int64_t>, 6, true>;
+
+  HMap map;
+  for (std::int64_t i = 0; i < 2000; i++) {
+    map.insert({i, i * 3});
+  }
+  for (std::int64_t i = 0; i < 2000; i += 3) {
+    map.erase(i);
+  }
+  BOOST_CHECK(map.overflow_size() > 0);
+
+  const flat_buffer buffer(map);
+  const HMapView view(buffer.data(), buffer.size());
+  BOOST_CHECK_EQUAL(view.size(), map.size());
+  for (std::int64_t i = -10; i < 2010; i++) {
+    const bool in_map = (i >= 0 && i < 2000 && i % 3 != 0);
+    BOOST_CHECK_EQUAL(view.contains(i), in_map);
+    if (in_map) {
+      BOOST_CHECK_EQUAL(view.at(i), i * 3);
+    }
+  }
+
+  std::size_t nb_elements = 0;
+  view.for_each([&](const std::pair<std::int64_t, std::int64_t>&) {
+    nb_elements++;
+  });
+  BOOST_CHECK_EQUAL(nb_elements, map.size());
+}
+
+BOOST_AUTO_TEST_CASE(test_empty_map_view) {
+  tsl::hopscotch_map<std::int64_t, std::int64_t> map;
+
+  const flat_buffer buffer(map);
+  const tsl::hopscotch_map_view<std::int64_t, std::int64_t> view(
+      buffer.data(), buffer.size());
+  BOOST_CHECK(view.empty());
+  BOOST_CHECK_EQUAL(view.bucket_count(), 0);
+  BOOST_CHECK(view.find(1) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(test_set_view_mapped_file) {
+  // Write a set to a file and view it through a memory mapping
+  const char* path = "tsl_hopscotch_view_test.bin";
+
+  tsl::hopscotch_set<std::int64_t> set;
+  for (std::int64_t i = 0; i < 10000; i += 2) {
+    set.insert(i);
+  }
+
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    auto writer = [&](const void* data, std::size_t size) {
+      file.write(static_cast<const char*>(data),
+                 static_cast<std::streamsize>(size));
+    };
+    set.flat_serialize(writer);
+  }
+
+  {
+    tsl::hopscotch_set_view<std::int64_t> view(path);
+    BOOST_CHECK_EQUAL(view.size(), set.size());
+    for (std::int64_t i = 0; i < 10000; i++) {
+      BOOST_CHECK_EQUAL(view.count(i), std::size_t(i % 2 == 0));
+    }
+
+    const tsl::hopscotch_set_view<std::int64_t> moved_view(std::move(view));
+    BOOST_CHECK(moved_view.contains(9998));
+  }
+
+  std::remove(path);
+  TSL_HH_CHECK_THROW(tsl::hopscotch_set_view<std::int64_t>{path},
+                    std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_view_invalid_header) {
+  tsl::hopscotch_map<std::int64_t, std::int64_t> map = {{1, 2}, {3, 4}};
+  flat_buffer buffer(map);
+
+  // Different layout
+  TSL_HH_CHECK_THROW((tsl::hopscotch_map_view<std::int64_t, std::int64_t,
+                                             std::hash<std::int64_t>,
+                                             std::equal_to<std::int64_t>, 30>(
+                        buffer.data(), buffer.size())),
+                    std::runtime_error);
+  TSL_HH_CHECK_THROW((tsl::hopscotch_map_view<std::int32_t, std::int64_t>(
+                        buffer.data(), buffer.size())),
+                    std::runtime_error);
+
+  // Truncated
+  TSL_HH_CHECK_THROW((tsl::hopscotch_map_view<std::int64_t, std::int64_t>(
+                        buffer.data(), buffer.size() - 1)),
+                    std::runtime_error);
+
+  // Invalid magic number
+  buffer.words()[0] = 0;
+  TSL_HH_CHECK_THROW((tsl::hopscotch_map_view<std::int64_t, std::int64_t>(
+                        buffer.data(), buffer.size())),
+                    std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
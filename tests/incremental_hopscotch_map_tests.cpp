@@ -0,0 +1,191 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <tsl/incremental_hopscotch_map.h>
+
+#include <boost/mpl/list.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "utils.h"
+
+BOOST_AUTO_TEST_SUITE(test_incremental_hopscotch_map)
+
+using test_types = boost::mpl::list<
+    tsl::incremental_hopscotch_map<std::int64_t, std::int64_t>,
+    tsl::incremental_hopscotch_map<std::string, std::string>,
+    // Test with hash having a lot of collisions
+    tsl::incremental_hopscotch_map<
+        std::int64_t, std::int64_t, mod_hash<9>, std::equal_to<std::int64_t>,
+        std::allocator<std::pair<std::int64_t, std::int64_t>>, 6>,
+    tsl::incremental_hopscotch_map<
+        move_only_test, move_only_test, mod_hash<9>,
+        std::equal_to<move_only_test>,
+        std::allocator<std::pair<move_only_test, move_only_test>>, 6>,
+    tsl::incremental_hopscotch_map<
+        std::int64_t, std::int64_t, std::hash<std::int64_t>,
+        std::equal_to<std::int64_t>,
+        std::allocator<std::pair<std::int64_t, std::int64_t>>, 30, true,
+        tsl::hh::prime_growth_policy, 1>>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert_find_erase, HMap, test_types) {
+  // insert x values, insert them again, erase half of them, check values
+  using key_t = typename HMap::key_type;
+  using value_t = typename HMap::mapped_type;
+
+  const std::size_t nb_values = 5000;
+  HMap map(0);
+  bool has_migrated = false;
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK(map.insert({utils::get_key<key_t>(i),
+                            utils::get_value<value_t>(i)}));
+    has_migrated = has_migrated || map.is_migrating();
+  }
+  BOOST_CHECK(has_migrated);
+  BOOST_CHECK_EQUAL(map.size(), nb_values);
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK(!map.insert({utils::get_key<key_t>(i),
+                             utils::get_value<value_t>(i + 1)}));
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values);
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    const auto* value = map.find(utils::get_key<key_t>(i));
+    BOOST_REQUIRE(value != nullptr);
+    BOOST_CHECK(*value == utils::get_value<value_t>(i));
+  }
+
+  for (std::size_t i = 0; i < nb_values; i += 2) {
+    BOOST_CHECK_EQUAL(map.erase(utils::get_key<key_t>(i)), 1);
+    BOOST_CHECK_EQUAL(map.erase(utils::get_key<key_t>(i)), 0);
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values / 2);
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(map.count(utils::get_key<key_t>(i)), i % 2);
+  }
+
+  std::size_t nb_elements = 0;
+  map.for_each([&](const key_t&, value_t&) { nb_elements++; });
+  BOOST_CHECK_EQUAL(nb_elements, nb_values / 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_operations_during_migration) {
+  // Grow the map and check each operation on keys still in the old buckets
+  // array before the migration completes.
+  using HMap = tsl::incremental_hopscotch_map<
+      std::int64_t, std::int64_t, std::hash<std::int64_t>,
+      std::equal_to<std::int64_t>,
+      std::allocator<std::pair<std::int64_t, std::int64_t>>, 62, false,
+      tsl::hh::power_of_two_growth_policy<2>, 1>;
+  HMap map(1024);
+  const std::size_t bucket_count = map.bucket_count();
+
+  std::int64_t nb_values = 0;
+  while (!map.is_migrating()) {
+    BOOST_CHECK(map.insert({nb_values, nb_values}));
+    nb_values++;
+  }
+  BOOST_CHECK(map.bucket_count() > bucket_count);
+  BOOST_CHECK_EQUAL(map.size(), std::size_t(nb_values));
+
+  // const lookups do not move any element
+  const HMap& cmap = map;
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK_EQUAL(cmap.at(i), i);
+  }
+  BOOST_CHECK(map.is_migrating());
+
+  BOOST_CHECK(!map.insert_or_assign(nb_values - 1, -1));
+  BOOST_CHECK_EQUAL(map.at(nb_values - 1), -1);
+  map[nb_values - 2] = -2;
+  BOOST_CHECK_EQUAL(map.at(nb_values - 2), -2);
+  BOOST_CHECK_EQUAL(map.erase(nb_values - 3), 1);
+  BOOST_CHECK(map.find(nb_values - 3) == nullptr);
+  TSL_HH_CHECK_THROW(map.at(nb_values), std::out_of_range);
+  BOOST_CHECK(map.is_migrating());
+
+  map.complete_migration();
+  BOOST_CHECK(!map.is_migrating());
+  BOOST_CHECK_EQUAL(map.size(), std::size_t(nb_values - 1));
+  BOOST_CHECK_EQUAL(map.at(nb_values - 1), -1);
+  BOOST_CHECK_EQUAL(map.at(nb_values - 2), -2);
+  BOOST_CHECK_EQUAL(map.count(nb_values - 3), 0);
+  for (std::int64_t i = 0; i < nb_values - 3; i++) {
+    BOOST_CHECK_EQUAL(map.at(i), i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_migration_overflow) {
+  // mod_hash<50> with a small neighborhood puts elements in the overflow list
+  tsl::incremental_hopscotch_map<
+      std::int64_t, std::int64_t, mod_hash<50>, std::equal_to<std::int64_t>,
+      std::allocator<std::pair<std::int64_t, std::int64_t>>, 6>
+      map;
+
+  const std::int64_t nb_values = 50000;
+  for (std::int64_t i = 1; i < nb_values; i += 50) {
+    BOOST_CHECK(map.insert_or_assign(i, i));
+  }
+  BOOST_CHECK(map.overflow_size() > 0);
+
+  for (std::int64_t i = 1; i < nb_values; i += 50) {
+    BOOST_CHECK(!map.insert_or_assign(i, i + 1));
+  }
+
+  map.complete_migration();
+  for (std::int64_t i = 1; i < nb_values; i += 50) {
+    BOOST_CHECK_EQUAL(map.at(i), i + 1);
+    BOOST_CHECK_EQUAL(map.erase(i), 1);
+  }
+
+  BOOST_CHECK(map.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_clear) {
+  tsl::incremental_hopscotch_map<std::int64_t, std::int64_t> map;
+  std::int64_t i = 0;
+  while (!map.is_migrating()) {
+    map[i] = i;
+    i++;
+  }
+
+  map.clear();
+  BOOST_CHECK(map.empty());
+  BOOST_CHECK(!map.is_migrating());
+  BOOST_CHECK(!map.contains(0));
+
+  map[1] = 2;
+  BOOST_CHECK_EQUAL(map.size(), 1);
+  BOOST_CHECK_EQUAL(map.at(1), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
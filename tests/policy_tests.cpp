@@ -38,7 +38,9 @@ using test_types =
     boost::mpl::list<tsl::hh::power_of_two_growth_policy<2>,
                      tsl::hh::power_of_two_growth_policy<4>,
                      tsl::hh::prime_growth_policy, tsl::hh::mod_growth_policy<>,
-                     tsl::hh::mod_growth_policy<std::ratio<7, 2>>>;
+                     tsl::hh::mod_growth_policy<std::ratio<7, 2>>,
+                     tsl::hh::fastrange_growth_policy<>,
+                     tsl::hh::fastrange_growth_policy<std::ratio<5, 4>>>;
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(test_policy, Policy, test_types) {
   // Call next_bucket_count() on the policy until we reach its
@@ -94,4 +96,39 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_policy_max_bucket_count, Policy,
   TSL_HH_CHECK_THROW((Policy(bucket_count)), std::length_error);
 }
 
+BOOST_AUTO_TEST_CASE(test_fastrange_policy_bucket_for_hash) {
+  // Any bucket count can be used, the buckets are in [0, bucket_count) and
+  // follow the order of the hashes.
+  for (const std::size_t count :
+       {std::size_t(1), std::size_t(7), std::size_t(1000), std::size_t(12345),
+        std::numeric_limits<std::size_t>::max() / 2}) {
+    std::size_t bucket_count = count;
+    tsl::hh::fastrange_growth_policy<> policy(bucket_count);
+    BOOST_CHECK_EQUAL(bucket_count, count);
+
+    const std::size_t max_hash = std::numeric_limits<std::size_t>::max();
+    BOOST_CHECK_EQUAL(policy.bucket_for_hash(0), 0);
+    BOOST_CHECK_EQUAL(policy.bucket_for_hash(max_hash), count - 1);
+    BOOST_CHECK_EQUAL(policy.bucket_for_hash(max_hash / 2), (count - 1) / 2);
+
+    std::size_t previous_bucket = 0;
+    for (std::size_t i = 0; i <= 1000; i++) {
+      const std::size_t bucket = policy.bucket_for_hash(max_hash / 1000 * i);
+      BOOST_CHECK_LT(bucket, count);
+      BOOST_CHECK_GE(bucket, previous_bucket);
+      previous_bucket = bucket;
+    }
+  }
+
+  // The 1000 hashes h * (max / 1000) are spread evenly over 1000 buckets.
+  std::size_t bucket_count = 1000;
+  tsl::hh::fastrange_growth_policy<> policy(bucket_count);
+  for (std::size_t i = 0; i < 1000; i++) {
+    BOOST_CHECK_EQUAL(policy.bucket_for_hash(
+                          std::numeric_limits<std::size_t>::max() / 1000 * i +
+                          std::numeric_limits<std::size_t>::max() / 2000),
+                      i);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,281 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2017 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <tsl/hopscotch_arena_allocator.h>
+#include <tsl/sharded_hopscotch_map.h>
+
+#include <boost/mpl/list.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+
+BOOST_AUTO_TEST_SUITE(test_sharded_hopscotch_map)
+
+using test_types = boost::mpl::list<
+    tsl::sharded_hopscotch_map<std::int64_t, std::int64_t>,
+    tsl::sharded_hopscotch_map<std::string, std::string, 4>,
+    // Test with hash having a lot of collisions
+    tsl::sharded_hopscotch_map<std::int64_t, std::int64_t, 8, mod_hash<9>,
+                               std::equal_to<std::int64_t>,
+                               std::allocator<std::pair<std::int64_t,
+                                                        std::int64_t>>,
+                               6>,
+    tsl::sharded_hopscotch_map<
+        std::int64_t, std::int64_t, 1, std::hash<std::int64_t>,
+        std::equal_to<std::int64_t>,
+        std::allocator<std::pair<std::int64_t, std::int64_t>>, 30, true,
+        tsl::hh::prime_growth_policy>,
+    tsl::sharded_hopscotch_map<
+        std::int64_t, std::int64_t, 16, std::hash<std::int64_t>,
+        std::equal_to<std::int64_t>,
+        std::allocator<std::pair<std::int64_t, std::int64_t>>, 62, false,
+        tsl::hh::fastrange_growth_policy<>>>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert_find_erase, HMap, test_types) {
+  // insert x values, insert them again, erase half of them, check values
+  using key_t = typename HMap::key_type;
+  using value_t = typename HMap::mapped_type;
+
+  const std::size_t nb_values = 1000;
+  HMap map(0);
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK(map.insert({utils::get_key<key_t>(i),
+                            utils::get_value<value_t>(i)}));
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values);
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    BOOST_CHECK(!map.insert({utils::get_key<key_t>(i),
+                             utils::get_value<value_t>(i + 1)}));
+    if (i % 3 == 0) {
+      BOOST_CHECK(!map.insert_or_assign(utils::get_key<key_t>(i),
+                                        utils::get_value<value_t>(i + 2)));
+    }
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values);
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    value_t value;
+    BOOST_CHECK(map.find(utils::get_key<key_t>(i), value));
+    BOOST_CHECK(value ==
+                utils::get_value<value_t>(i % 3 == 0 ? i + 2 : i));
+  }
+
+  for (std::size_t i = 0; i < nb_values; i += 2) {
+    BOOST_CHECK_EQUAL(map.erase(utils::get_key<key_t>(i)), 1);
+    BOOST_CHECK_EQUAL(map.erase(utils::get_key<key_t>(i)), 0);
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_values / 2);
+
+  std::size_t nb_in_shards = 0;
+  for (std::size_t ishard = 0; ishard < map.shard_count(); ishard++) {
+    nb_in_shards += map.shard(ishard).size();
+  }
+  BOOST_CHECK_EQUAL(nb_in_shards, nb_values / 2);
+
+  for (std::size_t i = 0; i < nb_values; i++) {
+    const key_t key = utils::get_key<key_t>(i);
+    BOOST_CHECK_EQUAL(map.count(key), i % 2);
+    BOOST_CHECK_EQUAL(map.shard(map.shard_for_key(key)).count(key), i % 2);
+  }
+
+  map.clear();
+  BOOST_CHECK(map.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_shards_spread) {
+  // Small integers with an identity hash must still be spread over all the
+  // shards, and each shard over all its buckets.
+  tsl::sharded_hopscotch_map<std::int64_t, std::int64_t, 8> map;
+  for (std::int64_t i = 0; i < 8000; i++) {
+    map.insert({i, i});
+  }
+
+  for (std::size_t ishard = 0; ishard < map.shard_count(); ishard++) {
+    BOOST_CHECK(map.shard(ishard).size() > 500);
+    BOOST_CHECK(map.shard(ishard).load_factor() >
+                map.shard(ishard).max_load_factor() / 4);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_batch) {
+  tsl::sharded_hopscotch_map<std::string, std::int64_t, 4> map;
+
+  std::vector<std::pair<std::string, std::int64_t>> values;
+  for (std::int64_t i = 0; i < 1000; i++) {
+    values.emplace_back(utils::get_key<std::string>(std::size_t(i)), i);
+  }
+
+  BOOST_CHECK_EQUAL(map.insert_batch(std::make_move_iterator(values.begin()),
+                                     std::make_move_iterator(values.end())),
+                    1000);
+  BOOST_CHECK_EQUAL(map.size(), 1000);
+
+  values.clear();
+  for (std::int64_t i = 500; i < 1500; i++) {
+    values.emplace_back(utils::get_key<std::string>(std::size_t(i)), -i);
+  }
+  BOOST_CHECK_EQUAL(map.insert_batch(values.begin(), values.end()), 500);
+  BOOST_CHECK_EQUAL(map.size(), 1500);
+
+  std::vector<std::string> keys;
+  for (std::size_t i = 0; i < 2000; i++) {
+    keys.push_back(utils::get_key<std::string>(i));
+  }
+
+  std::vector<bool> found;
+  map.contains_batch(keys.begin(), keys.end(), std::back_inserter(found));
+  BOOST_REQUIRE_EQUAL(found.size(), keys.size());
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    BOOST_CHECK_EQUAL(found[i], i < 1500);
+
+    std::int64_t value = 0;
+    BOOST_CHECK_EQUAL(map.find(keys[i], value), i < 1500);
+    if (i < 1500) {
+      BOOST_CHECK_EQUAL(value, i < 1000 ? std::int64_t(i) : -std::int64_t(i));
+    }
+  }
+
+  BOOST_CHECK_EQUAL(map.erase_batch(keys.begin() + 1000, keys.end()), 500);
+  BOOST_CHECK_EQUAL(map.size(), 1000);
+  BOOST_CHECK_EQUAL(map.erase_batch(keys.begin(), keys.begin()), 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_owned_shards) {
+  // Each thread owns a shard and inserts the keys of its shard in it without
+  // any lock.
+  using HMap = tsl::sharded_hopscotch_map<std::int64_t, std::int64_t, 4>;
+  HMap map;
+  const std::int64_t nb_values = 20000;
+
+  std::vector<std::thread> threads;
+  for (std::size_t ishard = 0; ishard < map.shard_count(); ishard++) {
+    threads.emplace_back([&, ishard]() {
+      for (std::int64_t i = 0; i < nb_values; i++) {
+        const std::size_t hash = map.hash_function()(i);
+        if (map.shard_for_hash(hash) == ishard) {
+          map.shard(ishard).insert({i, i * 2}, hash);
+        }
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  BOOST_CHECK_EQUAL(map.size(), std::size_t(nb_values));
+  for (std::int64_t i = 0; i < nb_values; i++) {
+    std::int64_t value = 0;
+    BOOST_CHECK(map.find(i, value));
+    BOOST_CHECK_EQUAL(value, i * 2);
+  }
+
+  BOOST_CHECK_EQUAL(map.visit_shard(0, [](HMap::map_type& shard) {
+    return shard.size();
+  }), map.shard(0).size());
+}
+
+BOOST_AUTO_TEST_CASE(test_shards_allocator) {
+  // arena_allocator has no default constructor, the shards must be
+  // constructed with the allocator given to the map.
+  using value_type = std::pair<std::int64_t, std::int64_t>;
+  using HMap = tsl::sharded_hopscotch_map<
+      std::int64_t, std::int64_t, 4, std::hash<std::int64_t>,
+      std::equal_to<std::int64_t>, tsl::hh::arena_allocator<value_type>>;
+
+  tsl::hh::arena arena;
+  HMap map(64, std::hash<std::int64_t>(), std::equal_to<std::int64_t>(),
+           tsl::hh::arena_allocator<value_type>(arena));
+  for (std::size_t ishard = 0; ishard < map.shard_count(); ishard++) {
+    BOOST_CHECK(&map.shard(ishard).get_allocator().get_arena() == &arena);
+    BOOST_CHECK_GE(map.shard(ishard).bucket_count(), 16);
+  }
+
+  for (std::int64_t i = 0; i < 1000; i++) {
+    BOOST_CHECK(map.insert({i, i * 2}));
+  }
+  BOOST_CHECK_GT(arena.heap_size(), 0);
+
+  std::int64_t value = 0;
+  BOOST_CHECK(map.find(10, value));
+  BOOST_CHECK_EQUAL(value, 20);
+}
+
+BOOST_AUTO_TEST_CASE(test_concurrent_writers) {
+  // Writers insert, update and erase their own range of keys, and a batch of
+  // shared keys, at the same time.
+  tsl::sharded_hopscotch_map<std::int64_t, std::int64_t, 8> map;
+  const std::int64_t nb_writers = 4;
+  const std::int64_t nb_values_per_writer = 20000;
+
+  std::vector<std::thread> threads;
+  for (std::int64_t iwriter = 0; iwriter < nb_writers; iwriter++) {
+    threads.emplace_back([&, iwriter]() {
+      const std::int64_t first = iwriter * nb_values_per_writer;
+      for (std::int64_t i = first; i < first + nb_values_per_writer; i++) {
+        map.insert({i, i});
+        if (i % 3 == 0) {
+          map.insert_or_assign(i, i * 2);
+        }
+        if (i % 7 == 0) {
+          map.erase(i);
+        }
+      }
+
+      std::vector<std::pair<std::int64_t, std::int64_t>> shared;
+      for (std::int64_t i = -1000; i < 0; i++) {
+        shared.emplace_back(i, i);
+      }
+      map.insert_batch(shared.begin(), shared.end());
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::size_t nb_expected = 1000;
+  for (std::int64_t i = 0; i < nb_writers * nb_values_per_writer; i++) {
+    std::int64_t value = 0;
+    if (i % 7 == 0) {
+      BOOST_CHECK(!map.find(i, value));
+    } else {
+      nb_expected++;
+      BOOST_CHECK(map.find(i, value));
+      BOOST_CHECK_EQUAL(value, (i % 3 == 0) ? i * 2 : i);
+    }
+  }
+  BOOST_CHECK_EQUAL(map.size(), nb_expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,293 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Thibaut Goetghebuer-Planchon <tessil@gmx.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <tsl/small_hopscotch_map.h>
+
+#include <boost/mpl/list.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+
+namespace {
+
+std::size_t nb_allocations = 0;
+std::size_t max_allocations = std::numeric_limits<std::size_t>::max();
+
+/**
+ * std::allocator counting its allocations in nb_allocations. An allocation
+ * throws std::bad_alloc once nb_allocations reached max_allocations.
+ */
+template <typename T>
+class counting_allocator {
+ public:
+  using value_type = T;
+
+  counting_allocator() = default;
+
+  template <typename U>
+  counting_allocator(const counting_allocator<U>&) {}
+
+  T* allocate(std::size_t n) {
+    if (nb_allocations >= max_allocations) {
+      throw std::bad_alloc();
+    }
+
+    nb_allocations++;
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* p, std::size_t n) { std::allocator<T>().deallocate(p, n); }
+};
+
+template <class T, class U>
+bool operator==(const counting_allocator<T>&, const counting_allocator<U>&) {
+  return true;
+}
+
+template <class T, class U>
+bool operator!=(const counting_allocator<T>&, const counting_allocator<U>&) {
+  return false;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(test_small_hopscotch_map)
+
+using test_types = boost::mpl::list<
+    tsl::small_hopscotch_map<std::int64_t, std::int64_t>,
+    tsl::small_hopscotch_map<std::string, std::string, 4>,
+    tsl::small_hopscotch_map<std::int64_t, std::int64_t, 1>,
+    // Test with hash having a lot of collisions
+    tsl::small_hopscotch_map<
+        move_only_test, move_only_test, 16, mod_hash<9>,
+        std::equal_to<move_only_test>,
+        std::allocator<std::pair<move_only_test, move_only_test>>, 6>>;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_insert_find_erase, HMap, test_types) {
+  // For each size around the inline capacity, insert x values, insert them
+  // again, erase half of them, check values.
+  using key_t = typename HMap::key_type;
+  using value_t = typename HMap::mapped_type;
+
+  for (std::size_t nb_values :
+       {std::size_t(0), HMap::INLINE_CAPACITY - 1, HMap::INLINE_CAPACITY,
+        HMap::INLINE_CAPACITY + 1, std::size_t(1000)}) {
+    HMap map;
+    for (std::size_t i = 0; i < nb_values; i++) {
+      auto it = map.insert(
+          {utils::get_key<key_t>(i), utils::get_value<value_t>(i)});
+      BOOST_CHECK(it.second);
+      BOOST_CHECK(it.first->first == utils::get_key<key_t>(i));
+    }
+    BOOST_CHECK_EQUAL(map.size(), nb_values);
+    BOOST_CHECK_EQUAL(map.is_inline(), nb_values <= HMap::INLINE_CAPACITY);
+    BOOST_CHECK_EQUAL(std::size_t(std::distance(map.begin(), map.end())),
+                      nb_values);
+
+    for (std::size_t i = 0; i < nb_values; i++) {
+      BOOST_CHECK(!map.insert({utils::get_key<key_t>(i),
+                               utils::get_value<value_t>(i + 1)})
+                       .second);
+      BOOST_CHECK(map.at(utils::get_key<key_t>(i)) ==
+                  utils::get_value<value_t>(i));
+    }
+
+    for (std::size_t i = 0; i < nb_values; i += 2) {
+      BOOST_CHECK_EQUAL(map.erase(utils::get_key<key_t>(i)), 1);
+      BOOST_CHECK_EQUAL(map.erase(utils::get_key<key_t>(i)), 0);
+    }
+    BOOST_CHECK_EQUAL(map.size(), nb_values / 2);
+
+    for (std::size_t i = 0; i < nb_values; i++) {
+      auto it = map.find(utils::get_key<key_t>(i));
+      if (i % 2 == 0) {
+        BOOST_CHECK(it == map.end());
+      } else {
+        BOOST_CHECK(it != map.end());
+        BOOST_CHECK(it.value() == utils::get_value<value_t>(i));
+      }
+    }
+    TSL_HH_CHECK_THROW(map.at(utils::get_key<key_t>(nb_values)),
+                       std::out_of_range);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_inline_no_allocation) {
+  // No allocation until the map holds more than its inline capacity.
+  using map_type = tsl::small_hopscotch_map<
+      std::int64_t, std::int64_t, 8, std::hash<std::int64_t>,
+      std::equal_to<std::int64_t>,
+      counting_allocator<std::pair<std::int64_t, std::int64_t>>>;
+
+  nb_allocations = 0;
+  map_type map;
+  for (std::int64_t i = 0; i < 8; i++) {
+    map[i] = i * 2;
+  }
+  map.erase(3);
+  map.insert_or_assign(3, 9);
+  map_type map_copy = map;
+  map_type map_move = std::move(map_copy);
+
+  BOOST_CHECK_EQUAL(nb_allocations, 0);
+  BOOST_CHECK(map.is_inline() && map_move.is_inline());
+  BOOST_CHECK(map == map_move);
+  BOOST_CHECK(map_copy.empty());
+
+  map[8] = 16;
+  BOOST_CHECK(!map.is_inline());
+  BOOST_CHECK_GT(nb_allocations, 0);
+  BOOST_CHECK_EQUAL(map.size(), 9);
+  BOOST_CHECK_EQUAL(map.at(3), 9);
+  BOOST_CHECK_EQUAL(map.at(8), 16);
+  BOOST_CHECK(map != map_move);
+
+  // The map doesn't go back inline once cleared.
+  map.clear();
+  BOOST_CHECK(!map.is_inline());
+  BOOST_CHECK(map.begin() == map.end());
+}
+
+#ifndef TSL_HH_NO_EXCEPTIONS
+BOOST_AUTO_TEST_CASE(test_move_to_map_exception) {
+  // All the keys collide, the switch to the hopscotch_map needs the overflow.
+  // Make each allocation of the insertion fail in turn, the map must keep all
+  // its elements. It stays inline if the switch itself failed.
+  using map_type = tsl::small_hopscotch_map<
+      std::string, std::string, 8, mod_hash<1>, std::equal_to<std::string>,
+      counting_allocator<std::pair<std::string, std::string>>, 4>;
+
+  std::size_t nb_failed_switches = 0;
+  for (std::size_t nb_allowed = 0;; nb_allowed++) {
+    map_type map;
+    for (std::size_t i = 0; i < 8; i++) {
+      map.insert(
+          {utils::get_key<std::string>(i), utils::get_value<std::string>(i)});
+    }
+
+    nb_allocations = 0;
+    max_allocations = nb_allowed;
+    bool thrown = false;
+    try {
+      map.insert(
+          {utils::get_key<std::string>(8), utils::get_value<std::string>(8)});
+    } catch (const std::bad_alloc&) {
+      thrown = true;
+    }
+    max_allocations = std::numeric_limits<std::size_t>::max();
+
+    if (!thrown) {
+      BOOST_CHECK(!map.is_inline());
+      BOOST_CHECK_EQUAL(map.size(), 9);
+      break;
+    }
+
+    if (map.is_inline()) {
+      nb_failed_switches++;
+    }
+    BOOST_REQUIRE_EQUAL(map.size(), 8);
+    for (std::size_t i = 0; i < 8; i++) {
+      BOOST_CHECK_EQUAL(map.at(utils::get_key<std::string>(i)),
+                        utils::get_value<std::string>(i));
+    }
+  }
+  BOOST_CHECK_GT(nb_failed_switches, 1);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(test_erase_iterator) {
+  // An inline erase moves the last element in the hole and returns an
+  // iterator to it.
+  tsl::small_hopscotch_map<std::int64_t, std::string, 4> map = {
+      {1, "one"}, {2, "two"}, {3, "three"}, {4, "four"}};
+
+  auto it = map.erase(map.find(2));
+  BOOST_CHECK_EQUAL(it->first, 4);
+  BOOST_CHECK_EQUAL(it.value(), "four");
+  BOOST_CHECK_EQUAL(map.erase(map.find(4))->first, 3);
+  it = map.erase(map.find(3));
+  BOOST_CHECK(it == map.end());
+  map[3] = "three";
+
+  std::vector<std::int64_t> keys;
+  for (it = map.begin(); it != map.end();) {
+    keys.push_back(it->first);
+    it = map.erase(it);
+  }
+  BOOST_CHECK((keys == std::vector<std::int64_t>{1, 3}));
+  BOOST_CHECK(map.empty());
+
+  for (std::int64_t i = 0; i < 100; i++) {
+    map[i] = std::to_string(i);
+  }
+  for (it = map.begin(); it != map.end();) {
+    it = (it->first % 2 == 0) ? map.erase(it) : std::next(it);
+  }
+  BOOST_CHECK_EQUAL(map.size(), 50);
+}
+
+BOOST_AUTO_TEST_CASE(test_copy_move_swap) {
+  using map_type = tsl::small_hopscotch_map<std::string, std::string, 4>;
+
+  map_type inline_map = {{"a", "1"}, {"b", "2"}};
+  map_type large_map;
+  for (std::size_t i = 0; i < 100; i++) {
+    large_map.insert(
+        {utils::get_key<std::string>(i), utils::get_value<std::string>(i)});
+  }
+
+  const map_type inline_map_copy = inline_map;
+  const map_type large_map_copy = large_map;
+
+  swap(inline_map, large_map);
+  BOOST_CHECK(!inline_map.is_inline() && large_map.is_inline());
+  BOOST_CHECK(inline_map == large_map_copy);
+  BOOST_CHECK(large_map == inline_map_copy);
+
+  inline_map = large_map;
+  BOOST_CHECK(inline_map.is_inline());
+  BOOST_CHECK(inline_map == inline_map_copy);
+
+  large_map = std::move(inline_map);
+  BOOST_CHECK(inline_map.empty() && inline_map.is_inline());
+  BOOST_CHECK(large_map == inline_map_copy);
+
+  inline_map.reserve(3);
+  BOOST_CHECK(inline_map.is_inline());
+  large_map.reserve(10);
+  BOOST_CHECK(!large_map.is_inline());
+  BOOST_CHECK(large_map == inline_map_copy);
+  BOOST_CHECK(!map_type(10).is_inline());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
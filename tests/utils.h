@@ -30,7 +30,9 @@
 #include <functional>
 #include <memory>
 #include <ostream>
+#include <sstream>
 #include <string>
+#include <type_traits>
 #include <utility>
 
 #ifdef TSL_HH_NO_EXCEPTIONS
@@ -257,6 +259,99 @@ template <>
 struct hash<heterogeneous_test> : std::hash<int> {};
 }  // namespace std
 
+/**
+ * Serializer and deserializer for the serialize and deserialize methods,
+ * storing the values in a std::stringstream.
+ */
+class serializer {
+ public:
+  serializer() { m_ostream.exceptions(m_ostream.badbit | m_ostream.failbit); }
+
+  template <class T>
+  void operator()(const T& val) {
+    serialize_impl(val);
+  }
+
+  std::string str() const { return m_ostream.str(); }
+
+ private:
+  template <typename T, typename std::enable_if<
+                            std::is_arithmetic<T>::value>::type* = nullptr>
+  void serialize_impl(const T& val) {
+    m_ostream.write(reinterpret_cast<const char*>(&val), sizeof(T));
+  }
+
+  void serialize_impl(const std::string& val) {
+    serialize_impl(std::uint64_t(val.size()));
+    m_ostream.write(val.data(), static_cast<std::streamsize>(val.size()));
+  }
+
+  void serialize_impl(const move_only_test& val) {
+    serialize_impl(val.value());
+  }
+
+  template <class T, class U>
+  void serialize_impl(const std::pair<T, U>& val) {
+    serialize_impl(val.first);
+    serialize_impl(val.second);
+  }
+
+ private:
+  std::stringstream m_ostream;
+};
+
+class deserializer {
+ public:
+  explicit deserializer(const std::string& init_str = "")
+      : m_istream(init_str) {
+    m_istream.exceptions(m_istream.badbit | m_istream.failbit |
+                         m_istream.eofbit);
+  }
+
+  template <class T>
+  T operator()() {
+    return deserialize_impl(type_tag<T>());
+  }
+
+ private:
+  template <class T>
+  struct type_tag {};
+
+  template <typename T, typename std::enable_if<
+                            std::is_arithmetic<T>::value>::type* = nullptr>
+  T deserialize_impl(type_tag<T>) {
+    T val;
+    m_istream.read(reinterpret_cast<char*>(&val), sizeof(T));
+
+    return val;
+  }
+
+  std::string deserialize_impl(type_tag<std::string>) {
+    const std::uint64_t size = deserialize_impl(type_tag<std::uint64_t>());
+
+    std::string val(std::size_t(size), '\0');
+    m_istream.read(&val[0], static_cast<std::streamsize>(size));
+
+    return val;
+  }
+
+  move_only_test deserialize_impl(type_tag<move_only_test>) {
+    return move_only_test(
+        std::stoll(deserialize_impl(type_tag<std::string>())));
+  }
+
+  template <class T, class U>
+  std::pair<T, U> deserialize_impl(type_tag<std::pair<T, U>>) {
+    // T is const for the std::pair<const Key, T> of a bhopscotch_map
+    typename std::remove_const<T>::type first =
+        deserialize_impl(type_tag<typename std::remove_const<T>::type>());
+    return std::pair<T, U>(std::move(first), deserialize_impl(type_tag<U>()));
+  }
+
+ private:
+  std::stringstream m_istream;
+};
+
 class utils {
  public:
   template <typename T>